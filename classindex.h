@@ -0,0 +1,177 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Maps CLSIDs to the modules which implement them, as per the description
+// attributes of the comClass elements in a manifest, for the exported
+// DllGetClassObject() to forward calls to. Entries are sorted by CLSID, with
+// duplicates in manifest order, so the first one wins. Once built, the index
+// is only ever read, except for the entry points it resolves on first use,
+// which are stored with an interlocked exchange, so lookups take no lock.
+// A static instance starts out empty, as it holds nothing but plain data.
+struct ClassIndex
+{
+	struct Entry
+	{
+		GUID clsid;
+		LPWSTR module;
+		LPFNGETCLASSOBJECT volatile pfn;
+	};
+
+	Entry *entries;
+	UINT count;
+
+	// Collects the entries from the manifest text
+	void Build(const char *p, DWORD cb)
+	{
+		static const char tag[] = "<comClass clsid=\"";
+		static const char attr[] = "\" description=\"";
+		const char *const end = p + cb;
+		// Count the candidates first, so the index can be allocated at once
+		UINT n = 0;
+		for (const char *q = p; (q = MemSearch(q, end - q, tag, sizeof tag - 1)) != NULL; q += sizeof tag - 1)
+			++n;
+		if (n == 0 || (entries = static_cast<Entry *>(HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, n * sizeof *entries))) == NULL)
+			return;
+		count = 0;
+		for (const char *q = p; (q = MemSearch(q, end - q, tag, sizeof tag - 1)) != NULL; )
+		{
+			q += sizeof tag - 1;
+			if (static_cast<size_t>(end - q) < 38 + sizeof attr - 1)
+				break;
+			WCHAR text[39];
+			for (int i = 0; i < 38; ++i)
+				text[i] = static_cast<BYTE>(q[i]);
+			text[38] = L'\0';
+			Entry entry;
+			if (!ParseGuid(text, entry.clsid))
+				continue;
+			q += 38;
+			if (MemSearch(q, sizeof attr - 1, attr, sizeof attr - 1) == NULL)
+				continue;
+			q += sizeof attr - 1;
+			const char *const e = MemSearch(q, end - q, "\"", 1);
+			if (e == NULL)
+				break;
+			const int len = MultiByteToWideChar(CP_UTF8, 0, q, static_cast<int>(e - q), NULL, 0);
+			if ((entry.module = static_cast<LPWSTR>(HeapAlloc(GetProcessHeap(), 0, (len + 1) * sizeof(WCHAR)))) == NULL)
+				break;
+			entry.module[MultiByteToWideChar(CP_UTF8, 0, q, static_cast<int>(e - q), entry.module, len)] = L'\0';
+			entry.pfn = NULL;
+			entries[count++] = entry;
+			q = e;
+		}
+		entries = Sort(entries, count);
+	}
+
+	void Free()
+	{
+		for (UINT i = 0; i < count; ++i)
+			HeapFree(GetProcessHeap(), 0, entries[i].module);
+		if (entries != NULL)
+			HeapFree(GetProcessHeap(), 0, entries);
+		entries = NULL;
+		count = 0;
+	}
+
+	// Returns the first entry for the CLSID, or NULL if there is none
+	Entry *Find(REFCLSID rclsid) const
+	{
+		UINT lower = 0;
+		UINT upper = count;
+		while (lower < upper)
+		{
+			const UINT i = (lower + upper) / 2;
+			if (Compare(entries[i].clsid, rclsid) < 0)
+				lower = i + 1;
+			else
+				upper = i;
+		}
+		return lower < count && Compare(entries[lower].clsid, rclsid) == 0 ? entries + lower : NULL;
+	}
+
+	// Forwards the call to the module which implements the class, provided
+	// it has been loaded. The module gets pinned once found, as the class
+	// object goes to COM as one of our own, so COM never asks the module
+	// whether it can unload, and would otherwise be left with a dangling
+	// object once the module which brought it in lets go of it. This is also
+	// what allows the entry point to be remembered for good.
+	HRESULT GetClassObject(REFCLSID rclsid, REFIID riid, LPVOID *ppv) const
+	{
+		Entry *const entry = Find(rclsid);
+		if (entry == NULL)
+			return CLASS_E_CLASSNOTAVAILABLE;
+		LPFNGETCLASSOBJECT pfn = entry->pfn;
+		if (pfn == NULL)
+		{
+			HMODULE module;
+			if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_PIN, entry->module, &module))
+				return HRESULT_FROM_WIN32(ERROR_MOD_NOT_FOUND);
+			if ((pfn = reinterpret_cast<LPFNGETCLASSOBJECT>(GetProcAddress(module, "DllGetClassObject"))) == NULL)
+				return HRESULT_FROM_WIN32(ERROR_PROC_NOT_FOUND);
+			InterlockedExchangePointer(reinterpret_cast<PVOID volatile *>(&entry->pfn), reinterpret_cast<PVOID>(pfn));
+		}
+		return pfn(rclsid, riid, ppv);
+	}
+
+	static int Compare(const GUID &a, const GUID &b)
+	{
+		const DWORD *const p = reinterpret_cast<const DWORD *>(&a);
+		const DWORD *const q = reinterpret_cast<const DWORD *>(&b);
+		for (int i = 0; i < 4; ++i)
+		{
+			if (p[i] != q[i])
+				return p[i] < q[i] ? -1 : 1;
+		}
+		return 0;
+	}
+
+	// Sorts the entries by CLSID through a bottom-up merge sort, which is
+	// stable, so equal CLSIDs stay in manifest order. Returns the buffer which
+	// ends up holding the result, and frees the other one.
+	static Entry *Sort(Entry *entries, UINT n)
+	{
+		Entry *const other = n > 1 ? static_cast<Entry *>(HeapAlloc(GetProcessHeap(), 0, n * sizeof *other)) : NULL;
+		if (other == NULL)
+			return entries;
+		Entry *src = entries;
+		Entry *dst = other;
+		for (UINT width = 1; width < n; width *= 2)
+		{
+			for (UINT lower = 0; lower < n; lower += 2 * width)
+			{
+				const UINT middle = n - lower > width ? lower + width : n;
+				const UINT upper = n - middle > width ? middle + width : n;
+				UINT i = lower;
+				UINT j = middle;
+				for (UINT k = lower; k < upper; ++k)
+					dst[k] = i < middle && (j == upper || Compare(src[j].clsid, src[i].clsid) >= 0) ? src[i++] : src[j++];
+			}
+			Entry *const swap = src;
+			src = dst;
+			dst = swap;
+		}
+		HeapFree(GetProcessHeap(), 0, dst);
+		return src;
+	}
+};
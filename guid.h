@@ -0,0 +1,171 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Parses and formats GUIDs in registry format, i.e.
+// {XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}, with the hex digits dealt with
+// 16 at a time where SSE2 is available.
+
+#include <emmintrin.h>
+
+// Text positions of the digit pairs which make up the bytes of a GUID, in
+// memory order, so Data1, Data2, and Data3 come out little-endian
+inline const BYTE *GuidDigitPositions()
+{
+	static const BYTE positions[16] = { 7, 5, 3, 1, 12, 10, 17, 15, 20, 22, 25, 27, 29, 31, 33, 35 };
+	return positions;
+}
+
+// Converts hex digits to their values, and tells which bytes are hex digits
+inline __m128i GuidNibbles(__m128i c, __m128i &valid)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+	const __m128i alpha = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+	const __m128i isdigit = _mm_cmpeq_epi8(_mm_subs_epu8(digit, _mm_set1_epi8(9)), zero);
+	const __m128i isalpha = _mm_cmpeq_epi8(_mm_subs_epu8(alpha, _mm_set1_epi8(5)), zero);
+	valid = _mm_or_si128(isdigit, isalpha);
+	return _mm_or_si128(_mm_and_si128(isdigit, digit),
+		_mm_andnot_si128(isdigit, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+}
+
+// Reads positions 1 through 36 in five overlapping loads, none of which goes
+// past the closing brace. Narrowing saturates as for signed words, so
+// characters from U+0100 through U+7FFF become 0xFF, and those from U+8000 up
+// become 0x00. Neither is a hex digit.
+inline bool ParseGuidDigitsSse2(LPCWSTR s, BYTE nibbles[40])
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i a = _mm_packus_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 1)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 9)));
+	const __m128i b = _mm_packus_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 17)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 25)));
+	const __m128i c = _mm_packus_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 29)), zero);
+	__m128i va, vb, vc;
+	const __m128i na = GuidNibbles(a, va);
+	const __m128i nb = GuidNibbles(b, vb);
+	const __m128i nc = GuidNibbles(c, vc);
+	// Dashes are at positions 9 and 14 in the first vector, and at positions
+	// 19 and 24 in the second one, and have been checked for already
+	const int ma = _mm_movemask_epi8(va) | 1 << (9 - 1) | 1 << (14 - 1);
+	const int mb = _mm_movemask_epi8(vb) | 1 << (19 - 17) | 1 << (24 - 17);
+	const int mc = _mm_movemask_epi8(vc) | 0xFF00;
+	if ((ma & mb & mc) != 0xFFFF)
+		return false;
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(nibbles + 1), na);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(nibbles + 17), nb);
+	_mm_storel_epi64(reinterpret_cast<__m128i *>(nibbles + 29), nc);
+	return true;
+}
+
+inline bool ParseGuid(LPCWSTR s, GUID &guid)
+{
+	if (s[0] != L'{')
+		return false;
+	// Check the frame first, which also keeps the reads below within bounds
+	int n = 1;
+	while (n <= 38 && s[n] != L'\0')
+		++n;
+	if (n != 38 || s[37] != L'}' || s[9] != L'-' || s[14] != L'-' || s[19] != L'-' || s[24] != L'-')
+		return false;
+	BYTE nibbles[40]; // indexed by text position
+	if (IsSse2Present())
+	{
+		if (!ParseGuidDigitsSse2(s, nibbles))
+			return false;
+	}
+	else for (int i = 1; i < 37; ++i)
+	{
+		const WCHAR c = s[i];
+		if (c >= L'0' && c <= L'9')
+			nibbles[i] = static_cast<BYTE>(c - L'0');
+		else if ((c | 0x20) >= L'a' && (c | 0x20) <= L'f')
+			nibbles[i] = static_cast<BYTE>((c | 0x20) - L'a' + 10);
+		else if (c != L'-' || (i != 9 && i != 14 && i != 19 && i != 24))
+			return false;
+	}
+	BYTE *const p = reinterpret_cast<BYTE *>(&guid);
+	const BYTE *const positions = GuidDigitPositions();
+	for (int i = 0; i < 16; ++i)
+		p[i] = static_cast<BYTE>(nibbles[positions[i]] << 4 | nibbles[positions[i] + 1]);
+	return true;
+}
+
+inline void StoreGuidDigits(char *d, __m128i lo, __m128i hi)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(d), lo);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(d + 16), hi);
+}
+
+inline void StoreGuidDigits(WCHAR *d, __m128i lo, __m128i hi)
+{
+	const __m128i zero = _mm_setzero_si128();
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(d), _mm_unpacklo_epi8(lo, zero));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(d + 8), _mm_unpackhi_epi8(lo, zero));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(d + 16), _mm_unpacklo_epi8(hi, zero));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(d + 24), _mm_unpackhi_epi8(hi, zero));
+}
+
+// Writes the 38 characters of a GUID in upper case, plus a terminating zero
+template<class T>
+void FormatGuid(const GUID &guid, T *s)
+{
+	const BYTE *const p = reinterpret_cast<const BYTE *>(&guid);
+	s[0] = '{';
+	s[9] = s[14] = s[19] = s[24] = '-';
+	s[37] = '}';
+	s[38] = '\0';
+	if (IsSse2Present())
+	{
+		// Bring the bytes into text order by swapping those of Data1, Data2,
+		// and Data3, then spread their nibbles out into hex digits
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+		const __m128i swapped = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		const __m128i t = _mm_shufflelo_epi16(_mm_unpacklo_epi64(swapped, _mm_srli_si128(v, 8)), _MM_SHUFFLE(3, 2, 0, 1));
+		const __m128i mask = _mm_set1_epi8(0x0F);
+		const __m128i hi = _mm_and_si128(_mm_srli_epi16(t, 4), mask);
+		const __m128i lo = _mm_and_si128(t, mask);
+		__m128i d0 = _mm_unpacklo_epi8(hi, lo);
+		__m128i d1 = _mm_unpackhi_epi8(hi, lo);
+		const __m128i nine = _mm_set1_epi8(9);
+		const __m128i zero = _mm_set1_epi8('0');
+		const __m128i seven = _mm_set1_epi8('A' - '0' - 10);
+		d0 = _mm_add_epi8(_mm_add_epi8(d0, zero), _mm_and_si128(_mm_cmpgt_epi8(d0, nine), seven));
+		d1 = _mm_add_epi8(_mm_add_epi8(d1, zero), _mm_and_si128(_mm_cmpgt_epi8(d1, nine), seven));
+		T d[32];
+		StoreGuidDigits(d, d0, d1);
+		MemCopy(s + 1, d, 8);
+		MemCopy(s + 10, d + 8, 4);
+		MemCopy(s + 15, d + 12, 4);
+		MemCopy(s + 20, d + 16, 4);
+		MemCopy(s + 25, d + 20, 12);
+	}
+	else
+	{
+		static const char hex[] = "0123456789ABCDEF";
+		const BYTE *const positions = GuidDigitPositions();
+		for (int i = 0; i < 16; ++i)
+		{
+			s[positions[i]] = hex[p[i] >> 4];
+			s[positions[i] + 1] = hex[p[i] & 0x0F];
+		}
+	}
+}
@@ -0,0 +1,201 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Hex encoding and decoding for REG_BINARY values in .rgs scripts, and
+// decoding of the comma separated bytes which represent hex values in .reg
+// files
+
+inline int HexDigitValue(WCHAR c)
+{
+	if (c >= L'0' && c <= L'9')
+		return c - L'0';
+	c |= 0x20;
+	if (c >= L'a' && c <= L'f')
+		return c - L'a' + 10;
+	return -1;
+}
+
+inline bool IsHexBlank(WCHAR c)
+{
+	return c == L' ' || c == L'\t' || c == L'\r' || c == L'\n';
+}
+
+// Encodes cb bytes as 2 * cb uppercase hex digits, 16 bytes at a time
+inline void HexEncode(const BYTE *p, DWORD cb, char *q)
+{
+	static const char digits[] = "0123456789ABCDEF";
+	if (IsSse2Present())
+	{
+		const __m128i mask = _mm_set1_epi8(0x0F);
+		const __m128i nine = _mm_set1_epi8(9);
+		const __m128i zero = _mm_set1_epi8('0');
+		const __m128i gap = _mm_set1_epi8('A' - '9' - 1);
+		for (; cb >= 16; cb -= 16, p += 16, q += 32)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+			__m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+			__m128i lo = _mm_and_si128(v, mask);
+			hi = _mm_add_epi8(_mm_add_epi8(hi, zero), _mm_and_si128(_mm_cmpgt_epi8(hi, nine), gap));
+			lo = _mm_add_epi8(_mm_add_epi8(lo, zero), _mm_and_si128(_mm_cmpgt_epi8(lo, nine), gap));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(q), _mm_unpacklo_epi8(hi, lo));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(q + 16), _mm_unpackhi_epi8(hi, lo));
+		}
+	}
+	for (; cb != 0; --cb, ++p, q += 2)
+	{
+		q[0] = digits[*p >> 4];
+		q[1] = digits[*p & 0x0F];
+	}
+}
+
+// Decodes 16 bytes from 48 characters if they read "XX,XX,...,XX," exactly.
+// The characters are narrowed with saturation, and checked against the digit
+// and comma positions, which repeat every three characters. The digits are
+// then converted to their values all at once, and paired up one by one.
+inline bool HexDecode16(LPCWSTR p, BYTE *q)
+{
+	static const int commas[3] = { 0x4924, 0x2492, 0x9249 };
+	const __m128i *const v = reinterpret_cast<const __m128i *>(p);
+	const __m128i comma = _mm_set1_epi8(',');
+	const __m128i case20 = _mm_set1_epi8(0x20);
+	__m128i c[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		c[i] = _mm_packus_epi16(_mm_loadu_si128(v + 2 * i), _mm_loadu_si128(v + 2 * i + 1));
+		const __m128i lower = _mm_or_si128(c[i], case20);
+		const __m128i digit = _mm_and_si128(
+			_mm_cmpgt_epi8(c[i], _mm_set1_epi8('0' - 1)),
+			_mm_cmplt_epi8(c[i], _mm_set1_epi8('9' + 1)));
+		const __m128i letter = _mm_and_si128(
+			_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+			_mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(c[i], comma)) != commas[i] ||
+			_mm_movemask_epi8(_mm_or_si128(digit, letter)) != (~commas[i] & 0xFFFF))
+		{
+			return false;
+		}
+		// Digits are unaffected by the case bit, and letters are off by 39
+		c[i] = _mm_sub_epi8(_mm_sub_epi8(lower, _mm_set1_epi8('0')), _mm_and_si128(letter, _mm_set1_epi8('a' - '0' - 10)));
+	}
+	BYTE nibbles[48];
+	for (int i = 0; i < 3; ++i)
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(nibbles + 16 * i), c[i]);
+	for (int i = 0; i < 16; ++i)
+		q[i] = static_cast<BYTE>(nibbles[3 * i] << 4 | nibbles[3 * i + 1]);
+	return true;
+}
+
+// Decodes the comma separated hex bytes of a .reg file value, which may span
+// continuation lines once they are joined. Returns the count of bytes, or -1
+// if the text doesn't parse. The bytes may overwrite the text as they go, as
+// long as they start no later than it does, since they never catch up with it.
+inline int HexDecode(LPCWSTR p, BYTE *q)
+{
+	BYTE *const base = q;
+	LPCWSTR const end = p + lstrlenW(p);
+	const bool sse2 = IsSse2Present();
+	for (;;)
+	{
+		while (sse2 && end - p >= 48 && HexDecode16(p, q))
+		{
+			p += 48;
+			q += 16;
+		}
+		while (IsHexBlank(*p))
+			++p;
+		if (*p == L'\0')
+			break;
+		int value = HexDigitValue(*p++);
+		if (value < 0)
+			return -1;
+		const int digit = HexDigitValue(*p);
+		if (digit >= 0)
+		{
+			value = value << 4 | digit;
+			++p;
+		}
+		*q++ = static_cast<BYTE>(value);
+		while (IsHexBlank(*p))
+			++p;
+		if (*p == L',')
+			++p;
+		else if (*p != L'\0')
+			return -1;
+	}
+	return static_cast<int>(q - base);
+}
+
+// Decodes 16 bytes from 32 characters if they are all hex digits. The pairs
+// of digits are put together in 16-bit lanes, high nibble first.
+inline bool HexDecodeRun16(LPCWSTR p, BYTE *q)
+{
+	const __m128i *const v = reinterpret_cast<const __m128i *>(p);
+	const __m128i case20 = _mm_set1_epi8(0x20);
+	__m128i c[2];
+	for (int i = 0; i < 2; ++i)
+	{
+		c[i] = _mm_packus_epi16(_mm_loadu_si128(v + 2 * i), _mm_loadu_si128(v + 2 * i + 1));
+		const __m128i lower = _mm_or_si128(c[i], case20);
+		const __m128i digit = _mm_and_si128(
+			_mm_cmpgt_epi8(c[i], _mm_set1_epi8('0' - 1)),
+			_mm_cmplt_epi8(c[i], _mm_set1_epi8('9' + 1)));
+		const __m128i letter = _mm_and_si128(
+			_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+			_mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+		if (_mm_movemask_epi8(_mm_or_si128(digit, letter)) != 0xFFFF)
+			return false;
+		const __m128i nibbles = _mm_sub_epi8(_mm_sub_epi8(lower, _mm_set1_epi8('0')), _mm_and_si128(letter, _mm_set1_epi8('a' - '0' - 10)));
+		c[i] = _mm_or_si128(
+			_mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00FF)), 4),
+			_mm_srli_epi16(nibbles, 8));
+	}
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(q), _mm_packus_epi16(c[0], c[1]));
+	return true;
+}
+
+// Decodes a run of hex digits as HexEncode() writes them. Returns the count
+// of bytes, or -1 if the text doesn't parse. The bytes may overwrite the text
+// as they go, same as with HexDecode().
+inline int HexDecodeRun(LPCWSTR p, BYTE *q)
+{
+	BYTE *const base = q;
+	LPCWSTR const end = p + lstrlenW(p);
+	if (IsSse2Present())
+	{
+		while (end - p >= 32 && HexDecodeRun16(p, q))
+		{
+			p += 32;
+			q += 16;
+		}
+	}
+	for (; *p != L'\0'; p += 2)
+	{
+		const int hi = HexDigitValue(p[0]);
+		const int lo = hi >= 0 ? HexDigitValue(p[1]) : -1;
+		if (lo < 0)
+			return -1;
+		*q++ = static_cast<BYTE>(hi << 4 | lo);
+	}
+	return static_cast<int>(q - base);
+}
@@ -0,0 +1,597 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <shlwapi.h>
+#include "hive.h"
+#include "miscutil.h"
+
+static const SIZE_T ArenaChunk = 0x10000;
+
+Hive::Hive()
+: heap(HeapCreate(HEAP_NO_SERIALIZE, 0, 0))
+, arena(NULL), cbArena(0), atoms(NULL), nAtoms(0), mask(0)
+, scratch(NULL), cbScratch(0)
+, journal(NULL), nJournal(0), stamp(1), selection(NULL)
+{
+	SecureZeroMemory(&root, sizeof root);
+	root.name = L"";
+}
+
+Hive::~Hive()
+{
+	Unwatch(&root);
+	if (heap != NULL)
+		HeapDestroy(heap);
+}
+
+// Registry names compare as ordinal strings with case ignored
+int Hive::Compare(LPCWSTR p, LPCWSTR q, int len)
+{
+	return CompareStringOrdinal(p, -1, q, len, TRUE) - CSTR_EQUAL;
+}
+
+void *Hive::Alloc(SIZE_T cb)
+{
+	cb = (cb + 7) & ~static_cast<SIZE_T>(7);
+	if (cb > ArenaChunk / 16)
+		return HeapAlloc(heap, 0, cb);
+	if (cb > cbArena)
+	{
+		if ((arena = static_cast<BYTE *>(HeapAlloc(heap, 0, ArenaChunk))) == NULL)
+		{
+			cbArena = 0;
+			return NULL;
+		}
+		cbArena = ArenaChunk;
+	}
+	void *p = arena;
+	arena += cb;
+	cbArena -= cb;
+	return p;
+}
+
+// Arrays grow to the next power of two whenever they run full
+template<class T>
+bool Hive::Reserve(T *&p, UINT n)
+{
+	if (n != 0 && (n < 4 || (n & (n - 1)) != 0))
+		return true;
+	SIZE_T cb = (n != 0 ? n * 2 : 4) * sizeof(T);
+	void *q = p != NULL ? HeapReAlloc(heap, 0, p, cb) : HeapAlloc(heap, 0, cb);
+	if (q == NULL)
+		return false;
+	p = static_cast<T *>(q);
+	return true;
+}
+
+UINT Hive::Hash(LPCWSTR name, int len)
+{
+	UINT hash = 2166136261U;
+	for (int i = 0; i < len; ++i)
+		hash = (hash ^ name[i]) * 16777619U;
+	return hash;
+}
+
+LPCWSTR Hive::Intern(LPCWSTR name, int len)
+{
+	if (len < 0)
+		len = lstrlenW(name);
+	if (nAtoms * 2 >= mask)
+	{
+		const UINT size = mask ? (mask + 1) * 2 : 256;
+		LPCWSTR *const table = static_cast<LPCWSTR *>(HeapAlloc(heap, HEAP_ZERO_MEMORY, size * sizeof *table));
+		if (table == NULL)
+			return NULL;
+		for (UINT i = 0; atoms != NULL && i <= mask; ++i)
+		{
+			if (LPCWSTR atom = atoms[i])
+			{
+				UINT hash = Hash(atom, lstrlenW(atom));
+				while (table[hash & (size - 1)] != NULL)
+					++hash;
+				table[hash & (size - 1)] = atom;
+			}
+		}
+		if (atoms != NULL)
+			HeapFree(heap, 0, atoms);
+		atoms = table;
+		mask = size - 1;
+	}
+	UINT hash = Hash(name, len);
+	while (LPCWSTR atom = atoms[hash & mask])
+	{
+		int i = 0;
+		while (i < len && atom[i] == name[i])
+			++i;
+		if (i == len && atom[i] == L'\0')
+			return atom;
+		++hash;
+	}
+	LPWSTR atom = static_cast<LPWSTR>(Alloc((len + 1) * sizeof(WCHAR)));
+	if (atom == NULL)
+		return NULL;
+	MemCopy(atom, name, len);
+	atom[len] = L'\0';
+	atoms[hash & mask] = atom;
+	++nAtoms;
+	return atom;
+}
+
+Hive::Key *Hive::Lookup(const Key *key, LPCWSTR name, int len, UINT &index) const
+{
+	UINT lower = 0;
+	UINT upper = key->nKeys;
+	while (lower < upper)
+	{
+		const UINT i = (lower + upper) / 2;
+		const int cmp = Compare(key->keys[i]->name, name, len);
+		if (cmp == 0)
+		{
+			index = i;
+			return key->keys[i];
+		}
+		if (cmp < 0)
+			lower = i + 1;
+		else
+			upper = i;
+	}
+	index = lower;
+	return NULL;
+}
+
+Hive::Key *Hive::OpenKey(Key *key, LPCWSTR path) const
+{
+	while (key != NULL && path != NULL && *path != L'\0')
+	{
+		LPCWSTR q = StrChrW(path, L'\\');
+		const int len = q ? static_cast<int>(q - path) : lstrlenW(path);
+		UINT index;
+		key = Lookup(key, path, len, index);
+		path = q ? q + 1 : NULL;
+	}
+	return key;
+}
+
+Hive::Key *Hive::CreateKey(Key *key, LPCWSTR path)
+{
+	while (key != NULL && path != NULL && *path != L'\0')
+	{
+		LPCWSTR q = StrChrW(path, L'\\');
+		const int len = q ? static_cast<int>(q - path) : lstrlenW(path);
+		key = CreateSubKey(key, path, len);
+		path = q ? q + 1 : NULL;
+	}
+	return key;
+}
+
+Hive::Key *Hive::CreateSubKey(Key *key, LPCWSTR name, int len)
+{
+	if (key == NULL)
+		return NULL;
+	if (len < 0)
+		len = lstrlenW(name);
+	UINT index;
+	if (Key *sub = Lookup(key, name, len, index))
+		return sub;
+	if (!Reserve(key->keys, key->nKeys))
+		return NULL;
+	Key *const sub = static_cast<Key *>(Alloc(sizeof(Key)));
+	if (sub == NULL)
+		return NULL;
+	SecureZeroMemory(sub, sizeof *sub);
+	if ((sub->name = Intern(name, len)) == NULL)
+		return NULL;
+	sub->parent = key;
+	for (UINT i = key->nKeys++; i > index; --i)
+		key->keys[i] = key->keys[i - 1];
+	key->keys[index] = sub;
+	Touch(sub);
+	return sub;
+}
+
+// The key is unlinked from its parent, and its memory is not reclaimed. The
+// parent goes into the journal, as its list of subkeys has changed.
+bool Hive::DeleteSubKey(Key *key, LPCWSTR name)
+{
+	UINT index;
+	Key *const sub = key != NULL ? Lookup(key, name, -1, index) : NULL;
+	if (sub == NULL)
+		return false;
+	Touch(key);
+	// Keep the journal from handing out the key as a subkey
+	sub->parent = NULL;
+	Unwatch(sub);
+	for (UINT i = index + 1; i < key->nKeys; ++i)
+		key->keys[i - 1] = key->keys[i];
+	--key->nKeys;
+	return true;
+}
+
+Hive::Value *Hive::QueryValue(const Key *key, LPCWSTR name) const
+{
+	if (key == NULL)
+		return NULL;
+	if (name == NULL)
+		name = L"";
+	for (UINT i = 0; i < key->nValues; ++i)
+	{
+		if (Compare(key->values[i].name, name, -1) == 0)
+			return key->values + i;
+	}
+	return NULL;
+}
+
+Hive::Value *Hive::SetValue(Key *key, LPCWSTR name, DWORD type, const void *data, DWORD cb)
+{
+	if (key == NULL)
+		return NULL;
+	Value *value = QueryValue(key, name);
+	if (value == NULL)
+	{
+		if (!Reserve(key->values, key->nValues))
+			return NULL;
+		value = key->values + key->nValues;
+		if ((value->name = Intern(name ? name : L"", -1)) == NULL)
+			return NULL;
+		value->type = REG_NONE;
+		value->cb = 0;
+		value->data = NULL;
+		++key->nValues;
+	}
+	// Reuse the existing storage if the new data fits in
+	BYTE *p = value->data != NULL && cb <= value->cb ? value->data : static_cast<BYTE *>(Alloc(cb + sizeof(WCHAR)));
+	if (p == NULL)
+		return NULL;
+	MemCopy(p, static_cast<const BYTE *>(data), cb);
+	p[cb] = p[cb + 1] = 0;
+	value->type = type;
+	value->cb = cb;
+	value->data = p;
+	return value;
+}
+
+LPCWSTR Hive::GetString(Key *key, LPCWSTR subkey, LPCWSTR name) const
+{
+	if (const Value *value = QueryValue(OpenKey(key, subkey), name))
+	{
+		if (value->type == REG_SZ || value->type == REG_EXPAND_SZ)
+			return reinterpret_cast<LPCWSTR>(value->data);
+	}
+	return NULL;
+}
+
+void Hive::Touch(Key *key)
+{
+	if (key->stamp != stamp && Reserve(journal, nJournal))
+	{
+		key->stamp = stamp;
+		journal[nJournal++] = key;
+	}
+}
+
+void Hive::Checkpoint()
+{
+	++stamp;
+	nJournal = 0;
+}
+
+// Returns the subkeys of a key which have been journaled since the last
+// checkpoint, in the order the key keeps them in. The array stays valid
+// until the next call.
+Hive::Key *const *Hive::GetChangedSubKeys(const Key *key, UINT *n)
+{
+	UINT count = 0;
+	for (UINT i = 0; i < nJournal; ++i)
+	{
+		Key *const sub = journal[i];
+		if (sub->parent != key)
+			continue;
+		if (!Reserve(selection, count))
+		{
+			*n = 0;
+			return NULL;
+		}
+		selection[count++] = sub;
+	}
+	// Sorting takes quadratic time, so with more than a few keys, rather go
+	// through all of them, and pick those which carry the current stamp
+	if (count <= 16)
+	{
+		SortKeys(selection, count);
+	}
+	else
+	{
+		count = 0;
+		for (UINT i = 0; i < key->nKeys; ++i)
+			if (key->keys[i]->stamp == stamp)
+				selection[count++] = key->keys[i];
+	}
+	*n = count;
+	return selection;
+}
+
+void Hive::SortKeys(Key **keys, UINT n)
+{
+	for (UINT i = 1; i < n; ++i)
+	{
+		Key *const key = keys[i];
+		UINT j = i;
+		while (j > 0 && Compare(keys[j - 1]->name, key->name, -1) > 0)
+		{
+			keys[j] = keys[j - 1];
+			--j;
+		}
+		keys[j] = key;
+	}
+}
+
+HRESULT Hive::Capture(HKEY hKey, const FILETIME *since)
+{
+	// Open a handle of its own for the root to hold on to
+	HKEY hRoot;
+	LSTATUS r = RegOpenKeyExW(hKey, NULL, 0, KEY_READ, &hRoot);
+	if (r == 0)
+		r = Capture(hRoot, &root, since);
+	return HRESULT_FROM_WIN32(r);
+}
+
+// Returns a buffer of at least the given size, which stays valid until the
+// next call
+BYTE *Hive::GetScratch(DWORD cb)
+{
+	if (cb > cbScratch)
+	{
+		if (scratch != NULL)
+			HeapFree(heap, 0, scratch);
+		cbScratch = cb;
+		if ((scratch = static_cast<BYTE *>(HeapAlloc(heap, 0, cbScratch))) == NULL)
+			cbScratch = 0;
+	}
+	return scratch;
+}
+
+// Writes the keys which have been journaled since the last checkpoint to the
+// registry, so that what has gone into the hive other than through Capture()
+// is in the registry too, for registrations which follow to build upon.
+HRESULT Hive::Store(HKEY hKey)
+{
+	LSTATUS r = 0;
+	for (UINT i = 0; r == 0 && i < nJournal; ++i)
+		r = Store(hKey, journal[i]);
+	return HRESULT_FROM_WIN32(r);
+}
+
+// Writes a key along with its values. Where the key exists already, subkeys
+// and values which the hive doesn't have are removed from it. Keys which have
+// been removed from the hive are skipped, as their parents have gone into the
+// journal in their place.
+LSTATUS Hive::Store(HKEY hKey, const Key *key)
+{
+	WCHAR path[0x1000];
+	int at = _countof(path) - 1;
+	path[at] = L'\0';
+	for (const Key *sub = key; sub != &root; sub = sub->parent)
+	{
+		if (sub == NULL)
+			return 0;
+		const int cch = lstrlenW(sub->name);
+		if (cch + 1 > at)
+			return ERROR_FILENAME_EXCED_RANGE;
+		if (at != _countof(path) - 1)
+			path[--at] = L'\\';
+		at -= cch;
+		MemCopy(path + at, sub->name, cch);
+	}
+	HKEY hSubKey;
+	DWORD disposition;
+	if (LSTATUS r = RegCreateKeyExW(hKey, path + at, 0, NULL, 0,
+		KEY_READ | KEY_WRITE, NULL, &hSubKey, &disposition))
+	{
+		return r;
+	}
+	LSTATUS r = 0;
+	if (disposition == REG_OPENED_EXISTING_KEY)
+	{
+		WCHAR name[256]; // registry key names are limited to 255 characters
+		DWORD cch = _countof(name);
+		DWORD i = 0;
+		while (0 == RegEnumKeyExW(hSubKey, i, name, &cch, NULL, NULL, NULL, NULL))
+		{
+			UINT index;
+			if (Lookup(key, name, cch, index) != NULL || RegDeleteTreeW(hSubKey, name) != 0)
+				++i;
+			cch = _countof(name);
+		}
+		DWORD cchMaxValueName = 0;
+		r = RegQueryInfoKeyW(hSubKey, NULL, NULL, NULL, NULL, NULL, NULL,
+			NULL, &cchMaxValueName, NULL, NULL, NULL);
+		const LPWSTR value = r == 0 ? reinterpret_cast<LPWSTR>(GetScratch(++cchMaxValueName * sizeof(WCHAR))) : NULL;
+		if (r == 0 && value == NULL)
+			r = ERROR_OUTOFMEMORY;
+		i = 0;
+		while (value != NULL && (cch = cchMaxValueName,
+			0 == RegEnumValueW(hSubKey, i, value, &cch, NULL, NULL, NULL, NULL)))
+		{
+			if (QueryValue(key, value) != NULL || RegDeleteValueW(hSubKey, value) != 0)
+				++i;
+		}
+	}
+	for (UINT i = 0; r == 0 && i < key->nValues; ++i)
+	{
+		const Value *const value = key->values + i;
+		r = RegSetValueExW(hSubKey, value->name, 0, value->type, value->data, value->cb);
+	}
+	RegCloseKey(hSubKey);
+	return r;
+}
+
+// Has the registry signal the key's event when anything changes at or below
+// the key. The key takes over the handle, and closes the one it held before.
+void Hive::Watch(Key *key, HKEY hKey)
+{
+	if (key->watch != NULL)
+		RegCloseKey(key->watch);
+	key->watch = hKey;
+	if (key->event == NULL)
+		key->event = CreateEventW(NULL, TRUE, FALSE, NULL);
+	else
+		ResetEvent(key->event);
+	if (key->event != NULL && RegNotifyChangeKeyValue(hKey, TRUE,
+		REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET, key->event, TRUE) != 0)
+	{
+		// Without a watch, the key counts as changed each time
+		SetEvent(key->event);
+	}
+}
+
+void Hive::Unwatch(Key *key)
+{
+	if (key->watch != NULL)
+	{
+		RegCloseKey(key->watch);
+		key->watch = NULL;
+	}
+	if (key->event != NULL)
+	{
+		CloseHandle(key->event);
+		key->event = NULL;
+	}
+	for (UINT i = 0; i < key->nKeys; ++i)
+		Unwatch(key->keys[i]);
+}
+
+bool Hive::HasChanged(const Key *key)
+{
+	return key->event == NULL || WaitForSingleObject(key->event, 0) != WAIT_TIMEOUT;
+}
+
+// Merges the content of a registry key into the hive, and takes over the
+// handle to watch the key. A key's last write time only tells about its own
+// values and list of subkeys, not about keys further down. Given a point in
+// time, only subkeys whose watch has signaled a change somewhere below them
+// are descended into, so the cost follows the keys which have changed rather
+// than the size of the registry. The values of keys which are known already
+// and haven't been written to since then are not read again. Without a point
+// in time, all subkeys are descended into. Keys found to have changed go into
+// the journal, and what no longer exists in the registry is removed from the
+// hive.
+LSTATUS Hive::Capture(HKEY hKey, Key *key, const FILETIME *since)
+{
+	Watch(key, hKey);
+	DWORD cSubKeys, cValues, cchMaxValueName, cbMaxValue;
+	FILETIME time;
+	if (LSTATUS r = RegQueryInfoKeyW(hKey, NULL, NULL, NULL, &cSubKeys, NULL, NULL,
+		&cValues, &cchMaxValueName, &cbMaxValue, NULL, &time))
+	{
+		return r;
+	}
+	const bool known = (key->time.dwLowDateTime | key->time.dwHighDateTime) != 0;
+	const bool written = CompareFileTime(&time, &key->time) != 0;
+	if (written && (!known || since == NULL || CompareFileTime(&time, since) >= 0))
+	{
+		key->time = time;
+		Touch(key);
+		const DWORD cbName = ++cchMaxValueName * sizeof(WCHAR);
+		if (GetScratch(cbName + cbMaxValue) == NULL)
+			return ERROR_OUTOFMEMORY;
+		const LPWSTR name = reinterpret_cast<LPWSTR>(scratch);
+		BYTE *const data = scratch + cbName;
+		// The registry has the final say on the values of keys it holds
+		key->nValues = 0;
+		for (DWORD i = 0; i < cValues; ++i)
+		{
+			DWORD type;
+			DWORD cch = cchMaxValueName;
+			DWORD cb = cbMaxValue;
+			if (0 == RegEnumValueW(hKey, i, name, &cch, NULL, &type, data, &cb))
+				SetValue(key, name, type, data, cb);
+		}
+	}
+	// Subkeys which carry a time have come from the registry before, unlike
+	// those which have been imported, so they are expected to show up again
+	UINT nCaptured = 0;
+	for (UINT i = 0; i < key->nKeys; ++i)
+		if ((key->keys[i]->time.dwLowDateTime | key->keys[i]->time.dwHighDateTime) != 0)
+			++nCaptured;
+	// Unless the list of subkeys has changed, just visit those with changes
+	if (since != NULL && known && !written && cSubKeys == nCaptured)
+	{
+		for (UINT i = 0; i < key->nKeys; ++i)
+		{
+			Key *const sub = key->keys[i];
+			if (sub->watch == NULL || !HasChanged(sub))
+				continue;
+			HKEY hSubKey;
+			if (0 == RegOpenKeyExW(hKey, sub->name, 0, KEY_READ, &hSubKey))
+				Capture(hSubKey, sub, since);
+		}
+		return 0;
+	}
+	UINT nSeen = 0;
+	LSTATUS r;
+	DWORD i = 0;
+	WCHAR name[256]; // registry key names are limited to 255 characters
+	DWORD cch = _countof(name);
+	while (0 == (r = RegEnumKeyExW(hKey, i++, name, &cch, NULL, NULL, NULL, NULL)))
+	{
+		UINT index;
+		Key *sub = Lookup(key, name, cch, index);
+		if (sub != NULL && (sub->time.dwLowDateTime | sub->time.dwHighDateTime) != 0)
+			++nSeen;
+		if (sub == NULL)
+			sub = CreateSubKey(key, name, cch);
+		HKEY hSubKey;
+		if (sub != NULL && (since == NULL || HasChanged(sub)) &&
+			0 == RegOpenKeyExW(hKey, name, 0, KEY_READ, &hSubKey))
+		{
+			Capture(hSubKey, sub, since);
+		}
+		cch = _countof(name);
+	}
+	if (r != ERROR_NO_MORE_ITEMS)
+		return r;
+	// Only if some have gone missing, find out which ones
+	if (nSeen < nCaptured)
+	{
+		UINT j = 0;
+		while (j < key->nKeys)
+		{
+			Key *const sub = key->keys[j];
+			if ((sub->time.dwLowDateTime | sub->time.dwHighDateTime) != 0)
+			{
+				HKEY hSubKey;
+				const LSTATUS status = RegOpenKeyExW(hKey, sub->name, 0, KEY_READ, &hSubKey);
+				if (status == ERROR_FILE_NOT_FOUND)
+				{
+					DeleteSubKey(key, sub->name);
+					continue;
+				}
+				if (status == 0)
+					RegCloseKey(hSubKey);
+			}
+			++j;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,110 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// In-memory registry hive which mirrors the layout of the sandbox, i.e. its
+// root plays the part of HKLM, and HKCR lives below Software\Classes.
+// All memory comes from a private heap, and is released at once on exit.
+class Hive
+{
+public:
+	struct Value
+	{
+		LPCWSTR name;
+		DWORD type;
+		DWORD cb;
+		BYTE *data; // always followed by a null WCHAR not counted in cb
+	};
+
+	struct Key
+	{
+		LPCWSTR name;
+		Key *parent;
+		Key **keys; // sorted by name, same as the registry enumerates them
+		Value *values; // in order of creation, same as the registry does
+		UINT nKeys;
+		UINT nValues;
+		FILETIME time; // last write time of the registry key captured
+		DWORD mark; // free for the caller to use
+		UINT stamp; // checkpoint at which the key has last been journaled
+		HKEY watch; // registry key held open to watch for changes below it
+		HANDLE event; // signaled by the registry on such changes
+	};
+
+	Hive();
+	~Hive();
+
+	Key *GetRoot() { return &root; }
+	Key *GetClassesRoot() { return CreateKey(&root, L"Software\\Classes"); }
+
+	Key *OpenKey(Key *key, LPCWSTR path) const;
+	Key *CreateKey(Key *key, LPCWSTR path);
+	Key *CreateSubKey(Key *key, LPCWSTR name, int len = -1);
+	bool DeleteSubKey(Key *key, LPCWSTR name);
+
+	Value *QueryValue(const Key *key, LPCWSTR name) const;
+	Value *SetValue(Key *key, LPCWSTR name, DWORD type, const void *data, DWORD cb);
+	LPCWSTR GetString(Key *key, LPCWSTR subkey, LPCWSTR name) const;
+
+	HRESULT Capture(HKEY hKey, const FILETIME *since = NULL);
+	HRESULT Store(HKEY hKey);
+
+	// Keys which are created or written to go into a journal, so callers can
+	// visit only those which have changed since the last checkpoint
+	void Touch(Key *key);
+	void Checkpoint();
+	Key *const *GetChangedSubKeys(const Key *key, UINT *n);
+	Key *const *GetChangedKeys(UINT *n) const { *n = nJournal; return journal; }
+	static void SortKeys(Key **keys, UINT n);
+
+private:
+	Hive(const Hive &);
+	void operator=(const Hive &);
+
+	static int Compare(LPCWSTR p, LPCWSTR q, int len);
+	static UINT Hash(LPCWSTR name, int len);
+	Key *Lookup(const Key *key, LPCWSTR name, int len, UINT &index) const;
+	LPCWSTR Intern(LPCWSTR name, int len);
+	void *Alloc(SIZE_T cb);
+	template<class T> bool Reserve(T *&p, UINT n);
+	BYTE *GetScratch(DWORD cb);
+	static void Watch(Key *key, HKEY hKey);
+	static void Unwatch(Key *key);
+	static bool HasChanged(const Key *key);
+	LSTATUS Capture(HKEY hKey, Key *key, const FILETIME *since);
+	LSTATUS Store(HKEY hKey, const Key *key);
+
+	HANDLE heap;
+	BYTE *arena;
+	SIZE_T cbArena;
+	LPCWSTR *atoms;
+	UINT nAtoms;
+	UINT mask;
+	BYTE *scratch;
+	DWORD cbScratch;
+	Key **journal;
+	UINT nJournal;
+	UINT stamp;
+	Key **selection;
+	Key root;
+};
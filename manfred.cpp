@@ -24,11 +24,24 @@ SOFTWARE.
 
 #include <shlwapi.h>
 #include "scoped.h"
+#include "miscutil.h"
+#include "hexcodec.h"
 #include "writer.h"
+#include "reader.h"
 #include "wstdio.h"
+#include "hive.h"
+#include "regcache.h"
+#include "peimage.h"
+#include "resupdate.h"
+#include "manifest.h"
+#include "typelib.h"
 #include "regimp.h"
+#include "rgsimp.h"
+#include "guid.h"
 #include "multimap.h"
-#include "miscutil.h"
+#include "workpool.h"
+#include "trace.h"
+#include "classindex.h"
 
 #define OUTPUT STD_ERROR_HANDLE
 
@@ -36,19 +49,34 @@ static const char usage[] =
 	"Manifest Resource Editor v1.09\r\n"
 	"\r\n"
 	"Usage:\r\n"
-	"\r\n"
-	"%ls <target> ... [ /once ] [ /ini ... ] [ /files ... ] [ /minus ... ]\r\n"
+	"\r\n";
+
+static const char syntax[] =
+	" <target> ... [ /once | /merge ] [ /ini ... ] [ /files ... ] [ /minus ... ]\r\n"
 	"\r\n"
 	"<target>  may be followed by a list of subfolders to search\r\n"
 	"/once     causes update of manifest to occur only when no file tags exist yet\r\n"
 	"/never    causes update of manifest to occur never; useful with /rgs option\r\n"
+	"/merge    causes update of manifest to touch only the file tags of files found\r\n"
 	"/ini      specifies an ini file from which to merge content into the manifest\r\n"
 	"/rgs      specifies an rgs file to write results to for bulk registration\r\n"
+	"/apply    specifies an rgs file written with /rgs to apply to the registry\r\n"
+	"/cache    specifies a file in which to keep registration results across runs\r\n"
+	"/trace    specifies a file to write timings to in Chrome trace event format\r\n"
 	"/files    specifies file inclusion patterns; may occur repeatedly\r\n"
 	"/minus    specifies file exclusion patterns; may occur only once\r\n"
 	"/keep     specifies files to keep in memory once loaded; may occur only once\r\n"
+	"/batch    takes the <target>s which follow, or @ a file which lists them\r\n"
+	"/static   evaluates embedded REGISTRY scripts rather than loading the files\r\n"
 	"/vld{+|-} enables or disables Visual Leak Detector\r\n"
 	"\r\n"
+	"With /apply, nothing but the rgs file is processed, with %ROOT% taken to be the\r\n"
+	"folder of <target>. Values which are in place already are not written again.\r\n"
+	"\r\n"
+	"With /batch, any number of <target>s share a single registration of the files in\r\n"
+	"their subfolders. A list file holds one <target> per line, along with its list\r\n"
+	"of subfolders, and optionally an /ini file which applies to it alone.\r\n"
+	"\r\n"
 	"Passing <target> as the only argument yields a list of TypeLibIndex definitions\r\n"
 	"for use with the CComTypeInfoHolderLib template from ComTypeInfoHolderLib.h.\r\n"
 	"\r\n";
@@ -59,6 +87,13 @@ static const WCHAR appkey[] =
 static const GUID CLSID_Registrar =
 	{ 0x44ec053a, 0x400f, 0x11d0, { 0x9d, 0xcd, 0x00, 0xa0, 0xc9, 0x03, 0x91, 0xd3 } };
 
+// Indentation of RGS scripts, which levels off at some depth
+static const char ScriptTabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+static const int ScriptDepth = sizeof ScriptTabs - 1;
+
+// Count of subkeys of a top-level key to write the subtrees of in one go
+static const UINT ScriptSlice = 64;
+
 static LPCWSTR PathEatPrefix(LPCWSTR path, LPCWSTR root)
 {
 	int prefix = PathCommonPrefixW(path, root, NULL);
@@ -87,64 +122,25 @@ static LPFNGETCLASSOBJECT GetDllGetClassObject(LPCWSTR name)
 	return DllGetClassObjectFailWith<ERROR_PROC_NOT_FOUND>;
 }
 
-STDAPI DllGetClassObject(REFCLSID rclsid, REFIID riid, LPVOID *ppv)
+static INIT_ONCE ClassIndexOnce = INIT_ONCE_STATIC_INIT;
+static ClassIndex Classes;
+
+static BOOL CALLBACK BuildClassIndex(PINIT_ONCE, PVOID, PVOID *)
 {
-	// Deal with prerequisite dependencies like ATL Registrar, as per manifest
-	if (const HRSRC res = FindResourceW(NULL, MAKEINTRESOURCEW(1), RT_MANIFEST))
-	{
-		if (DWORD cb = SizeofResource(NULL, res))
-		{
-			if (const HGLOBAL global = LoadResource(NULL, res))
-			{
-				if (const char *p = static_cast<const char *>(LockResource(global)))
-				{
-					char buf[72];
-					int len = wsprintfA(buf,
-						"<comClass clsid=\"{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}\" description=",
-						rclsid.Data1, rclsid.Data2, rclsid.Data3,
-						rclsid.Data4[0], rclsid.Data4[1], rclsid.Data4[2], rclsid.Data4[3],
-						rclsid.Data4[4], rclsid.Data4[5], rclsid.Data4[6], rclsid.Data4[7]);
-					if (const char *q = MemSearch(p, cb, buf, len))
-					{
-						if ((cb -= len) && *(q += len) == '"')
-						{
-							if (q = static_cast<const char *>(MemSearch(p = q + 1, cb - 1, q, 1)))
-							{
-								WCHAR name[MAX_PATH];
-								name[MultiByteToWideChar(CP_UTF8, 0, p, q - p, name, _countof(name))] = L'\0';
-								LPFNGETCLASSOBJECT DllGetClassObject = DllGetClassObjectFailWith<ERROR_MOD_NOT_FOUND>;
-								if (HMODULE module = GetModuleHandleW(name))
-								{
-									DllGetClassObject = DllGetClassObjectFailWith<ERROR_PROC_NOT_FOUND>;
-									if (FARPROC pfn = GetProcAddress(module, "DllGetClassObject"))
-										DllGetClassObject = reinterpret_cast<LPFNGETCLASSOBJECT>(pfn);
-								}
-								return DllGetClassObject(rclsid, riid, ppv);
-							}
-						}
-					}
-				}
-			}
-		}
-	}
-	return CLASS_E_CLASSNOTAVAILABLE;
+	const HRSRC res = FindResourceW(NULL, MAKEINTRESOURCEW(1), RT_MANIFEST);
+	const DWORD cb = res ? SizeofResource(NULL, res) : 0;
+	const HGLOBAL global = cb ? LoadResource(NULL, res) : NULL;
+	if (const char *const p = global ? static_cast<const char *>(LockResource(global)) : NULL)
+		Classes.Build(p, cb);
+	return TRUE;
 }
 
-class ValueBuffer
+STDAPI DllGetClassObject(REFCLSID rclsid, REFIID riid, LPVOID *ppv)
 {
-	// Registrar tokens are limited to 4096 characters, which in case of
-	// string values may expand to 8194 bytes including null termination.
-	static const DWORD size = 8200; // a few bytes more than required
-public:
-	DWORD type;
-	BufferCapacity<size> cb;
-	union
-	{
-		BYTE b[size];
-		WCHAR s[size / sizeof(WCHAR)];
-		DWORD d;
-	};
-};
+	// Deal with prerequisite dependencies like ATL Registrar, as per manifest
+	InitOnceExecuteOnce(&ClassIndexOnce, BuildClassIndex, NULL, NULL);
+	return Classes.GetClassObject(rclsid, riid, ppv);
+}
 
 class Appartment
 {
@@ -191,17 +187,67 @@ private:
 	}
 };
 
-class Application: ZeroInit<Application>
+class Application: public ZeroInit<Application>
 {
+	// A file to be registered, along with what has been gathered from it in
+	// advance, possibly on a worker thread
+	struct FileTask
+	{
+		LPWSTR path;
+		LPCWSTR name; // relative to the folder of the target it was found for
+		HRESULT hr;
+		BSTR *scripts;
+		UINT nScripts;
+		bool typelib;
+		DWORD begin; // where the contents of its element have been staged
+		DWORD end; // on a batch run
+	};
+
+	// A target of a batch run, along with its subfolders and ini file
+	struct Target
+	{
+		LPWSTR spec; // <target>[;<subfolder>...], split up in place
+		LPWSTR ini;
+		LPWSTR name; // points into path, past the folder
+		UINT nFolders;
+		WCHAR path[MAX_PATH];
+	};
+
+	// A slice of the subkeys of a top-level key, along with the script which
+	// has been written for their subtrees
+	struct ScriptPart
+	{
+		Hive::Key *key;
+		UINT first;
+		UINT last;
+		HRESULT hr;
+		char *data;
+		DWORD cb;
+	};
+
+	// A folder which has been searched on a batch run, along with the range
+	// of tasks which have come from it
+	struct Folder
+	{
+		UINT first;
+		UINT last;
+		WCHAR path[MAX_PATH];
+	};
+
 	LPWSTR ManifestName;
 	LANGID ManifestLang;
-	HANDLE update;
+	WCHAR ManifestNameString[MAX_PATH];
 	LPCWSTR appname;
-	enum { always, once, never } option;
+	enum { always, once, never, merge } option;
 	LPCSTR vldoption;
+	bool statically;
+	bool batch;
 	LPWSTR target;
 	LPWSTR ini;
 	LPWSTR rgs;
+	LPWSTR cache;
+	LPWSTR trace;
+	LPWSTR apply;
 	LPWSTR keep;
 	LPWSTR files;
 	UINT minus;
@@ -209,18 +255,24 @@ class Application: ZeroInit<Application>
 	MultiMap progmm;
 	MultiMap tlbmm;
 	Writer writer;
-	ValueBuffer vb;
+	ManifestMerge merger;
+	Hive hive;
+	RegCache regcache;
+	Trace tracer;
+	RegImportStats regstats;
+	FileTask *tasks;
+	UINT nTasks;
+	Target *targets;
+	UINT nTargets;
+	Folder *folders;
+	UINT nFolders;
+	Hive::Key **typelibs;
+	UINT nTypeLibs;
+	ScriptPart *parts;
+	UINT nParts;
+	Hive::Key *classes; // looked up before worker threads write the script
 	WCHAR root[MAX_PATH];
 
-	static DWORD ManfredWasHere(HKEY hKey, DWORD dwNewState)
-	{
-		DWORD dwOldState = 0;
-		DWORD cb = sizeof dwOldState;
-		LONG r = RegQueryValueEx(hKey, L"ManfredWasHere", NULL, NULL, (BYTE *)&dwOldState, &cb);
-		LONG w = RegSetValueEx(hKey, L"ManfredWasHere", 0, REG_DWORD, (BYTE *)&dwNewState, sizeof dwNewState);
-		return r == 0 && w == 0 ? dwOldState : 0;
-	}
-
 	static LPCSTR GetMiscStatusText(int code)
 	{
 		switch (code)
@@ -282,190 +334,336 @@ class Application: ZeroInit<Application>
 			bool first = true;
 			do if (LPCSTR text = GetMiscStatusText(bit & mask))
 			{
-				writer.write(&",%s"[first], text);
+				writer.write(&","[first], text);
 				first = false;
 			} while ((bit <<= 1) != 0);
 			writer.write(format + lstrlenA(format) - 1);
 		}
 	}
 
+	// Adds a CLSID or LIBID to its map by value, so it hashes and compares as
+	// 16 bytes rather than as 38 characters, unless it is not a proper GUID
+	static void AddGuid(MultiMap &mm, LPCWSTR key, LPCWSTR name)
+	{
+		GUID guid;
+		if (ParseGuid(key, guid))
+			mm.Add(guid, name);
+		else
+			mm.Add(key, name);
+	}
+
+	// Exports the classes registered since the last checkpoint, as told by the
+	// hive's journal, and takes note of the type libraries they refer to. Keys
+	// of type libraries yet to be exported by ExportTlb() are marked 1.
 	HRESULT ExportCls(LPCWSTR name)
 	{
-		TCHAR subkey[MAX_PATH];
-		PathCombineW(subkey, appkey, L"Software\\Classes\\CLSID");
-		HKEY hKey;
-		if (LSTATUS r = RegCreateKeyW(HKEY_CURRENT_USER, subkey, &hKey))
-			return CoGetError(r);
-		DWORD i = 0;
-		WCHAR id[40];
-		HKEY hKey2;
-		while (0 == RegEnumKeyW(hKey, i++, id, _countof(id)) && 0 == RegOpenKeyW(hKey, id, &hKey2))
-		{
-			if (ManfredWasHere(hKey2, 1) == 0)
-			{
-				clsmm.Add(id, name);
-				writer.write("\t\t<comClass clsid=\"%ls\"", id);
-				WCHAR data[MAX_PATH];
-				BufferCapacity<sizeof data> cb;
-				if (0 == SHRegGetValueW(hKey2, L"VersionIndependentProgID", NULL, SRRF_RT_REG_SZ, NULL, data, &cb) ||
-					0 == SHRegGetValueW(hKey2, L"ProgID", NULL, SRRF_RT_REG_SZ, NULL, data, &cb))
-				{
-					progmm.Add(data, name);
-					writer.write(" progid=\"%ls\"", data);
-				}
-				if (0 == SHRegGetValueW(hKey2, L"InprocServer32", L"ThreadingModel", SRRF_RT_REG_SZ, NULL, data, &cb))
-					writer.write(" threadingModel=\"%ls\"", data);
-				HKEY hKey3;
-				if (0 == RegOpenKeyW(hKey2, L"MiscStatus", &hKey3))
-				{
-					if (0 == SHRegGetValueW(hKey3, NULL, NULL, SRRF_RT_REG_SZ, NULL, data, &cb))
-						WriteMistStatus(" miscStatus=\"", data);
-					if (0 == SHRegGetValueW(hKey3, L"1", NULL, SRRF_RT_REG_SZ, NULL, data, &cb))
-						WriteMistStatus(" miscStatusContent=\"", data);
-					if (0 == SHRegGetValueW(hKey3, L"2", NULL, SRRF_RT_REG_SZ, NULL, data, &cb))
-						WriteMistStatus(" miscStatusThumbnail=\"", data);
-					if (0 == SHRegGetValueW(hKey3, L"4", NULL, SRRF_RT_REG_SZ, NULL, data, &cb))
-						WriteMistStatus(" miscStatusIcon=\"", data);
-					if (0 == SHRegGetValueW(hKey3, L"8", NULL, SRRF_RT_REG_SZ, NULL, data, &cb))
-						WriteMistStatus(" miscStatusDocPrint=\"", data);
-					RegCloseKey(hKey3);
-				}
-				writer.write(" />\r\n");
-				if (0 == SHRegGetValueW(hKey2, L"TypeLib", NULL, SRRF_RT_REG_SZ, NULL, data, &cb))
+		Hive::Key *const classes = hive.GetClassesRoot();
+		Hive::Key *const clsids = hive.OpenKey(classes, L"CLSID");
+		Hive::Key *const tlbs = hive.OpenKey(classes, L"TypeLib");
+		UINT n = 0;
+		Hive::Key *const *const keys = clsids != NULL ? hive.GetChangedSubKeys(clsids, &n) : NULL;
+		for (UINT i = 0; i < n; ++i)
+		{
+			Hive::Key *const key = keys[i];
+			AddGuid(clsmm, key->name, name);
+			writer.write("\t\t<comClass clsid=\"", key->name, "\"");
+			LPCWSTR data;
+			if ((data = hive.GetString(key, L"VersionIndependentProgID", NULL)) != NULL ||
+				(data = hive.GetString(key, L"ProgID", NULL)) != NULL)
+			{
+				progmm.Add(data, name);
+				writer.write(" progid=\"", data, "\"");
+			}
+			if ((data = hive.GetString(key, L"InprocServer32", L"ThreadingModel")) != NULL)
+				writer.write(" threadingModel=\"", data, "\"");
+			if (Hive::Key *const misc = hive.OpenKey(key, L"MiscStatus"))
+			{
+				if ((data = hive.GetString(misc, NULL, NULL)) != NULL)
+					WriteMistStatus(" miscStatus=\"", data);
+				if ((data = hive.GetString(misc, L"1", NULL)) != NULL)
+					WriteMistStatus(" miscStatusContent=\"", data);
+				if ((data = hive.GetString(misc, L"2", NULL)) != NULL)
+					WriteMistStatus(" miscStatusThumbnail=\"", data);
+				if ((data = hive.GetString(misc, L"4", NULL)) != NULL)
+					WriteMistStatus(" miscStatusIcon=\"", data);
+				if ((data = hive.GetString(misc, L"8", NULL)) != NULL)
+					WriteMistStatus(" miscStatusDocPrint=\"", data);
+			}
+			writer.write(" />\r\n");
+			if ((data = hive.GetString(key, L"TypeLib", NULL)) != NULL)
+			{
+				Hive::Key *const tlb = hive.OpenKey(tlbs, data);
+				if (tlb != NULL && tlb->mark != 1)
 				{
-					PathCombineW(subkey, appkey, L"Software\\Classes\\TypeLib");
-					PathAppendW(subkey, data);
-					if (0 == RegCreateKeyW(HKEY_CURRENT_USER, subkey, &hKey3))
+					// Grow the array whenever the count reaches a power of two
+					if ((nTypeLibs & (nTypeLibs - 1)) == 0)
 					{
-						ManfredWasHere(hKey3, 1);
-						RegCloseKey(hKey3);
+						void *const p = CoTaskMemRealloc(typelibs, (nTypeLibs ? nTypeLibs * 2 : 1) * sizeof *typelibs);
+						if (p == NULL)
+							return E_OUTOFMEMORY;
+						typelibs = static_cast<Hive::Key **>(p);
 					}
+					typelibs[nTypeLibs++] = tlb;
+					tlb->mark = 1;
 				}
 			}
-			RegCloseKey(hKey2);
 		}
-		RegCloseKey(hKey);
+		hive.Checkpoint();
 		return S_OK;
 	}
 
 	HRESULT ExportTlb(LPCWSTR name)
 	{
-		TCHAR subkey[MAX_PATH];
-		PathCombineW(subkey, appkey, L"Software\\Classes\\TypeLib");
-		HKEY hKey;
-		if (LSTATUS r = RegCreateKeyW(HKEY_CURRENT_USER, subkey, &hKey))
-			return CoGetError(r);
-		DWORD i = 0;
-		WCHAR id[40];
-		HKEY hKey2;
-		while (0 == RegEnumKeyW(hKey, i++, id, _countof(id)) && 0 == RegOpenKeyW(hKey, id, &hKey2))
-		{
-			if (ManfredWasHere(hKey2, 2) == 1)
-			{
-				tlbmm.Add(id, name);
-				DWORD i = 0;
-				WCHAR ver[40];
-				while (0 == RegEnumKeyW(hKey2, i++, ver, _countof(ver)))
-				{
-					writer.write("\t\t<typelib tlbid=\"%ls\" version=\"%ls\" helpdir=\"\" />\r\n", id, ver);
-				}
+		Hive::SortKeys(typelibs, nTypeLibs);
+		for (UINT i = 0; i < nTypeLibs; ++i)
+		{
+			Hive::Key *const key = typelibs[i];
+			key->mark = 0;
+			AddGuid(tlbmm, key->name, name);
+			for (UINT j = 0; j < key->nKeys; ++j)
+			{
+				writer.write("\t\t<typelib tlbid=\"", key->name, "\" version=\"", key->keys[j]->name, "\" helpdir=\"\" />\r\n");
 			}
-			RegCloseKey(hKey2);
 		}
-		RegCloseKey(hKey);
+		nTypeLibs = 0;
 		return S_OK;
 	}
 
-	static BOOL CALLBACK EnumResNameProcW(HMODULE, LPCWSTR, LPWSTR lpName, LONG_PTR lParam)
+	HRESULT BeginManifest(const PEImage &image)
 	{
-		reinterpret_cast<Application *>(lParam)->ManifestName = lpName;
-		return FALSE;
+		HRESULT hr = S_FALSE;
+		const IMAGE_RESOURCE_DIRECTORY *const dir = image.getDirectory(image.findEntry(image.getRoot(), RT_MANIFEST));
+		const IMAGE_RESOURCE_DIRECTORY_ENTRY *const name = image.findEntry(dir, NULL);
+		if (name == NULL)
+			return hr;
+		if (const IMAGE_RESOURCE_DIR_STRING_U *const string = image.getName(name))
+		{
+			const int len = string->Length < _countof(ManifestNameString) ? string->Length : _countof(ManifestNameString) - 1;
+			lstrcpynW(ManifestNameString, string->NameString, len + 1);
+			ManifestName = ManifestNameString;
+		}
+		else
+		{
+			ManifestName = MAKEINTRESOURCEW(name->Name);
+		}
+		const IMAGE_RESOURCE_DIRECTORY_ENTRY *const lang = image.findEntry(image.getDirectory(name), NULL);
+		if (lang == NULL)
+			return hr;
+		ManifestLang = static_cast<LANGID>(lang->Name);
+		DWORD cb = 0;
+		const char *const p = reinterpret_cast<const char *>(image.getData(lang, &cb));
+		if (p != NULL && cb != 0)
+		{
+			// Detect indentation style
+			int tabwidth = 0;
+			const char *q = p + cb;
+			do { } while (q > p && *--q != '<');
+			do { } while (q > p && *--q != '<');
+			while (q > p && *--q == ' ') ++tabwidth;
+			static const char tag[] = "<file ";
+			q = MemSearch(p, cb, tag, sizeof tag - 1);
+			if (q == NULL)
+			{
+				static const char tag[] = "</assembly>";
+				q = MemSearch(p, cb, tag, sizeof tag - 1);
+			}
+			else if (option == once)
+			{
+				q = NULL;
+			}
+			else if (option == merge && merger.Open(p, cb) == S_OK)
+			{
+				// Leave it to EndManifest() to put the pieces together
+				q = p;
+			}
+			else
+			{
+				while (q > p && q[-1] != '>')
+					--q;
+				while (*q == '\r' || *q == '\n')
+					++q;
+			}
+			if (q != NULL)
+			{
+				hr = writer.open();
+				if (SUCCEEDED(hr))
+				{
+					writer.setTabWidth(tabwidth);
+					// Manifests are XML, which defaults to UTF-8
+					writer.setCodePage(CP_UTF8);
+					writer.write(static_cast<DWORD>(q - p), p);
+					hr = S_OK;
+				}
+			}
+		}
+		return hr;
 	}
 
-	static BOOL CALLBACK EnumResLangProcW(HMODULE, LPCWSTR, LPCWSTR, LANGID wLanguage, LONG_PTR lParam)
+	// Once the files have been searched, root holds just the folder
+	void GetTargetPath(LPWSTR path) const
 	{
-		reinterpret_cast<Application *>(lParam)->ManifestLang = wLanguage;
-		return FALSE;
+		PathCombineW(path, root, target);
 	}
 
-	HRESULT BeginManifest(HMODULE module)
+	HRESULT BeginManifest()
 	{
 		HRESULT hr = S_FALSE;
-		EnumResourceNamesW(module, RT_MANIFEST, EnumResNameProcW, reinterpret_cast<LONG_PTR>(this));
-		EnumResourceLanguagesW(module, RT_MANIFEST, ManifestName, EnumResLangProcW, reinterpret_cast<LONG_PTR>(this));
-		if (const HRSRC res = FindResourceW(module, ManifestName, RT_MANIFEST))
+		PEImage image;
+		WCHAR path[MAX_PATH];
+		GetTargetPath(path);
+		if (SUCCEEDED(image.open(path)))
 		{
-			if (const DWORD cb = SizeofResource(module, res))
+			hr = BeginManifest(image);
+			if (hr == S_FALSE)
 			{
-				if (const HGLOBAL global = LoadResource(module, res))
-				{
-					if (const char *const p = static_cast<const char *>(LockResource(global)))
-					{
-						// Detect indentation style
-						int tabwidth = 0;
-						const char *q = p + cb;
-						do { } while (q > p && *--q != '<');
-						do { } while (q > p && *--q != '<');
-						while (q > p && *--q == ' ') ++tabwidth;
-						static const char tag[] = "<file ";
-						q = MemSearch(p, cb, tag, sizeof tag - 1);
-						if (q == NULL)
-						{
-							static const char tag[] = "</assembly>";
-							q = MemSearch(p, cb, tag, sizeof tag - 1);
-						}
-						else if (option == once)
-						{
-							q = NULL;
-						}
-						else
-						{
-							while (q > p && q[-1] != '>')
-								--q;
-							while (*q == '\r' || *q == '\n')
-								++q;
-						}
-						if (q != NULL)
-						{
-							hr = CreateStreamOnHGlobal(NULL, TRUE, &writer);
-							if (SUCCEEDED(hr))
-							{
-								writer.setTabWidth(tabwidth);
-								writer.write(static_cast<DWORD>(q - p), p);
-								hr = S_OK;
-							}
-						}
-					}
-				}
+				// Start over from our own manifest
+				GetModuleFileNameW(NULL, path, _countof(path));
+				if (SUCCEEDED(image.open(path)))
+					hr = BeginManifest(image);
 			}
 		}
 		return hr;
 	}
 
-	HRESULT BeginManifest()
+	static void CALLBACK LoadScripts(void *context, UINT index)
 	{
-		HRESULT hr = S_FALSE;
-		if (HMODULE module = LoadLibraryExW(root, NULL, LOAD_LIBRARY_AS_DATAFILE))
+		Application &app = *static_cast<Application *>(context);
+		FileTask &task = app.tasks[index];
+		Trace::Scope scope(app.tracer, Trace::Scripts, PathFindFileNameW(task.path));
+		task.hr = LoadScripts(task);
+	}
+
+	// Expands the REGISTRY scripts embedded in a file, without touching any
+	// state but the task's own, so this can run on a worker thread. Returns
+	// S_FALSE if there are no scripts, or if they need replacements other
+	// than the ones ATL provides for any module.
+	static HRESULT LoadScripts(FileTask &task)
+	{
+		const LPCWSTR path = task.path;
+		if (PathMatchSpecW(path, L"*.REG"))
+			return S_FALSE;
+		PEImage image;
+		if (FAILED(image.open(path)))
+			return S_FALSE;
+		const IMAGE_RESOURCE_DIRECTORY *const dir = image.getDirectory(image.findEntry(image.getRoot(), L"REGISTRY"));
+		const UINT n = image.getCount(dir);
+		if (n == 0)
+			return S_FALSE;
+		// ATL doubles any single quotes in %MODULE% but not in %MODULE_RAW%
+		WCHAR module[MAX_PATH * 2];
+		LPWSTR q = module;
+		for (LPCWSTR p = path; *p != L'\0' && q < module + _countof(module) - 2; ++p)
 		{
-			hr = BeginManifest(module);
-			FreeLibrary(module);
-			if (hr == S_FALSE)
-				hr = BeginManifest(NULL);
-			if (hr == S_OK)
-				update = BeginUpdateResourceW(root, FALSE);
+			if ((*q++ = *p) == L'\'')
+				*q++ = L'\'';
+		}
+		*q = L'\0';
+		const RgsReplacement replacements[] =
+		{
+			{ L"MODULE", module },
+			{ L"MODULE_RAW", path },
+		};
+		// Expand all scripts up front, so as to not leave anything behind in
+		// the hive if it turns out that the file needs to be loaded after all
+		if ((task.scripts = static_cast<BSTR *>(CoTaskMemAlloc(n * sizeof(BSTR)))) == NULL)
+			return E_OUTOFMEMORY;
+		HRESULT hr = S_OK;
+		while (task.nScripts < n)
+		{
+			DWORD cb = 0;
+			const BYTE *const data = image.getData(image.findEntry(image.getDirectory(image.getEntry(dir, task.nScripts)), NULL), &cb);
+			if (FAILED(hr = ExpandRgsScript(data, cb, replacements, _countof(replacements), task.scripts + task.nScripts)))
+				break;
+			++task.nScripts;
+		}
+		if (FAILED(hr))
+		{
+			FreeScripts(task);
+			return hr == DISP_E_UNKNOWNNAME ? S_FALSE : hr;
+		}
+		task.typelib = image.getCount(image.getDirectory(image.findEntry(image.getRoot(), L"TYPELIB"))) != 0;
+		return S_OK;
+	}
+
+	static void FreeScripts(FileTask &task)
+	{
+		while (task.nScripts != 0)
+			SysFreeString(task.scripts[--task.nScripts]);
+		CoTaskMemFree(task.scripts);
+		task.scripts = NULL;
+	}
+
+	// Runs the scripts loaded from a file through the RGS parser, and has its
+	// type library register itself, all without loading the file as a module
+	HRESULT RegisterFromScripts(FileTask &task)
+	{
+		HRESULT hr = task.hr;
+		for (UINT i = 0; hr == S_OK && i < task.nScripts; ++i)
+			hr = ImportRgsScript(hive, task.scripts[i]);
+		// Let the type library and the files which follow build upon it
+		hr = StoreInSandbox(hr);
+		// Pick up from the sandbox what the type library has written to it
+		if (hr == S_OK && task.typelib)
+		{
+			FILETIME since;
+			GetSystemTimeAsFileTime(&since);
+			ITypeLib *pTypeLib = NULL;
+			if (SUCCEEDED(hr = LoadTypeLibEx(task.path, REGKIND_REGISTER, &pTypeLib)))
+				pTypeLib->Release();
+			hive.Capture(HKEY_LOCAL_MACHINE, &since);
 		}
 		return hr;
 	}
 
-	HRESULT DllRegisterServer(LPCWSTR path)
+	// Writes what has gone into the hive since the last checkpoint, other than
+	// by registration, to the sandbox, where the registrations which follow
+	// may build upon it. Picking it up again has the hive know it as captured.
+	HRESULT StoreInSandbox(HRESULT hr)
 	{
+		if (hr == S_OK)
+		{
+			FILETIME since;
+			GetSystemTimeAsFileTime(&since);
+			hr = hive.Store(HKEY_LOCAL_MACHINE);
+			hive.Capture(HKEY_LOCAL_MACHINE, &since);
+		}
+		return hr;
+	}
+
+	HRESULT DllRegisterServer(FileTask &task)
+	{
+		const LPCWSTR path = task.path;
+		const LPCWSTR name = PathFindFileNameW(path);
 		HRESULT hr = S_FALSE;
 		if (PathMatchSpecW(path, L"*.REG"))
 		{
-			hr = ImportRegFile(path);
+			Trace::Scope scope(tracer, Trace::Reg, name);
+			return StoreInSandbox(ImportRegFile(hive, path, &regstats));
+		}
+		if (statically)
+		{
+			Trace::Scope scope(tracer, Trace::Rgs, name);
+			if ((hr = RegisterFromScripts(task)) != S_FALSE)
+				return hr;
 		}
-		else if (HMODULE module = LoadLibraryW(path))
+		// Replay what registration has added to the hive on an earlier run if
+		// the file is still the same, unless it is meant to stay in memory
+		RegCache::Fingerprint fp;
+		const bool cached = cache != NULL && !PathMatchSpecW(name, keep) &&
+			RegCache::Identify(path, fp) == S_OK;
+		if (cached)
 		{
+			Trace::Scope scope(tracer, Trace::Replay, name);
+			if (regcache.Replay(hive, fp) == S_OK)
+				return StoreInSandbox(S_OK);
+		}
+		FILETIME since;
+		GetSystemTimeAsFileTime(&since);
+		LONGLONG start = tracer.now();
+		if (HMODULE module = LoadLibraryW(path))
+		{
+			tracer.record(Trace::Load, name, start);
+			start = tracer.now();
 			if (FARPROC pfn = GetProcAddress(module, "DllRegisterServer"))
 			{
 				hr = reinterpret_cast<LPFNCANUNLOADNOW>(pfn)();
@@ -474,21 +672,32 @@ class Application: ZeroInit<Application>
 			{
 				hr = CoGetError();
 			}
-			if (!PathMatchSpecW(PathFindFileNameW(path), keep))
+			tracer.record(Trace::Register, name, start);
+			if (!PathMatchSpecW(name, keep))
 			{
+				Trace::Scope scope(tracer, Trace::Unload, name);
 				FreeLibrary(module);
 			}
 		}
 		else
 		{
 			hr = CoGetError();
+			tracer.record(Trace::Load, name, start);
+		}
+		// Pick up from the sandbox what has been written to it since
+		start = tracer.now();
+		hive.Capture(HKEY_LOCAL_MACHINE, &since);
+		tracer.record(Trace::Capture, name, start);
+		if (cached && hr == S_OK)
+		{
+			regcache.Record(hive, fp);
 		}
 		return hr;
 	}
 
 	HRESULT AddFileToManifest(LPCWSTR name)
 	{
-		writer.write("\t<file name=\"%ls\">\r\n", name);
+		writer.write("\t<file name=\"", name, "\">\r\n");
 		ExportCls(name);
 		ExportTlb(name);
 		writer.write("\t</file>\r\n");
@@ -507,11 +716,11 @@ class Application: ZeroInit<Application>
 		if (GetPrivateProfileSectionW(name, buffer, _countof(buffer), full) == 0)
 			return S_FALSE;
 
-		writer.write("\t<file name=\"%ls\">\r\n", name);
+		writer.write("\t<file name=\"", name, "\">\r\n");
 		LPWSTR p = buffer;
 		while (int len = lstrlenW(p))
 		{
-			writer.write("\t\t%ls\r\n", p);
+			writer.write("\t\t", p, "\r\n");
 			p += len + 1;
 		}
 		writer.write("\t</file>\r\n");
@@ -519,32 +728,80 @@ class Application: ZeroInit<Application>
 		return S_OK;
 	}
 
-	HRESULT EndManifest()
+	// Notes where the element for a file has gone, so it can take the place
+	// of the existing one when merging
+	void MergeFileIntoManifest(LPCWSTR name, const ULARGE_INTEGER &begin)
 	{
-		HRESULT hr;
+		ULARGE_INTEGER end;
+		if (merger.IsOpen() && SUCCEEDED(writer.tell(&end)) && end.QuadPart != begin.QuadPart)
+			merger.Replace(name, begin.LowPart, end.LowPart);
+	}
 
-		if (FAILED(hr = writer.write("</assembly>\r\n")))
-			return hr;
+	// Puts the output collected so far into the target's manifest resource
+	HRESULT EndManifest(Writer &out)
+	{
+		HRESULT hr;
 
 		ULARGE_INTEGER pos;
-		if (FAILED(hr = writer.tell(&pos)))
+		if (FAILED(hr = out.tell(&pos)))
 			return hr;
 
-		HGLOBAL global;
-		if (FAILED(hr = GetHGlobalFromStream(writer, &global)))
-			return hr;
+		UINT nChunks;
+		const Chunk *chunks = out.gather(&nChunks);
 
-		if (LPVOID pv = GlobalLock(global))
+		WCHAR path[MAX_PATH];
+		GetTargetPath(path);
+
+		// Resort to the API if the file doesn't lend itself to being patched
+		hr = ReplaceResource(path, RT_MANIFEST, ManifestName, ManifestLang, chunks, nChunks);
+		if (hr != S_OK)
 		{
-			UpdateResourceW(update, RT_MANIFEST, ManifestName, ManifestLang, pv, pos.LowPart);
-			GlobalUnlock(global);
+			BYTE *const data = static_cast<BYTE *>(HeapAlloc(GetProcessHeap(), 0, pos.LowPart));
+			if (data == NULL)
+				return E_OUTOFMEMORY;
+			BYTE *p = data;
+			for (UINT i = 0; i < nChunks; ++i)
+			{
+				MemCopy(p, chunks[i].data, chunks[i].cb);
+				p += chunks[i].cb;
+			}
+			if (HANDLE update = BeginUpdateResourceW(path, FALSE))
+			{
+				hr = UpdateResourceW(update, RT_MANIFEST, ManifestName, ManifestLang, data, pos.LowPart) ? S_OK : CoGetError();
+				if (!EndUpdateResourceW(update, FAILED(hr)) && SUCCEEDED(hr))
+					hr = CoGetError();
+			}
+			else
+			{
+				hr = CoGetError();
+			}
+			HeapFree(GetProcessHeap(), 0, data);
 		}
 
-		EndUpdateResourceW(update, FALSE);
-		update = NULL;
+		return hr;
+	}
+
+	HRESULT EndManifest()
+	{
+		HRESULT hr;
+
+		if (merger.IsOpen())
+		{
+			UINT nChunks;
+			const Chunk *chunks = writer.gather(&nChunks);
+			Writer merged;
+			// Leave the resource alone if nothing has changed
+			if ((hr = merger.Merge(chunks, nChunks, merged)) == S_OK)
+				hr = EndManifest(merged);
+		}
+		else if (SUCCEEDED(hr = writer.write("</assembly>\r\n")))
+		{
+			hr = EndManifest(writer);
+		}
 
 		writer.close();
-		return S_OK;
+		merger.Close();
+		return FAILED(hr) ? hr : S_OK;
 	}
 
 	void UpdateFiles(LPCWSTR folder)
@@ -580,18 +837,9 @@ class Application: ZeroInit<Application>
 					lstrcpyW(name, fd.cFileName);
 					if (PathMatchSpecW(name, p) && !PathMatchSpecW(name, q))
 					{
-						HRESULT hr = E_UNEXPECTED;
-						if (LPCWSTR name = PathEatPrefix(path, root))
-						{
-							hr = DllRegisterServer(path);
-							if (hr == S_OK && option != never)
-							{
-								hr = ManualAddFileToManifest(name);
-								if (hr == S_FALSE)
-									hr = AddFileToManifest(name);
-							}
-						}
-						WriteTo<OUTPUT>("[%08lX] %ls\r\n", hr, name);
+						HRESULT hr = AddFileTask(path);
+						if (FAILED(hr))
+							WriteTo<OUTPUT>("[", Hex(hr, 8), "] ", name, "\r\n");
 					}
 				} while (FindNextFileW(h, &fd));
 				FindClose(h);
@@ -603,21 +851,103 @@ class Application: ZeroInit<Application>
 		} while (p);
 	}
 
-	int ReportConflicts(const MultiMap &mm, LPCSTR format)
+	HRESULT AddFileTask(LPCWSTR path)
+	{
+		// Grow the array whenever the count reaches a power of two
+		if ((nTasks & (nTasks - 1)) == 0)
+		{
+			void *const p = CoTaskMemRealloc(tasks, (nTasks ? nTasks * 2 : 1) * sizeof *tasks);
+			if (p == NULL)
+				return E_OUTOFMEMORY;
+			tasks = static_cast<FileTask *>(p);
+		}
+		FileTask &task = tasks[nTasks];
+		SecureZeroMemory(&task, sizeof task);
+		HRESULT hr = SHStrDupW(path, &task.path);
+		if (SUCCEEDED(hr))
+		{
+			task.name = PathEatPrefix(task.path, root);
+			++nTasks;
+		}
+		return hr;
+	}
+
+	// Registers the files in the order they were found, and adds them to the
+	// manifest. In static mode, worker threads go ahead with loading scripts,
+	// while anything that involves the hive or the sandbox stays on this one.
+	void RegisterFiles()
+	{
+		WorkPool pool;
+		const UINT threads = WorkPool::getProcessorCount();
+		const bool pooled = statically && pool.start(LoadScripts, this, nTasks, threads, threads * 4) == S_OK;
+		for (UINT i = 0; i < nTasks; ++i)
+		{
+			FileTask &task = tasks[i];
+			if (pooled)
+				pool.wait(i);
+			else if (statically)
+				LoadScripts(this, i);
+			HRESULT hr = E_UNEXPECTED;
+			const LONGLONG start = tracer.now();
+			if (LPCWSTR name = task.name)
+			{
+				// Have the journal tell what registration of this file changes
+				hive.Checkpoint();
+				hr = DllRegisterServer(task);
+				if (hr == S_OK && option != never)
+				{
+					Trace::Scope scope(tracer, Trace::Export, PathFindFileNameW(name));
+					ULARGE_INTEGER begin;
+					writer.tell(&begin);
+					if (batch)
+					{
+						// Stage the contents of the element for the targets to copy
+						ExportCls(name);
+						ExportTlb(name);
+						ULARGE_INTEGER end;
+						writer.tell(&end);
+						task.begin = begin.LowPart;
+						task.end = end.LowPart;
+					}
+					else
+					{
+						hr = ManualAddFileToManifest(name);
+						if (hr == S_FALSE)
+							hr = AddFileToManifest(name);
+						MergeFileIntoManifest(name, begin);
+					}
+				}
+			}
+			tracer.record(Trace::File, PathFindFileNameW(task.path), start);
+			WriteTo<OUTPUT>("[", Hex(hr, 8), "] ", PathFindFileNameW(task.path), "\r\n");
+			FreeScripts(task);
+			task.hr = hr;
+			if (pooled)
+				pool.release();
+		}
+		pool.stop();
+	}
+
+	void FreeTasks()
+	{
+		for (UINT i = 0; i < nTasks; ++i)
+			CoTaskMemFree(tasks[i].path);
+		CoTaskMemFree(tasks);
+		tasks = NULL;
+		nTasks = 0;
+	}
+
+	int ReportConflicts(const MultiMap &mm, LPCSTR what)
 	{
 		int count = 0;
 		int n = mm.GetItemCount();
 		for (int i = 0; i < n; ++i)
 		{
-			WCHAR key[MAX_PATH];
-			if (BSTR bstr = mm.GetItem(key, i))
+			LPCWSTR const val = mm.GetItem(i);
+			if (StrChrW(val, mm.separator) != NULL)
 			{
-				if (StrChrW(bstr, mm.separator) != NULL)
-				{
-					WriteTo<OUTPUT>(format, key, bstr);
-					++count;
-				}
-				SysFreeString(bstr);
+				WriteTo<OUTPUT>("\r\n", what, " ", mm.GetKey(i), " conflicts between:\r\n<", val, ">");
+				++count;
 			}
 		}
 		return count;
@@ -629,27 +959,21 @@ class Application: ZeroInit<Application>
 		if (folder)
 			*folder++ = L'\0';
 		GetFullPathNameW(target, _countof(root), root, &target);
+		target[-1] = L'\0';
 		HRESULT hr = S_OK;
 		if (option != never)
 			hr = BeginManifest();
-		target[-1] = L'\0';
 		SetDllDirectoryW(root);
 		if (hr == S_OK)
 		{
-			// Keep Visual Leak Detector resident throughout process lifetime
-#ifdef _WIN64
-			static const WCHAR vldlib[] = L"vld_x64";
-#else
-			static const WCHAR vldlib[] = L"vld_x86";
-#endif
-			if (HMODULE h = LoadLibraryW(vldlib))
-				if (FARPROC f = GetProcAddress(h, vldoption))
-					reinterpret_cast<void(*)()>(f)();
-
+			LoadLeakDetector();
 			if (option != never)
 			{
+				ULARGE_INTEGER begin;
+				writer.tell(&begin);
 				hr = ManualAddFileToManifest(target);
-				WriteTo<OUTPUT>("[%08lX] %ls\r\n", hr, target);
+				MergeFileIntoManifest(target, begin);
+				WriteTo<OUTPUT>("[", Hex(hr, 8), "] ", target, "\r\n");
 			}
 			do
 			{
@@ -659,118 +983,667 @@ class Application: ZeroInit<Application>
 				UpdateFiles(folder);
 				folder = separator ? separator + 1 : NULL;
 			} while(folder);
+			OpenCache();
+			RegisterFiles();
+			FreeTasks();
+			SaveCache();
 			if (option != never)
+			{
+				Trace::Scope scope(tracer, Trace::Manifest, target);
 				hr = EndManifest();
+			}
+			ReportIssues();
+		}
+		return hr;
+	}
 
-			WriteTo<OUTPUT>("\r\nIssues:");
-			int count = 0;
-			count += ReportConflicts(clsmm, "\r\nclsid %ls conflicts between:\r\n<%ls>");
-			count += ReportConflicts(progmm, "\r\nprogid %ls conflicts between:\r\n<%ls>");
-			count += ReportConflicts(tlbmm, "\r\ntlbid %ls conflicts between:\r\n<%ls>");
-			if (count == 0)
-				WriteTo<OUTPUT>(" none");
-			WriteTo<OUTPUT>("\r\n");
+	// Opens the cache, which need not exist yet. If it fails to open for any
+	// other reason, the run goes on without it, and leaves the file alone.
+	void OpenCache()
+	{
+		if (cache == NULL)
+			return;
+		const HRESULT hr = regcache.Open(cache);
+		if (FAILED(hr))
+		{
+			WriteTo<OUTPUT>("[", Hex(hr, 8), "] ", cache, "\r\n");
+			cache = NULL;
 		}
+	}
+
+	void SaveCache()
+	{
+		if (cache == NULL)
+			return;
+		const HRESULT hr = regcache.Save();
+		if (FAILED(hr))
+			WriteTo<OUTPUT>("[", Hex(hr, 8), "] ", cache, "\r\n");
+	}
+
+	void LoadLeakDetector()
+	{
+		// Keep Visual Leak Detector resident throughout process lifetime
+#ifdef _WIN64
+		static const WCHAR vldlib[] = L"vld_x64";
+#else
+		static const WCHAR vldlib[] = L"vld_x86";
+#endif
+		if (HMODULE h = LoadLibraryW(vldlib))
+			if (FARPROC f = GetProcAddress(h, vldoption))
+				reinterpret_cast<void(*)()>(f)();
+	}
+
+	void ReportIssues()
+	{
+		WriteTo<OUTPUT>("\r\nIssues:");
+		int count = 0;
+		count += ReportConflicts(clsmm, "clsid");
+		count += ReportConflicts(progmm, "progid");
+		count += ReportConflicts(tlbmm, "tlbid");
+		if (count == 0)
+			WriteTo<OUTPUT>(" none");
+		WriteTo<OUTPUT>("\r\n");
+		ReportRegImportStats();
+	}
+
+	// Tells how well the key path cache has done on the .reg files imported
+	void ReportRegImportStats()
+	{
+		const RegImportStats &s = regstats;
+		if (s.sections == 0)
+			return;
+		const DWORD percent = MulDiv(s.hits, 100, s.sections);
+		WriteTo<OUTPUT>("\r\nKey paths: ", static_cast<DWORD>(s.sections), " sections, ", percent, "% of them started from a cached key\r\n");
+		WriteTo<OUTPUT>("Key paths: ", static_cast<DWORD>(s.steps), " components resolved, ", static_cast<DWORD>(s.saved), " saved by the cache\r\n");
+	}
+
+	HRESULT AddTarget(LPCWSTR spec)
+	{
+		// Grow the array whenever the count reaches a power of two
+		if ((nTargets & (nTargets - 1)) == 0)
+		{
+			void *const p = CoTaskMemRealloc(targets, (nTargets ? nTargets * 2 : 1) * sizeof *targets);
+			if (p == NULL)
+				return E_OUTOFMEMORY;
+			targets = static_cast<Target *>(p);
+		}
+		Target &t = targets[nTargets];
+		SecureZeroMemory(&t, sizeof t);
+		HRESULT hr = SHStrDupW(spec, &t.spec);
+		if (SUCCEEDED(hr))
+			++nTargets;
 		return hr;
 	}
 
-	static HRESULT MayForceRemove(HKEY key, LPCWSTR name)
+	// Takes a line from a list of targets, which consists of the <target>
+	// and its subfolders, optionally followed by an /ini file of its own
+	HRESULT AddTargetLine(LPWSTR p)
 	{
-		if (PathMatchSpecW(name, L"{*}"))
+		if (*p == L'\0')
 			return S_OK;
-		if (key != HKEY_CLASSES_ROOT)
+		LPWSTR q = PathGetArgsW(p);
+		PathRemoveArgsW(p);
+		PathUnquoteSpacesW(p);
+		HRESULT hr = AddTarget(p);
+		if (SUCCEEDED(hr) && *q != L'\0')
+		{
+			LPWSTR r = PathGetArgsW(q);
+			PathRemoveArgsW(q);
+			if (lstrcmpiW(q, L"/ini") != 0 || *r == L'\0' || *PathGetArgsW(r) != L'\0')
+				return E_INVALIDARG;
+			PathUnquoteSpacesW(r);
+			hr = SHStrDupW(r, &targets[nTargets - 1].ini);
+		}
+		return hr;
+	}
+
+	HRESULT AddTargets(LPCWSTR path)
+	{
+		Reader reader;
+		HRESULT hr = reader.map(path);
+		if (FAILED(hr))
+			return hr;
+		Reader::Encoding encoding = reader.readBom();
+		BYTE eol = reader.allocCtype("\n");
+		BYTE blank = reader.allocCtype(" \t\r\n");
+		ULONG len = 0;
+		if (encoding == Reader::UCS2BE)
+		{
+			reader.swapBytes();
+			encoding = Reader::UCS2LE;
+		}
+		if (encoding == Reader::UCS2LE)
+		{
+			LPWSTR line = NULL;
+			while (SUCCEEDED(hr) && (line = reader.viewLine(eol, &len, line)) != NULL)
+			{
+				reader.trim(line, len, blank);
+				len = 0;
+				hr = AddTargetLine(line);
+			}
+		}
+		else if (encoding == Reader::ANSI || encoding == Reader::UTF8)
+		{
+			const UINT codepage = encoding == Reader::ANSI ? CP_ACP : CP_UTF8;
+			LPSTR line = NULL;
+			while (SUCCEEDED(hr) && (line = reader.viewLine(eol, &len, line)) != NULL)
+			{
+				reader.trim(line, len, blank);
+				len = 0;
+				WCHAR wide[0x1000];
+				hr = MultiByteToWideChar(codepage, 0, line, -1, wide, _countof(wide)) ? AddTargetLine(wide) : CoGetError();
+			}
+		}
+		else
+		{
+			hr = E_INVALIDARG;
+		}
+		return hr;
+	}
+
+	void FreeTargets()
+	{
+		for (UINT i = 0; i < nTargets; ++i)
+		{
+			CoTaskMemFree(targets[i].spec);
+			CoTaskMemFree(targets[i].ini);
+		}
+		CoTaskMemFree(targets);
+		targets = NULL;
+		nTargets = 0;
+		CoTaskMemFree(folders);
+		folders = NULL;
+		nFolders = 0;
+	}
+
+	void SelectTarget(const Target &t)
+	{
+		MemCopy(root, t.path, _countof(root));
+		target = root + (t.name - t.path);
+	}
+
+	Folder *FindFolder(LPCWSTR folder)
+	{
+		WCHAR path[MAX_PATH];
+		PathCombineW(path, root, folder);
+		for (UINT i = 0; i < nFolders; ++i)
+			if (lstrcmpiW(folders[i].path, path) == 0)
+				return folders + i;
+		return NULL;
+	}
+
+	// Searches a folder of the current target unless it has been searched
+	// for another target already
+	HRESULT SearchFolder(LPWSTR folder)
+	{
+		if (FindFolder(folder) != NULL)
 			return S_FALSE;
-		CLSID clsid;
-		return CLSIDFromProgID(name, &clsid);
+		// Grow the array whenever the count reaches a power of two
+		if ((nFolders & (nFolders - 1)) == 0)
+		{
+			void *const p = CoTaskMemRealloc(folders, (nFolders ? nFolders * 2 : 1) * sizeof *folders);
+			if (p == NULL)
+				return E_OUTOFMEMORY;
+			folders = static_cast<Folder *>(p);
+		}
+		Folder &f = folders[nFolders++];
+		PathCombineW(f.path, root, folder);
+		f.first = nTasks;
+		UpdateFiles(folder);
+		f.last = nTasks;
+		return S_OK;
+	}
+
+	// Returns the first of the target's subfolders, if any, and the number of
+	// subfolders to go through, which is one even if there are none
+	static LPWSTR GetFolders(const Target &t, UINT *n)
+	{
+		*n = t.nFolders ? t.nFolders : 1;
+		return t.nFolders ? t.spec + lstrlenW(t.spec) + 1 : NULL;
+	}
+
+	// Adds a file to the manifest from what has been staged on registration
+	void AddStagedFileToManifest(const FileTask &task, LPCSTR staged)
+	{
+		LPCWSTR const name = PathEatPrefix(task.path, root);
+		if (task.hr != S_OK || name == NULL)
+			return;
+		ULARGE_INTEGER begin;
+		writer.tell(&begin);
+		if (ManualAddFileToManifest(name) == S_FALSE)
+		{
+			writer.write("\t<file name=\"", name, "\">\r\n");
+			LPCSTR p = staged + task.begin;
+			LPCSTR const end = staged + task.end;
+			while (p < end)
+			{
+				LPCSTR q = p;
+				while (q < end && *q++ != '\n')
+					continue;
+				writer.writeLine(static_cast<DWORD>(q - p), p);
+				p = q;
+			}
+			writer.write("\t</file>\r\n");
+		}
+		MergeFileIntoManifest(name, begin);
 	}
 
-	HRESULT WriteValue()
+	HRESULT UpdateTarget(const Target &t, LPCSTR staged)
+	{
+		HRESULT hr = BeginManifest();
+		if (hr != S_OK)
+			return hr;
+		ULARGE_INTEGER begin;
+		writer.tell(&begin);
+		ManualAddFileToManifest(target);
+		MergeFileIntoManifest(target, begin);
+		UINT n;
+		LPWSTR folder = GetFolders(t, &n);
+		while (n != 0)
+		{
+			if (const Folder *const f = FindFolder(folder))
+			{
+				for (UINT i = f->first; i < f->last; ++i)
+					AddStagedFileToManifest(tasks[i], staged);
+			}
+			if (--n != 0)
+				folder += lstrlenW(folder) + 1;
+		}
+		Trace::Scope scope(tracer, Trace::Manifest, target);
+		return EndManifest();
+	}
+
+	// Updates the manifests of a number of targets from a single pass over
+	// the files in their subfolders. Each folder is searched only once, and
+	// each file is registered only once, with the contents of its element
+	// staged for every target which takes in the file to copy them from.
+	HRESULT UpdateTargets()
+	{
+		HRESULT hr = S_OK;
+		for (UINT i = 0; i < nTargets; ++i)
+		{
+			Target &t = targets[i];
+			for (LPWSTR p = t.spec; (p = StrChrW(p, L';')) != NULL; ++t.nFolders)
+				*p++ = L'\0';
+			if (GetFullPathNameW(t.spec, _countof(t.path), t.path, &t.name) == 0 || t.name == NULL)
+				return E_INVALIDARG;
+			t.name[-1] = L'\0';
+			SelectTarget(t);
+			UINT n;
+			LPWSTR folder = GetFolders(t, &n);
+			while (n != 0)
+			{
+				// S_FALSE tells that another target shares the folder
+				const HRESULT hrFolder = SearchFolder(folder);
+				if (FAILED(hrFolder))
+					return hrFolder;
+				if (--n != 0)
+					folder += lstrlenW(folder) + 1;
+			}
+		}
+		// Register the files from the first target's point of view
+		SelectTarget(targets[0]);
+		SetDllDirectoryW(root);
+		LoadLeakDetector();
+		if (option != never)
+		{
+			if (FAILED(hr = writer.open()))
+				return hr;
+			writer.setTabWidth(0);
+			writer.setCodePage(CP_UTF8);
+		}
+		OpenCache();
+		RegisterFiles();
+		SaveCache();
+		if (option != never)
+		{
+			// Move what has been staged out of the way of the manifests
+			ULARGE_INTEGER size;
+			UINT nChunks;
+			const Chunk *const chunks = writer.gather(&nChunks);
+			char *const staged = SUCCEEDED(writer.tell(&size)) ?
+				static_cast<char *>(HeapAlloc(GetProcessHeap(), 0, size.LowPart + 1)) : NULL;
+			if (staged != NULL)
+			{
+				char *p = staged;
+				for (UINT i = 0; i < nChunks; ++i)
+				{
+					MemCopy(p, reinterpret_cast<const char *>(chunks[i].data), chunks[i].cb);
+					p += chunks[i].cb;
+				}
+				writer.close();
+				const LPWSTR shared = ini;
+				for (UINT i = 0; i < nTargets; ++i)
+				{
+					const Target &t = targets[i];
+					SelectTarget(t);
+					if (t.ini != NULL)
+						ini = t.ini;
+					const HRESULT hrTarget = UpdateTarget(t, staged);
+					WriteTo<OUTPUT>("[", Hex(hrTarget, 8), "] ", target, "\r\n");
+					if (FAILED(hrTarget))
+						hr = hrTarget;
+					ini = shared;
+				}
+				HeapFree(GetProcessHeap(), 0, staged);
+			}
+			else
+			{
+				hr = E_OUTOFMEMORY;
+			}
+			writer.close();
+		}
+		// Leave %ROOT% to mean the first target's folder in the RGS file
+		SelectTarget(targets[0]);
+		FreeTasks();
+		ReportIssues();
+		return hr;
+	}
+
+	HRESULT MayForceRemove(Hive::Key *outerkey, Hive::Key *key)
+	{
+		GUID guid;
+		if (ParseGuid(key->name, guid))
+			return S_OK;
+		if (outerkey != classes)
+			return S_FALSE;
+		// Tell a ProgID by its CLSID subkey, same as CLSIDFromProgID does
+		return hive.GetString(key, L"CLSID", NULL) ? S_OK : CO_E_CLASSSTRING;
+	}
+
+	HRESULT WriteValue(Writer &out, const Hive::Value *value)
 	{
 		HRESULT hr = S_OK;
-		switch (vb.type)
+		switch (value->type)
 		{
 		case REG_SZ:
 		case REG_EXPAND_SZ:
-			if (LPCWSTR name = PathEatPrefix(vb.s, root))
-				hr = writer.write(" = s '%%ROOT%%%ls'", name);
+			if (LPCWSTR name = PathEatPrefix(reinterpret_cast<LPCWSTR>(value->data), root))
+				hr = out.write(" = s '%ROOT%", name, "'");
 			else
-				hr = writer.write(" = s '%ls'", vb.s);
+				hr = out.write(" = s '", reinterpret_cast<LPCWSTR>(value->data), "'");
 			break;
 		case REG_DWORD:
-			hr = writer.write(" = d '%lu'", vb.d);
-			break;
+			// Anything short of a DWORD goes out as the bytes it consists of
+			if (value->cb >= sizeof(DWORD))
+			{
+				hr = out.write(" = d '", *reinterpret_cast<const DWORD *>(value->data), "'");
+				break;
+			}
+			// fall through
 		case REG_BINARY:
-			hr = writer.write(" = b '");
-			for (DWORD i = 0; i < vb.cb; ++i)
-				hr = writer.write("%02X", vb.b[i]);
-			hr = writer.write("'");
+			hr = out.write(" = b '", HexBytes(value->data, value->cb), "'");
 			break;
 		}
 		return hr;
 	}
 
-	HRESULT WriteValue(HKEY key, LPCWSTR name)
+	static LPCSTR GetScriptPrefix(HRESULT hr)
 	{
-		HRESULT hr = S_OK;
-		if (0 == RegQueryValueExW(key, name, NULL, &vb.type, vb.b, &vb.cb))
-		{
-			hr = WriteValue();
-		}
-		return hr;
+		return hr == S_FALSE ? "'" : hr == S_OK ? "ForceRemove '" : "NoRemove '";
 	}
 
-	HRESULT WriteScript(HKEY outerkey, LPCWSTR outername, int depth = 0, LPCSTR format = "%ls")
-	{
-		static const char tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
-		if (depth > sizeof tabs - 1)
-			depth = sizeof tabs - 1;
-		writer.write(depth, tabs);
-		writer.write(format, outername);
-		WriteValue(outerkey, NULL);
-		writer.write("\r\n");
-		writer.write(depth, tabs);
-		writer.write("{\r\n");
-		DWORD i = 0;
-		HKEY key;
-		WCHAR name[MAX_PATH];
-		while (0 == RegEnumKeyW(outerkey, i++, name, _countof(name)) && 0 == RegOpenKeyW(outerkey, name, &key))
-		{
-			HRESULT hr = MayForceRemove(outerkey, name);
-			WriteScript(key, name, depth + 1,
-				hr == S_FALSE ? "'%ls'" : hr == S_OK ? "ForceRemove '%ls'" : "NoRemove '%ls'");
-			RegCloseKey(key);
-		}
-		BufferCapacity<_countof(name)> namelen;
-		i = 0;
-		while (0 == RegEnumValueW(outerkey, i++, name, &namelen, NULL, &vb.type, vb.b, &vb.cb))
-		{
-			if (namelen == 0 || lstrcmpW(name, L"ManfredWasHere") == 0)
+	void WriteScriptHead(Writer &out, Hive::Key *outerkey, LPCWSTR outername, int depth, LPCSTR prefix)
+	{
+		out.write(depth, ScriptTabs);
+		out.write(prefix, outername, &"'"[*prefix == '\0']);
+		if (const Hive::Value *value = hive.QueryValue(outerkey, NULL))
+			WriteValue(out, value);
+		out.write("\r\n");
+		out.write(depth, ScriptTabs);
+		out.write("{\r\n");
+	}
+
+	void WriteScriptTail(Writer &out, Hive::Key *outerkey, int depth)
+	{
+		for (UINT i = 0; i < outerkey->nValues; ++i)
+		{
+			const Hive::Value *const value = outerkey->values + i;
+			if (*value->name == L'\0')
 				continue;
 			// write only values of supported types
-			if ((1 << vb.type) & (1 << REG_SZ | 1 << REG_EXPAND_SZ | 1 << REG_DWORD | 1 << REG_BINARY))
+			if ((1 << value->type) & (1 << REG_SZ | 1 << REG_EXPAND_SZ | 1 << REG_DWORD | 1 << REG_BINARY))
+			{
+				out.write(depth + 1, ScriptTabs);
+				out.write("val '", value->name, "'");
+				WriteValue(out, value);
+				out.write("\r\n");
+			}
+		}
+		out.write(depth, ScriptTabs);
+		out.write("}\r\n");
+	}
+
+	// Writes the subtrees of a range of subkeys. This only reads from the
+	// hive, so it can run on several threads at once.
+	void WriteScript(Writer &out, Hive::Key *outerkey, UINT first, UINT last, int depth)
+	{
+		for (UINT i = first; i < last; ++i)
+		{
+			Hive::Key *const key = outerkey->keys[i];
+			WriteScript(out, key, key->name, depth,
+				GetScriptPrefix(MayForceRemove(outerkey, key)));
+		}
+	}
+
+	void WriteScript(Writer &out, Hive::Key *outerkey, LPCWSTR outername, int depth, LPCSTR prefix)
+	{
+		if (depth > ScriptDepth)
+			depth = ScriptDepth;
+		WriteScriptHead(out, outerkey, outername, depth, prefix);
+		WriteScript(out, outerkey, 0, outerkey->nKeys, depth + 1);
+		WriteScriptTail(out, outerkey, depth);
+	}
+
+	static void CALLBACK WriteScriptPart(void *context, UINT index)
+	{
+		Application &app = *static_cast<Application *>(context);
+		ScriptPart &part = app.parts[index];
+		Writer out;
+		part.hr = out.open();
+		if (FAILED(part.hr))
+			return;
+		app.WriteScript(out, part.key, part.first, part.last, 2);
+		// Piece the output together for the consumer to copy in one go
+		ULARGE_INTEGER size;
+		UINT nChunks;
+		const Chunk *const chunks = out.gather(&nChunks);
+		out.tell(&size);
+		if ((part.data = static_cast<char *>(HeapAlloc(GetProcessHeap(), 0, size.LowPart + 1))) == NULL)
+		{
+			part.hr = E_OUTOFMEMORY;
+			return;
+		}
+		for (UINT i = 0; i < nChunks; ++i)
+		{
+			MemCopy(part.data + part.cb, reinterpret_cast<const char *>(chunks[i].data), chunks[i].cb);
+			part.cb += chunks[i].cb;
+		}
+	}
+
+	// Cuts the subkeys of the top-level keys into slices, for worker threads
+	// to write the subtrees of concurrently
+	HRESULT GetScriptParts(Hive::Key *outerkey)
+	{
+		UINT n = 0;
+		for (UINT i = 0; i < outerkey->nKeys; ++i)
+			n += (outerkey->keys[i]->nKeys + ScriptSlice - 1) / ScriptSlice;
+		if (n == 0)
+			return S_FALSE;
+		if ((parts = static_cast<ScriptPart *>(CoTaskMemAlloc(n * sizeof *parts))) == NULL)
+			return E_OUTOFMEMORY;
+		SecureZeroMemory(parts, n * sizeof *parts);
+		for (UINT i = 0; i < outerkey->nKeys; ++i)
+		{
+			Hive::Key *const key = outerkey->keys[i];
+			for (UINT first = 0; first < key->nKeys; first += ScriptSlice)
 			{
-				writer.write(depth + 1, tabs);
-				writer.write("val '%ls'", name);
-				WriteValue();
-				writer.write("\r\n");
+				ScriptPart &part = parts[nParts++];
+				part.key = key;
+				part.first = first;
+				part.last = key->nKeys - first > ScriptSlice ? first + ScriptSlice : key->nKeys;
 			}
 		}
-		writer.write(depth, tabs);
-		writer.write("}\r\n");
 		return S_OK;
 	}
 
+	void FreeScriptParts()
+	{
+		for (UINT i = 0; i < nParts; ++i)
+			HeapFree(GetProcessHeap(), 0, parts[i].data);
+		CoTaskMemFree(parts);
+		parts = NULL;
+		nParts = 0;
+	}
+
+	// Writes the top-level keys on this thread, while worker threads write
+	// the slices of their subkeys into buffers of their own. The buffers are
+	// copied out in order, so the output is the same as from a serial run.
+	HRESULT WriteScript(Hive::Key *outerkey, LPCWSTR outername)
+	{
+		HRESULT hr = GetScriptParts(outerkey);
+		if (FAILED(hr))
+			return hr;
+		WorkPool pool;
+		const UINT threads = WorkPool::getProcessorCount();
+		const bool pooled = pool.start(WriteScriptPart, this, nParts, threads, threads * 4) == S_OK;
+		WriteScriptHead(writer, outerkey, outername, 0, "");
+		UINT k = 0;
+		for (UINT i = 0; i < outerkey->nKeys; ++i)
+		{
+			Hive::Key *const key = outerkey->keys[i];
+			WriteScriptHead(writer, key, key->name, 1, GetScriptPrefix(MayForceRemove(outerkey, key)));
+			for (; k < nParts && parts[k].key == key; ++k)
+			{
+				ScriptPart &part = parts[k];
+				if (pooled)
+					pool.wait(k);
+				else
+					WriteScriptPart(this, k);
+				if (FAILED(part.hr))
+					hr = part.hr;
+				else
+					writer.write(part.cb, part.data);
+				HeapFree(GetProcessHeap(), 0, part.data);
+				part.data = NULL;
+				if (pooled)
+					pool.release();
+			}
+			WriteScriptTail(writer, key, 1);
+		}
+		WriteScriptTail(writer, outerkey, 0);
+		pool.stop();
+		FreeScriptParts();
+		return FAILED(hr) ? hr : S_OK;
+	}
+
 	HRESULT WriteScript()
 	{
 		writer.setTabWidth(0);
+		// The registrar reads scripts in the ANSI code page
+		writer.setCodePage(CP_ACP);
 		HRESULT hr = SHCreateStreamOnFileEx(rgs,
 			STGM_CREATE | STGM_WRITE | STGM_SHARE_DENY_WRITE,
 			FILE_ATTRIBUTE_NORMAL, FALSE, NULL, &writer);
 		if (SUCCEEDED(hr))
 		{
-			WriteScript(HKEY_CLASSES_ROOT, L"HKCR");
+			// Catch up on changes to keys which existed before registration,
+			// so the hive holds still while the script is being written
+			hive.Capture(HKEY_LOCAL_MACHINE);
+			// Look up HKCR here, as doing so may add it to the hive, which
+			// must not happen while worker threads are reading from it
+			classes = hive.GetClassesRoot();
+			hr = WriteScript(classes, L"HKCR");
 			writer.close();
 		}
+		return SUCCEEDED(hr) ? S_OK : hr;
+	}
+
+	// Applies an RGS file as written by WriteScript() right to the registry,
+	// rather than through the registrar, which makes a round trip per token
+	HRESULT ApplyScript()
+	{
+		LPWSTR name;
+		if (GetFullPathNameW(target, _countof(root), root, &name) == 0 || name == NULL)
+			return CoGetError();
+		// Leave the backslash in place, as WriteScript() eats it along with the root
+		*name = L'\0';
+		HANDLE file = CreateFileW(apply, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return CoGetError();
+		HRESULT hr = S_OK;
+		BSTR script = NULL;
+		LARGE_INTEGER li;
+		if (!GetFileSizeEx(file, &li))
+		{
+			hr = CoGetError();
+		}
+		else if (li.HighPart != 0)
+		{
+			hr = HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+		}
+		else if (HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL))
+		{
+			if (const BYTE *view = static_cast<const BYTE *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)))
+			{
+				const RgsReplacement replacements[] =
+				{
+					{ L"ROOT", root },
+				};
+				hr = ExpandRgsScript(view, li.LowPart, replacements, _countof(replacements), &script);
+				UnmapViewOfFile(view);
+			}
+			else
+			{
+				hr = CoGetError();
+			}
+			CloseHandle(mapping);
+		}
+		else
+		{
+			hr = CoGetError();
+		}
+		CloseHandle(file);
+		if (SUCCEEDED(hr))
+			hr = ApplyRgsScript(HKEY_CLASSES_ROOT, script);
+		SysFreeString(script);
+		return hr;
+	}
+
+	static void WriteTypeLibIndex(TYPEKIND typekind, WORD flags, LPCWSTR type, LPCWSTR lib, LPCWSTR index)
+	{
+		const char *prefix = NULL;
+		switch (typekind)
+		{
+		case TKIND_COCLASS:
+			prefix = "int const CComTypeInfoHolderLib<&CLSID_";
+			break;
+		case TKIND_DISPATCH:
+			if ((flags & TYPEFLAG_FDUAL) == 0)
+			{
+				prefix = "int const CComTypeInfoHolderLib<&DIID_";
+				break;
+			}
+			// fall through
+		case TKIND_INTERFACE:
+			prefix = "int const CComTypeInfoHolderLib<&IID_";
+			break;
+		}
+		if (prefix)
+			WriteTo<STD_OUTPUT_HANDLE>(prefix, type, ", &LIBID_", lib, ">::TypeLibIndex = SetTypeLibIndex(", index, ");\r\n");
+	}
+
+	static HRESULT WriteTypeLibIndex(const TypeLib &typelib, LPCWSTR index)
+	{
+		WCHAR lib[256];
+		typelib.getName(lib, _countof(lib));
+		UINT count = typelib.getTypeInfoCount();
+		for (UINT i = 0; i < count; ++i)
+		{
+			WCHAR type[256];
+			if (typelib.getTypeName(i, type, _countof(type)) != 0)
+				WriteTypeLibIndex(typelib.getTypeKind(i), typelib.getTypeFlags(i), type, lib, index);
+		}
 		return S_OK;
 	}
 
@@ -793,27 +1666,7 @@ class Application: ZeroInit<Application>
 					{
 						Scoped2<BSTR, eBSTR> bstrType;
 						if (SUCCEEDED(pTypeInfo->GetDocumentation(MEMBERID_NIL, &bstrType, NULL, NULL, NULL)))
-						{
-							const char *format = NULL;
-							switch (pTypeAttr->typekind)
-							{
-							case TKIND_COCLASS:
-								format = "int const CComTypeInfoHolderLib<&CLSID_%ls, &LIBID_%ls>::TypeLibIndex = SetTypeLibIndex(%ls);\r\n";
-								break;
-							case TKIND_DISPATCH:
-								if ((pTypeAttr->wTypeFlags & TYPEFLAG_FDUAL) == 0)
-								{
-									format = "int const CComTypeInfoHolderLib<&DIID_%ls, &LIBID_%ls>::TypeLibIndex = SetTypeLibIndex(%ls);\r\n";
-									break;
-								}
-								// fall through
-							case TKIND_INTERFACE:
-								format = "int const CComTypeInfoHolderLib<&IID_%ls, &LIBID_%ls>::TypeLibIndex = SetTypeLibIndex(%ls);\r\n";
-								break;
-							}
-							if (format)
-								WriteTo<STD_OUTPUT_HANDLE>(format, *&bstrType, *&bstrLib, PathFindFileNameW(path));
-						}
+							WriteTypeLibIndex(pTypeAttr->typekind, pTypeAttr->wTypeFlags, bstrType, bstrLib, PathFindFileNameW(path));
 						pTypeInfo->ReleaseTypeAttr(pTypeAttr);
 					}
 					pTypeInfo->Release();
@@ -824,28 +1677,43 @@ class Application: ZeroInit<Application>
 		return hr;
 	}
 
-	static BOOL CALLBACK EnumResNameProc(HMODULE module, LPCWSTR type, LPWSTR name, LONG_PTR param)
+	HRESULT EnumTypeLibs()
 	{
-		if (IS_INTRESOURCE(name))
+		PEImage image;
+		HRESULT hr = image.open(target);
+		if (FAILED(hr))
+			return hr;
+		const IMAGE_RESOURCE_DIRECTORY *const dir = image.getDirectory(image.findEntry(image.getRoot(), L"TYPELIB"));
+		UINT n = image.getCount(dir);
+		for (UINT i = 0; i < n; ++i)
 		{
-			WCHAR path[MAX_PATH + 8];
-			wnsprintfW(path, _countof(path), L"%s\\%d", param, reinterpret_cast<ATOM>(name));
-			WriteTypeLibIndex(path);
+			const IMAGE_RESOURCE_DIRECTORY_ENTRY *const entry = image.getEntry(dir, i);
+			if ((entry->Name & IMAGE_RESOURCE_NAME_IS_STRING) == 0)
+			{
+				WCHAR path[MAX_PATH + 8];
+				wnsprintfW(path, _countof(path), L"%s\\%d", target, static_cast<WORD>(entry->Name));
+				// Read the type library right from the image unless it is in a
+				// format which only LoadTypeLib knows how to deal with
+				DWORD cb = 0;
+				const BYTE *const data = image.getData(image.findEntry(image.getDirectory(entry), NULL), &cb);
+				TypeLib typelib;
+				if (typelib.open(data, cb) == S_OK)
+					WriteTypeLibIndex(typelib, PathFindFileNameW(path));
+				else
+					WriteTypeLibIndex(path);
+			}
 		}
-		return TRUE;
+		return S_OK;
 	}
 
-	HRESULT EnumTypeLibs()
+public:
+	~Application()
 	{
-		HMODULE module = LoadLibraryEx(target, NULL, LOAD_LIBRARY_AS_DATAFILE);
-		if (module == NULL)
-			return CoGetError();
-		EnumResourceNamesW(module, L"TYPELIB", EnumResNameProc, reinterpret_cast<LONG_PTR>(target));
-		FreeLibrary(module);
-		return S_OK;
+		FreeTasks();
+		FreeTargets();
+		CoTaskMemFree(typelibs);
 	}
 
-public:
 	HRESULT Run(const LPWSTR cmdline)
 	{
 		LPWSTR *parg = &target;
@@ -862,7 +1730,13 @@ public:
 			}
 			else if (*p != L'/')
 			{
-				if (const LPWSTR arg = *parg)
+				if (parg == NULL)
+				{
+					// Take another target, or the ones listed in a file
+					if (FAILED(*p == L'@' ? AddTargets(p + 1) : AddTarget(p)))
+						break;
+				}
+				else if (const LPWSTR arg = *parg)
 				{
 					if (sep == '\0')
 						break;
@@ -881,8 +1755,19 @@ public:
 				else
 				{
 					*parg = p;
+					// Give way to more targets once an option has its value
+					if (batch && sep == L'\0')
+						parg = NULL;
 				}
 			}
+			else if (lstrcmpiW(p + 1, L"batch") == 0)
+			{
+				if (target != NULL && FAILED(AddTarget(target)))
+					break;
+				target = NULL;
+				batch = true;
+				parg = NULL;
+			}
 			else if (lstrcmpiW(p + 1, L"keep") == 0)
 			{
 				sep = L';';
@@ -910,10 +1795,29 @@ public:
 				sep = L'\0';
 				parg = &rgs;
 			}
+			else if (lstrcmpiW(p + 1, L"cache") == 0)
+			{
+				sep = L'\0';
+				parg = &cache;
+			}
+			else if (lstrcmpiW(p + 1, L"trace") == 0)
+			{
+				sep = L'\0';
+				parg = &trace;
+			}
+			else if (lstrcmpiW(p + 1, L"apply") == 0)
+			{
+				sep = L'\0';
+				parg = &apply;
+			}
 			else if (lstrcmpiW(p + 1, L"once") == 0)
 				option = once;
 			else if (lstrcmpiW(p + 1, L"never") == 0)
 				option = never;
+			else if (lstrcmpiW(p + 1, L"merge") == 0)
+				option = merge;
+			else if (lstrcmpiW(p + 1, L"static") == 0)
+				statically = true;
 			else if (lstrcmpiW(p + 1, L"vld+") == 0)
 				vldoption = "VLDEnable";
 			else if (lstrcmpiW(p + 1, L"vld-") == 0)
@@ -924,19 +1828,38 @@ public:
 		} while (*p != L'\0');
 
 		// If no target was specified, or unconsumed arguments exist, give up.
-		if (target == NULL || *p != L'\0')
+		if ((target == NULL && nTargets == 0) || *p != L'\0')
 		{
-			WriteTo<OUTPUT>(usage, appname);
+			WriteTo<OUTPUT>(usage, appname, syntax);
 			return E_FAIL;
 		}
 
+		if (apply != NULL)
+		{
+			HRESULT hr = ApplyScript();
+			WriteTo<OUTPUT>("[", Hex(hr, 8), "] ", apply, "\r\n");
+			return hr;
+		}
+
 		if (files == NULL)
 		{
-			return EnumTypeLibs();
+			if (!batch)
+				return EnumTypeLibs();
+			for (UINT i = 0; i < nTargets; ++i)
+			{
+				if (LPWSTR separator = StrChrW(targets[i].spec, L';'))
+					*separator = L'\0';
+				target = targets[i].spec;
+				EnumTypeLibs();
+			}
+			return S_OK;
 		}
 
-		WriteTo<OUTPUT>("target = %ls\r\n", target);
-		WriteTo<OUTPUT>("files = %ls\r\n", files);
+		if (!batch)
+			WriteTo<OUTPUT>("target = ", target, "\r\n");
+		for (UINT i = 0; i < nTargets; ++i)
+			WriteTo<OUTPUT>("target = ", targets[i].spec, "\r\n");
+		WriteTo<OUTPUT>("files = ", files, "\r\n");
 
 		// Fail gracefully if not running as administrator
 		BOOL fIsRunAsAdmin = FALSE;
@@ -957,16 +1880,31 @@ public:
 			return S_OK;
 		}
 
+		if (trace != NULL)
+		{
+			HRESULT hr = tracer.open(trace);
+			if (FAILED(hr))
+				WriteTo<OUTPUT>("[", Hex(hr, 8), "] ", trace, "\r\n");
+		}
+
 		Appartment appartment;
 		HRESULT hr = appartment.GetHResult();
 		if (SUCCEEDED(hr))
 		{
-			hr = UpdateFiles();
+			hr = batch ? UpdateTargets() : UpdateFiles();
 			if (hr == S_OK && rgs != NULL)
 			{
+				Trace::Scope scope(tracer, Trace::Script, PathFindFileNameW(rgs));
 				hr = WriteScript();
 			}
 		}
+
+		if (tracer.active())
+		{
+			StdWriter<OUTPUT> out;
+			tracer.summarize(out);
+			tracer.close();
+		}
 		return hr;
 	}
 };
@@ -0,0 +1,320 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Merges the <file> elements generated on a run into an existing manifest.
+// The manifest is copied once, since the file it comes from gets rewritten,
+// and its <file> elements are indexed by name as offsets into that copy. On
+// merging, the elements of the files which have been processed take the place
+// of their former selves, those of new files go after the last existing one,
+// and everything else stays as it is, including the elements of files which
+// have not been processed and any content which has been edited by hand.
+// Names compare case-insensitively as far as ASCII is concerned.
+class ManifestMerge
+{
+public:
+	ManifestMerge()
+	: heap(HeapCreate(HEAP_NO_SERIALIZE, 0, 0)), text(NULL), cbText(0), names(NULL)
+	, entries(NULL), nEntries(0), table(NULL), mask(0), added(NULL), nAdded(0)
+	{
+	}
+	~ManifestMerge()
+	{
+		if (heap != NULL)
+			HeapDestroy(heap);
+	}
+
+	void Close()
+	{
+		void *const blocks[] = { text, names, entries, table, added };
+		for (UINT i = 0; i < _countof(blocks); ++i)
+			if (blocks[i] != NULL)
+				HeapFree(heap, 0, blocks[i]);
+		text = NULL;
+		cbText = 0;
+		names = NULL;
+		entries = NULL;
+		nEntries = 0;
+		table = NULL;
+		mask = 0;
+		added = NULL;
+		nAdded = 0;
+	}
+
+	// Returns S_FALSE if there are no <file> elements to merge into
+	HRESULT Open(const char *p, DWORD cb)
+	{
+		Close();
+		if (heap == NULL)
+			return E_OUTOFMEMORY;
+		if ((text = static_cast<char *>(HeapAlloc(heap, 0, cb))) == NULL)
+			return E_OUTOFMEMORY;
+		MemCopy(text, p, cb);
+		cbText = cb;
+		// Names can't take more WCHARs than there are bytes to the manifest
+		if ((names = static_cast<LPWSTR>(HeapAlloc(heap, 0, (cb + 1) * sizeof(WCHAR)))) == NULL)
+			return E_OUTOFMEMORY;
+		LPWSTR name = names;
+		static const char tag[] = "<file ";
+		static const char attr[] = " name=";
+		static const char etag[] = "</file>";
+		const char *const end = text + cb;
+		const char *q = text;
+		while ((q = MemSearch(q, end - q, tag, sizeof tag - 1)) != NULL)
+		{
+			// Take in the indentation if the element starts on a line of its own
+			const char *begin = q;
+			while (begin > text && (begin[-1] == ' ' || begin[-1] == '\t'))
+				--begin;
+			if (begin > text && begin[-1] != '\n')
+				begin = q;
+			const char *const gt = MemSearch(q, end - q, ">", 1);
+			if (gt == NULL)
+				break;
+			const char *after = gt + 1;
+			if (gt[-1] != '/')
+			{
+				if ((after = MemSearch(gt, end - gt, etag, sizeof etag - 1)) == NULL)
+					break;
+				after += sizeof etag - 1;
+			}
+			// Take in the line break, same as the writer puts it out
+			if (after < end && *after == '\r')
+				++after;
+			if (after < end && *after == '\n')
+				++after;
+			const char *value = MemSearch(q, gt - q, attr, sizeof attr - 1);
+			if (value != NULL && (value += sizeof attr - 1) < gt && (*value == '"' || *value == '\''))
+			{
+				const char quote = *value++;
+				const char *const close = MemSearch(value, gt - value, &quote, 1);
+				if (close != NULL && close > value)
+				{
+					const int len = MultiByteToWideChar(CP_UTF8, 0, value, static_cast<int>(close - value), name, static_cast<int>(close - value));
+					name[len] = L'\0';
+					if (len != 0 && !Insert(name, static_cast<DWORD>(begin - text), static_cast<DWORD>(after - text)))
+						return E_OUTOFMEMORY;
+					name += len + 1;
+				}
+			}
+			q = after;
+		}
+		return nEntries != 0 && Rehash() ? S_OK : S_FALSE;
+	}
+
+	bool IsOpen() const
+	{
+		return table != NULL;
+	}
+
+	// Notes where in the generated output the element for a file has gone
+	bool Replace(LPCWSTR name, DWORD begin, DWORD end)
+	{
+		const UINT hash = Hash(name);
+		UINT i = hash;
+		while (const UINT index = table[i & mask])
+		{
+			Entry &entry = entries[index - 1];
+			if (entry.newEnd == 0 && entry.hash == hash && Equal(entry.name, name))
+			{
+				entry.newBegin = begin;
+				entry.newEnd = end;
+				return true;
+			}
+			++i;
+		}
+		// Grow the array whenever the count reaches a power of two
+		if (nAdded == 0 || (nAdded >= 16 && (nAdded & (nAdded - 1)) == 0))
+		{
+			const SIZE_T cb = (nAdded ? nAdded * 2 : 16) * sizeof *added;
+			void *const p = added != NULL ? HeapReAlloc(heap, 0, added, cb) : HeapAlloc(heap, 0, cb);
+			if (p == NULL)
+				return false;
+			added = static_cast<Range *>(p);
+		}
+		added[nAdded].begin = begin;
+		added[nAdded].end = end;
+		++nAdded;
+		return true;
+	}
+
+	// Writes the merged manifest to the given writer, pulling the generated
+	// elements from the given chunks. Returns S_FALSE if the result is the
+	// same as what is already there.
+	HRESULT Merge(const Chunk *chunks, UINT nChunks, Writer &out) const
+	{
+		HRESULT hr = out.open();
+		const DWORD last = entries[nEntries - 1].end;
+		DWORD pos = 0;
+		for (UINT i = 0; SUCCEEDED(hr) && i < nEntries; ++i)
+		{
+			const Entry &entry = entries[i];
+			if (entry.newEnd == 0)
+				continue;
+			if (SUCCEEDED(hr = out.write(entry.begin - pos, text + pos)))
+				hr = Copy(out, chunks, nChunks, entry.newBegin, entry.newEnd);
+			pos = entry.end;
+		}
+		if (SUCCEEDED(hr) && pos < last)
+		{
+			hr = out.write(last - pos, text + pos);
+			pos = last;
+		}
+		for (UINT i = 0; SUCCEEDED(hr) && i < nAdded; ++i)
+			hr = Copy(out, chunks, nChunks, added[i].begin, added[i].end);
+		if (SUCCEEDED(hr))
+			hr = out.write(cbText - pos, text + pos);
+		if (SUCCEEDED(hr) && nAdded == 0)
+			hr = Compare(out);
+		return hr;
+	}
+
+private:
+	ManifestMerge(const ManifestMerge &);
+	void operator=(const ManifestMerge &);
+
+	struct Range
+	{
+		DWORD begin;
+		DWORD end;
+	};
+
+	struct Entry
+	{
+		LPCWSTR name;
+		UINT hash;
+		DWORD begin;
+		DWORD end;
+		DWORD newBegin;
+		DWORD newEnd; // zero unless the element has been generated anew
+	};
+
+	static WCHAR Fold(WCHAR c)
+	{
+		return c >= L'a' && c <= L'z' ? c - (L'a' - L'A') : c;
+	}
+	static UINT Hash(LPCWSTR name)
+	{
+		UINT hash = 2166136261U;
+		while (const WCHAR c = *name++)
+			hash = (hash ^ Fold(c)) * 16777619U;
+		return hash;
+	}
+	static bool Equal(LPCWSTR p, LPCWSTR q)
+	{
+		while (Fold(*p) == Fold(*q))
+		{
+			if (*p == L'\0')
+				return true;
+			++p;
+			++q;
+		}
+		return false;
+	}
+
+	bool Insert(LPCWSTR name, DWORD begin, DWORD end)
+	{
+		// Grow the array whenever the count reaches a power of two
+		if (nEntries == 0 || (nEntries >= 16 && (nEntries & (nEntries - 1)) == 0))
+		{
+			const SIZE_T cb = (nEntries ? nEntries * 2 : 16) * sizeof *entries;
+			void *const p = entries != NULL ? HeapReAlloc(heap, 0, entries, cb) : HeapAlloc(heap, 0, cb);
+			if (p == NULL)
+				return false;
+			entries = static_cast<Entry *>(p);
+		}
+		Entry &entry = entries[nEntries++];
+		entry.name = name;
+		entry.hash = Hash(name);
+		entry.begin = begin;
+		entry.end = end;
+		entry.newBegin = 0;
+		entry.newEnd = 0;
+		return true;
+	}
+
+	// Sets up a table which holds indices into the array of entries, offset
+	// by one so zero can tell an empty slot, and is at most half full
+	bool Rehash()
+	{
+		UINT size = 16;
+		while (size < nEntries * 2)
+			size *= 2;
+		if ((table = static_cast<UINT *>(HeapAlloc(heap, HEAP_ZERO_MEMORY, size * sizeof *table))) == NULL)
+			return false;
+		mask = size - 1;
+		for (UINT index = 0; index < nEntries; ++index)
+		{
+			UINT i = entries[index].hash;
+			while (table[i & mask] != 0)
+				++i;
+			table[i & mask] = index + 1;
+		}
+		return true;
+	}
+
+	// Copies a range of the generated output, which may span chunks
+	static HRESULT Copy(Writer &out, const Chunk *chunks, UINT nChunks, DWORD begin, DWORD end)
+	{
+		HRESULT hr = S_OK;
+		DWORD offset = 0;
+		for (UINT i = 0; SUCCEEDED(hr) && i < nChunks && offset < end; ++i)
+		{
+			const DWORD cb = chunks[i].cb;
+			if (offset + cb > begin)
+			{
+				const DWORD from = begin > offset ? begin - offset : 0;
+				const DWORD to = end - offset < cb ? end - offset : cb;
+				hr = out.write(to - from, reinterpret_cast<LPCSTR>(chunks[i].data) + from);
+			}
+			offset += cb;
+		}
+		return hr;
+	}
+
+	HRESULT Compare(const Writer &out) const
+	{
+		UINT n;
+		const Chunk *const chunks = out.gather(&n);
+		DWORD offset = 0;
+		for (UINT i = 0; i < n; ++i)
+		{
+			const DWORD cb = chunks[i].cb;
+			if (cb > cbText - offset || !MemEqual(chunks[i].data, reinterpret_cast<const BYTE *>(text + offset), cb))
+				return S_OK;
+			offset += cb;
+		}
+		return offset == cbText ? S_FALSE : S_OK;
+	}
+
+	const HANDLE heap;
+	char *text;
+	DWORD cbText;
+	LPWSTR names;
+	Entry *entries;
+	UINT nEntries;
+	UINT *table;
+	UINT mask;
+	Range *added;
+	UINT nAdded;
+};
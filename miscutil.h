@@ -22,26 +22,166 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <emmintrin.h>
+
+inline bool IsSse2Present()
+{
+#ifdef _M_X64
+	return true;
+#else
+	return IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE) != FALSE;
+#endif
+}
+
+template<typename T>
+bool MemEqual(const T *p, const T *q, size_t len)
+{
+	const T *const pEnd = p + len;
+	while (p < pEnd)
+		if (*p++ != *q++)
+			return false;
+	return true;
+}
+
+// Computes the maximal suffix of q and its period, with respect to either
+// the natural order of elements or the reverse one
+template<typename T>
+void MemMaximalSuffix(const T *q, size_t qLen, bool reverse, size_t &ms, size_t &period)
+{
+	size_t i = static_cast<size_t>(-1); // wraps around to 0 when added 1
+	size_t j = 0;
+	size_t k = 1;
+	size_t p = 1;
+	while (j + k < qLen)
+	{
+		const T a = q[i + k];
+		const T b = q[j + k];
+		if (a == b)
+		{
+			if (k == p)
+			{
+				j += p;
+				k = 1;
+			}
+			else
+			{
+				++k;
+			}
+		}
+		else if (reverse ? a < b : b < a)
+		{
+			j += k;
+			k = 1;
+			p = j - i;
+		}
+		else
+		{
+			i = j++;
+			k = p = 1;
+		}
+	}
+	ms = i;
+	period = p;
+}
+
+// Two-Way string matching (Crochemore & Perrin), which takes linear time and
+// constant space regardless of the needle
+template<typename T>
+const T *MemSearchTwoWay(const T *p, size_t pLen, const T *q, size_t qLen)
+{
+	size_t ms, period, ms2, period2;
+	MemMaximalSuffix(q, qLen, false, ms, period);
+	MemMaximalSuffix(q, qLen, true, ms2, period2);
+	if (ms2 + 1 > ms + 1)
+	{
+		ms = ms2;
+		period = period2;
+	}
+	// The left part needs to be remembered across shifts only if the needle
+	// is periodic, and otherwise allows for shifting farther
+	size_t mem0 = 0;
+	if (MemEqual(q, q + period, ms + 1))
+		mem0 = qLen - period;
+	else
+		period = (ms > qLen - ms - 1 ? ms : qLen - ms - 1) + 1;
+	size_t mem = 0;
+	const T *const pEnd = p + pLen;
+	while (static_cast<size_t>(pEnd - p) >= qLen)
+	{
+		size_t k = ms + 1 > mem ? ms + 1 : mem;
+		while (k < qLen && q[k] == p[k])
+			++k;
+		if (k < qLen)
+		{
+			p += k - ms;
+			mem = 0;
+			continue;
+		}
+		k = ms + 1;
+		while (k > mem && q[k - 1] == p[k - 1])
+			--k;
+		if (k <= mem)
+			return p;
+		p += period;
+		mem = mem0;
+	}
+	return NULL;
+}
+
 template<typename T>
 const T *MemSearch(const T *p, size_t pLen, const T *q, size_t qLen)
 {
 	if (qLen > pLen)
 		return NULL;
-	const T *pEnd = p + pLen - qLen;
-	const T *qEnd = q + qLen;
-	do
+	if (qLen == 0)
+		return p;
+	return MemSearchTwoWay(p, pLen, q, qLen);
+}
+
+// Short needles are looked for by testing 16 positions at a time for their
+// first and last characters, and checking what is in between only for those
+// positions which pass. Long ones go the Two-Way, to avoid quadratic time.
+template<>
+inline const char *MemSearch(const char *p, size_t pLen, const char *q, size_t qLen)
+{
+	if (qLen > pLen)
+		return NULL;
+	if (qLen == 0)
+		return p;
+	if (qLen > 32 || !IsSse2Present())
+		return MemSearchTwoWay(p, pLen, q, qLen);
+	const size_t n = pLen - qLen + 1; // number of positions to test
+	const size_t m = qLen - 1;
+	size_t i = 0;
+	const __m128i first = _mm_set1_epi8(q[0]);
+	const __m128i last = _mm_set1_epi8(q[m]);
+	for (; i + 16 <= n; i += 16)
 	{
-		const T *u = p;
-		const T *v = q;
-		do
+		const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+		const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i + m));
+		int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+		for (const char *r = p + i; mask != 0; ++r, mask >>= 1)
 		{
-			if (v == qEnd)
-				return p;
-		} while (*u++ == *v++);
-	} while (++p <= pEnd);
+			if ((mask & 1) != 0 && MemEqual(r + 1, q + 1, m))
+				return r;
+		}
+	}
+	for (; i < n; ++i)
+	{
+		if (p[i] == q[0] && MemEqual(p + i + 1, q + 1, m))
+			return p + i;
+	}
 	return NULL;
 }
 
+template<typename T>
+void MemCopy(T *p, const T *q, size_t qLen)
+{
+	const T *const qEnd = q + qLen;
+	while (q < qEnd)
+		*p++ = *q++;
+}
+
 template<typename T>
 void MemReverse(T *p, size_t pLen)
 {
@@ -54,6 +194,39 @@ void MemReverse(T *p, size_t pLen)
 	}
 }
 
+// Divides a 64-bit number by a 32-bit one, using only 32-bit arithmetic, as
+// there is no CRT around to provide the helper which x86 compilers call for
+// a 64-bit division
+inline ULONGLONG DivMod64(ULONGLONG n, DWORD d, DWORD *r)
+{
+	const DWORD hi = static_cast<DWORD>(n >> 32);
+	DWORD lo = static_cast<DWORD>(n);
+	DWORD rem = hi % d;
+	DWORD q = 0;
+	for (int i = 0; i < 32; ++i)
+	{
+		// The remainder may take 33 bits for a moment, so mind the carry
+		const DWORD carry = rem >> 31;
+		rem = rem << 1 | lo >> 31;
+		lo <<= 1;
+		q <<= 1;
+		if (carry || rem >= d)
+		{
+			rem -= d;
+			q |= 1;
+		}
+	}
+	*r = rem;
+	return static_cast<ULONGLONG>(hi / d) << 32 | q;
+}
+
+// A piece of data to be gathered, where NULL data stands for zero padding
+struct Chunk
+{
+	const BYTE *data;
+	DWORD cb;
+};
+
 template<DWORD size>
 class BufferCapacity
 {
@@ -22,77 +22,214 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+// Maps keys to the list of values which have been added for them, in order
+// of appearance. Keys compare case-insensitively as far as ASCII is concerned,
+// and the key's spelling is the one it has been added with first. The values
+// for a key are kept joined by separators as they come in, so they can be
+// handed out as is. All memory comes from a private heap, which is released
+// at once when the map goes away.
 class MultiMap
 {
-	const HMENU menu;
 public:
 	static const WCHAR separator = L':';
 	MultiMap()
-	: menu(CreatePopupMenu())
+	: heap(HeapCreate(HEAP_NO_SERIALIZE, 0, 0)), items(NULL), nItems(0), table(NULL), mask(0)
 	{
 	}
 	~MultiMap()
 	{
-		Clear();
-		DestroyMenu(menu);
+		if (heap != NULL)
+			HeapDestroy(heap);
 	}
 	void Add(LPCWSTR key, LPCWSTR val)
 	{
-		if (ATOM atom = AddAtomW(key))
+		UINT len = 0;
+		UINT hash = 2166136261U;
+		while (const WCHAR c = key[len++])
+			hash = (hash ^ Fold(c)) * 16777619U;
+		UINT slot;
+		if (!Lookup(hash, key, NULL, val, slot))
+			return;
+		if (Item *const item = Insert(hash, len, NULL))
 		{
-			UINT total = lstrlenW(val);
-			if (UINT len = GetMenuStringW(menu, atom, NULL, 0, MF_BYCOMMAND))
-			{
-				total += len + 1;
-				if (BSTR bstr = SysAllocStringLen(NULL, total))
-				{
-					GetMenuStringW(menu, atom, bstr, total, MF_BYCOMMAND);
-					bstr[len++] = separator;
-					lstrcpyW(bstr + len, val);
-					ModifyMenuW(menu, atom, MF_BYCOMMAND, atom, bstr);
-					SysFreeString(bstr);
-				}
-			}
-			else
-			{
-				AppendMenuW(menu, MF_STRING, atom, val);
-			}
+			lstrcpyW(item->key, key);
+			Commit(*item, slot, val);
+		}
+	}
+	// Takes a GUID for a key, which compares by its 16 bytes, and is spelled
+	// out in registry format. GUIDs never match keys which come as strings, so
+	// a map can hold both, as long as any string which is a GUID comes as one.
+	void Add(const GUID &guid, LPCWSTR val)
+	{
+		const DWORD *const p = reinterpret_cast<const DWORD *>(&guid);
+		UINT hash = 2166136261U;
+		for (int i = 0; i < 4; ++i)
+			hash = (hash ^ p[i]) * 16777619U;
+		// Let the high bits have a say in which slot the key goes to
+		hash ^= hash >> 16;
+		UINT slot;
+		if (!Lookup(hash, NULL, &guid, val, slot))
+			return;
+		if (Item *const item = Insert(hash, 39, &guid))
+		{
+			FormatGuid(guid, item->key);
+			Commit(*item, slot, val);
 		}
 	}
 	int GetItemCount() const
 	{
-		return GetMenuItemCount(menu);
+		return nItems;
+	}
+	LPCWSTR GetKey(int i) const
+	{
+		return items[i].key;
+	}
+	// Returns the values joined by separators
+	LPCWSTR GetItem(int i) const
+	{
+		return items[i].val;
 	}
-	BSTR GetItem(LPWSTR key, int i) const
+private:
+	MultiMap(const MultiMap &);
+	void operator=(const MultiMap &);
+	struct Item
 	{
-		ATOM atom = GetMenuItemID(menu, i);
-		UINT len = GetMenuStringW(menu, i, NULL, 0, MF_BYPOSITION);
-		BSTR bstr = SysAllocStringLen(NULL, len);
-		if (bstr != NULL)
+		LPWSTR key;
+		LPWSTR val;
+		UINT hash;
+		UINT len;
+		UINT cap;
+		bool binary;
+		GUID guid;
+	};
+	static WCHAR Fold(WCHAR c)
+	{
+		return c >= L'a' && c <= L'z' ? c - (L'a' - L'A') : c;
+	}
+	static bool Equal(LPCWSTR p, LPCWSTR q)
+	{
+		while (Fold(*p) == Fold(*q))
 		{
-			GetMenuStringW(menu, i, bstr, len + 1, MF_BYPOSITION);
-			if (key != NULL)
-			{
-				GetAtomNameW(atom, key, MAX_PATH);
-			}
-			else do
-			{
-				DeleteAtom(atom);
-			} while ((key = StrRChrW(bstr, key, separator)) != NULL);
+			if (*p == L'\0')
+				return true;
+			++p;
+			++q;
 		}
-		return bstr;
+		return false;
 	}
-	void Clear()
+	static bool Equal(const GUID &a, const GUID &b)
 	{
-		int i = GetItemCount();
-		while (i > 0)
+		const DWORD *const p = reinterpret_cast<const DWORD *>(&a);
+		const DWORD *const q = reinterpret_cast<const DWORD *>(&b);
+		return p[0] == q[0] && p[1] == q[1] && p[2] == q[2] && p[3] == q[3];
+	}
+	// Looks for the key, which is either a string or a GUID, and appends the
+	// value if found. Otherwise tells the slot where the key is to go. Returns
+	// whether the key is yet to be inserted.
+	bool Lookup(UINT hash, LPCWSTR key, const GUID *guid, LPCWSTR val, UINT &slot)
+	{
+		if (nItems * 2 >= mask && !Rehash())
+			return false;
+		UINT i = hash;
+		while (const UINT index = table[i & mask])
 		{
-			--i;
-			if (BSTR bstr = GetItem(NULL, i))
+			Item &item = items[index - 1];
+			if (item.hash == hash && (guid != NULL ?
+				item.binary && Equal(item.guid, *guid) :
+				!item.binary && Equal(item.key, key)))
 			{
-				SysFreeString(bstr);
+				Append(item, val);
+				return false;
 			}
-			DeleteMenu(menu, i, MF_BYPOSITION);
+			++i;
+		}
+		slot = i & mask;
+		return true;
+	}
+	// Makes room for another item, with a key of the given length, including
+	// the terminating zero
+	Item *Insert(UINT hash, UINT len, const GUID *guid)
+	{
+		// Grow the array whenever the count reaches a power of two
+		if (nItems == 0 || (nItems >= 16 && (nItems & (nItems - 1)) == 0))
+		{
+			const SIZE_T cb = (nItems ? nItems * 2 : 16) * sizeof *items;
+			void *const p = items != NULL ? HeapReAlloc(heap, 0, items, cb) : HeapAlloc(heap, 0, cb);
+			if (p == NULL)
+				return NULL;
+			items = static_cast<Item *>(p);
+		}
+		Item &item = items[nItems];
+		if ((item.key = static_cast<LPWSTR>(HeapAlloc(heap, 0, len * sizeof(WCHAR)))) == NULL)
+			return NULL;
+		item.hash = hash;
+		item.val = NULL;
+		item.len = 0;
+		item.cap = 0;
+		item.binary = guid != NULL;
+		if (guid != NULL)
+			item.guid = *guid;
+		return &item;
+	}
+	// Adds the first value to the item which Insert() has made room for, and
+	// puts the item in its slot
+	void Commit(Item &item, UINT slot, LPCWSTR val)
+	{
+		if (!Append(item, val))
+		{
+			HeapFree(heap, 0, item.key);
+			return;
+		}
+		table[slot] = ++nItems;
+	}
+	// Appends a value to the ones which are already there, while letting the
+	// buffer grow by at least a factor of two when it runs full
+	bool Append(Item &item, LPCWSTR val)
+	{
+		const UINT len = lstrlenW(val);
+		const UINT at = item.val != NULL ? item.len + 1 : 0;
+		if (at + len >= item.cap)
+		{
+			UINT cap = item.cap * 2;
+			if (cap <= at + len)
+				cap = at + len + 1;
+			const SIZE_T cb = cap * sizeof(WCHAR);
+			void *const p = item.val != NULL ? HeapReAlloc(heap, 0, item.val, cb) : HeapAlloc(heap, 0, cb);
+			if (p == NULL)
+				return false;
+			item.val = static_cast<LPWSTR>(p);
+			item.cap = cap;
+		}
+		if (at != 0)
+			item.val[item.len] = separator;
+		lstrcpyW(item.val + at, val);
+		item.len = at + len;
+		return true;
+	}
+	// Doubles the size of the table, which holds indices into the array of
+	// items, offset by one so zero can tell an empty slot
+	bool Rehash()
+	{
+		const UINT size = mask ? (mask + 1) * 2 : 256;
+		UINT *const p = static_cast<UINT *>(HeapAlloc(heap, HEAP_ZERO_MEMORY, size * sizeof *p));
+		if (p == NULL)
+			return false;
+		for (UINT index = 0; index < nItems; ++index)
+		{
+			UINT i = items[index].hash;
+			while (p[i & (size - 1)] != 0)
+				++i;
+			p[i & (size - 1)] = index + 1;
 		}
+		if (table != NULL)
+			HeapFree(heap, 0, table);
+		table = p;
+		mask = size - 1;
+		return true;
 	}
+	const HANDLE heap;
+	Item *items;
+	UINT nItems;
+	UINT *table;
+	UINT mask;
 };
@@ -0,0 +1,343 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Maps a PE/PE32+ file into memory as is, and walks its resource directory
+// in place, so all that is returned are pointers into the mapped view.
+// Everything is bounds-checked against the file size, as the files we look
+// at may come from anywhere.
+class PEImage
+{
+public:
+	PEImage(): base(NULL), size(0), nt(NULL), dirs(NULL), nDirs(0), sections(NULL), nSections(0), rsrc(NULL), rsrcRva(0), rsrcSize(0) { }
+	~PEImage() { close(); }
+
+	// Pass FILE_MAP_COPY for a view which can be patched without affecting
+	// the file
+	HRESULT open(LPCWSTR path, DWORD access = FILE_MAP_READ)
+	{
+		close();
+		HANDLE file = CreateFileW(path, GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return lastError();
+		HRESULT hr = S_OK;
+		LARGE_INTEGER li;
+		if (!GetFileSizeEx(file, &li))
+		{
+			hr = lastError();
+		}
+		else if (li.HighPart != 0 || li.LowPart < sizeof(IMAGE_DOS_HEADER))
+		{
+			hr = HRESULT_FROM_WIN32(ERROR_BAD_EXE_FORMAT);
+		}
+		else if (HANDLE mapping = CreateFileMappingW(file, NULL, access == FILE_MAP_COPY ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL))
+		{
+			if ((base = static_cast<const BYTE *>(MapViewOfFile(mapping, access, 0, 0, 0))) == NULL)
+				hr = lastError();
+			CloseHandle(mapping);
+		}
+		else
+		{
+			hr = lastError();
+		}
+		CloseHandle(file);
+		if (SUCCEEDED(hr))
+		{
+			size = li.LowPart;
+			if (FAILED(hr = parse()))
+				close();
+		}
+		return hr;
+	}
+
+	HRESULT close()
+	{
+		if (base == NULL)
+			return E_POINTER;
+		UnmapViewOfFile(base);
+		base = NULL;
+		size = 0;
+		nt = NULL;
+		dirs = NULL;
+		nDirs = 0;
+		sections = NULL;
+		nSections = 0;
+		rsrc = NULL;
+		rsrcRva = 0;
+		rsrcSize = 0;
+		return S_OK;
+	}
+
+	const BYTE *getBase() const { return base; }
+	DWORD getSize() const { return size; }
+
+	// The fields accessed through this are common to PE and PE32+, except for
+	// those which follow SizeOfStackReserve
+	const IMAGE_NT_HEADERS32 *getNtHeaders() const { return nt; }
+
+	const IMAGE_DATA_DIRECTORY *getDataDirectory(UINT i) const
+	{
+		return i < nDirs ? dirs + i : NULL;
+	}
+
+	DWORD getResourceRva() const { return rsrcRva; }
+
+	const IMAGE_RESOURCE_DIRECTORY *getRoot() const
+	{
+		return getDirectoryAt(0);
+	}
+
+	UINT getCount(const IMAGE_RESOURCE_DIRECTORY *dir) const
+	{
+		if (dir == NULL)
+			return 0;
+		const DWORD offset = static_cast<DWORD>(reinterpret_cast<const BYTE *>(dir + 1) - rsrc);
+		const UINT n = dir->NumberOfNamedEntries + dir->NumberOfIdEntries;
+		const UINT limit = (rsrcSize - offset) / sizeof(IMAGE_RESOURCE_DIRECTORY_ENTRY);
+		return n < limit ? n : limit;
+	}
+
+	const IMAGE_RESOURCE_DIRECTORY_ENTRY *getEntry(const IMAGE_RESOURCE_DIRECTORY *dir, UINT i) const
+	{
+		if (i >= getCount(dir))
+			return NULL;
+		return reinterpret_cast<const IMAGE_RESOURCE_DIRECTORY_ENTRY *>(dir + 1) + i;
+	}
+
+	// Looks up an entry by its integer or string id, or returns the first
+	// entry if the id passed is NULL
+	const IMAGE_RESOURCE_DIRECTORY_ENTRY *findEntry(const IMAGE_RESOURCE_DIRECTORY *dir, LPCWSTR id) const
+	{
+		const UINT n = getCount(dir);
+		if (n == 0)
+			return NULL;
+		if (id == NULL)
+			return getEntry(dir, 0);
+		const IMAGE_RESOURCE_DIRECTORY_ENTRY *const entries =
+			reinterpret_cast<const IMAGE_RESOURCE_DIRECTORY_ENTRY *>(dir + 1);
+		const UINT named = dir->NumberOfNamedEntries < n ? dir->NumberOfNamedEntries : n;
+		if (IS_INTRESOURCE(id))
+		{
+			// Integer ids follow the named entries, in ascending order
+			const WORD wId = static_cast<WORD>(reinterpret_cast<ULONG_PTR>(id));
+			UINT lower = named;
+			UINT upper = n;
+			while (lower < upper)
+			{
+				const UINT i = (lower + upper) / 2;
+				const WORD wCur = static_cast<WORD>(entries[i].Name);
+				if (wCur == wId)
+					return entries + i;
+				if (wCur < wId)
+					lower = i + 1;
+				else
+					upper = i;
+			}
+		}
+		else for (UINT i = 0; i < named; ++i)
+		{
+			if (const IMAGE_RESOURCE_DIR_STRING_U *name = getName(entries + i))
+			{
+				if (CompareStringOrdinal(name->NameString, name->Length, id, -1, TRUE) == CSTR_EQUAL)
+					return entries + i;
+			}
+		}
+		return NULL;
+	}
+
+	const IMAGE_RESOURCE_DIR_STRING_U *getName(const IMAGE_RESOURCE_DIRECTORY_ENTRY *entry) const
+	{
+		if (entry == NULL || (entry->Name & IMAGE_RESOURCE_NAME_IS_STRING) == 0)
+			return NULL;
+		const DWORD offset = entry->Name & ~IMAGE_RESOURCE_NAME_IS_STRING;
+		if (offset > rsrcSize || rsrcSize - offset < sizeof(WORD))
+			return NULL;
+		const IMAGE_RESOURCE_DIR_STRING_U *name = reinterpret_cast<const IMAGE_RESOURCE_DIR_STRING_U *>(rsrc + offset);
+		if ((rsrcSize - offset - sizeof(WORD)) / sizeof(WCHAR) < name->Length)
+			return NULL;
+		return name;
+	}
+
+	const IMAGE_RESOURCE_DIRECTORY *getDirectory(const IMAGE_RESOURCE_DIRECTORY_ENTRY *entry) const
+	{
+		if (entry == NULL || (entry->OffsetToData & IMAGE_RESOURCE_DATA_IS_DIRECTORY) == 0)
+			return NULL;
+		return getDirectoryAt(entry->OffsetToData & ~IMAGE_RESOURCE_DATA_IS_DIRECTORY);
+	}
+
+	const IMAGE_RESOURCE_DATA_ENTRY *getDataEntry(const IMAGE_RESOURCE_DIRECTORY_ENTRY *entry) const
+	{
+		if (entry == NULL || (entry->OffsetToData & IMAGE_RESOURCE_DATA_IS_DIRECTORY) != 0)
+			return NULL;
+		const DWORD offset = entry->OffsetToData;
+		if (offset > rsrcSize || rsrcSize - offset < sizeof(IMAGE_RESOURCE_DATA_ENTRY))
+			return NULL;
+		return reinterpret_cast<const IMAGE_RESOURCE_DATA_ENTRY *>(rsrc + offset);
+	}
+
+	const BYTE *getData(const IMAGE_RESOURCE_DIRECTORY_ENTRY *entry, DWORD *cb) const
+	{
+		if (const IMAGE_RESOURCE_DATA_ENTRY *data = getDataEntry(entry))
+		{
+			DWORD avail;
+			const DWORD offset = rvaToOffset(data->OffsetToData, &avail);
+			if (offset != 0 && data->Size <= avail)
+			{
+				*cb = data->Size;
+				return base + offset;
+			}
+		}
+		*cb = 0;
+		return NULL;
+	}
+
+	// Looks up a resource by type, name, and language, where NULL as either
+	// name or language picks the first one available
+	const BYTE *findResource(LPCWSTR type, LPCWSTR name, LPCWSTR lang, DWORD *cb) const
+	{
+		const IMAGE_RESOURCE_DIRECTORY *dir = getDirectory(findEntry(getRoot(), type));
+		dir = getDirectory(findEntry(dir, name));
+		return getData(findEntry(dir, lang), cb);
+	}
+
+	const IMAGE_SECTION_HEADER *getSections(UINT *n) const
+	{
+		*n = nSections;
+		return sections;
+	}
+
+	// Returns the file offset for an RVA, or 0 if the RVA is not backed by the
+	// file, along with the number of bytes which can be read from there
+	DWORD rvaToOffset(DWORD rva, DWORD *avail) const
+	{
+		for (UINT i = 0; i < nSections; ++i)
+		{
+			const IMAGE_SECTION_HEADER &section = sections[i];
+			const DWORD delta = rva - section.VirtualAddress;
+			if (rva >= section.VirtualAddress && delta < section.SizeOfRawData)
+			{
+				const DWORD offset = section.PointerToRawData + delta;
+				if (offset < section.PointerToRawData || offset >= size)
+					break;
+				const DWORD raw = section.SizeOfRawData - delta;
+				*avail = raw < size - offset ? raw : size - offset;
+				return offset;
+			}
+		}
+		*avail = 0;
+		return 0;
+	}
+
+private:
+	PEImage(const PEImage &);
+	void operator=(const PEImage &);
+
+	static HRESULT lastError()
+	{
+		DWORD dw = GetLastError();
+		return dw ? HRESULT_FROM_WIN32(dw) : E_UNEXPECTED;
+	}
+
+	template<class T>
+	const T *view(DWORD offset, DWORD count = 1) const
+	{
+		if (offset > size || (size - offset) / sizeof(T) < count)
+			return NULL;
+		return reinterpret_cast<const T *>(base + offset);
+	}
+
+	const IMAGE_RESOURCE_DIRECTORY *getDirectoryAt(DWORD offset) const
+	{
+		if (rsrc == NULL || offset > rsrcSize || rsrcSize - offset < sizeof(IMAGE_RESOURCE_DIRECTORY))
+			return NULL;
+		return reinterpret_cast<const IMAGE_RESOURCE_DIRECTORY *>(rsrc + offset);
+	}
+
+	HRESULT parse()
+	{
+		const HRESULT hr = HRESULT_FROM_WIN32(ERROR_BAD_EXE_FORMAT);
+		const IMAGE_DOS_HEADER *const dos = view<IMAGE_DOS_HEADER>(0);
+		if (dos == NULL || dos->e_magic != IMAGE_DOS_SIGNATURE)
+			return hr;
+		// The fields up to and including the optional header's magic are common
+		// to PE and PE32+, and so is the layout of the data directories array
+		const DWORD offset = static_cast<DWORD>(dos->e_lfanew);
+		nt = view<IMAGE_NT_HEADERS32>(offset);
+		if (nt == NULL || nt->Signature != IMAGE_NT_SIGNATURE)
+			return hr;
+		const DWORD cbOptionalHeader = nt->FileHeader.SizeOfOptionalHeader;
+		DWORD cbFixed;
+		switch (nt->OptionalHeader.Magic)
+		{
+		case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
+			dirs = nt->OptionalHeader.DataDirectory;
+			nDirs = nt->OptionalHeader.NumberOfRvaAndSizes;
+			cbFixed = FIELD_OFFSET(IMAGE_OPTIONAL_HEADER32, DataDirectory);
+			break;
+		case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
+			if (const IMAGE_NT_HEADERS64 *const nt64 = view<IMAGE_NT_HEADERS64>(offset))
+			{
+				dirs = nt64->OptionalHeader.DataDirectory;
+				nDirs = nt64->OptionalHeader.NumberOfRvaAndSizes;
+				cbFixed = FIELD_OFFSET(IMAGE_OPTIONAL_HEADER64, DataDirectory);
+				break;
+			}
+			// fall through
+		default:
+			return hr;
+		}
+		if (cbOptionalHeader < cbFixed || nDirs > (cbOptionalHeader - cbFixed) / sizeof *dirs)
+			return hr;
+		nSections = nt->FileHeader.NumberOfSections;
+		sections = view<IMAGE_SECTION_HEADER>(offset +
+			FIELD_OFFSET(IMAGE_NT_HEADERS32, OptionalHeader) + cbOptionalHeader, nSections);
+		if (sections == NULL)
+			return hr;
+		if (nDirs > IMAGE_DIRECTORY_ENTRY_RESOURCE && dirs[IMAGE_DIRECTORY_ENTRY_RESOURCE].Size != 0)
+		{
+			DWORD avail;
+			if (DWORD start = rvaToOffset(dirs[IMAGE_DIRECTORY_ENTRY_RESOURCE].VirtualAddress, &avail))
+			{
+				rsrc = base + start;
+				rsrcRva = dirs[IMAGE_DIRECTORY_ENTRY_RESOURCE].VirtualAddress;
+				rsrcSize = dirs[IMAGE_DIRECTORY_ENTRY_RESOURCE].Size;
+				if (rsrcSize > avail)
+					rsrcSize = avail;
+			}
+		}
+		return S_OK;
+	}
+
+	const BYTE *base;
+	DWORD size;
+	const IMAGE_NT_HEADERS32 *nt;
+	const IMAGE_DATA_DIRECTORY *dirs;
+	DWORD nDirs;
+	const IMAGE_SECTION_HEADER *sections;
+	UINT nSections;
+	const BYTE *rsrc;
+	DWORD rsrcRva;
+	DWORD rsrcSize;
+};
@@ -26,33 +26,97 @@ class Reader
 {
 private:
 	IStream *pstm;
+	BYTE *view;
+	void *spill;
 	ULONG index;
 	ULONG ahead;
 	BYTE chunk[256];
 	BYTE ctype[256];
+	BYTE members[8][8]; // the first few members of each class, for scan()
+	BYTE nMembers[8];
 
 	template<typename T>
-	BYTE *sip(T *p, const T *q, BYTE opAnd, BYTE opXor, ULONG n)
+	bool test(T c, BYTE opAnd, BYTE opXor) const
+	{
+		const BYTE b = static_cast<BYTE>(c);
+		return ((c == static_cast<T>(b) ? ctype[b] : 0) & opAnd ^ opXor) != 0;
+	}
+
+	static __m128i match(__m128i v, char c)
+	{
+		return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+	}
+
+	static __m128i match(__m128i v, WCHAR c)
+	{
+		return _mm_cmpeq_epi16(v, _mm_set1_epi16(c));
+	}
+
+	// Finds the first character which passes test(), or else returns end.
+	// A single class of up to eight members, or its complement, is looked for
+	// 16 bytes at a time, by comparing them against each member in turn.
+	template<typename T>
+	const T *scan(const T *p, const T *end, BYTE opAnd, BYTE opXor) const
 	{
-		while (n != 0)
+		int k = 0;
+		while (k < 8 && (opAnd >> k) != 1)
+			++k;
+		if (k < 8 && (opXor == 0 || opXor == opAnd) && nMembers[k] <= 8 && IsSse2Present())
 		{
-			const T c = *q++;
-			*p = c; // caller may want to include the token terminator
-			const BYTE b = static_cast<BYTE>(c);
-			if ((c == static_cast<T>(b) ? ctype[b] : 0) & opAnd ^ opXor)
-				return reinterpret_cast<BYTE *>(p);
+			const int flip = opXor != 0 ? 0xFFFF : 0;
+			const int n = nMembers[k];
+			while (static_cast<size_t>(end - p) >= sizeof(__m128i) / sizeof(T))
+			{
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+				__m128i m = _mm_setzero_si128();
+				for (int i = 0; i < n; ++i)
+					m = _mm_or_si128(m, match(v, static_cast<T>(members[k][i])));
+				if (int mask = _mm_movemask_epi8(m) ^ flip)
+				{
+					int i = 0;
+					while ((mask & 1) == 0)
+					{
+						mask >>= 1;
+						++i;
+					}
+					return p + i / sizeof(T);
+				}
+				p += sizeof(__m128i) / sizeof(T);
+			}
+		}
+		while (p < end && !test(*p, opAnd, opXor))
 			++p;
-			n -= sizeof(T);
+		return p;
+	}
+
+	template<typename T>
+	BYTE *sip(T *p, const T *q, BYTE opAnd, BYTE opXor, ULONG n)
+	{
+		const T *const end = q + n / sizeof(T);
+		const T *const r = scan(q, end, opAnd, opXor);
+		if (r == end)
+		{
+			MemCopy(p, q, end - q);
+			return NULL;
 		}
-		return NULL;
+		// caller may want to include the token terminator
+		MemCopy(p, q, r - q + 1);
+		return reinterpret_cast<BYTE *>(p + (r - q));
+	}
+
+	static HRESULT lastError()
+	{
+		DWORD dw = GetLastError();
+		return dw ? HRESULT_FROM_WIN32(dw) : E_UNEXPECTED;
 	}
 
 public:
 	enum Encoding { ANSI = 0x00, UTF8 = 0xEF, UCS2BE = 0xFE, UCS2LE = 0xFF };
 
-	Reader(): pstm(NULL), index(0), ahead(0)
+	Reader(): pstm(NULL), view(NULL), spill(NULL), index(0), ahead(0)
 	{
 		SecureZeroMemory(ctype, sizeof ctype);
+		SecureZeroMemory(nMembers, sizeof nMembers);
 		ctype[0] = 1;
 	}
 
@@ -61,6 +125,103 @@ public:
 	operator IStream *() { return pstm; }
 	IStream **operator&() { return &pstm; }
 
+	// Maps the whole file copy-on-write, so viewLine() can hand out lines in
+	// place, and patch them up without affecting the file
+	HRESULT map(LPCWSTR path)
+	{
+		close();
+		HANDLE file = CreateFileW(path, GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return lastError();
+		HRESULT hr = S_OK;
+		LARGE_INTEGER li;
+		if (!GetFileSizeEx(file, &li))
+		{
+			hr = lastError();
+		}
+		else if (li.HighPart != 0)
+		{
+			hr = HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+		}
+		else if (li.LowPart == 0)
+		{
+			// Empty files can't be mapped, but read fine as nothing
+		}
+		else if (HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_WRITECOPY, 0, 0, NULL))
+		{
+			if ((view = static_cast<BYTE *>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0))) == NULL)
+				hr = lastError();
+			CloseHandle(mapping);
+		}
+		else
+		{
+			hr = lastError();
+		}
+		CloseHandle(file);
+		if (view != NULL)
+			ahead = li.LowPart;
+		return hr;
+	}
+
+	// Returns the next line of the mapped file in place, with its terminator
+	// overwritten by a null character, or NULL past the end. Passing the line
+	// so far as head, along with its length in bytes as *pn, moves the next
+	// line down to join it, so continuation lines cost no more than a single
+	// copy. Either way, *pn receives the length in bytes of what is returned.
+	template<typename T>
+	T *viewLine(BYTE op, ULONG *pn, T *head = NULL)
+	{
+		const ULONG n = *pn;
+		if (ahead < sizeof(T))
+			return n != 0 ? head : NULL;
+		T *const lower = reinterpret_cast<T *>(view + index);
+		T *const end = lower + ahead / sizeof(T);
+		T *const upper = const_cast<T *>(scan(lower, end, op, 0));
+		const ULONG cb = static_cast<ULONG>(reinterpret_cast<BYTE *>(upper) - reinterpret_cast<BYTE *>(lower));
+		const bool terminated = upper < end;
+		index += cb + sizeof(T);
+		ahead = terminated ? ahead - cb - sizeof(T) : 0;
+		T *line = lower;
+		if (n != 0)
+		{
+			// The terminator of the line so far leaves room for the new one
+			line = head;
+			MemCopy(reinterpret_cast<BYTE *>(line) + n, reinterpret_cast<const BYTE *>(lower), cb);
+		}
+		else if (!terminated)
+		{
+			// The last line of the file lacks a terminator, and there may be
+			// no room for one
+			void *const p = CoTaskMemRealloc(spill, cb + sizeof(T));
+			if (p == NULL)
+				return NULL;
+			spill = p;
+			line = static_cast<T *>(p);
+			MemCopy(static_cast<BYTE *>(p), reinterpret_cast<const BYTE *>(lower), cb);
+		}
+		*reinterpret_cast<T *>(reinterpret_cast<BYTE *>(line) + n + cb) = 0;
+		*pn = n + cb;
+		return line;
+	}
+
+	// Trims characters of the given class off both ends of a string of cb
+	// bytes, same as StrTrim does, and returns the remaining length in bytes
+	template<typename T>
+	ULONG trim(T *s, ULONG cb, BYTE op) const
+	{
+		const T *const end = s + cb / sizeof(T);
+		const T *const p = scan(s, end, op, op);
+		const T *q = end;
+		while (q > p && test(q[-1], op, 0))
+			--q;
+		if (p > s)
+			MemCopy(s, p, q - p);
+		s[q - p] = 0;
+		return static_cast<ULONG>((q - p) * sizeof(T));
+	}
+
 	template<typename T>
 	ULONG slurp(T **ps, BYTE opAnd, BYTE opXor, ULONG n = 0, ULONG t = 0)
 	{
@@ -101,34 +262,74 @@ public:
 	{
 		BYTE cookie = ctype[0];
 		ctype[0] <<= 1;
+		int k = 0;
+		while (k < 8 && (cookie >> k) != 1)
+			++k;
 		while (BYTE c = *q++)
 		{
 			ctype[c] |= cookie;
+			// Remember members up to the capacity, and count one beyond
+			if (k < 8 && nMembers[k] <= 8)
+			{
+				if (nMembers[k] < 8)
+					members[k][nMembers[k]] = c;
+				++nMembers[k];
+			}
 		}
 		return cookie;
 	}
 
 	Encoding readBom()
 	{
+		const BYTE *const p = view != NULL ? view : chunk;
 		if (pstm)
 			pstm->Read(chunk, sizeof chunk, &ahead);
 		if (ahead >= 2)
 		{
-			if (chunk[0] == 0xFF && chunk[1] == 0xFE || chunk[0] == 0xFE && chunk[1] == 0xFF)
+			if (p[0] == 0xFF && p[1] == 0xFE || p[0] == 0xFE && p[1] == 0xFF)
 				index = 2;
-			else if (ahead >= 3 && chunk[0] == 0xEF && chunk[1] == 0xBB && chunk[2] == 0xBF)
+			else if (ahead >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF)
 				index = 3;
 		}
 		ahead -= index;
-		return index ? static_cast<Encoding>(chunk[0]) : ANSI;
+		return index ? static_cast<Encoding>(p[0]) : ANSI;
+	}
+
+	// Turns UCS-2BE into UCS-2LE for what is left of the mapped file
+	void swapBytes()
+	{
+		WCHAR *p = reinterpret_cast<WCHAR *>(view + index);
+		WCHAR *const end = p + ahead / sizeof(WCHAR);
+		if (IsSse2Present())
+		{
+			for (; end - p >= 8; p += 8)
+			{
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+			}
+		}
+		for (; p < end; ++p)
+			*p = static_cast<WCHAR>(*p << 8 | *p >> 8);
 	}
 
 	HRESULT close()
 	{
-		if (pstm == NULL)
-			return E_POINTER;
-		pstm->Release();
-		pstm = NULL;
-		return S_OK;
+		HRESULT hr = E_POINTER;
+		if (view != NULL)
+		{
+			UnmapViewOfFile(view);
+			view = NULL;
+			hr = S_OK;
+		}
+		if (pstm != NULL)
+		{
+			pstm->Release();
+			pstm = NULL;
+			hr = S_OK;
+		}
+		CoTaskMemFree(spill);
+		spill = NULL;
+		index = ahead = 0;
+		return hr;
 	}
 };
@@ -0,0 +1,466 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <shlwapi.h>
+#include "hive.h"
+#include "regcache.h"
+#include "miscutil.h"
+
+// Entries depend on the registry view, hence on the bitness of the process
+static const DWORD Signature = 0x4352464D; // "MFRC"
+static const DWORD Version = sizeof(void *) << 16 | 1;
+
+struct Header
+{
+	DWORD signature;
+	DWORD version;
+};
+
+static HRESULT CoGetError(DWORD dw = GetLastError())
+{
+	return dw ? HRESULT_FROM_WIN32(dw) : E_UNEXPECTED;
+}
+
+static DWORD Rotate(DWORD x, int n)
+{
+	return x << n | x >> (32 - n);
+}
+
+static DWORD Scramble(DWORD k)
+{
+	return Rotate(k * 0xCC9E2D51U, 15) * 0x1B873593U;
+}
+
+static DWORD Finish(DWORD h)
+{
+	h ^= h >> 16;
+	h *= 0x85EBCA6BU;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35U;
+	h ^= h >> 16;
+	return h;
+}
+
+// Advances past an item which is padded to a multiple of 4 bytes, unless it
+// extends beyond the end. As everything before is padded alike, so is the
+// remaining length, and padding never extends beyond the end either.
+static const BYTE *Take(const BYTE *&p, const BYTE *end, DWORD cb)
+{
+	const BYTE *const q = p;
+	if (cb > static_cast<DWORD>(end - p))
+		return NULL;
+	p += (cb + 3) & ~3U;
+	return q;
+}
+
+static LPCWSTR TakeString(const BYTE *&p, const BYTE *end, DWORD cch)
+{
+	if (cch == 0 || cch > MAXLONG / sizeof(WCHAR))
+		return NULL;
+	LPCWSTR const s = reinterpret_cast<LPCWSTR>(Take(p, end, cch * sizeof(WCHAR)));
+	return s != NULL && s[cch - 1] == L'\0' ? s : NULL;
+}
+
+RegCache::RegCache()
+: path(NULL), base(NULL), slots(NULL), nSlots(0), table(NULL), mask(0)
+, records(NULL), cbRecords(0), cbAlloc(0)
+{
+}
+
+RegCache::~RegCache()
+{
+	Close();
+	if (records != NULL)
+		HeapFree(GetProcessHeap(), 0, records);
+}
+
+void RegCache::Close()
+{
+	if (base != NULL)
+	{
+		UnmapViewOfFile(base);
+		base = NULL;
+	}
+	if (slots != NULL)
+	{
+		HeapFree(GetProcessHeap(), 0, slots);
+		slots = NULL;
+	}
+	if (table != NULL)
+	{
+		HeapFree(GetProcessHeap(), 0, table);
+		table = NULL;
+	}
+	nSlots = 0;
+	mask = 0;
+}
+
+// Two lanes of MurmurHash3's 32-bit block mixing, which are combined at the
+// end. Reads DWORDs regardless of alignment, which x86 and x64 allow for.
+void RegCache::Hash(const void *p, DWORD cb, DWORD hash[2])
+{
+	const DWORD *q = static_cast<const DWORD *>(p);
+	DWORD h1 = 0x9747B28CU ^ cb;
+	DWORD h2 = 0x5BD1E995U ^ cb;
+	for (DWORD n = cb / 8; n != 0; --n)
+	{
+		h1 = Rotate(h1 ^ Scramble(*q++), 13) * 5 + 0xE6546B64U;
+		h2 = Rotate(h2 ^ Scramble(*q++), 13) * 5 + 0xE6546B64U;
+	}
+	if (const DWORD rest = cb & 7)
+	{
+		DWORD k[2] = { 0, 0 };
+		MemCopy(reinterpret_cast<BYTE *>(k), reinterpret_cast<const BYTE *>(q), rest);
+		h1 ^= Scramble(k[0]);
+		h2 ^= Scramble(k[1]);
+	}
+	h1 += h2;
+	h2 += h1;
+	h1 = Finish(h1);
+	h2 = Finish(h2);
+	hash[0] = h1 + h2;
+	hash[1] = h2 + h1 + h2;
+}
+
+bool RegCache::Equal(const Fingerprint &fp1, const Fingerprint &fp2)
+{
+	return fp1.path == fp2.path && fp1.size == fp2.size
+		&& fp1.time.dwLowDateTime == fp2.time.dwLowDateTime
+		&& fp1.time.dwHighDateTime == fp2.time.dwHighDateTime
+		&& fp1.hash[0] == fp2.hash[0] && fp1.hash[1] == fp2.hash[1];
+}
+
+// Walks the keys of an entry, and creates them in the hive if one is given,
+// or just makes sure that they are well-formed otherwise. Each key comes as
+// its path from the root and a number of values, followed by the values.
+bool RegCache::Apply(Hive *hive, const Entry *entry)
+{
+	const BYTE *p = reinterpret_cast<const BYTE *>(entry + 1);
+	const BYTE *const end = reinterpret_cast<const BYTE *>(entry) + entry->cb;
+	while (p < end)
+	{
+		const DWORD *head = reinterpret_cast<const DWORD *>(Take(p, end, 2 * sizeof(DWORD)));
+		if (head == NULL)
+			return false;
+		const DWORD nValues = head[1];
+		LPCWSTR const keypath = TakeString(p, end, head[0]);
+		if (keypath == NULL)
+			return false;
+		Hive::Key *key = NULL;
+		if (hive != NULL)
+		{
+			if ((key = hive->CreateKey(hive->GetRoot(), keypath)) == NULL)
+				return false;
+			hive->Touch(key);
+		}
+		for (DWORD i = 0; i < nValues; ++i)
+		{
+			if ((head = reinterpret_cast<const DWORD *>(Take(p, end, 3 * sizeof(DWORD)))) == NULL)
+				return false;
+			const DWORD type = head[1];
+			const DWORD cb = head[2];
+			LPCWSTR const name = TakeString(p, end, head[0]);
+			const BYTE *const data = name != NULL ? Take(p, end, cb) : NULL;
+			if (data == NULL)
+				return false;
+			if (key != NULL && hive->SetValue(key, name, type, data, cb) == NULL)
+				return false;
+		}
+	}
+	return true;
+}
+
+// Maps the file, and takes note of the entries which pass the checks. A file
+// which doesn't exist yet, or which an older version has written, counts as
+// empty, and yields S_FALSE. On failure, the cache is left without a path,
+// so that Save() won't overwrite a file which may not be a cache at all.
+HRESULT RegCache::Open(LPCWSTR path)
+{
+	Close();
+	this->path = NULL;
+	HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		const DWORD dw = GetLastError();
+		if (dw != ERROR_FILE_NOT_FOUND)
+			return CoGetError(dw);
+		this->path = path;
+		return S_FALSE;
+	}
+	HRESULT hr = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+	LARGE_INTEGER li;
+	if (!GetFileSizeEx(file, &li))
+	{
+		hr = CoGetError();
+	}
+	else if (li.HighPart == 0 && li.LowPart >= sizeof(Header))
+	{
+		if (HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL))
+		{
+			if ((base = static_cast<const BYTE *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0))) == NULL)
+				hr = CoGetError();
+			CloseHandle(mapping);
+		}
+		else
+		{
+			hr = CoGetError();
+		}
+	}
+	CloseHandle(file);
+	if (base == NULL)
+		return hr;
+	const Header *const header = reinterpret_cast<const Header *>(base);
+	if (header->signature != Signature)
+	{
+		Close();
+		return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+	}
+	this->path = path;
+	if (header->version != Version)
+	{
+		Close();
+		return S_FALSE;
+	}
+	const DWORD size = li.LowPart;
+	DWORD offset = sizeof(Header);
+	while (size - offset >= sizeof(Entry))
+	{
+		const Entry *const entry = reinterpret_cast<const Entry *>(base + offset);
+		// Past a broken length, there is no telling where the next entry is
+		if (entry->cb < sizeof(Entry) || entry->cb % 4 != 0 || entry->cb > size - offset)
+			break;
+		offset += entry->cb;
+		DWORD hash[2];
+		Hash(&entry->fp, entry->cb - FIELD_OFFSET(Entry, fp), hash);
+		if (hash[0] != entry->check || !Apply(NULL, entry))
+			continue;
+		// Grow the array whenever the count reaches a power of two
+		if ((nSlots & (nSlots - 1)) == 0)
+		{
+			const SIZE_T cb = (nSlots ? nSlots * 2 : 1) * sizeof *slots;
+			void *const p = slots != NULL ? HeapReAlloc(GetProcessHeap(), 0, slots, cb) : HeapAlloc(GetProcessHeap(), 0, cb);
+			if (p == NULL)
+				break;
+			slots = static_cast<Slot *>(p);
+		}
+		slots[nSlots].entry = entry;
+		slots[nSlots].kept = false;
+		++nSlots;
+	}
+	Index();
+	return S_OK;
+}
+
+// Sets up a hash table over the slots, so as to not have to go through all
+// of them for every file. Without one, Replay() finds nothing.
+void RegCache::Index()
+{
+	UINT size = 16;
+	while (size < nSlots * 2)
+		size *= 2;
+	if ((table = static_cast<UINT *>(HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, size * sizeof *table))) == NULL)
+		return;
+	mask = size - 1;
+	for (UINT i = 0; i < nSlots; ++i)
+	{
+		UINT hash = slots[i].entry->fp.hash[0];
+		while (table[hash & mask] != 0)
+			++hash;
+		table[hash & mask] = i + 1;
+	}
+}
+
+// Writes out the entries which have been used or recorded since opening
+HRESULT RegCache::Save()
+{
+	if (path == NULL)
+		return S_FALSE;
+	Close();
+	HANDLE file = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return CoGetError();
+	const Header header = { Signature, Version };
+	DWORD cb;
+	HRESULT hr = S_OK;
+	if (!WriteFile(file, &header, sizeof header, &cb, NULL) ||
+		(cbRecords != 0 && !WriteFile(file, records, cbRecords, &cb, NULL)))
+	{
+		hr = CoGetError();
+	}
+	CloseHandle(file);
+	return hr;
+}
+
+HRESULT RegCache::Identify(LPCWSTR path, Fingerprint &fp)
+{
+	SecureZeroMemory(&fp, sizeof fp);
+	DWORD hash[2];
+	Hash(path, lstrlenW(path) * sizeof(WCHAR), hash);
+	fp.path = hash[0];
+	HANDLE file = CreateFileW(path, GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return CoGetError();
+	HRESULT hr = S_OK;
+	BY_HANDLE_FILE_INFORMATION info;
+	if (!GetFileInformationByHandle(file, &info))
+	{
+		hr = CoGetError();
+	}
+	else if (info.nFileSizeHigh != 0)
+	{
+		hr = S_FALSE;
+	}
+	else
+	{
+		fp.size = info.nFileSizeLow;
+		fp.time = info.ftLastWriteTime;
+		if (fp.size == 0)
+		{
+			Hash(NULL, 0, fp.hash);
+		}
+		else if (HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL))
+		{
+			if (const void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0))
+			{
+				Hash(view, fp.size, fp.hash);
+				UnmapViewOfFile(view);
+			}
+			else
+			{
+				hr = CoGetError();
+			}
+			CloseHandle(mapping);
+		}
+		else
+		{
+			hr = CoGetError();
+		}
+	}
+	CloseHandle(file);
+	return hr;
+}
+
+HRESULT RegCache::Replay(Hive &hive, const Fingerprint &fp)
+{
+	if (table == NULL)
+		return S_FALSE;
+	for (UINT hash = fp.hash[0]; UINT i = table[hash & mask]; ++hash)
+	{
+		Slot &slot = slots[i - 1];
+		if (!Equal(slot.entry->fp, fp))
+			continue;
+		if (!Apply(&hive, slot.entry))
+			return E_OUTOFMEMORY;
+		// Keep a copy, as the view goes away before the cache is saved
+		if (!slot.kept)
+			slot.kept = Append(slot.entry, slot.entry->cb);
+		return S_OK;
+	}
+	return S_FALSE;
+}
+
+bool RegCache::Append(const void *p, DWORD cb)
+{
+	const DWORD cbPadded = (cb + 3) & ~3U;
+	if (cbPadded > cbAlloc - cbRecords)
+	{
+		DWORD cbNew = cbAlloc ? cbAlloc : 0x10000;
+		while (cbPadded > cbNew - cbRecords)
+			cbNew *= 2;
+		void *const q = records != NULL ? HeapReAlloc(GetProcessHeap(), 0, records, cbNew) : HeapAlloc(GetProcessHeap(), 0, cbNew);
+		if (q == NULL)
+			return false;
+		records = static_cast<BYTE *>(q);
+		cbAlloc = cbNew;
+	}
+	MemCopy(records + cbRecords, static_cast<const BYTE *>(p), cb);
+	while (cb < cbPadded)
+		records[cbRecords + cb++] = 0;
+	cbRecords += cbPadded;
+	return true;
+}
+
+// Appends a key which has been written to, along with all its values, as the
+// sandbox does not tell which of them have actually changed. Keys which have
+// been deleted since are left out, as they no longer lead up to the root.
+bool RegCache::Record(const Hive::Key *root, const Hive::Key *key)
+{
+	WCHAR path[MaxKeyPath];
+	int at = MaxKeyPath - 1;
+	path[at] = L'\0';
+	for (const Hive::Key *sub = key; sub != root; sub = sub->parent)
+	{
+		if (sub == NULL)
+			return true;
+		const int cch = lstrlenW(sub->name);
+		if (cch + 1 > at)
+			return false;
+		if (at != MaxKeyPath - 1)
+			path[--at] = L'\\';
+		at -= cch;
+		MemCopy(path + at, sub->name, cch);
+	}
+	const int len = MaxKeyPath - 1 - at;
+	const DWORD head[2] = { len + 1, key->nValues };
+	if (!Append(head, sizeof head) || !Append(path + at, (len + 1) * sizeof(WCHAR)))
+		return false;
+	for (UINT i = 0; i < key->nValues; ++i)
+	{
+		const Hive::Value *const value = key->values + i;
+		const int cch = lstrlenW(value->name) + 1;
+		const DWORD head[3] = { cch, value->type, value->cb };
+		if (!Append(head, sizeof head) || !Append(value->name, cch * sizeof(WCHAR)) || !Append(value->data, value->cb))
+			return false;
+	}
+	return true;
+}
+
+// Records the keys which have been journaled since the last checkpoint
+HRESULT RegCache::Record(Hive &hive, const Fingerprint &fp)
+{
+	if (path == NULL)
+		return S_FALSE;
+	const DWORD start = cbRecords;
+	Entry entry;
+	SecureZeroMemory(&entry, sizeof entry);
+	entry.fp = fp;
+	UINT n;
+	Hive::Key *const *const keys = hive.GetChangedKeys(&n);
+	bool ok = Append(&entry, sizeof entry);
+	for (UINT i = 0; ok && i < n; ++i)
+		ok = Record(hive.GetRoot(), keys[i]);
+	if (!ok)
+	{
+		cbRecords = start;
+		return E_FAIL;
+	}
+	Entry *const p = reinterpret_cast<Entry *>(records + start);
+	p->cb = cbRecords - start;
+	DWORD hash[2];
+	Hash(&p->fp, p->cb - FIELD_OFFSET(Entry, fp), hash);
+	p->check = hash[0];
+	return S_OK;
+}
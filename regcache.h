@@ -0,0 +1,87 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// On-disk cache of what registering a file has added to the hive, keyed by
+// the file's path, size, time stamp, and a hash of its content. The cache is
+// read from a mapped view, and every entry is checked before it is trusted,
+// so entries which are stale or corrupt are simply ignored, and dropped on
+// the next save, along with entries which have not been used.
+class RegCache
+{
+public:
+	struct Fingerprint
+	{
+		DWORD path;
+		DWORD size;
+		FILETIME time;
+		DWORD hash[2];
+	};
+
+	RegCache();
+	~RegCache();
+
+	HRESULT Open(LPCWSTR path);
+	HRESULT Save();
+
+	static HRESULT Identify(LPCWSTR path, Fingerprint &fp);
+	HRESULT Replay(Hive &hive, const Fingerprint &fp);
+	HRESULT Record(Hive &hive, const Fingerprint &fp);
+
+private:
+	RegCache(const RegCache &);
+	void operator=(const RegCache &);
+
+	struct Entry
+	{
+		DWORD cb; // including the header, always a multiple of 4
+		DWORD check; // hash of all that follows
+		Fingerprint fp;
+	};
+
+	struct Slot
+	{
+		const Entry *entry;
+		bool kept;
+	};
+
+	enum { MaxKeyPath = 0x1000 };
+
+	static void Hash(const void *p, DWORD cb, DWORD hash[2]);
+	static bool Equal(const Fingerprint &fp1, const Fingerprint &fp2);
+	static bool Apply(Hive *hive, const Entry *entry);
+	bool Append(const void *p, DWORD cb);
+	bool Record(const Hive::Key *root, const Hive::Key *key);
+	void Index();
+	void Close();
+
+	LPCWSTR path;
+	const BYTE *base;
+	Slot *slots;
+	UINT nSlots;
+	UINT *table; // indices of slots plus one, by hash of the fingerprint
+	UINT mask;
+	BYTE *records;
+	DWORD cbRecords;
+	DWORD cbAlloc;
+};
@@ -23,15 +23,19 @@ SOFTWARE.
 */
 
 #include <shlwapi.h>
+#include "miscutil.h"
+#include "hexcodec.h"
 #include "reader.h"
+#include "hive.h"
+#include "regimp.h"
 //#include "wstdio.h"
 
-static HKEY GetRootKeyFromName(LPCWSTR name)
+static Hive::Key *GetRootKeyFromName(Hive &hive, LPCWSTR name)
 {
 	if (PathMatchSpecW(name, L"HKEY_CLASSES_ROOT;HKCR"))
-		return HKEY_CLASSES_ROOT;
+		return hive.GetClassesRoot();
 	if (PathMatchSpecW(name, L"HKEY_LOCAL_MACHINE;HKLM"))
-		return HKEY_LOCAL_MACHINE;
+		return hive.GetRoot();
 	return NULL;
 }
 
@@ -90,42 +94,192 @@ static LPWSTR SplitAssignment(LPWSTR line)
 	return r;
 }
 
-static HKEY ProcessLine(HKEY key, LPWSTR line, bool ansi = false)
+// Remembers the keys of recent section headers by the hash of their paths, so
+// a section which shares a prefix with a recent one can start out from there
+// rather than from the root. Each path hash picks a set of four entries, the
+// least recently used of which gives way to a new one. Hits are verified by
+// walking up the parent chain of the key, as hashes may collide.
+class KeyPathCache
 {
-	if (LPWSTR p = EatPrefix(line, L"["))
+public:
+	static const int MaxDepth = 64;
+
+	KeyPathCache(): tick(0)
 	{
-		RegCloseKey(key);
-		key = NULL;
-		LPWSTR q;
-		while ((q = PathFindNextComponentW(p)) > p)
+		SecureZeroMemory(entries, sizeof entries);
+		SecureZeroMemory(&stats, sizeof stats);
+	}
+
+	Hive::Key *Resolve(Hive &hive, LPCWSTR const *names, int n)
+	{
+		++stats.sections;
+		UINT hashes[MaxDepth];
+		UINT hash = 2166136261U;
+		for (int i = 0; i < n; ++i)
+			hashes[i] = hash = Hash(hash, names[i]);
+		// Look for the deepest ancestor on record, below the root
+		Hive::Key *key = NULL;
+		int i = n;
+		while (i > 1 && (key = Find(hive, hashes[i - 1], names, i)) == NULL)
+			--i;
+		if (key != NULL)
 		{
-			q[-1] = L'\0';
-			if (HKEY tmp = key)
+			++stats.hits;
+			stats.saved += i;
+		}
+		else
+		{
+			i = 0;
+		}
+		for (; i < n; ++i)
+		{
+			++stats.steps;
+			key = i == 0 ? GetRootKeyFromName(hive, names[0]) : hive.CreateSubKey(key, names[i]);
+			if (key == NULL)
+				break;
+			if (i != 0)
+				Insert(hashes[i], key);
+		}
+		return key;
+	}
+
+	RegImportStats stats;
+
+private:
+	struct Entry
+	{
+		UINT hash;
+		UINT used;
+		Hive::Key *key;
+	};
+
+	static const UINT Sets = 64;
+	static const UINT Ways = 4;
+
+	static UINT Hash(UINT hash, LPCWSTR name)
+	{
+		hash = (hash ^ L'\\') * 16777619U;
+		while (WCHAR c = *name++)
+		{
+			// Fold ASCII case, which is all it takes for the usual suspects
+			if (c >= L'A' && c <= L'Z')
+				c |= 0x20;
+			hash = (hash ^ c) * 16777619U;
+		}
+		return hash;
+	}
+
+	Hive::Key *Find(Hive &hive, UINT hash, LPCWSTR const *names, int n)
+	{
+		Entry *const set = entries + hash % Sets * Ways;
+		for (UINT way = 0; way < Ways; ++way)
+		{
+			Entry &entry = set[way];
+			if (entry.key == NULL || entry.hash != hash)
+				continue;
+			Hive::Key *key = entry.key;
+			int i = n;
+			while (--i > 0 && key != NULL &&
+				CompareStringOrdinal(key->name, -1, names[i], -1, TRUE) == CSTR_EQUAL)
 			{
-				key = NULL;
-				RegCreateKeyW(tmp, p, &key);
-				if (tmp < HKEY_CLASSES_ROOT)
-					RegCloseKey(tmp);
+				key = key->parent;
 			}
-			else
+			if (i == 0 && key == GetRootKeyFromName(hive, names[0]))
 			{
-				key = GetRootKeyFromName(p);
+				entry.used = ++tick;
+				return entry.key;
 			}
-			if (key == NULL)
+		}
+		return NULL;
+	}
+
+	void Insert(UINT hash, Hive::Key *key)
+	{
+		Entry *const set = entries + hash % Sets * Ways;
+		Entry *victim = set;
+		for (UINT way = 1; way < Ways; ++way)
+		{
+			if (set[way].used < victim->used)
+				victim = set + way;
+		}
+		victim->hash = hash;
+		victim->used = ++tick;
+		victim->key = key;
+	}
+
+	Entry entries[Sets * Ways];
+	UINT tick;
+};
+
+// Widens a string of n bytes, including its terminator, into a buffer of at
+// least n WCHARs. Leading ASCII goes 16 characters at a time, and the rest is
+// left to MultiByteToWideChar.
+static int Widen(UINT codepage, LPCSTR p, int n, LPWSTR q)
+{
+	int i = 0;
+	if (IsSse2Present())
+	{
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 16 <= n; i += 16)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+			if (_mm_movemask_epi8(v) != 0)
 				break;
-			//WriteTo<STD_OUTPUT_HANDLE>("RegCreateKeyW(%ls)\n", p);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(q + i), _mm_unpacklo_epi8(v, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(q + i + 8), _mm_unpackhi_epi8(v, zero));
+		}
+	}
+	while (i < n && (p[i] & 0x80) == 0)
+	{
+		q[i] = p[i];
+		++i;
+	}
+	if (i < n)
+	{
+		const int cch = MultiByteToWideChar(codepage, 0, p + i, n - i, q + i, n - i);
+		if (cch == 0)
+			q[i] = L'\0';
+		i += cch;
+	}
+	return i;
+}
+
+static Hive::Key *ProcessLine(Hive &hive, KeyPathCache &cache, Hive::Key *key, LPWSTR line, bool ansi = false)
+{
+	if (LPWSTR p = EatPrefix(line, L"["))
+	{
+		LPCWSTR names[KeyPathCache::MaxDepth];
+		int n = 0;
+		LPWSTR q;
+		while (n < _countof(names) && (q = PathFindNextComponentW(p)) > p)
+		{
+			q[-1] = L'\0';
+			names[n++] = p;
 			p = q;
 		}
+		key = n != 0 ? cache.Resolve(hive, names, n) : NULL;
+		// Paths too deep for the cache go on from there
+		while (key != NULL && (q = PathFindNextComponentW(p)) > p)
+		{
+			q[-1] = L'\0';
+			key = hive.CreateSubKey(key, p);
+			//WriteTo<STD_OUTPUT_HANDLE>("RegCreateKeyW(", p, ")\n");
+			p = q;
+		}
+		// Keys named by a section count as written to, so their values make
+		// it into the sandbox along with those of keys yet to be created
+		if (key != NULL)
+			hive.Touch(key);
 	}
 	else if (const LPWSTR val = SplitAssignment(line))
 	{
 		SplitAssignment(val);
-		//WriteTo<STD_OUTPUT_HANDLE>("L = %ls\n", line);
-		//WriteTo<STD_OUTPUT_HANDLE>("R = %ls\n", val);
+		//WriteTo<STD_OUTPUT_HANDLE>("L = ", line, "\n");
+		//WriteTo<STD_OUTPUT_HANDLE>("R = ", val, "\n");
 		const LPWSTR name = lstrcmpW(line, L"@") ? EatQuotes(line) : NULL;
 		if (LPWSTR p = EatQuotes(val))
 		{
-			RegSetValueExW(key, name, 0, REG_SZ, reinterpret_cast<BYTE *>(p), (lstrlenW(p) + 1) * sizeof(WCHAR));
+			hive.SetValue(key, name, REG_SZ, p, (lstrlenW(p) + 1) * sizeof(WCHAR));
 		}
 		else if (LPWSTR p = EatPrefix(val, L"DWORD:"))
 		{
@@ -135,7 +289,7 @@ static HKEY ProcessLine(HKEY key, LPWSTR line, bool ansi = false)
 			int iVal;
 			if (StrToIntExW(p, STIF_SUPPORT_HEX, &iVal))
 			{
-				RegSetValueExW(key, name, 0, REG_DWORD, reinterpret_cast<BYTE *>(&iVal), sizeof iVal);
+				hive.SetValue(key, name, REG_DWORD, &iVal, sizeof iVal);
 			}
 		}
 		else if (LPWSTR p = EatPrefix(val, L"HEX:\0" L"HEX(2):\0" L"HEX(7):\0" L"HEX(B):\0", true))
@@ -155,90 +309,115 @@ static HKEY ProcessLine(HKEY key, LPWSTR line, bool ansi = false)
 			// disable character widening for non-string values
 			if (((1 << type) & (1 << REG_EXPAND_SZ | 1 << REG_MULTI_SZ)) == 0)
 				ansi = false;
-			DWORD cb = 0;
-			BYTE b[8200];
-			do
+			// Decode in place, as the bytes never catch up with the text
+			BYTE *const b = reinterpret_cast<BYTE *>(val);
+			int cb = HexDecode(p, b);
+			if (cb >= 0)
 			{
-				p += StrSpnW(p, L" \t\r\n");
-				LPWSTR q = StrChrW(p, L',');
-				*--p = L'x';
-				*--p = L'0';
-				int iVal;
-				if (!StrToIntExW(p, STIF_SUPPORT_HEX, &iVal))
-					break;
-				b[cb++] = static_cast<BYTE>(iVal);
 				if (ansi)
-					b[cb++] = 0;
-				p = q ? q + 1 : NULL;
-			} while (p && cb < sizeof b);
-			if (p == NULL) // everything parsed with no issues
-			{
-				RegSetValueExW(key, name, 0, type, b, cb);
+				{
+					// Widen from the end, as the text leaves room for twice the bytes
+					for (int i = cb; i-- > 0; )
+					{
+						b[2 * i + 1] = 0;
+						b[2 * i] = b[i];
+					}
+					cb *= 2;
+				}
+				hive.SetValue(key, name, type, b, cb);
 			}
 		}
 	}
 	return key;
 }
 
-HRESULT ImportRegFile(LPCWSTR path)
+HRESULT ImportRegFile(Hive &hive, LPCWSTR path, RegImportStats *stats)
 {
 	Reader reader;
-	HRESULT hr = SHCreateStreamOnFileEx(path,
-		STGM_READ | STGM_SHARE_DENY_NONE,
-		FILE_ATTRIBUTE_NORMAL, FALSE, NULL, &reader);
+	KeyPathCache cache;
+	HRESULT hr = reader.map(path);
 	if (FAILED(hr))
 		return hr;
 	Reader::Encoding encoding = reader.readBom();
 	BYTE eol = reader.allocCtype("\n");
-	HKEY key = NULL;
+	BYTE blank = reader.allocCtype(" \t\r\n");
+	BYTE backslash = reader.allocCtype("\\");
+	Hive::Key *key = NULL;
 	ULONG len = 0;
+	if (encoding == Reader::UCS2BE)
+	{
+		reader.swapBytes();
+		encoding = Reader::UCS2LE;
+	}
 	if (encoding == Reader::UCS2LE)
 	{
 		LPWSTR line = NULL;
-		while (reader.readLine(&line, eol, len))
+		while ((line = reader.viewLine(eol, &len, line)) != NULL)
 		{
-			//WriteTo<STD_OUTPUT_HANDLE>("%ls", line);
-			StrTrimW(line, L" \t\r\n");
-			if (StrTrimW(line, L"\\"))
+			//WriteTo<STD_OUTPUT_HANDLE>("", line);
+			len = reader.trim(line, len, blank);
+			const ULONG cb = reader.trim(line, len, backslash);
+			if (cb != len)
 			{
 				// continuation line follows
-				len = lstrlenW(line) * sizeof(WCHAR);
+				len = cb;
 				continue;
 			}
 			// line complete
 			len = 0;
-			key = ProcessLine(key, line);
+			key = ProcessLine(hive, cache, key, line);
 		}
-		CoTaskMemFree(line);
 	}
-	else if (encoding == Reader::ANSI)
+	else if (encoding == Reader::ANSI || encoding == Reader::UTF8)
 	{
+		// Only REGEDIT4 style ANSI files hold single-byte characters in their
+		// hex(2) and hex(7) values
+		const bool ansi = encoding == Reader::ANSI;
+		const UINT codepage = ansi ? CP_ACP : CP_UTF8;
 		LPSTR line = NULL;
-		while (reader.readLine(&line, eol, len))
+		LPWSTR wide = NULL;
+		int cch = 0;
+		while ((line = reader.viewLine(eol, &len, line)) != NULL)
 		{
 			//WriteTo<STD_OUTPUT_HANDLE>(line);
-			StrTrimA(line, " \t\r\n");
-			if (StrTrimA(line, "\\"))
+			len = reader.trim(line, len, blank);
+			const ULONG cb = reader.trim(line, len, backslash);
+			if (cb != len)
 			{
 				// continuation line follows
-				len = lstrlenA(line);
+				len = cb;
 				continue;
 			}
 			// line complete
 			len = 0;
-			LPWSTR pwsz = NULL;
-			if (FAILED(hr = SHStrDupA(line, &pwsz)))
-				break;
-			key = ProcessLine(key, pwsz, true);
-			CoTaskMemFree(pwsz);
+			// Widen into a buffer which only ever grows
+			const int n = static_cast<int>(cb) + 1;
+			if (n > cch)
+			{
+				void *const p = CoTaskMemRealloc(wide, n * sizeof(WCHAR));
+				if (p == NULL)
+				{
+					hr = E_OUTOFMEMORY;
+					break;
+				}
+				wide = static_cast<LPWSTR>(p);
+				cch = n;
+			}
+			Widen(codepage, line, n, wide);
+			key = ProcessLine(hive, cache, key, wide, ansi);
 		}
-		CoTaskMemFree(line);
+		CoTaskMemFree(wide);
 	}
 	else
 	{
 		hr = E_INVALIDARG;
 	}
-	if (key < HKEY_CLASSES_ROOT)
-		RegCloseKey(key);
+	if (stats != NULL)
+	{
+		stats->sections += cache.stats.sections;
+		stats->hits += cache.stats.hits;
+		stats->steps += cache.stats.steps;
+		stats->saved += cache.stats.saved;
+	}
 	return hr;
 }
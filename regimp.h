@@ -1 +1,12 @@
-HRESULT ImportRegFile(LPCWSTR);
+class Hive;
+
+// Counts of how the key path cache has fared, added up across imports
+struct RegImportStats
+{
+	UINT sections; // section headers seen
+	UINT hits; // sections which started out from a cached ancestor key
+	UINT steps; // path components resolved one by one
+	UINT saved; // path components skipped thanks to the cache
+};
+
+HRESULT ImportRegFile(Hive &, LPCWSTR, RegImportStats * = NULL);
@@ -0,0 +1,302 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <shlwapi.h>
+#include "peimage.h"
+#include "miscutil.h"
+#include "resupdate.h"
+
+static HRESULT CoGetError(DWORD dw = GetLastError())
+{
+	return dw ? HRESULT_FROM_WIN32(dw) : E_UNEXPECTED;
+}
+
+// Sums up 16-bit words with end-around carry, same as CheckSumMappedFile()
+// does, except that the file can be fed in pieces of arbitrary length
+class CheckSum
+{
+public:
+	CheckSum(): sum(0), len(0) { }
+
+	void update(const BYTE *p, DWORD cb)
+	{
+		DWORD i = 0;
+		if ((len & 1) != 0 && cb != 0)
+			add(p[i++] << 8);
+		for (; cb - i >= 2; i += 2)
+			add(p[i] | p[i + 1] << 8);
+		if (i < cb)
+			add(p[i]);
+		len += cb;
+	}
+
+	// Zeros add nothing to the sum but still count towards the length
+	void skip(DWORD cb) { len += cb; }
+
+	DWORD get() const { return sum + len; }
+
+private:
+	void add(DWORD word)
+	{
+		sum += word;
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+
+	DWORD sum;
+	DWORD len;
+};
+
+static DWORD AlignUp(DWORD n, DWORD alignment)
+{
+	return (n + alignment - 1) & ~(alignment - 1);
+}
+
+static void Lower(DWORD &next, DWORD rva, DWORD candidate)
+{
+	if (candidate > rva && candidate < next)
+		next = candidate;
+}
+
+// Finds the lowest RVA above the given one at which the resource section has
+// anything in use, be it directory tables, names, data entries, or data
+static DWORD NextInUse(const PEImage &image, const IMAGE_RESOURCE_DIRECTORY *dir, DWORD rva, DWORD next, int depth)
+{
+	const BYTE *const rsrc = reinterpret_cast<const BYTE *>(image.getRoot());
+	const DWORD rsrcRva = image.getResourceRva();
+	Lower(next, rva, rsrcRva + static_cast<DWORD>(reinterpret_cast<const BYTE *>(dir) - rsrc));
+	const UINT n = image.getCount(dir);
+	for (UINT i = 0; i < n; ++i)
+	{
+		const IMAGE_RESOURCE_DIRECTORY_ENTRY *const entry = image.getEntry(dir, i);
+		if (const IMAGE_RESOURCE_DIR_STRING_U *const name = image.getName(entry))
+			Lower(next, rva, rsrcRva + static_cast<DWORD>(reinterpret_cast<const BYTE *>(name) - rsrc));
+		if (const IMAGE_RESOURCE_DIRECTORY *const sub = image.getDirectory(entry))
+		{
+			// Directories nest three levels deep, for type, name, and language
+			if (depth < 2)
+				next = NextInUse(image, sub, rva, next, depth + 1);
+		}
+		else if (const IMAGE_RESOURCE_DATA_ENTRY *const data = image.getDataEntry(entry))
+		{
+			Lower(next, rva, rsrcRva + static_cast<DWORD>(reinterpret_cast<const BYTE *>(data) - rsrc));
+			Lower(next, rva, data->OffsetToData);
+		}
+	}
+	return next;
+}
+
+static HRESULT WriteChunks(LPCWSTR path, const Chunk *chunks, UINT n)
+{
+	static const BYTE zeros[0x1000] = { 0 };
+	HANDLE file = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return CoGetError();
+	HRESULT hr = S_OK;
+	for (UINT i = 0; SUCCEEDED(hr) && i < n; ++i)
+	{
+		DWORD cb = chunks[i].cb;
+		while (SUCCEEDED(hr) && cb != 0)
+		{
+			const BYTE *const p = chunks[i].data ? chunks[i].data + (chunks[i].cb - cb) : zeros;
+			DWORD cbWritten = p != zeros || cb < sizeof zeros ? cb : sizeof zeros;
+			if (!WriteFile(file, p, cbWritten, &cbWritten, NULL))
+				hr = CoGetError();
+			else if (cbWritten == 0)
+				hr = E_UNEXPECTED;
+			cb -= cbWritten;
+		}
+	}
+	if (!CloseHandle(file) && SUCCEEDED(hr))
+		hr = CoGetError();
+	return hr;
+}
+
+static HRESULT PatchResource(LPCWSTR path, LPCWSTR type, LPCWSTR name, WORD lang, const Chunk *pieces, UINT nPieces, DWORD cb, Chunk *chunks)
+{
+	PEImage image;
+	HRESULT hr = image.open(path, FILE_MAP_COPY);
+	if (FAILED(hr))
+		return hr;
+	// The view is copy-on-write, so it can be patched up in place before being
+	// written out to the temporary file
+	BYTE *const base = const_cast<BYTE *>(image.getBase());
+	IMAGE_NT_HEADERS32 *const nt = const_cast<IMAGE_NT_HEADERS32 *>(image.getNtHeaders());
+	const IMAGE_RESOURCE_DIRECTORY *dir = image.getDirectory(image.findEntry(image.getRoot(), type));
+	dir = image.getDirectory(image.findEntry(dir, name));
+	const IMAGE_RESOURCE_DIRECTORY_ENTRY *const entry = image.findEntry(dir, MAKEINTRESOURCEW(lang));
+	IMAGE_RESOURCE_DATA_ENTRY *const data = const_cast<IMAGE_RESOURCE_DATA_ENTRY *>(image.getDataEntry(entry));
+	if (data == NULL || entry->Name != lang)
+		return S_FALSE;
+	// Certificates are located by file offset, and wouldn't match anymore
+	const IMAGE_DATA_DIRECTORY *const security = image.getDataDirectory(IMAGE_DIRECTORY_ENTRY_SECURITY);
+	if (security != NULL && security->Size != 0)
+		return S_FALSE;
+	UINT nSections;
+	IMAGE_SECTION_HEADER *const sections = const_cast<IMAGE_SECTION_HEADER *>(image.getSections(&nSections));
+	UINT k = 0;
+	while (k < nSections && data->OffsetToData - sections[k].VirtualAddress >= sections[k].SizeOfRawData)
+		++k;
+	if (k == nSections)
+		return S_FALSE;
+	IMAGE_SECTION_HEADER &section = sections[k];
+	const DWORD size = image.getSize();
+	const DWORD cbRaw = section.SizeOfRawData;
+	if (section.PointerToRawData > size || size - section.PointerToRawData < cbRaw)
+		return S_FALSE;
+	// Whatever lies beyond the virtual size is file alignment padding
+	DWORD cbUsed = section.Misc.VirtualSize;
+	if (cbUsed == 0 || cbUsed > cbRaw)
+		cbUsed = cbRaw;
+	const DWORD start = data->OffsetToData - section.VirtualAddress;
+	const DWORD next = NextInUse(image, image.getRoot(), data->OffsetToData,
+		section.VirtualAddress + cbUsed, 0) - section.VirtualAddress;
+	if (next <= start || next - start < data->Size)
+		return S_FALSE;
+	UINT nChunks = 0;
+	if (cb <= next - start)
+	{
+		// Patch in place, and clear what is left over from the previous data
+		BYTE *p = base + section.PointerToRawData + start;
+		for (UINT i = 0; i < nPieces; ++i)
+		{
+			if (pieces[i].data)
+				MemCopy(p, pieces[i].data, pieces[i].cb);
+			else
+				SecureZeroMemory(p, pieces[i].cb);
+			p += pieces[i].cb;
+		}
+		if (data->Size > cb)
+			SecureZeroMemory(p, data->Size - cb);
+		chunks[nChunks].data = base;
+		chunks[nChunks++].cb = size;
+	}
+	else
+	{
+		// Growing the section requires it to be the last one, or to be followed
+		// by nothing but base relocations, which don't care where they live
+		for (UINT i = k + 1; i < nSections; ++i)
+		{
+			if (StrCmpNA(reinterpret_cast<LPCSTR>(sections[i].Name), ".reloc", IMAGE_SIZEOF_SHORT_NAME) != 0)
+				return S_FALSE;
+			if (sections[i].SizeOfRawData != 0 && sections[i].PointerToRawData < section.PointerToRawData + cbRaw)
+				return S_FALSE;
+		}
+		const DWORD fileAlignment = nt->OptionalHeader.FileAlignment;
+		const DWORD sectionAlignment = nt->OptionalHeader.SectionAlignment;
+		if (fileAlignment == 0 || (fileAlignment & (fileAlignment - 1)) != 0 ||
+			sectionAlignment == 0 || (sectionAlignment & (sectionAlignment - 1)) != 0)
+		{
+			return S_FALSE;
+		}
+		// Reuse the slot if nothing follows it, or else append to the section
+		const DWORD pos = next == cbUsed ? start : AlignUp(cbUsed, 8);
+		const DWORD cbVirtual = pos + cb;
+		if (pos > cbRaw || cbVirtual < pos || cbVirtual > MAXLONG)
+			return S_FALSE;
+		DWORD cbNewRaw = AlignUp(cbVirtual, fileAlignment);
+		if (cbNewRaw < cbRaw)
+			cbNewRaw = cbRaw;
+		const DWORD cbSpan = AlignUp(section.Misc.VirtualSize > cbRaw ? section.Misc.VirtualSize : cbRaw, sectionAlignment);
+		DWORD cbNewSpan = AlignUp(cbVirtual, sectionAlignment);
+		if (cbNewSpan < cbSpan)
+			cbNewSpan = cbSpan;
+		const DWORD deltaRaw = cbNewRaw - cbRaw;
+		const DWORD deltaVirtual = cbNewSpan - cbSpan;
+		const DWORD end = section.VirtualAddress + cbSpan;
+		for (UINT i = k + 1; i < nSections; ++i)
+		{
+			sections[i].VirtualAddress += deltaVirtual;
+			if (sections[i].SizeOfRawData != 0)
+				sections[i].PointerToRawData += deltaRaw;
+		}
+		for (UINT i = 0; const IMAGE_DATA_DIRECTORY *const directory = image.getDataDirectory(i); ++i)
+		{
+			if (directory->VirtualAddress >= end)
+				const_cast<IMAGE_DATA_DIRECTORY *>(directory)->VirtualAddress += deltaVirtual;
+		}
+		IMAGE_DATA_DIRECTORY *const resource = const_cast<IMAGE_DATA_DIRECTORY *>(image.getDataDirectory(IMAGE_DIRECTORY_ENTRY_RESOURCE));
+		if (resource->VirtualAddress + resource->Size < section.VirtualAddress + cbVirtual)
+			resource->Size = section.VirtualAddress + cbVirtual - resource->VirtualAddress;
+		nt->OptionalHeader.SizeOfImage += deltaVirtual;
+		nt->OptionalHeader.SizeOfInitializedData += deltaRaw;
+		section.Misc.VirtualSize = cbVirtual;
+		section.SizeOfRawData = cbNewRaw;
+		data->OffsetToData = section.VirtualAddress + pos;
+		chunks[nChunks].data = base;
+		chunks[nChunks++].cb = section.PointerToRawData + pos;
+		for (UINT i = 0; i < nPieces; ++i)
+			chunks[nChunks++] = pieces[i];
+		chunks[nChunks].data = NULL;
+		chunks[nChunks++].cb = cbNewRaw - cbVirtual;
+		chunks[nChunks].data = base + section.PointerToRawData + cbRaw;
+		chunks[nChunks++].cb = size - (section.PointerToRawData + cbRaw);
+	}
+	data->Size = cb;
+	// Files which come without a checksum are left without one
+	if (nt->OptionalHeader.CheckSum != 0)
+	{
+		nt->OptionalHeader.CheckSum = 0;
+		CheckSum sum;
+		for (UINT i = 0; i < nChunks; ++i)
+		{
+			if (chunks[i].data)
+				sum.update(chunks[i].data, chunks[i].cb);
+			else
+				sum.skip(chunks[i].cb);
+		}
+		nt->OptionalHeader.CheckSum = sum.get();
+	}
+	WCHAR folder[MAX_PATH];
+	lstrcpynW(folder, path, _countof(folder));
+	PathRemoveFileSpecW(folder);
+	WCHAR temp[MAX_PATH];
+	if (GetTempFileNameW(*folder ? folder : L".", L"mfd", 0, temp) == 0)
+		return CoGetError();
+	hr = WriteChunks(temp, chunks, nChunks);
+	// Let go of the mapping so the file can be replaced
+	image.close();
+	if (SUCCEEDED(hr) && !MoveFileExW(temp, path, MOVEFILE_REPLACE_EXISTING))
+		hr = CoGetError();
+	if (FAILED(hr))
+		DeleteFileW(temp);
+	return hr;
+}
+
+HRESULT ReplaceResource(LPCWSTR path, LPCWSTR type, LPCWSTR name, WORD lang, const Chunk *pieces, UINT nPieces)
+{
+	DWORD cb = 0;
+	for (UINT i = 0; i < nPieces; ++i)
+	{
+		if (pieces[i].cb > MAXLONG - cb)
+			return S_FALSE;
+		cb += pieces[i].cb;
+	}
+	// Room for the pieces, and for what comes before and after them
+	Chunk *const chunks = static_cast<Chunk *>(HeapAlloc(GetProcessHeap(), 0, (nPieces + 3) * sizeof *chunks));
+	if (chunks == NULL)
+		return E_OUTOFMEMORY;
+	HRESULT hr = PatchResource(path, type, name, lang, pieces, nPieces, cb, chunks);
+	HeapFree(GetProcessHeap(), 0, chunks);
+	return hr;
+}
@@ -0,0 +1,574 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <shlwapi.h>
+#include "miscutil.h"
+#include "hexcodec.h"
+#include "hive.h"
+#include "rgsimp.h"
+
+// Substitutes %NAME% by the replacement of that name, and %% by a single %,
+// same as ATL's registrar does before it parses a script. Returns
+// DISP_E_UNKNOWNNAME if the script refers to a replacement not passed in.
+static HRESULT Expand(LPCWSTR p, int n, const RgsReplacement *replacements, UINT count, LPWSTR out, int &len)
+{
+	len = 0;
+	while (n > 0)
+	{
+		LPCWSTR q = p;
+		while (n > 0 && *q != L'%')
+			++q, --n;
+		const int cch = static_cast<int>(q - p);
+		if (out)
+		{
+			for (int i = 0; i < cch; ++i)
+				out[len + i] = p[i];
+		}
+		len += cch;
+		if (n == 0)
+			break;
+		p = ++q;
+		--n;
+		while (n > 0 && *q != L'%')
+			++q, --n;
+		if (n == 0)
+			return DISP_E_UNKNOWNNAME;
+		LPCWSTR value = L"%";
+		if (q > p)
+		{
+			UINT i = 0;
+			while (i < count && CompareStringOrdinal(p, static_cast<int>(q - p), replacements[i].name, -1, TRUE) != CSTR_EQUAL)
+				++i;
+			if (i == count)
+				return DISP_E_UNKNOWNNAME;
+			value = replacements[i].value;
+		}
+		const int cchValue = lstrlenW(value);
+		if (out)
+		{
+			for (int i = 0; i < cchValue; ++i)
+				out[len + i] = value[i];
+		}
+		len += cchValue;
+		p = ++q;
+		--n;
+	}
+	return S_OK;
+}
+
+// Takes the content of a REGISTRY resource, which can be UTF-16 or UTF-8 if
+// it comes with a BOM, and is taken as ANSI otherwise
+HRESULT ExpandRgsScript(const BYTE *data, DWORD cb, const RgsReplacement *replacements, UINT count, BSTR *pbstr)
+{
+	*pbstr = NULL;
+	BSTR text = NULL;
+	LPCWSTR p;
+	int n;
+	if (cb >= 2 && data[0] == 0xFF && data[1] == 0xFE)
+	{
+		p = reinterpret_cast<LPCWSTR>(data + 2);
+		n = (cb - 2) / sizeof(WCHAR);
+	}
+	else
+	{
+		UINT codepage = CP_ACP;
+		if (cb >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF)
+		{
+			codepage = CP_UTF8;
+			data += 3;
+			cb -= 3;
+		}
+		const LPCSTR s = reinterpret_cast<LPCSTR>(data);
+		n = MultiByteToWideChar(codepage, 0, s, static_cast<int>(cb), NULL, 0);
+		if ((text = SysAllocStringLen(NULL, n)) == NULL)
+			return E_OUTOFMEMORY;
+		MultiByteToWideChar(codepage, 0, s, static_cast<int>(cb), text, n);
+		p = text;
+	}
+	int len;
+	HRESULT hr = Expand(p, n, replacements, count, NULL, len);
+	if (SUCCEEDED(hr))
+	{
+		if ((*pbstr = SysAllocStringLen(NULL, len)) != NULL)
+			Expand(p, n, replacements, count, *pbstr, len);
+		else
+			hr = E_OUTOFMEMORY;
+	}
+	SysFreeString(text);
+	return hr;
+}
+
+// Splits a script into tokens, and decodes the data of values. Tokens are
+// delimited in place, so the script gets destroyed.
+class RgsTokenizer
+{
+	LPWSTR p;
+	LPWSTR ahead;
+	DWORD dword;
+
+protected:
+	RgsTokenizer(LPWSTR p): p(p), ahead(NULL), dword(0) { }
+
+	static bool IsToken(LPCWSTR token, LPCWSTR text)
+	{
+		return token != NULL && lstrcmpiW(token, text) == 0;
+	}
+
+	// Tokens are delimited by white space, unless quoted, in which case they
+	// extend to the closing quote, with any doubled quotes taken literally
+	LPWSTR NextToken()
+	{
+		if (LPWSTR token = ahead)
+		{
+			ahead = NULL;
+			return token;
+		}
+		p += StrSpnW(p, L" \t\r\n");
+		if (*p == L'\0')
+			return NULL;
+		LPWSTR token = p;
+		if (*p == L'\'')
+		{
+			LPWSTR q = ++token;
+			for (;;)
+			{
+				if (*++p == L'\0')
+					return NULL;
+				if (*p == L'\'' && *++p != L'\'')
+					break;
+				*q++ = *p;
+			}
+			*q = L'\0';
+		}
+		else
+		{
+			while (*p != L'\0' && StrChrW(L" \t\r\n", *p) == NULL)
+				++p;
+			if (*p != L'\0')
+				*p++ = L'\0';
+		}
+		return token;
+	}
+
+	LPWSTR PeekToken()
+	{
+		return ahead = NextToken();
+	}
+
+	// Takes the type and data of a value, and turns the data into what goes
+	// into the registry. The data stays valid until the next call.
+	HRESULT NextValue(DWORD &type, const void *&pv, DWORD &cb)
+	{
+		const LPWSTR tag = NextToken();
+		const LPWSTR data = NextToken();
+		if (tag == NULL || data == NULL || tag[0] == L'\0' || tag[1] != L'\0')
+			return E_INVALIDARG;
+		pv = data;
+		switch (*tag | 0x20)
+		{
+		case L's':
+			type = REG_SZ;
+			cb = (lstrlenW(data) + 1) * sizeof(WCHAR);
+			break;
+		case L'e':
+			type = REG_EXPAND_SZ;
+			cb = (lstrlenW(data) + 1) * sizeof(WCHAR);
+			break;
+		case L'd':
+			{
+				int iVal;
+				if (!StrToIntExW(data, STIF_SUPPORT_HEX, &iVal))
+					return E_INVALIDARG;
+				dword = iVal;
+				type = REG_DWORD;
+				pv = &dword;
+				cb = sizeof dword;
+			}
+			break;
+		case L'b':
+			{
+				// Decode in place, which is fine as bytes are shorter than digits
+				const int n = HexDecodeRun(data, reinterpret_cast<BYTE *>(data));
+				if (n < 0)
+					return E_INVALIDARG;
+				cb = n;
+				type = REG_BINARY;
+			}
+			break;
+		case L'm':
+			{
+				// Strings are separated by \0 sequences
+				LPWSTR q = data;
+				for (LPCWSTR r = data; *r != L'\0'; ++r)
+				{
+					if (r[0] == L'\\' && r[1] == L'0')
+					{
+						*q++ = L'\0';
+						++r;
+					}
+					else
+					{
+						*q++ = *r;
+					}
+				}
+				*q = L'\0';
+				type = REG_MULTI_SZ;
+				cb = static_cast<DWORD>(q - data + 1) * sizeof(WCHAR);
+			}
+			break;
+		default:
+			return E_INVALIDARG;
+		}
+		return S_OK;
+	}
+};
+
+// Recursive descent parser for the script language understood by ATL's
+// registrar
+class RgsParser: RgsTokenizer
+{
+	Hive &hive;
+
+public:
+	RgsParser(Hive &hive, LPWSTR p): RgsTokenizer(p), hive(hive) { }
+
+	HRESULT Parse()
+	{
+		while (LPWSTR token = NextToken())
+		{
+			Hive::Key *key = NULL;
+			if (PathMatchSpecW(token, L"HKEY_CLASSES_ROOT;HKCR"))
+				key = hive.GetClassesRoot();
+			else if (PathMatchSpecW(token, L"HKEY_LOCAL_MACHINE;HKLM"))
+				key = hive.GetRoot();
+			// The hive has no place for these, so their content goes nowhere
+			else if (!PathMatchSpecW(token, L"HKEY_CURRENT_USER;HKCU;HKEY_USERS;HKU;"
+				L"HKEY_PERFORMANCE_DATA;HKPD;HKEY_DYN_DATA;HKDD;HKEY_CURRENT_CONFIG;HKCC"))
+			{
+				return E_INVALIDARG;
+			}
+			if (!IsToken(NextToken(), L"{"))
+				return E_INVALIDARG;
+			if (HRESULT hr = ParseKeys(key))
+				return hr;
+		}
+		return S_OK;
+	}
+
+private:
+	HRESULT ParseValue(Hive::Key *key, LPCWSTR name)
+	{
+		DWORD type, cb;
+		const void *data;
+		HRESULT hr = NextValue(type, data, cb);
+		if (hr == S_OK)
+			hive.SetValue(key, name, type, data, cb);
+		return hr;
+	}
+
+	// Parses the content of a key up to the closing brace. Passing a NULL key
+	// still parses the content but drops it on the floor.
+	HRESULT ParseKeys(Hive::Key *parent)
+	{
+		while (LPWSTR token = NextToken())
+		{
+			if (IsToken(token, L"}"))
+				return S_OK;
+			bool remove = false;
+			bool keep = true;
+			if (IsToken(token, L"ForceRemove"))
+			{
+				remove = true;
+				token = NextToken();
+			}
+			else if (IsToken(token, L"NoRemove"))
+			{
+				token = NextToken();
+			}
+			else if (IsToken(token, L"Delete"))
+			{
+				remove = true;
+				keep = false;
+				token = NextToken();
+			}
+			if (token == NULL)
+				break;
+			if (IsToken(token, L"val"))
+			{
+				const LPWSTR name = NextToken();
+				if (name == NULL || !IsToken(NextToken(), L"="))
+					return E_INVALIDARG;
+				if (HRESULT hr = ParseValue(parent, name))
+					return hr;
+				continue;
+			}
+			Hive::Key *key = NULL;
+			if (parent != NULL)
+			{
+				if (remove)
+					hive.DeleteSubKey(parent, token);
+				if (keep && (key = hive.CreateKey(parent, token)) == NULL)
+					return E_OUTOFMEMORY;
+			}
+			// Keys named by the script count as written to, same as Capture()
+			// would find them after a registration through the registrar
+			if (key != NULL)
+				hive.Touch(key);
+			if (IsToken(PeekToken(), L"="))
+			{
+				NextToken();
+				if (HRESULT hr = ParseValue(key, NULL))
+					return hr;
+			}
+			if (IsToken(PeekToken(), L"{"))
+			{
+				NextToken();
+				if (HRESULT hr = ParseKeys(key))
+					return hr;
+			}
+		}
+		return E_INVALIDARG;
+	}
+};
+
+HRESULT ImportRgsScript(Hive &hive, LPWSTR script)
+{
+	return RgsParser(hive, script).Parse();
+}
+
+// Applies a script of the kind manfred writes right to the registry, through
+// one handle per key, and without writing what is there already. Keys marked
+// ForceRemove, along with their subkeys, end up holding just what the script
+// says, same as if they had been deleted and created anew by the registrar.
+class RgsApplier: RgsTokenizer
+{
+	// A name which occurs within the block of a key
+	struct Name
+	{
+		LPCWSTR name;
+		bool key;
+	};
+
+	Name *names;
+	UINT nNames;
+	bool changed;
+	BYTE *current; // data of the value in place, for comparison
+	DWORD cbCurrent;
+	WCHAR buffer[16384];
+
+public:
+	RgsApplier(LPWSTR p): RgsTokenizer(p), names(NULL), nNames(0), changed(false), current(NULL), cbCurrent(0) { }
+	~RgsApplier()
+	{
+		CoTaskMemFree(names);
+		CoTaskMemFree(current);
+	}
+
+	// Returns S_FALSE if the registry was left as it is
+	HRESULT Apply(HKEY hKey)
+	{
+		while (LPWSTR token = NextToken())
+		{
+			if (!PathMatchSpecW(token, L"HKEY_CLASSES_ROOT;HKCR") || !IsToken(NextToken(), L"{"))
+				return E_INVALIDARG;
+			if (HRESULT hr = ApplyKeys(hKey, false, false))
+				return hr;
+		}
+		return changed ? S_OK : S_FALSE;
+	}
+
+private:
+	HRESULT Note(LPCWSTR name, bool key)
+	{
+		// Grow the array whenever the count reaches a power of two
+		if ((nNames & (nNames - 1)) == 0)
+		{
+			void *const p = CoTaskMemRealloc(names, (nNames ? nNames * 2 : 1) * sizeof *names);
+			if (p == NULL)
+				return E_OUTOFMEMORY;
+			names = static_cast<Name *>(p);
+		}
+		names[nNames].name = name;
+		names[nNames].key = key;
+		++nNames;
+		return S_OK;
+	}
+
+	bool IsNoted(LPCWSTR name, bool key, UINT first) const
+	{
+		for (UINT i = first; i < nNames; ++i)
+			if (names[i].key == key && lstrcmpiW(names[i].name, name) == 0)
+				return true;
+		return false;
+	}
+
+	// Tells whether the value is in place already. The buffer to read it into
+	// grows to the size of the largest value compared so far.
+	bool IsCurrent(HKEY key, LPCWSTR name, DWORD type, const void *data, DWORD cb)
+	{
+		if (cb > cbCurrent)
+		{
+			void *const p = CoTaskMemRealloc(current, cb);
+			if (p == NULL)
+				return false;
+			current = static_cast<BYTE *>(p);
+			cbCurrent = cb;
+		}
+		// Anything bigger than the new data fails to fit, and differs anyway
+		DWORD typeInPlace;
+		DWORD cbInPlace = cb;
+		return RegQueryValueExW(key, name, NULL, &typeInPlace, current, &cbInPlace) == ERROR_SUCCESS &&
+			typeInPlace == type && cbInPlace == cb && MemEqual(current, static_cast<const BYTE *>(data), cb);
+	}
+
+	HRESULT ApplyValue(HKEY key, LPCWSTR name, bool fresh)
+	{
+		DWORD type, cb;
+		const void *data;
+		if (HRESULT hr = NextValue(type, data, cb))
+			return hr;
+		if (!fresh && IsCurrent(key, name, type, data, cb))
+			return S_OK;
+		if (LSTATUS status = RegSetValueExW(key, name, 0, type, static_cast<const BYTE *>(data), cb))
+			return HRESULT_FROM_WIN32(status);
+		changed = true;
+		return S_OK;
+	}
+
+	// Deletes the values and subkeys of a key which have not been noted from
+	// the given index on
+	HRESULT Prune(HKEY key, UINT first)
+	{
+		DWORD index = 0;
+		for (;;)
+		{
+			DWORD cch = _countof(buffer);
+			LSTATUS status = RegEnumValueW(key, index, buffer, &cch, NULL, NULL, NULL, NULL);
+			if (status == ERROR_NO_MORE_ITEMS)
+				break;
+			if (status == ERROR_SUCCESS && !IsNoted(buffer, false, first))
+			{
+				if ((status = RegDeleteValueW(key, buffer)) != ERROR_SUCCESS)
+					return HRESULT_FROM_WIN32(status);
+				changed = true;
+				continue;
+			}
+			if (status != ERROR_SUCCESS)
+				return HRESULT_FROM_WIN32(status);
+			++index;
+		}
+		index = 0;
+		for (;;)
+		{
+			DWORD cch = _countof(buffer);
+			LSTATUS status = RegEnumKeyExW(key, index, buffer, &cch, NULL, NULL, NULL, NULL);
+			if (status == ERROR_NO_MORE_ITEMS)
+				break;
+			if (status == ERROR_SUCCESS && !IsNoted(buffer, true, first))
+			{
+				if ((status = RegDeleteTreeW(key, buffer)) != ERROR_SUCCESS)
+					return HRESULT_FROM_WIN32(status);
+				changed = true;
+				continue;
+			}
+			if (status != ERROR_SUCCESS)
+				return HRESULT_FROM_WIN32(status);
+			++index;
+		}
+		return S_OK;
+	}
+
+	// Applies a key along with its default value and block, if any. Keys
+	// which have just been created have nothing to compare against or prune.
+	HRESULT ApplyKey(HKEY parent, LPCWSTR name, bool prune)
+	{
+		const REGSAM access = KEY_QUERY_VALUE | KEY_SET_VALUE | KEY_CREATE_SUB_KEY |
+			(prune ? KEY_ENUMERATE_SUB_KEYS | DELETE : 0);
+		HKEY key;
+		DWORD disposition;
+		if (LSTATUS status = RegCreateKeyExW(parent, name, 0, NULL, 0, access, NULL, &key, &disposition))
+			return HRESULT_FROM_WIN32(status);
+		const bool fresh = disposition == REG_CREATED_NEW_KEY;
+		if (fresh)
+			changed = true;
+		const UINT first = nNames;
+		HRESULT hr = S_OK;
+		if (IsToken(PeekToken(), L"="))
+		{
+			NextToken();
+			hr = ApplyValue(key, NULL, fresh);
+			if (hr == S_OK && prune)
+				hr = Note(L"", false);
+		}
+		if (hr == S_OK && IsToken(PeekToken(), L"{"))
+		{
+			NextToken();
+			hr = ApplyKeys(key, prune, fresh);
+		}
+		if (hr == S_OK && prune && !fresh)
+			hr = Prune(key, first);
+		nNames = first;
+		RegCloseKey(key);
+		return hr;
+	}
+
+	// Applies the content of a key up to the closing brace
+	HRESULT ApplyKeys(HKEY parent, bool prune, bool fresh)
+	{
+		while (LPWSTR token = NextToken())
+		{
+			if (IsToken(token, L"}"))
+				return S_OK;
+			bool remove = prune;
+			if (IsToken(token, L"ForceRemove"))
+			{
+				remove = true;
+				token = NextToken();
+			}
+			else if (IsToken(token, L"NoRemove"))
+			{
+				token = NextToken();
+			}
+			// Scripts which manfred writes never delete anything
+			if (token == NULL || IsToken(token, L"Delete"))
+				break;
+			const bool value = IsToken(token, L"val");
+			if (value && ((token = NextToken()) == NULL || !IsToken(NextToken(), L"=")))
+				return E_INVALIDARG;
+			if (prune)
+			{
+				if (HRESULT hr = Note(token, !value))
+					return hr;
+			}
+			if (HRESULT hr = value ? ApplyValue(parent, token, fresh) : ApplyKey(parent, token, remove))
+				return hr;
+		}
+		return E_INVALIDARG;
+	}
+};
+
+HRESULT ApplyRgsScript(HKEY hKey, LPWSTR script)
+{
+	return RgsApplier(script).Apply(hKey);
+}
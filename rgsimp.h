@@ -0,0 +1,11 @@
+class Hive;
+
+struct RgsReplacement
+{
+	LPCWSTR name;
+	LPCWSTR value;
+};
+
+HRESULT ExpandRgsScript(const BYTE *, DWORD, const RgsReplacement *, UINT, BSTR *);
+HRESULT ImportRgsScript(Hive &, LPWSTR);
+HRESULT ApplyRgsScript(HKEY, LPWSTR);
@@ -30,80 +30,96 @@ public:
 	~Scoped();
 };
 
+template<>
 inline Scoped<VARIANT>::Scoped()
 {
 	VariantInit(this);
 }
 
+template<>
 inline Scoped<VARIANT>::~Scoped()
 {
 	VariantClear(this);
 }
 
+// Tags which tell Scoped2 how to free what it holds
+enum eLOCAL { };
+enum eTASKMEM { };
+enum eHCRYPTPROV { };
+enum eHCRYPTKEY { };
+enum eHCERTSTORE { };
+enum eHKEY { };
+enum eHWND { };
+enum eFINDFILE { };
+enum ePSID { };
+enum eBSTR { };
+enum eOBJECT { };
+enum eSCALAR { };
+enum eVECTOR { };
+
 template<class T, class U>
 class Scoped2
 {
 protected:
 	T scoped;
 private:
-	template<class U> void Free();
-	template<> void Free<enum eLOCAL>()
+	void Free(eLOCAL *)
 	{
 		LocalFree(scoped);
 	}
-	template<> void Free<enum eTASKMEM>()
+	void Free(eTASKMEM *)
 	{
 		CoTaskMemFree(scoped);
 	}
-	template<> void Free<enum eHCRYPTPROV>()
+	void Free(eHCRYPTPROV *)
 	{
 		if (scoped != NULL)
 			CryptReleaseContext(scoped, 0);
 	}
-	template<> void Free<enum eHCRYPTKEY>()
+	void Free(eHCRYPTKEY *)
 	{
 		if (scoped != NULL)
 			CryptDestroyKey(scoped);
 	}
-	template<> void Free<enum eHCERTSTORE>()
+	void Free(eHCERTSTORE *)
 	{
 		if (scoped != NULL)
 			CertCloseStore(scoped, 0);
 	}
-	template<> void Free<enum eHKEY>()
+	void Free(eHKEY *)
 	{
 		if (scoped != NULL)
 			RegCloseKey(scoped);
 	}
-	template<> void Free<enum eHWND>()
+	void Free(eHWND *)
 	{
 		if (scoped != NULL)
 			DestroyWindow(scoped);
 	}
-	template<> void Free<enum eFINDFILE>()
+	void Free(eFINDFILE *)
 	{
 		if (scoped != INVALID_HANDLE_VALUE)
 			FindClose(scoped);
 	}
-	template<> void Free<enum ePSID>()
+	void Free(ePSID *)
 	{
 		if (scoped != NULL)
 			FreeSid(scoped);
 	}
-	template<> void Free<enum eBSTR>()
+	void Free(eBSTR *)
 	{
 		SysFreeString(scoped);
 	}
-	template<> void Free<enum eOBJECT>()
+	void Free(eOBJECT *)
 	{
 		if (scoped != NULL)
 			scoped->Release();
 	}
-	template<> void Free<enum eSCALAR>()
+	void Free(eSCALAR *)
 	{
 		delete scoped;
 	}
-	template<> void Free<enum eVECTOR>()
+	void Free(eVECTOR *)
 	{
 		delete[] scoped;
 	}
@@ -113,5 +129,5 @@ public:
 	T *operator &() { return &scoped; }
 	Scoped2(T scoped = 0) : scoped(scoped) { }
 	void operator=(T scoped) { this->scoped = scoped; }
-	~Scoped2() { Free<U>(); }
+	~Scoped2() { Free(static_cast<U *>(NULL)); }
 };
@@ -0,0 +1,236 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bench.h"
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <vector>
+
+namespace
+{
+	struct Entry
+	{
+		const char *name;
+		Bench::Function function;
+	};
+
+	std::vector<Entry> &Cases()
+	{
+		static std::vector<Entry> cases;
+		return cases;
+	}
+
+	double Now()
+	{
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec + ts.tv_nsec * 1e-9;
+	}
+
+	int Remove(const char *path, const struct stat *, int, struct FTW *)
+	{
+		return remove(path);
+	}
+
+	void RemoveTree(const char *path)
+	{
+		nftw(path, Remove, 16, FTW_DEPTH | FTW_PHYS);
+	}
+
+	// Benchmark names and error messages come without anything to escape
+	// but quotes and backslashes
+	std::string Quote(const std::string &s)
+	{
+		std::string quoted = "\"";
+		for (size_t i = 0; i < s.size(); ++i)
+		{
+			if (s[i] == '"' || s[i] == '\\')
+				quoted += '\\';
+			quoted += s[i] >= 0x20 ? s[i] : ' ';
+		}
+		return quoted + "\"";
+	}
+
+	bool ParseNumber(const char *arg, UINT &value)
+	{
+		char *end;
+		const unsigned long n = arg ? strtoul(arg, &end, 10) : 0;
+		if (arg == NULL || *end != '\0' || end == arg)
+			return false;
+		value = static_cast<UINT>(n);
+		return true;
+	}
+
+	int Usage(const char *program)
+	{
+		fprintf(stderr,
+			"Usage: %s [options] [benchmark ...]\n"
+			"\n"
+			"--seed N         seed of the synthetic corpus (1)\n"
+			"--components N   count of .reg files (50)\n"
+			"--classes N      count of classes per component (40)\n"
+			"--values N       count of binary values per class (2)\n"
+			"--shared N       count of classes shared with the next component (1)\n"
+			"--iterations N   runs each benchmark exactly so many times\n"
+			"--seconds N      runs each benchmark for at least so many seconds (1)\n"
+			"--list           lists the benchmarks rather than running them\n",
+			program);
+		return 2;
+	}
+}
+
+Bench::Case::Case(const char *name, Function function)
+{
+	const Entry entry = { name, function };
+	Cases().push_back(entry);
+}
+
+Bench::State::State(const Corpus::Options &corpus, UINT iterations, double seconds)
+: corpus(corpus), count(0), elapsed(0), bytes(0), items(0), iterations(iterations), seconds(seconds), start(0), running(false)
+{
+}
+
+bool Bench::State::Next()
+{
+	const double now = Now();
+	if (!running)
+	{
+		running = true;
+		start = now;
+	}
+	else
+	{
+		++count;
+		elapsed = now - start;
+	}
+	if (!error.empty())
+		return false;
+	return iterations != 0 ? count < iterations : count == 0 || elapsed < seconds;
+}
+
+void Bench::State::Fail(const std::string &message)
+{
+	if (error.empty())
+		error = message;
+}
+
+// Runs all benchmarks, or those whose names are given on the command line,
+// and writes one JSON document with the results to standard output
+int main(int argc, char *argv[])
+{
+	Corpus::Options corpus;
+	UINT iterations = 0;
+	UINT seconds = 1;
+	bool list = false;
+	std::vector<const char *> names;
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *const arg = argv[i];
+		const char *const next = i + 1 < argc ? argv[i + 1] : NULL;
+		UINT *const value =
+			strcmp(arg, "--seed") == 0 ? &corpus.seed :
+			strcmp(arg, "--components") == 0 ? &corpus.components :
+			strcmp(arg, "--classes") == 0 ? &corpus.classes :
+			strcmp(arg, "--values") == 0 ? &corpus.values :
+			strcmp(arg, "--shared") == 0 ? &corpus.shared :
+			strcmp(arg, "--iterations") == 0 ? &iterations :
+			strcmp(arg, "--seconds") == 0 ? &seconds : NULL;
+		if (value != NULL)
+		{
+			if (!ParseNumber(next, *value))
+				return Usage(argv[0]);
+			++i;
+		}
+		else if (strcmp(arg, "--list") == 0)
+			list = true;
+		else if (arg[0] == '-')
+			return Usage(argv[0]);
+		else
+			names.push_back(arg);
+	}
+	const std::vector<Entry> &cases = Cases();
+	if (list)
+	{
+		for (size_t i = 0; i < cases.size(); ++i)
+			printf("%s\n", cases[i].name);
+		return 0;
+	}
+	char root[] = "/tmp/manfred-bench-XXXXXX";
+	if (mkdtemp(root) == NULL)
+	{
+		perror("mkdtemp");
+		return 2;
+	}
+	int failures = 0;
+	int count = 0;
+	ULONGLONG cbCorpus = 0;
+	std::string results;
+	for (size_t i = 0; i < cases.size(); ++i)
+	{
+		bool selected = names.empty();
+		for (size_t j = 0; j < names.size(); ++j)
+			if (strcmp(names[j], cases[i].name) == 0)
+				selected = true;
+		if (!selected)
+			continue;
+		// Give each benchmark a fresh drive C: and registry
+		char folder[sizeof root + 16];
+		snprintf(folder, sizeof folder, "%s/%d", root, count++);
+		mkdir(folder, 0755);
+		Shim::SetRoot(folder);
+		Shim::ResetRegistry();
+		Shim::RemoveModules();
+		Shim::EnableSse2(true);
+		cbCorpus = Corpus::Write(corpus);
+		Bench::State state(corpus, iterations, seconds);
+		cases[i].function(state);
+		Shim::TakeOutput();
+		char text[256];
+		results += results.empty() ? "\n\t\t{ " : ",\n\t\t{ ";
+		results += "\"name\": " + Quote(cases[i].name);
+		if (!state.error.empty())
+		{
+			results += ", \"error\": " + Quote(state.error) + " }";
+			fprintf(stderr, "%s: %s\n", cases[i].name, state.error.c_str());
+			++failures;
+			continue;
+		}
+		const double ns = state.count ? state.elapsed * 1e9 / state.count : 0;
+		results.append(text, snprintf(text, sizeof text, ", \"iterations\": %u, \"ns_per_iteration\": %.0f", state.count, ns));
+		if (state.bytes != 0 && state.elapsed > 0)
+			results.append(text, snprintf(text, sizeof text, ", \"bytes_per_second\": %.0f", state.bytes * state.count / state.elapsed));
+		if (state.items != 0 && state.elapsed > 0)
+			results.append(text, snprintf(text, sizeof text, ", \"items_per_second\": %.0f", state.items * state.count / state.elapsed));
+		results += " }";
+	}
+	RemoveTree(root);
+	printf("{\n\t\"corpus\": { \"seed\": %u, \"components\": %u, \"classes\": %u, \"values\": %u, \"shared\": %u, \"bytes\": %llu },\n",
+		corpus.seed, corpus.components, corpus.classes, corpus.values, corpus.shared, static_cast<unsigned long long>(cbCorpus));
+	printf("\t\"benchmarks\": [%s\n\t]\n}\n", results.c_str());
+	return failures != 0 || count == 0;
+}
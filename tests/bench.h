@@ -0,0 +1,79 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// A minimal benchmark framework: BENCH() defines a benchmark which registers
+// itself, and which loops on State::Next() around the code to be timed. Each
+// benchmark gets a fresh drive C: and registry, with the synthetic corpus of
+// corpus.h in place. The results go to standard output as JSON.
+
+#pragma once
+
+#include <shlwapi.h>
+#include "win32/shim.h"
+#include "corpus.h"
+#include <string>
+
+namespace Bench
+{
+	class State;
+
+	typedef void (*Function)(State &);
+
+	struct Case
+	{
+		Case(const char *name, Function function);
+	};
+
+	// Times the iterations of a benchmark. Next() keeps returning true until
+	// the iterations have taken the minimum time, or reached the count given
+	// on the command line. Anything done before the first call to Next() is
+	// set up, and does not count.
+	class State
+	{
+	public:
+		State(const Corpus::Options &corpus, UINT iterations, double seconds);
+		bool Next();
+		// Counts what one iteration goes through, for rates to be derived
+		void SetBytes(ULONGLONG cb) { bytes = cb; }
+		void SetItems(ULONGLONG n) { items = n; }
+		// Tells a benchmark why it could not be run, without ending the program
+		void Fail(const std::string &message);
+		const Corpus::Options &corpus;
+		UINT count;
+		double elapsed;
+		ULONGLONG bytes;
+		ULONGLONG items;
+		std::string error;
+	private:
+		const UINT iterations;
+		const double seconds;
+		double start;
+		bool running;
+	};
+}
+
+#define BENCH(name) \
+	static void name(Bench::State &); \
+	static Bench::Case name##_case(#name, name); \
+	static void name(Bench::State &state)
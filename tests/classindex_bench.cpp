@@ -0,0 +1,167 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Benchmarks for the ClassIndex of classindex.h, with all processors calling
+// through it at once, and for the search of the manifest text which it has
+// taken the place of
+
+#include "bench.h"
+#include "../miscutil.h"
+#include "../guid.h"
+#include "../classindex.h"
+#include "../workpool.h"
+#include <vector>
+
+namespace
+{
+	const UINT CallsPerThread = 10000;
+
+	HRESULT STDMETHODCALLTYPE GetClassObject(REFCLSID, REFIID, LPVOID *ppv)
+	{
+		*ppv = NULL;
+		return S_OK;
+	}
+
+	// A manifest which names a module per component in the description of
+	// each of its classes, as manfred.manifest does
+	std::string MakeServerManifest(const Corpus::Options &options)
+	{
+		std::string text = "<assembly>\r\n\t<file name=\"manfred.exe\">\r\n";
+		for (UINT c = 0; c < options.components; ++c)
+		{
+			char module[32];
+			snprintf(module, sizeof module, "comp%u.dll", c);
+			for (UINT i = 0; i < options.classes; ++i)
+			{
+				char clsid[39];
+				FormatGuid(Corpus::MakeGuid(options, c, i), clsid);
+				text += std::string("\t\t<comClass clsid=\"") + clsid + "\" description=\"" + module + "\" threadingModel=\"Both\" />\r\n";
+			}
+		}
+		return text + "\t</file>\r\n</assembly>\r\n";
+	}
+
+	void LoadModules(const Corpus::Options &options)
+	{
+		const Shim::Export exports[] =
+		{
+			{ "DllGetClassObject", reinterpret_cast<FARPROC>(GetClassObject) },
+		};
+		for (UINT c = 0; c < options.components; ++c)
+		{
+			WCHAR module[32];
+			wnsprintfW(module, _countof(module), L"comp%u.dll", c);
+			Shim::AddModule(module, exports, _countof(exports));
+			LoadLibraryW(module);
+		}
+	}
+
+	struct Context
+	{
+		const ClassIndex *index;
+		std::vector<GUID> clsids;
+		volatile LONG threads;
+		volatile LONG failures;
+	};
+
+	DWORD WINAPI CallThrough(LPVOID param)
+	{
+		Context &context = *static_cast<Context *>(param);
+		const UINT n = static_cast<UINT>(context.clsids.size());
+		UINT k = static_cast<UINT>(InterlockedIncrement(&context.threads)) * 7919;
+		for (UINT i = 0; i < CallsPerThread; ++i)
+		{
+			LPVOID pv;
+			k = k * 1103515245 + 12345;
+			if (context.index->GetClassObject(context.clsids[(k >> 8) % n], IID_IUnknown, &pv) != S_OK)
+				InterlockedIncrement(&context.failures);
+		}
+		return 0;
+	}
+}
+
+// Lookups on as many threads as there are processors, but no fewer than four,
+// each of which makes the same number of calls, in an order of its own
+BENCH(ClassIndexContention)
+{
+	LoadModules(state.corpus);
+	const std::string manifest = MakeServerManifest(state.corpus);
+	ClassIndex index = { NULL, 0 };
+	index.Build(manifest.data(), static_cast<DWORD>(manifest.size()));
+	Context context;
+	context.index = &index;
+	context.failures = 0;
+	for (UINT c = 0; c < state.corpus.components; ++c)
+		for (UINT i = 0; i < state.corpus.classes; ++i)
+			context.clsids.push_back(Corpus::MakeGuid(state.corpus, c, i));
+	UINT nThreads = WorkPool::getProcessorCount();
+	HANDLE threads[64];
+	if (nThreads < 4)
+		nThreads = 4;
+	if (nThreads > _countof(threads))
+		nThreads = _countof(threads);
+	while (!context.clsids.empty() && state.Next())
+	{
+		context.threads = 0;
+		for (UINT i = 0; i < nThreads; ++i)
+			threads[i] = CreateThread(NULL, 0, CallThrough, &context, 0, NULL);
+		WaitForMultipleObjects(nThreads, threads, TRUE, INFINITE);
+		for (UINT i = 0; i < nThreads; ++i)
+			CloseHandle(threads[i]);
+	}
+	if (context.failures != 0)
+		state.Fail("Some calls did not go through");
+	index.Free();
+	state.SetItems(static_cast<ULONGLONG>(nThreads) * CallsPerThread);
+}
+
+// The search of the manifest text for a CLSID which each call used to make
+// before there was an index, on one thread
+BENCH(ClassLookupScan)
+{
+	const std::string manifest = MakeServerManifest(state.corpus);
+	const char *const end = manifest.data() + manifest.size();
+	std::vector<GUID> clsids;
+	for (UINT c = 0; c < state.corpus.components; ++c)
+		for (UINT i = 0; i < state.corpus.classes; ++i)
+			clsids.push_back(Corpus::MakeGuid(state.corpus, c, i));
+	const UINT n = static_cast<UINT>(clsids.size());
+	const UINT calls = n < 1000 ? n : 1000;
+	UINT found = 0;
+	while (n != 0 && state.Next())
+	{
+		found = 0;
+		for (UINT i = 0; i < calls; ++i)
+		{
+			char tag[] = "<comClass clsid=\"{00000000-0000-0000-0000-000000000000}\" description=\"";
+			FormatGuid(clsids[i * 7919 % n], tag + 17);
+			tag[17 + 38] = '"';
+			if (MemSearch(manifest.data(), end - manifest.data(), tag, sizeof tag - 1) != NULL)
+				++found;
+		}
+	}
+	if (found != calls)
+		state.Fail("Some classes were not found");
+	state.SetItems(calls);
+}
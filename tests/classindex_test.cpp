@@ -0,0 +1,225 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Tests for the ClassIndex of classindex.h, which the exported
+// DllGetClassObject() forwards calls through
+
+#include "test.h"
+#include "../miscutil.h"
+#include "../guid.h"
+#include "../classindex.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+	volatile LONG CallsOfA;
+	volatile LONG CallsOfB;
+
+	HRESULT STDMETHODCALLTYPE GetClassObjectA(REFCLSID, REFIID, LPVOID *ppv)
+	{
+		InterlockedIncrement(&CallsOfA);
+		*ppv = const_cast<char *>("A");
+		return S_OK;
+	}
+
+	HRESULT STDMETHODCALLTYPE GetClassObjectB(REFCLSID, REFIID, LPVOID *ppv)
+	{
+		InterlockedIncrement(&CallsOfB);
+		*ppv = const_cast<char *>("B");
+		return S_OK;
+	}
+
+	void AddModule(LPCWSTR name, LPFNGETCLASSOBJECT pfn)
+	{
+		const Shim::Export exports[] =
+		{
+			{ "DllGetClassObject", reinterpret_cast<FARPROC>(pfn) },
+		};
+		Shim::AddModule(name, exports, pfn ? 1 : 0);
+	}
+
+	GUID MakeClsid(UINT i)
+	{
+		GUID guid = { i * 2654435761U, static_cast<WORD>(i), 0, { 0, 0, 0, 0, 0, 0, 0, static_cast<BYTE>(i) } };
+		return guid;
+	}
+
+	std::string ComClass(const GUID &clsid, const char *module)
+	{
+		char text[39];
+		FormatGuid(clsid, text);
+		return std::string("\t\t<comClass clsid=\"") + text + "\" description=\"" + module + "\" threadingModel=\"Both\" />\r\n";
+	}
+
+	struct Index: ClassIndex
+	{
+		explicit Index(const std::string &manifest)
+		{
+			entries = NULL;
+			count = 0;
+			Build(manifest.data(), static_cast<DWORD>(manifest.size()));
+		}
+		~Index()
+		{
+			Free();
+		}
+	};
+
+	const WCHAR *Module(const Index &index, const GUID &clsid)
+	{
+		const ClassIndex::Entry *const entry = index.Find(clsid);
+		return entry ? entry->module : NULL;
+	}
+}
+
+// [user-010] Every CLSID is found, whatever order the manifest has them in,
+// and the entries come out sorted
+TEST(FindsEachClass)
+{
+	std::string manifest = "<assembly>\r\n\t<file name=\"manfred.exe\">\r\n";
+	for (UINT i = 0; i < 1000; ++i)
+		manifest += ComClass(MakeClsid(i * 7919 % 1000), i % 2 ? "a.dll" : "b.dll");
+	manifest += "\t</file>\r\n</assembly>\r\n";
+	Index index(manifest);
+	CHECK_EQ(index.count, 1000u);
+	for (UINT i = 1; i < index.count; ++i)
+		CHECK(ClassIndex::Compare(index.entries[i - 1].clsid, index.entries[i].clsid) < 0);
+	for (UINT i = 0; i < 1000; ++i)
+		CHECK(index.Find(MakeClsid(i)) != NULL);
+	CHECK(index.Find(MakeClsid(1000)) == NULL);
+	CHECK(index.Find(IID_IUnknown) == NULL);
+}
+
+// [user-010] Of several entries for a CLSID, the first in the manifest wins
+TEST(FirstOfDuplicatesWins)
+{
+	std::string manifest;
+	for (UINT i = 0; i < 20; ++i)
+		manifest += ComClass(MakeClsid(i), "other.dll");
+	manifest += ComClass(MakeClsid(5), "second.dll");
+	manifest = ComClass(MakeClsid(5), "first.dll") + manifest;
+	Index index(manifest);
+	CHECK_EQ(index.count, 22u);
+	CHECK_STR(Module(index, MakeClsid(5)), L"first.dll");
+}
+
+// [user-010] Entries which lack a proper CLSID or a description are left out,
+// and so is one which a truncated manifest cuts off
+TEST(SkipsMalformedEntries)
+{
+	const std::string manifest =
+		"<comClass clsid=\"{not-a-guid-0000-0000-0000-000000000000}\" description=\"bad.dll\" />\r\n"
+		"<comClass clsid=\"{00000001-0000-0000-0000-000000000000}\" threadingModel=\"Both\" />\r\n"
+		+ ComClass(MakeClsid(2), "good.dll") +
+		"<comClass clsid=\"{00000003-0000-0000-0000-000000000000}\" description=\"cut";
+	Index index(manifest);
+	CHECK_EQ(index.count, 1u);
+	CHECK_STR(Module(index, MakeClsid(2)), L"good.dll");
+	Index empty("<assembly />");
+	CHECK_EQ(empty.count, 0u);
+	CHECK(empty.Find(MakeClsid(2)) == NULL);
+}
+
+// [user-010] A call goes through once the module has been loaded, and from
+// then on takes the remembered entry point, with the module pinned
+TEST(ResolvesOnceLoaded)
+{
+	AddModule(L"a.dll", GetClassObjectA);
+	AddModule(L"noexport.dll", NULL);
+	Index index(ComClass(MakeClsid(1), "a.dll") + ComClass(MakeClsid(2), "noexport.dll"));
+	LPVOID pv = NULL;
+	CHECK_EQ(index.GetClassObject(MakeClsid(1), IID_IUnknown, &pv), HRESULT_FROM_WIN32(ERROR_MOD_NOT_FOUND));
+	CHECK_EQ(index.GetClassObject(MakeClsid(3), IID_IUnknown, &pv), CLASS_E_CLASSNOTAVAILABLE);
+	const HMODULE a = LoadLibraryW(L"a.dll");
+	CHECK(a != NULL);
+	CallsOfA = 0;
+	CHECK_EQ(index.GetClassObject(MakeClsid(1), IID_IUnknown, &pv), S_OK);
+	CHECK(pv != NULL && *static_cast<const char *>(pv) == 'A');
+	CHECK(index.Find(MakeClsid(1))->pfn == GetClassObjectA);
+	// The module stays loaded after whoever loaded it lets go of it
+	FreeLibrary(a);
+	CHECK_EQ(Shim::GetModuleLoadCount(L"a.dll"), 1);
+	CHECK_EQ(index.GetClassObject(MakeClsid(1), IID_IUnknown, &pv), S_OK);
+	CHECK_EQ(CallsOfA, 2);
+	LoadLibraryW(L"noexport.dll");
+	CHECK_EQ(index.GetClassObject(MakeClsid(2), IID_IUnknown, &pv), HRESULT_FROM_WIN32(ERROR_PROC_NOT_FOUND));
+}
+
+namespace
+{
+	struct Contention
+	{
+		const Index *index;
+		volatile LONG threads;
+		volatile LONG failures;
+	};
+
+	const UINT ContendedClasses = 256;
+	const UINT ContendedCalls = 20000;
+
+	DWORD WINAPI Contend(LPVOID param)
+	{
+		Contention &c = *static_cast<Contention *>(param);
+		const UINT first = InterlockedIncrement(&c.threads);
+		for (UINT i = 0; i < ContendedCalls; ++i)
+		{
+			const UINT k = (first * 31 + i) % ContendedClasses;
+			LPVOID pv = NULL;
+			if (c.index->GetClassObject(MakeClsid(k), IID_IUnknown, &pv) != S_OK ||
+				*static_cast<const char *>(pv) != (k % 2 ? 'A' : 'B'))
+			{
+				InterlockedIncrement(&c.failures);
+			}
+		}
+		return 0;
+	}
+}
+
+// [user-010] Threads which race to resolve the same entries all get through
+// to the right module
+TEST(ResolvesUnderContention)
+{
+	AddModule(L"a.dll", GetClassObjectA);
+	AddModule(L"b.dll", GetClassObjectB);
+	LoadLibraryW(L"a.dll");
+	LoadLibraryW(L"b.dll");
+	std::string manifest;
+	for (UINT i = 0; i < ContendedClasses; ++i)
+		manifest += ComClass(MakeClsid(i), i % 2 ? "a.dll" : "b.dll");
+	Index index(manifest);
+	Contention c = { &index, 0, 0 };
+	CallsOfA = CallsOfB = 0;
+	HANDLE threads[8];
+	for (UINT i = 0; i < _countof(threads); ++i)
+		threads[i] = CreateThread(NULL, 0, Contend, &c, 0, NULL);
+	WaitForMultipleObjects(_countof(threads), threads, TRUE, INFINITE);
+	for (UINT i = 0; i < _countof(threads); ++i)
+		CloseHandle(threads[i]);
+	CHECK_EQ(c.failures, 0);
+	CHECK_EQ(CallsOfA + CallsOfB, static_cast<LONG>(_countof(threads) * ContendedCalls));
+	for (UINT i = 0; i < ContendedClasses; ++i)
+		CHECK(index.Find(MakeClsid(i))->pfn == (i % 2 ? GetClassObjectA : GetClassObjectB));
+}
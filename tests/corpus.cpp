@@ -0,0 +1,184 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "corpus.h"
+#include "pebuilder.h"
+#include "win32/shim.h"
+#include "../miscutil.h"
+#include "../guid.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+const WCHAR Corpus::Folder[] = L"C:\\app";
+const WCHAR Corpus::Target[] = L"C:\\app\\app.exe";
+
+namespace
+{
+	const char *const Models[] = { "Apartment", "Both", "Free", "Neutral" };
+
+	// SplitMix64, which turns consecutive inputs into well-mixed outputs
+	ULONGLONG Mix(ULONGLONG x)
+	{
+		x += 0x9E3779B97F4A7C15ULL;
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+		return x ^ (x >> 31);
+	}
+
+	ULONGLONG Key(const Corpus::Options &options, UINT component, UINT index, UINT salt)
+	{
+		return Mix(Mix(Mix(options.seed) ^ component) ^ index) ^ salt;
+	}
+
+	std::string Format(const GUID &guid)
+	{
+		char text[39];
+		FormatGuid(guid, text);
+		return text;
+	}
+
+	std::string Printf(const char *format, UINT a, UINT b = 0)
+	{
+		char text[64];
+		return std::string(text, snprintf(text, sizeof text, format, a, b));
+	}
+
+	// The type library of a component goes after its classes
+	GUID MakeLibId(const Corpus::Options &options, UINT component)
+	{
+		return Corpus::MakeGuid(options, component, options.classes);
+	}
+
+	const char *GetModel(const Corpus::Options &options, UINT component, UINT index)
+	{
+		return Models[Key(options, component, index, 1) % _countof(Models)];
+	}
+
+	void AppendClass(std::string &text, const Corpus::Options &options, UINT owner, UINT component, UINT index)
+	{
+		const std::string clsid = Format(Corpus::MakeGuid(options, owner, index));
+		const std::string progid = Printf("Comp%u.Class%u", owner, index);
+		const std::string key = "[HKEY_CLASSES_ROOT\\CLSID\\" + clsid;
+		text += key + "]\r\n@=\"" + progid + "\"\r\n";
+		for (UINT i = 0; i < options.values; ++i)
+		{
+			text += Printf("\"Data%u\"=hex:", i);
+			for (UINT j = 0; j < 32; ++j)
+				text += Printf(j ? ",%02x" : "%02x", static_cast<UINT>(Key(options, owner, index, 2 + i * 32 + j) & 0xFF));
+			text += "\r\n";
+		}
+		text += "\r\n" + key + "\\InprocServer32]\r\n";
+		text += Printf("@=\"C:\\\\app\\\\comp%u.dll\"\r\n", component);
+		text += std::string("\"ThreadingModel\"=\"") + GetModel(options, owner, index) + "\"\r\n\r\n";
+		text += key + "\\ProgID]\r\n@=\"" + progid + ".1\"\r\n\r\n";
+		text += key + "\\VersionIndependentProgID]\r\n@=\"" + progid + "\"\r\n\r\n";
+		text += key + "\\TypeLib]\r\n@=\"" + Format(MakeLibId(options, owner)) + "\"\r\n\r\n";
+		text += "[HKEY_CLASSES_ROOT\\" + progid + "]\r\n@=\"" + progid + "\"\r\n\r\n";
+		text += "[HKEY_CLASSES_ROOT\\" + progid + "\\CLSID]\r\n@=\"" + clsid + "\"\r\n\r\n";
+	}
+
+	void WriteFile(LPCWSTR path, const std::string &data)
+	{
+		const HANDLE file = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		DWORD cb = 0;
+		if (file == INVALID_HANDLE_VALUE || !::WriteFile(file, data.data(), static_cast<DWORD>(data.size()), &cb, NULL) || cb != data.size())
+		{
+			fprintf(stderr, "Cannot write %s\n", Shim::ToLocalPath(path).c_str());
+			abort();
+		}
+		CloseHandle(file);
+	}
+}
+
+GUID Corpus::MakeGuid(const Options &options, UINT component, UINT index)
+{
+	GUID guid;
+	const ULONGLONG lo = Key(options, component, index, 0);
+	const ULONGLONG hi = Mix(lo);
+	memcpy(&guid, &lo, sizeof lo);
+	memcpy(reinterpret_cast<BYTE *>(&guid) + sizeof lo, &hi, sizeof hi);
+	return guid;
+}
+
+std::string Corpus::MakeRegFile(const Options &options, UINT component)
+{
+	std::string text = "REGEDIT4\r\n\r\n";
+	for (UINT i = 0; i < options.classes; ++i)
+		AppendClass(text, options, component, component, i);
+	// Classes which belong to the next component show up here too
+	if (options.components > 1)
+	{
+		const UINT next = (component + 1) % options.components;
+		for (UINT i = 0; i < options.shared && i < options.classes; ++i)
+			AppendClass(text, options, next, component, i);
+	}
+	const std::string key = "[HKEY_CLASSES_ROOT\\TypeLib\\" + Format(MakeLibId(options, component)) + "\\1.0";
+	text += key + "]\r\n" + Printf("@=\"Comp%u Library\"\r\n\r\n", component);
+	text += key + "\\0\\win32]\r\n" + Printf("@=\"C:\\\\app\\\\comp%u.dll\"\r\n\r\n", component);
+	text += key + "\\FLAGS]\r\n@=\"0\"\r\n\r\n";
+	return text;
+}
+
+// The <file> elements are those of an earlier run, which had each class
+// registered as apartment threaded
+std::string Corpus::MakeManifest(const Options &options)
+{
+	std::string text =
+		"<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\r\n"
+		"<assembly xmlns=\"urn:schemas-microsoft-com:asm.v1\" manifestVersion=\"1.0\">\r\n"
+		"\t<assemblyIdentity type=\"win32\" name=\"app\" version=\"1.0.0.0\" />\r\n";
+	for (UINT c = 0; c < options.components; ++c)
+	{
+		text += Printf("\t<file name=\"comp%u.reg\">\r\n", c);
+		for (UINT i = 0; i < options.classes; ++i)
+		{
+			text += "\t\t<comClass clsid=\"" + Format(MakeGuid(options, c, i));
+			text += Printf("\" progid=\"Comp%u.Class%u\" threadingModel=\"Apartment\" />\r\n", c, i);
+		}
+		text += "\t\t<typelib tlbid=\"" + Format(MakeLibId(options, c)) + "\" version=\"1.0\" helpdir=\"\" />\r\n";
+		text += "\t</file>\r\n";
+	}
+	text += "</assembly>\r\n";
+	return text;
+}
+
+ULONGLONG Corpus::Write(const Options &options)
+{
+	CreateDirectoryW(Folder, NULL);
+	std::vector<PEBuilder::Resource> resources;
+	resources.push_back(PEBuilder::MakeResource(RT_MANIFEST, MAKEINTRESOURCEW(1), 1033, MakeManifest(options)));
+	WriteFile(Target, PEBuilder::Build(resources));
+	ULONGLONG cb = 0;
+	for (UINT c = 0; c < options.components; ++c)
+	{
+		WCHAR path[MAX_PATH];
+		wnsprintfW(path, _countof(path), L"%s\\comp%u.reg", Folder, c);
+		const std::string text = MakeRegFile(options, c);
+		WriteFile(path, text);
+		cb += text.size();
+	}
+	return cb;
+}
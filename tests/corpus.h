@@ -0,0 +1,61 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Puts together a synthetic application for the benchmarks to work on: a
+// target whose manifest holds the <file> elements of an earlier run, and a
+// .reg file per component, which registers its classes, their ProgIDs, and
+// a type library. Everything derives from the seed, so the same options
+// yield the same corpus on every run and every machine.
+
+#pragma once
+
+#include <shlwapi.h>
+#include <string>
+
+namespace Corpus
+{
+	struct Options
+	{
+		UINT seed;
+		UINT components;	// count of .reg files
+		UINT classes;		// count of classes per component, each with a ProgID
+		UINT values;		// count of binary values per class, to scale the .reg files
+		UINT shared;		// count of classes each component shares with the next
+		Options(): seed(1), components(50), classes(40), values(2), shared(1) { }
+	};
+
+	extern const WCHAR Folder[];
+	extern const WCHAR Target[];
+
+	// Counter based, so any GUID of the corpus can be had without generating
+	// all those before it
+	GUID MakeGuid(const Options &options, UINT component, UINT index);
+
+	std::string MakeRegFile(const Options &options, UINT component);
+	std::string MakeManifest(const Options &options);
+
+	// Writes the target and the .reg files to the folder, and returns the
+	// size of the .reg files taken together
+	ULONGLONG Write(const Options &options);
+}
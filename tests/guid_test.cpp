@@ -0,0 +1,180 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Tests for the GUID parsing and formatting of guid.h, which must come to the
+// same results with and without SSE2
+
+#include "test.h"
+#include "../miscutil.h"
+#include "../guid.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+	const GUID Sample = { 0x0123ABCD, 0x4567, 0x89EF, { 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10 } };
+	const char SampleText[] = "{0123ABCD-4567-89EF-FEDC-BA9876543210}";
+
+	std::vector<WCHAR> Widen(const char *s)
+	{
+		std::vector<WCHAR> w(s, s + strlen(s));
+		w.push_back(L'\0');
+		return w;
+	}
+
+	// Parses with and without SSE2, and checks that both agree
+	bool Parse(const std::vector<WCHAR> &text, GUID &guid)
+	{
+		GUID scalar;
+		memset(&guid, 0xCC, sizeof guid);
+		memset(&scalar, 0xCC, sizeof scalar);
+		Shim::EnableSse2(true);
+		const bool ok = ParseGuid(&text[0], guid);
+		Shim::EnableSse2(false);
+		const bool okScalar = ParseGuid(&text[0], scalar);
+		Shim::EnableSse2(true);
+		CHECK_EQ(ok, okScalar);
+		CHECK(!ok || guid == scalar);
+		return ok;
+	}
+
+	bool Parse(const char *text, GUID &guid)
+	{
+		return Parse(Widen(text), guid);
+	}
+
+	std::string Format(const GUID &guid)
+	{
+		char s[39];
+		FormatGuid(guid, s);
+		return std::string(s, s + strlen(s));
+	}
+
+	GUID RandomGuid()
+	{
+		GUID guid;
+		BYTE *const p = reinterpret_cast<BYTE *>(&guid);
+		for (size_t i = 0; i < sizeof guid; ++i)
+			p[i] = static_cast<BYTE>(rand());
+		return guid;
+	}
+}
+
+TEST(ParseReadsRegistryFormat)
+{
+	GUID guid;
+	CHECK(Parse(SampleText, guid));
+	CHECK(guid == Sample);
+	CHECK(Parse("{0123abcd-4567-89ef-fedc-ba9876543210}", guid));
+	CHECK(guid == Sample);
+}
+
+TEST(ParseRejectsBadFrames)
+{
+	GUID guid;
+	CHECK(!Parse("", guid));
+	CHECK(!Parse("0123ABCD-4567-89EF-FEDC-BA9876543210", guid));
+	CHECK(!Parse("{0123ABCD-4567-89EF-FEDC-BA9876543210", guid));
+	CHECK(!Parse("{0123ABCD-4567-89EF-FEDC-BA9876543210}}", guid));
+	CHECK(!Parse("{0123ABCD-4567-89EF-FEDC-BA987654321}", guid));
+	CHECK(!Parse("{0123ABCD45-67-89EF-FEDC-BA9876543210}", guid));
+	CHECK(!Parse("(0123ABCD-4567-89EF-FEDC-BA9876543210)", guid));
+}
+
+TEST(ParseRejectsBadDigitsAnywhere)
+{
+	// Characters next to the ranges of digits and letters, and wide ones
+	// which narrow to 0xFF or 0x00 under saturation
+	static const WCHAR bad[] = { L'/', L':', L'@', L'G', L'`', L'g', L'-', L' ', 0x0130, 0x0161, 0x8030, 0xFF10 };
+	const std::vector<WCHAR> text = Widen(SampleText);
+	for (int i = 1; i < 37; ++i)
+	{
+		if (i == 9 || i == 14 || i == 19 || i == 24)
+			continue;
+		for (size_t j = 0; j < _countof(bad); ++j)
+		{
+			std::vector<WCHAR> damaged = text;
+			damaged[i] = bad[j];
+			GUID guid;
+			CHECK(!Parse(damaged, guid));
+		}
+	}
+	// Dashes must be dashes
+	static const int dashes[] = { 9, 14, 19, 24 };
+	for (int i = 0; i < 4; ++i)
+	{
+		std::vector<WCHAR> damaged = text;
+		damaged[dashes[i]] = L'0';
+		GUID guid;
+		CHECK(!Parse(damaged, guid));
+	}
+}
+
+TEST(FormatWritesUppercase)
+{
+	CHECK_EQ(Format(Sample), SampleText);
+	WCHAR wide[39];
+	FormatGuid(Sample, wide);
+	CHECK(wide[38] == L'\0');
+	CHECK_STR(wide, &Widen(SampleText)[0]);
+}
+
+TEST(FormatMatchesScalar)
+{
+	srand(6);
+	for (int i = 0; i < 1000; ++i)
+	{
+		const GUID guid = RandomGuid();
+		char expected[39];
+		snprintf(expected, sizeof expected, "{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}",
+			static_cast<unsigned>(guid.Data1), guid.Data2, guid.Data3,
+			guid.Data4[0], guid.Data4[1], guid.Data4[2], guid.Data4[3],
+			guid.Data4[4], guid.Data4[5], guid.Data4[6], guid.Data4[7]);
+		Shim::EnableSse2(true);
+		CHECK_EQ(Format(guid), expected);
+		WCHAR wide[39];
+		FormatGuid(guid, wide);
+		CHECK_STR(wide, &Widen(expected)[0]);
+		Shim::EnableSse2(false);
+		CHECK_EQ(Format(guid), expected);
+		FormatGuid(guid, wide);
+		CHECK_STR(wide, &Widen(expected)[0]);
+	}
+}
+
+TEST(ParseReadsWhatFormatWrites)
+{
+	srand(7);
+	for (int i = 0; i < 1000; ++i)
+	{
+		const GUID guid = RandomGuid();
+		WCHAR text[39];
+		FormatGuid(guid, text);
+		GUID parsed;
+		CHECK(Parse(std::vector<WCHAR>(text, text + 39), parsed));
+		CHECK(parsed == guid);
+	}
+}
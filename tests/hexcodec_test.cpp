@@ -0,0 +1,236 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Tests for the hex codec of hexcodec.h, which must come to the same results
+// with and without SSE2
+
+#include "test.h"
+#include "../miscutil.h"
+#include "../hexcodec.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+	std::vector<WCHAR> Widen(const std::string &s)
+	{
+		std::vector<WCHAR> w(s.begin(), s.end());
+		w.push_back(L'\0');
+		return w;
+	}
+
+	std::string Encode(const BYTE *p, DWORD cb)
+	{
+		std::string s(2 * cb, '?');
+		HexEncode(p, cb, cb ? &s[0] : NULL);
+		return s;
+	}
+
+	// Formats bytes as a .reg file does, with lowercase digits
+	std::string RegFormat(const BYTE *p, DWORD cb)
+	{
+		std::string s;
+		for (DWORD i = 0; i < cb; ++i)
+		{
+			char text[4];
+			snprintf(text, sizeof text, i + 1 < cb ? "%02x," : "%02x", p[i]);
+			s += text;
+		}
+		return s;
+	}
+
+	int Decode(const std::string &s, std::vector<BYTE> &bytes)
+	{
+		std::vector<WCHAR> w = Widen(s);
+		bytes.assign(w.size(), 0);
+		const int cb = HexDecode(&w[0], &bytes[0]);
+		bytes.resize(cb > 0 ? cb : 0);
+		return cb;
+	}
+
+	int DecodeRun(const std::string &s, std::vector<BYTE> &bytes)
+	{
+		std::vector<WCHAR> w = Widen(s);
+		bytes.assign(w.size(), 0);
+		const int cb = HexDecodeRun(&w[0], &bytes[0]);
+		bytes.resize(cb > 0 ? cb : 0);
+		return cb;
+	}
+
+	std::vector<BYTE> RandomBytes(size_t cb)
+	{
+		std::vector<BYTE> bytes(cb);
+		for (size_t i = 0; i < cb; ++i)
+			bytes[i] = static_cast<BYTE>(rand());
+		return bytes;
+	}
+}
+
+TEST(EncodeWritesUppercaseDigits)
+{
+	static const BYTE bytes[] = { 0x00, 0x01, 0x7F, 0x80, 0xAB, 0xFF };
+	CHECK_EQ(Encode(bytes, sizeof bytes), "00017F80ABFF");
+	CHECK_EQ(Encode(bytes, 0), "");
+}
+
+TEST(EncodeMatchesScalarForAllLengths)
+{
+	srand(1);
+	for (DWORD cb = 0; cb <= 70; ++cb)
+	{
+		const std::vector<BYTE> bytes = RandomBytes(cb);
+		Shim::EnableSse2(true);
+		const std::string sse2 = Encode(cb ? &bytes[0] : NULL, cb);
+		Shim::EnableSse2(false);
+		const std::string scalar = Encode(cb ? &bytes[0] : NULL, cb);
+		CHECK_EQ(sse2, scalar);
+		std::string expected;
+		for (DWORD i = 0; i < cb; ++i)
+		{
+			char text[4];
+			snprintf(text, sizeof text, "%02X", bytes[i]);
+			expected += text;
+		}
+		CHECK_EQ(sse2, expected);
+	}
+}
+
+TEST(DecodeReadsRegFileBytes)
+{
+	std::vector<BYTE> bytes;
+	CHECK_EQ(Decode("01,ab,FF", bytes), 3);
+	CHECK(bytes.size() == 3 && bytes[0] == 0x01 && bytes[1] == 0xAB && bytes[2] == 0xFF);
+	CHECK_EQ(Decode("", bytes), 0);
+	// Blanks, as left over from continuation lines, and single digits
+	CHECK_EQ(Decode("  1, a ,\r\n  0b,", bytes), 3);
+	CHECK(bytes.size() == 3 && bytes[0] == 0x01 && bytes[1] == 0x0A && bytes[2] == 0x0B);
+}
+
+TEST(DecodeRejectsMalformedText)
+{
+	std::vector<BYTE> bytes;
+	CHECK_EQ(Decode("01,xy", bytes), -1);
+	CHECK_EQ(Decode("012", bytes), -1);
+	CHECK_EQ(Decode("01;02", bytes), -1);
+	CHECK_EQ(Decode(",01", bytes), -1);
+	CHECK_EQ(Decode("01,,02", bytes), -1);
+}
+
+TEST(DecodeMatchesScalarForAllLengths)
+{
+	srand(2);
+	for (DWORD cb = 0; cb <= 70; ++cb)
+	{
+		const std::vector<BYTE> bytes = RandomBytes(cb);
+		std::string text = RegFormat(cb ? &bytes[0] : NULL, cb);
+		// Mix the case of the letters
+		for (size_t i = 0; i < text.size(); ++i)
+			if (text[i] >= 'a' && text[i] <= 'f' && rand() % 2)
+				text[i] -= 0x20;
+		std::vector<BYTE> sse2, scalar;
+		Shim::EnableSse2(true);
+		CHECK_EQ(Decode(text, sse2), static_cast<int>(cb));
+		Shim::EnableSse2(false);
+		CHECK_EQ(Decode(text, scalar), static_cast<int>(cb));
+		CHECK(sse2 == bytes);
+		CHECK(scalar == bytes);
+	}
+}
+
+TEST(DecodeMatchesScalarOnDamagedText)
+{
+	// Break the 48 character blocks in every position, with characters which
+	// sit just outside the ranges the SSE2 code tests for
+	static const char damage[] = { '/', ':', '@', 'G', '`', 'g', ' ', ',', '\x7F' };
+	srand(3);
+	const std::vector<BYTE> bytes = RandomBytes(40);
+	const std::string text = RegFormat(&bytes[0], 40);
+	for (size_t i = 0; i < 100; ++i)
+	{
+		for (size_t j = 0; j < sizeof damage; ++j)
+		{
+			std::string damaged = text;
+			damaged[i] = damage[j];
+			std::vector<BYTE> sse2, scalar;
+			Shim::EnableSse2(true);
+			const int cbSse2 = Decode(damaged, sse2);
+			Shim::EnableSse2(false);
+			const int cbScalar = Decode(damaged, scalar);
+			CHECK_EQ(cbSse2, cbScalar);
+			CHECK(sse2 == scalar);
+		}
+	}
+}
+
+TEST(DecodeWorksInPlace)
+{
+	srand(4);
+	const std::vector<BYTE> bytes = RandomBytes(50);
+	std::vector<WCHAR> text = Widen(RegFormat(&bytes[0], 50));
+	BYTE *const q = reinterpret_cast<BYTE *>(&text[0]);
+	CHECK_EQ(HexDecode(&text[0], q), 50);
+	CHECK(memcmp(q, &bytes[0], 50) == 0);
+}
+
+TEST(DecodeRunReadsWhatEncodeWrites)
+{
+	srand(5);
+	for (DWORD cb = 0; cb <= 70; ++cb)
+	{
+		const std::vector<BYTE> bytes = RandomBytes(cb);
+		std::string text = Encode(cb ? &bytes[0] : NULL, cb);
+		if (cb % 3 == 0)
+			for (size_t i = 0; i < text.size(); ++i)
+				text[i] = static_cast<char>(tolower(text[i]));
+		std::vector<BYTE> sse2, scalar;
+		Shim::EnableSse2(true);
+		CHECK_EQ(DecodeRun(text, sse2), static_cast<int>(cb));
+		Shim::EnableSse2(false);
+		CHECK_EQ(DecodeRun(text, scalar), static_cast<int>(cb));
+		CHECK(sse2 == bytes);
+		CHECK(scalar == bytes);
+	}
+}
+
+TEST(DecodeRunRejectsMalformedText)
+{
+	std::vector<BYTE> bytes;
+	CHECK_EQ(DecodeRun("ABC", bytes), -1);
+	CHECK_EQ(DecodeRun("0G", bytes), -1);
+	CHECK_EQ(DecodeRun("01,02", bytes), -1);
+	// Damage within and after the first block of 32 digits
+	const std::string text(40, 'A');
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		std::string damaged = text;
+		damaged[i] = 'g';
+		Shim::EnableSse2(true);
+		CHECK_EQ(DecodeRun(damaged, bytes), -1);
+		Shim::EnableSse2(false);
+		CHECK_EQ(DecodeRun(damaged, bytes), -1);
+	}
+}
@@ -0,0 +1,192 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Tests for the Hive of hive.cpp, and how it captures what has been written
+// to the registry of the shim
+
+#include "test.h"
+#include "../hive.h"
+
+namespace
+{
+	LPCWSTR const Sandbox = L"Sandbox";
+
+	const UINT ClassCount = 200;
+
+	void SetString(HKEY key, LPCWSTR name, LPCWSTR data)
+	{
+		CHECK_EQ(RegSetValueExW(key, name, 0, REG_SZ, reinterpret_cast<const BYTE *>(data), (lstrlenW(data) + 1) * sizeof(WCHAR)), 0);
+	}
+
+	// Writes a class below Software\Classes\CLSID of the sandbox
+	void WriteClass(HKEY sandbox, UINT i, LPCWSTR model)
+	{
+		WCHAR path[MAX_PATH];
+		wnsprintfW(path, _countof(path), L"Software\\Classes\\CLSID\\{%08X-0000-0000-0000-000000000000}\\InprocServer32", i);
+		HKEY key;
+		CHECK_EQ(RegCreateKeyW(sandbox, path, &key), 0);
+		SetString(key, NULL, L"C:\\app\\x.dll");
+		SetString(key, L"ThreadingModel", model);
+		RegCloseKey(key);
+	}
+
+	LPCWSTR GetModel(Hive &hive, UINT i)
+	{
+		WCHAR path[MAX_PATH];
+		wnsprintfW(path, _countof(path), L"CLSID\\{%08X-0000-0000-0000-000000000000}", i);
+		Hive::Key *const key = hive.OpenKey(hive.GetClassesRoot(), path);
+		return key ? hive.GetString(key, L"InprocServer32", L"ThreadingModel") : NULL;
+	}
+
+	// A sandbox with a lot of classes in it, which the hive has captured
+	struct Fixture
+	{
+		HKEY sandbox;
+		Hive hive;
+		Fixture()
+		{
+			RegCreateKeyW(HKEY_CURRENT_USER, Sandbox, &sandbox);
+			for (UINT i = 0; i < ClassCount; ++i)
+				WriteClass(sandbox, i, L"Apartment");
+			CHECK_EQ(hive.Capture(sandbox), S_OK);
+			hive.Checkpoint();
+		}
+		~Fixture()
+		{
+			RegCloseKey(sandbox);
+		}
+	};
+}
+
+// [user-001] A full capture brings in every key and value
+TEST(CaptureReadsEverything)
+{
+	Fixture f;
+	CHECK_STR(GetModel(f.hive, 0), L"Apartment");
+	CHECK_STR(GetModel(f.hive, ClassCount - 1), L"Apartment");
+	Hive::Key *const clsid = f.hive.OpenKey(f.hive.GetClassesRoot(), L"CLSID");
+	CHECK(clsid != NULL && clsid->nKeys == ClassCount);
+}
+
+// [user-001] Given a point in time, a capture descends only into the keys
+// whose watch has seen a change, so it costs a few calls per changed key
+// rather than a few per key in the registry
+TEST(CaptureDescendsOnlyIntoChangedKeys)
+{
+	Fixture f;
+	FILETIME since;
+	GetSystemTimeAsFileTime(&since);
+	WriteClass(f.sandbox, 7, L"Both");
+	const LONG before = Shim::GetRegistryCallCount();
+	CHECK_EQ(f.hive.Capture(f.sandbox, &since), S_OK);
+	const LONG calls = Shim::GetRegistryCallCount() - before;
+	CHECK(calls < 40);
+	CHECK_STR(GetModel(f.hive, 7), L"Both");
+	CHECK_STR(GetModel(f.hive, 8), L"Apartment");
+	// Just the key whose values have been written goes into the journal
+	UINT n = 0;
+	Hive::Key *const *const changed = f.hive.GetChangedKeys(&n);
+	CHECK_EQ(n, 1u);
+	if (n == 1)
+		CHECK_STR(changed[0]->parent->name, L"{00000007-0000-0000-0000-000000000000}");
+	// With nothing changed since, the capture stops at the root
+	f.hive.Checkpoint();
+	const LONG again = Shim::GetRegistryCallCount();
+	CHECK_EQ(f.hive.Capture(f.sandbox, &since), S_OK);
+	CHECK(Shim::GetRegistryCallCount() - again < 5);
+	f.hive.GetChangedKeys(&n);
+	CHECK_EQ(n, 0u);
+}
+
+// [user-001] New keys and removed ones are picked up alongside changed ones
+TEST(CaptureAddsAndDropsKeys)
+{
+	Fixture f;
+	FILETIME since;
+	GetSystemTimeAsFileTime(&since);
+	WriteClass(f.sandbox, ClassCount, L"Free");
+	CHECK_EQ(RegDeleteTreeW(f.sandbox, L"Software\\Classes\\CLSID\\{00000003-0000-0000-0000-000000000000}"), 0);
+	CHECK_EQ(f.hive.Capture(f.sandbox, &since), S_OK);
+	CHECK_STR(GetModel(f.hive, ClassCount), L"Free");
+	CHECK(GetModel(f.hive, 3) == NULL);
+	CHECK_STR(GetModel(f.hive, 4), L"Apartment");
+	// A value written below a key which has just been captured shows too
+	FILETIME later;
+	GetSystemTimeAsFileTime(&later);
+	WriteClass(f.sandbox, ClassCount, L"Neutral");
+	CHECK_EQ(f.hive.Capture(f.sandbox, &later), S_OK);
+	CHECK_STR(GetModel(f.hive, ClassCount), L"Neutral");
+}
+
+// [user-001] The keys which the hive holds open to watch go away with it, or
+// with the keys removed from it
+TEST(CaptureReleasesWatches)
+{
+	const LONG before = Shim::GetOpenKeyCount();
+	{
+		Fixture f;
+		CHECK(Shim::GetOpenKeyCount() > before + static_cast<LONG>(ClassCount));
+		CHECK_EQ(RegDeleteTreeW(f.sandbox, L"Software\\Classes\\CLSID"), 0);
+		CHECK_EQ(f.hive.Capture(f.sandbox), S_OK);
+		CHECK(Shim::GetOpenKeyCount() < before + 10);
+	}
+	CHECK_EQ(Shim::GetOpenKeyCount(), before);
+}
+
+// [user-001] Keys which have gone into the hive other than by a capture make
+// it into the registry, and so does their removal
+TEST(StoreWritesJournaledKeys)
+{
+	Fixture f;
+	Hive::Key *const clsid = f.hive.OpenKey(f.hive.GetClassesRoot(), L"CLSID");
+	// A new key, a key removed, and a key replaced by one without a subkey
+	Hive::Key *const added = f.hive.CreateKey(clsid, L"{00001000-0000-0000-0000-000000000000}\\InprocServer32");
+	static const WCHAR model[] = L"Free";
+	f.hive.SetValue(added, L"ThreadingModel", REG_SZ, model, sizeof model);
+	f.hive.DeleteSubKey(clsid, L"{00000005-0000-0000-0000-000000000000}");
+	f.hive.DeleteSubKey(clsid, L"{00000006-0000-0000-0000-000000000000}");
+	Hive::Key *const replaced = f.hive.CreateKey(clsid, L"{00000006-0000-0000-0000-000000000000}");
+	f.hive.SetValue(replaced, NULL, REG_SZ, model, sizeof model);
+	CHECK_EQ(f.hive.Store(f.sandbox), S_OK);
+	HKEY key;
+	CHECK_EQ(RegOpenKeyExW(f.sandbox, L"Software\\Classes\\CLSID\\{00001000-0000-0000-0000-000000000000}\\InprocServer32", 0, KEY_READ, &key), 0);
+	WCHAR data[16];
+	DWORD cb = sizeof data;
+	CHECK_EQ(RegQueryValueExW(key, L"ThreadingModel", NULL, NULL, reinterpret_cast<BYTE *>(data), &cb), 0);
+	CHECK_STR(data, L"Free");
+	RegCloseKey(key);
+	CHECK_EQ(RegOpenKeyExW(f.sandbox, L"Software\\Classes\\CLSID\\{00000005-0000-0000-0000-000000000000}", 0, KEY_READ, &key), ERROR_FILE_NOT_FOUND);
+	CHECK_EQ(RegOpenKeyExW(f.sandbox, L"Software\\Classes\\CLSID\\{00000006-0000-0000-0000-000000000000}\\InprocServer32", 0, KEY_READ, &key), ERROR_FILE_NOT_FOUND);
+	CHECK_EQ(RegOpenKeyExW(f.sandbox, L"Software\\Classes\\CLSID\\{00000007-0000-0000-0000-000000000000}\\InprocServer32", 0, KEY_READ, &key), 0);
+	RegCloseKey(key);
+	// Capturing what has been stored changes nothing
+	FILETIME since;
+	GetSystemTimeAsFileTime(&since);
+	f.hive.Checkpoint();
+	CHECK_EQ(f.hive.Capture(f.sandbox, &since), S_OK);
+	CHECK_STR(GetModel(f.hive, 0x1000), L"Free");
+	CHECK(GetModel(f.hive, 5) == NULL);
+	CHECK(GetModel(f.hive, 6) == NULL);
+	CHECK_STR(GetModel(f.hive, 7), L"Apartment");
+}
@@ -0,0 +1,219 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Benchmarks for the hot paths of manfred, on the synthetic corpus of
+// corpus.h: the portable parts one at a time, and whole runs of the
+// application which import the .reg files of the corpus and write the
+// manifest or an RGS file
+
+#include "bench.h"
+#include "../manfred.cpp"
+#include <vector>
+
+namespace
+{
+	// Runs the application on a copy of the command line, as Run() splits it
+	// up in place
+	HRESULT RunApp(LPCWSTR cmdline)
+	{
+		std::vector<WCHAR> buffer(cmdline, cmdline + lstrlenW(cmdline) + 1);
+		return Application().Run(&buffer[0]);
+	}
+
+	void GetRegFile(UINT component, WCHAR path[MAX_PATH])
+	{
+		wnsprintfW(path, MAX_PATH, L"%s\\comp%u.reg", Corpus::Folder, component);
+	}
+
+	void RunBench(Bench::State &state, LPCWSTR cmdline)
+	{
+		// The first run brings the manifest up to date, and the ones which
+		// follow find it that way, as they would on repeated builds
+		HRESULT hr = RunApp(cmdline);
+		if (Shim::TakeOutput().find("[00000000] comp0.reg") == std::string::npos)
+			state.Fail("comp0.reg did not import");
+		while (SUCCEEDED(hr) && state.Next())
+			hr = RunApp(cmdline);
+		if (FAILED(hr))
+			state.Fail("Run() failed");
+		state.SetItems(state.corpus.components);
+	}
+}
+
+// Finds the <file> elements of the manifest as ManifestMerge does
+BENCH(MemSearch)
+{
+	static const char tag[] = "<file ";
+	const std::string text = Corpus::MakeManifest(state.corpus);
+	const char *const end = text.data() + text.size();
+	UINT n = 0;
+	while (state.Next())
+	{
+		n = 0;
+		for (const char *q = text.data(); (q = MemSearch(q, end - q, tag, sizeof tag - 1)) != NULL; q += sizeof tag - 1)
+			++n;
+	}
+	if (n != state.corpus.components)
+		state.Fail("MemSearch() missed some elements");
+	state.SetBytes(text.size());
+}
+
+// Splits the .reg files into lines the way ImportRegFile() does, without
+// going on to parse them
+BENCH(ReaderLines)
+{
+	ULONGLONG cb = 0;
+	while (state.Next())
+	{
+		cb = 0;
+		for (UINT c = 0; c < state.corpus.components; ++c)
+		{
+			WCHAR path[MAX_PATH];
+			GetRegFile(c, path);
+			Reader reader;
+			if (FAILED(reader.map(path)))
+			{
+				state.Fail("Reader::map() failed");
+				break;
+			}
+			reader.readBom();
+			const BYTE eol = reader.allocCtype("\n");
+			const BYTE blank = reader.allocCtype(" \t\r\n");
+			ULONG len = 0;
+			LPSTR line = NULL;
+			while ((line = reader.viewLine(eol, &len, line)) != NULL)
+			{
+				cb += len;
+				len = reader.trim(line, len, blank);
+				len = 0;
+			}
+		}
+	}
+	state.SetBytes(cb);
+}
+
+BENCH(ImportRegFile)
+{
+	RegImportStats stats = { };
+	while (state.Next())
+	{
+		Hive hive;
+		for (UINT c = 0; c < state.corpus.components; ++c)
+		{
+			WCHAR path[MAX_PATH];
+			GetRegFile(c, path);
+			if (FAILED(ImportRegFile(hive, path, &stats)))
+			{
+				state.Fail("ImportRegFile() failed");
+				break;
+			}
+		}
+	}
+	ULONGLONG cb = 0;
+	for (UINT c = 0; c < state.corpus.components; ++c)
+		cb += Corpus::MakeRegFile(state.corpus, c).size();
+	state.SetBytes(cb);
+}
+
+// Writes <comClass> elements the way ExportCls() does
+BENCH(WriterComClass)
+{
+	const UINT n = state.corpus.components * state.corpus.classes;
+	std::vector<WCHAR> clsids(n * 39);
+	for (UINT i = 0; i < n; ++i)
+		FormatGuid(Corpus::MakeGuid(state.corpus, i / state.corpus.classes, i % state.corpus.classes), &clsids[i * 39]);
+	ULARGE_INTEGER size = { };
+	while (state.Next())
+	{
+		Writer writer;
+		if (FAILED(writer.open()))
+		{
+			state.Fail("Writer::open() failed");
+			break;
+		}
+		for (UINT i = 0; i < n; ++i)
+			writer.write("\t\t<comClass clsid=\"", &clsids[i * 39], "\" progid=\"Comp.Class\" threadingModel=\"", L"Apartment", "\" />\r\n");
+		writer.tell(&size);
+	}
+	state.SetBytes(size.QuadPart);
+	state.SetItems(n);
+}
+
+// Adds the CLSIDs of the corpus the way ExportCls() does, so each one which
+// components share comes out as a conflict
+BENCH(MultiMapAdd)
+{
+	const UINT n = state.corpus.components * state.corpus.classes;
+	std::vector<WCHAR> clsids(n * 39);
+	for (UINT i = 0; i < n; ++i)
+		FormatGuid(Corpus::MakeGuid(state.corpus, i / state.corpus.classes, i % state.corpus.classes), &clsids[i * 39]);
+	int count = 0;
+	while (state.Next())
+	{
+		MultiMap mm;
+		for (UINT i = 0; i < n; ++i)
+			mm.Add(&clsids[i * 39], L"comp.reg");
+		count = mm.GetItemCount();
+	}
+	if (count != static_cast<int>(n))
+		state.Fail("MultiMap lost some keys");
+	state.SetItems(n);
+}
+
+// Adds the same CLSIDs by value, as ExportCls() does, parsing included
+BENCH(MultiMapAddGuid)
+{
+	const UINT n = state.corpus.components * state.corpus.classes;
+	std::vector<WCHAR> clsids(n * 39);
+	for (UINT i = 0; i < n; ++i)
+		FormatGuid(Corpus::MakeGuid(state.corpus, i / state.corpus.classes, i % state.corpus.classes), &clsids[i * 39]);
+	int count = 0;
+	while (state.Next())
+	{
+		MultiMap mm;
+		for (UINT i = 0; i < n; ++i)
+		{
+			GUID guid;
+			if (ParseGuid(&clsids[i * 39], guid))
+				mm.Add(guid, L"comp.reg");
+		}
+		count = mm.GetItemCount();
+	}
+	if (count != static_cast<int>(n))
+		state.Fail("MultiMap lost some keys");
+	state.SetItems(n);
+}
+
+// Imports the .reg files, reports conflicts, and merges the <file> elements
+// into the manifest of the target
+BENCH(UpdateManifest)
+{
+	RunBench(state, L"manfred.exe C:\\app\\app.exe /files *.reg /merge");
+}
+
+// Imports the .reg files, reports conflicts, and writes an RGS file
+BENCH(WriteScript)
+{
+	RunBench(state, L"manfred.exe C:\\app\\app.exe /files *.reg /never /rgs C:\\out.rgs");
+}
@@ -0,0 +1,329 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// End-to-end tests which run the Application of manfred.cpp on targets put
+// together by PEBuilder, with modules whose DllRegisterServer() writes to
+// the registry of the shim
+
+#include "test.h"
+#include "pebuilder.h"
+#include "../manfred.cpp"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using PEBuilder::MakeResource;
+
+namespace
+{
+	const char Manifest[] =
+		"<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\r\n"
+		"<assembly xmlns=\"urn:schemas-microsoft-com:asm.v1\" manifestVersion=\"1.0\">\r\n"
+		"</assembly>\r\n";
+
+	const WCHAR ClsidA[] = L"{A0000000-0000-0000-0000-00000000000A}";
+	const WCHAR ClsidB[] = L"{B0000000-0000-0000-0000-00000000000B}";
+	const WCHAR ClsidC[] = L"{C0000000-0000-0000-0000-00000000000C}";
+
+	// Runs the application on a copy of the command line, as Run() splits it
+	// up in place
+	HRESULT RunApp(LPCWSTR cmdline)
+	{
+		std::vector<WCHAR> buffer(cmdline, cmdline + lstrlenW(cmdline) + 1);
+		return Application().Run(&buffer[0]);
+	}
+
+	void WriteTarget(LPCWSTR path)
+	{
+		std::vector<PEBuilder::Resource> resources;
+		resources.push_back(MakeResource(RT_MANIFEST, MAKEINTRESOURCEW(1), 1033, Manifest));
+		const std::string image = PEBuilder::Build(resources);
+		Test::WriteFile(path, image.data(), image.size());
+	}
+
+	std::string ReadManifest(LPCWSTR path)
+	{
+		PEImage image;
+		if (FAILED(image.open(path)))
+			return "(none)";
+		DWORD cb = 0;
+		const BYTE *const p = image.findResource(RT_MANIFEST, MAKEINTRESOURCEW(1), NULL, &cb);
+		return p ? std::string(reinterpret_cast<const char *>(p), cb) : "(none)";
+	}
+
+	bool Contains(const std::string &s, const char *what)
+	{
+		return s.find(what) != std::string::npos;
+	}
+
+	HRESULT RegisterClass(LPCWSTR clsid)
+	{
+		WCHAR path[MAX_PATH];
+		wnsprintfW(path, _countof(path), L"CLSID\\%s\\InprocServer32", clsid);
+		HKEY key;
+		if (LSTATUS r = RegCreateKeyW(HKEY_CLASSES_ROOT, path, &key))
+			return HRESULT_FROM_WIN32(r);
+		static const WCHAR model[] = L"Apartment";
+		const LSTATUS r = RegSetValueExW(key, L"ThreadingModel", 0, REG_SZ,
+			reinterpret_cast<const BYTE *>(model), sizeof model);
+		RegCloseKey(key);
+		return HRESULT_FROM_WIN32(r);
+	}
+
+	LONG RegistrationsOfA;
+
+	HRESULT STDAPICALLTYPE RegisterA() { ++RegistrationsOfA; return RegisterClass(ClsidA); }
+	HRESULT STDAPICALLTYPE RegisterB() { return RegisterClass(ClsidB); }
+	HRESULT STDAPICALLTYPE RegisterC() { return RegisterClass(ClsidC); }
+
+	// Registers class B as an emulation of class A, which has to be there
+	HRESULT STDAPICALLTYPE RegisterTreatAs()
+	{
+		WCHAR path[MAX_PATH];
+		wnsprintfW(path, _countof(path), L"CLSID\\%s", ClsidA);
+		HKEY key;
+		if (LSTATUS r = RegOpenKeyExW(HKEY_CLASSES_ROOT, path, 0, KEY_READ, &key))
+			return HRESULT_FROM_WIN32(r);
+		RegCloseKey(key);
+		return RegisterClass(ClsidB);
+	}
+
+	const UINT ManyClasses = 200;
+
+	// Registers enough classes for the script to be written in several slices,
+	// and a ProgID for one of them
+	HRESULT STDAPICALLTYPE RegisterMany()
+	{
+		for (UINT i = 0; i < ManyClasses; ++i)
+		{
+			WCHAR clsid[40];
+			wnsprintfW(clsid, _countof(clsid), L"{%08X-0000-0000-0000-000000000000}", i);
+			if (HRESULT hr = RegisterClass(clsid))
+				return hr;
+		}
+		HKEY key;
+		if (LSTATUS r = RegCreateKeyW(HKEY_CLASSES_ROOT, L"Many.Class\\CLSID", &key))
+			return HRESULT_FROM_WIN32(r);
+		static const WCHAR clsid[] = L"{00000000-0000-0000-0000-000000000000}";
+		const LSTATUS r = RegSetValueExW(key, NULL, 0, REG_SZ,
+			reinterpret_cast<const BYTE *>(clsid), sizeof clsid);
+		RegCloseKey(key);
+		return HRESULT_FROM_WIN32(r);
+	}
+
+	// Makes a file which LoadLibraryW() loads as a module with the given
+	// DllRegisterServer()
+	void WriteModule(LPCWSTR path, LPFNCANUNLOADNOW pfn)
+	{
+		const Shim::Export exports[] =
+		{
+			{ "DllRegisterServer", reinterpret_cast<FARPROC>(pfn) },
+		};
+		Shim::AddModule(PathFindFileNameW(path), exports, _countof(exports));
+		Test::WriteFile(path, "MZ");
+	}
+
+	// Two targets which share the bin folder, and one of which has a folder
+	// of its own
+	void WriteBatch()
+	{
+		WriteTarget(L"C:\\app\\one.exe");
+		WriteTarget(L"C:\\app\\two.exe");
+		WriteModule(L"C:\\app\\bin\\a.dll", RegisterA);
+		WriteModule(L"C:\\app\\bin\\b.dll", RegisterB);
+		WriteModule(L"C:\\app\\one\\c.dll", RegisterC);
+	}
+}
+
+// [user-022] Each target gets the files of its own folders, under names
+// relative to its own folder, and the shared folder is registered once
+// without the maps seeing conflicts
+TEST(BatchUpdatesEachTarget)
+{
+	WriteBatch();
+	CHECK_EQ(RunApp(L"manfred.exe /batch C:\\app\\one.exe;bin;one C:\\app\\two.exe;bin /files *.dll"), S_OK);
+	const std::string output = Shim::TakeOutput();
+	CHECK(Contains(output, "Issues: none"));
+	CHECK(!Contains(output, "conflicts"));
+	const std::string one = ReadManifest(L"C:\\app\\one.exe");
+	CHECK(Contains(one, "\t<file name=\"bin\\a.dll\">\r\n\t\t<comClass clsid=\"{A0000000-0000-0000-0000-00000000000A}\" threadingModel=\"Apartment\" />\r\n\t</file>\r\n"));
+	CHECK(Contains(one, "\t<file name=\"bin\\b.dll\">"));
+	CHECK(Contains(one, "\t<file name=\"one\\c.dll\">\r\n\t\t<comClass clsid=\"{C0000000-0000-0000-0000-00000000000C}\""));
+	CHECK(Contains(one, "</file>\r\n</assembly>\r\n"));
+	const std::string two = ReadManifest(L"C:\\app\\two.exe");
+	CHECK(Contains(two, "\t<file name=\"bin\\a.dll\">"));
+	CHECK(Contains(two, "\t<file name=\"bin\\b.dll\">\r\n\t\t<comClass clsid=\"{B0000000-0000-0000-0000-00000000000B}\""));
+	CHECK(!Contains(two, "c.dll"));
+	CHECK(!Contains(two, "C:"));
+	// Modules are let go of once registered, unless /keep says otherwise
+	CHECK_EQ(Shim::GetModuleLoadCount(L"a.dll"), 0);
+}
+
+// [user-022] A folder which the second target shares with the first does not
+// keep the RGS file from being written
+TEST(BatchWithSharedFolderWritesScript)
+{
+	WriteBatch();
+	CHECK_EQ(RunApp(L"manfred.exe /batch C:\\app\\one.exe;bin C:\\app\\two.exe;bin /files *.dll /never /rgs C:\\out.rgs"), S_OK);
+	CHECK(Contains(Shim::TakeOutput(), "Issues: none"));
+	const std::string script = Test::ReadFile(L"C:\\out.rgs");
+	CHECK(Contains(script, "ForceRemove '{A0000000-0000-0000-0000-00000000000A}'"));
+	CHECK(Contains(script, "ForceRemove '{B0000000-0000-0000-0000-00000000000B}'"));
+	CHECK(!Contains(script, "{C0000000"));
+	CHECK_EQ(ReadManifest(L"C:\\app\\one.exe"), Manifest);
+}
+
+// [user-001] What a .reg file imports goes into the sandbox, where the modules
+// registered after it find it
+TEST(RegImportPrecedesDependentRegistration)
+{
+	WriteTarget(L"C:\\app\\app.exe");
+	Test::WriteFile(L"C:\\app\\a.reg",
+		"REGEDIT4\r\n"
+		"\r\n"
+		"[HKEY_CLASSES_ROOT\\CLSID\\{A0000000-0000-0000-0000-00000000000A}\\InprocServer32]\r\n"
+		"\"ThreadingModel\"=\"Both\"\r\n");
+	WriteModule(L"C:\\app\\b.dll", RegisterTreatAs);
+	CHECK_EQ(RunApp(L"manfred.exe C:\\app\\app.exe /files *.reg:*.dll"), S_OK);
+	const std::string output = Shim::TakeOutput();
+	CHECK(Contains(output, "[00000000] a.reg"));
+	CHECK(Contains(output, "[00000000] b.dll"));
+	const std::string manifest = ReadManifest(L"C:\\app\\app.exe");
+	CHECK(Contains(manifest, "\t<file name=\"a.reg\">\r\n\t\t<comClass clsid=\"{A0000000-0000-0000-0000-00000000000A}\" threadingModel=\"Both\" />\r\n\t</file>\r\n"));
+	CHECK(Contains(manifest, "\t<file name=\"b.dll\">\r\n\t\t<comClass clsid=\"{B0000000-0000-0000-0000-00000000000B}\" threadingModel=\"Apartment\" />\r\n\t</file>\r\n"));
+}
+
+// [user-004] What a REGISTRY script has been evaluated into goes into the
+// sandbox, where the modules registered after it find it
+TEST(StaticScriptPrecedesDependentRegistration)
+{
+	WriteTarget(L"C:\\app\\app.exe");
+	std::vector<PEBuilder::Resource> resources;
+	resources.push_back(MakeResource(L"REGISTRY", MAKEINTRESOURCEW(101), 1033,
+		"HKCR\r\n"
+		"{\r\n"
+		"\tNoRemove CLSID\r\n"
+		"\t{\r\n"
+		"\t\tForceRemove {A0000000-0000-0000-0000-00000000000A} = s 'A'\r\n"
+		"\t\t{\r\n"
+		"\t\t\tInprocServer32 = s '%MODULE%'\r\n"
+		"\t\t\t{\r\n"
+		"\t\t\t\tval ThreadingModel = s 'Both'\r\n"
+		"\t\t\t}\r\n"
+		"\t\t}\r\n"
+		"\t}\r\n"
+		"}\r\n"));
+	const std::string image = PEBuilder::Build(resources);
+	Test::WriteFile(L"C:\\app\\a.dll", image.data(), image.size());
+	WriteModule(L"C:\\app\\b.dll", RegisterTreatAs);
+	CHECK_EQ(RunApp(L"manfred.exe C:\\app\\app.exe /files *.dll /static"), S_OK);
+	const std::string output = Shim::TakeOutput();
+	CHECK(Contains(output, "[00000000] a.dll"));
+	CHECK(Contains(output, "[00000000] b.dll"));
+	const std::string manifest = ReadManifest(L"C:\\app\\app.exe");
+	CHECK(Contains(manifest, "\t<file name=\"a.dll\">\r\n\t\t<comClass clsid=\"{A0000000-0000-0000-0000-00000000000A}\" threadingModel=\"Both\" />\r\n\t</file>\r\n"));
+	CHECK(Contains(manifest, "\t<file name=\"b.dll\">\r\n\t\t<comClass clsid=\"{B0000000-0000-0000-0000-00000000000B}\" threadingModel=\"Apartment\" />\r\n\t</file>\r\n"));
+}
+
+// [user-007] What is replayed from the cache goes into the sandbox, where the
+// modules registered after it find it
+TEST(ReplayPrecedesDependentRegistration)
+{
+	WriteTarget(L"C:\\app\\app.exe");
+	WriteModule(L"C:\\app\\a.dll", RegisterA);
+	WriteModule(L"C:\\app\\b.dll", RegisterTreatAs);
+	RegistrationsOfA = 0;
+	// The second run replays a.dll, while b.dll is kept out of the cache
+	for (int run = 0; run < 2; ++run)
+	{
+		CHECK_EQ(RunApp(L"manfred.exe C:\\app\\app.exe /files *.dll /keep b.dll /cache C:\\reg.cache /merge"), S_OK);
+		const std::string output = Shim::TakeOutput();
+		CHECK(Contains(output, "[00000000] a.dll"));
+		CHECK(Contains(output, "[00000000] b.dll"));
+	}
+	CHECK_EQ(RegistrationsOfA, 1);
+	const std::string manifest = ReadManifest(L"C:\\app\\app.exe");
+	CHECK(Contains(manifest, "\t<file name=\"a.dll\">\r\n\t\t<comClass clsid=\"{A0000000-0000-0000-0000-00000000000A}\" threadingModel=\"Apartment\" />\r\n\t</file>\r\n"));
+	CHECK(Contains(manifest, "\t<file name=\"b.dll\">\r\n\t\t<comClass clsid=\"{B0000000-0000-0000-0000-00000000000B}\" threadingModel=\"Apartment\" />\r\n\t</file>\r\n"));
+}
+
+// [user-007] A cache file which fails to open is reported, and the run goes
+// on without it rather than overwrite the file
+TEST(CacheFailingToOpenIsLeftAlone)
+{
+	static const char text[] = "Not a cache";
+	WriteTarget(L"C:\\app\\app.exe");
+	WriteModule(L"C:\\app\\a.dll", RegisterA);
+	Test::WriteFile(L"C:\\notes.txt", text);
+	CHECK_EQ(RunApp(L"manfred.exe C:\\app\\app.exe /files *.dll /cache C:\\notes.txt"), S_OK);
+	const std::string output = Shim::TakeOutput();
+	CHECK(Contains(output, "[8007000D] C:\\notes.txt"));
+	CHECK(Contains(output, "[00000000] a.dll"));
+	CHECK_EQ(Test::ReadFile(L"C:\\notes.txt"), text);
+}
+
+// [user-024] The slices which worker threads write come out in order, and the
+// top-level keys of HKCR which are ProgIDs are told apart from the others
+TEST(ScriptFromWorkerThreads)
+{
+	WriteTarget(L"C:\\app\\app.exe");
+	WriteModule(L"C:\\app\\many.dll", RegisterMany);
+	CHECK_EQ(RunApp(L"manfred.exe C:\\app\\app.exe /files *.dll /never /rgs C:\\out.rgs"), S_OK);
+	CHECK(Contains(Shim::TakeOutput(), "Issues: none"));
+	const std::string script = Test::ReadFile(L"C:\\out.rgs");
+	CHECK(Contains(script, "\tForceRemove 'Many.Class'\r\n"));
+	CHECK(Contains(script, "\tNoRemove 'CLSID'\r\n"));
+	std::string::size_type pos = 0;
+	for (UINT i = 0; i < ManyClasses && pos != std::string::npos; ++i)
+	{
+		char name[64];
+		snprintf(name, sizeof name, "\t\tForceRemove '{%08X-0000-0000-0000-000000000000}'", i);
+		pos = script.find(name, pos);
+	}
+	CHECK(pos != std::string::npos);
+}
+
+// [user-009] A CLSID which two files register is reported as a conflict,
+// however either of them spells it
+TEST(ConflictsCompareClsidsByValue)
+{
+	WriteTarget(L"C:\\app\\app.exe");
+	Test::WriteFile(L"C:\\app\\a.reg",
+		"REGEDIT4\r\n"
+		"\r\n"
+		"[HKEY_CLASSES_ROOT\\CLSID\\{a0000000-0000-0000-0000-00000000000a}]\r\n"
+		"@=\"A\"\r\n");
+	Test::WriteFile(L"C:\\app\\b.reg",
+		"REGEDIT4\r\n"
+		"\r\n"
+		"[HKEY_CLASSES_ROOT\\CLSID\\{A0000000-0000-0000-0000-00000000000A}]\r\n"
+		"@=\"B\"\r\n"
+		"\r\n"
+		"[HKEY_CLASSES_ROOT\\CLSID\\{B0000000-0000-0000-0000-00000000000B}]\r\n"
+		"@=\"B\"\r\n");
+	CHECK_EQ(RunApp(L"manfred.exe C:\\app\\app.exe /files *.reg"), S_OK);
+	const std::string output = Shim::TakeOutput();
+	CHECK(Contains(output, "clsid {A0000000-0000-0000-0000-00000000000A} conflicts between:\r\n<a.reg:b.reg>"));
+	CHECK(!Contains(output, "{B0000000"));
+}
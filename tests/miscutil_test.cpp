@@ -0,0 +1,162 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Tests for MemSearch and DivMod64 of miscutil.h
+
+#include "test.h"
+#include "../miscutil.h"
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+	template<typename T>
+	const T *NaiveSearch(const T *p, size_t pLen, const T *q, size_t qLen)
+	{
+		for (size_t i = 0; i + qLen <= pLen; ++i)
+			if (MemEqual(p + i, q, qLen))
+				return p + i;
+		return NULL;
+	}
+
+	std::string RandomText(size_t len, int alphabet)
+	{
+		std::string s(len, 'a');
+		for (size_t i = 0; i < len; ++i)
+			s[i] = static_cast<char>('a' + rand() % alphabet);
+		return s;
+	}
+
+	// Searches with and without SSE2, and checks both against the naive way
+	void CheckSearch(const std::string &p, const std::string &q)
+	{
+		const char *const expected = NaiveSearch(p.data(), p.size(), q.data(), q.size());
+		Shim::EnableSse2(true);
+		CHECK(MemSearch(p.data(), p.size(), q.data(), q.size()) == expected);
+		Shim::EnableSse2(false);
+		CHECK(MemSearch(p.data(), p.size(), q.data(), q.size()) == expected);
+		Shim::EnableSse2(true);
+		// The generic version goes the Two-Way for any element type
+		const std::vector<WCHAR> wp(p.begin(), p.end());
+		const std::vector<WCHAR> wq(q.begin(), q.end());
+		const WCHAR *const found = MemSearch(wp.data(), wp.size(), wq.data(), wq.size());
+		CHECK(expected ? found == wp.data() + (expected - p.data()) : found == NULL);
+	}
+}
+
+TEST(SearchFindsFirstOccurrence)
+{
+	CheckSearch("", "");
+	CheckSearch("abc", "");
+	CheckSearch("", "a");
+	CheckSearch("ab", "abc");
+	CheckSearch("abcabc", "cab");
+	CheckSearch("abcabc", "abc");
+	CheckSearch("abcabd", "abd");
+	CheckSearch("<assembly xmlns=\"urn:schemas-microsoft-com:asm.v1\">", "xmlns");
+	CheckSearch(std::string(100, 'a') + "b", std::string(40, 'a') + "b");
+	CheckSearch(std::string(100, 'a'), std::string(40, 'a') + "b");
+}
+
+TEST(SearchMatchesNaiveOnRandomText)
+{
+	// Small alphabets make for many partial matches, and periodic needles
+	srand(8);
+	for (int alphabet = 1; alphabet <= 4; ++alphabet)
+	{
+		for (int i = 0; i < 300; ++i)
+		{
+			const std::string p = RandomText(rand() % 120, alphabet);
+			std::string q;
+			if (i % 2 && !p.empty())
+			{
+				// Take the needle from the haystack, so there is a match
+				const size_t start = rand() % p.size();
+				q = p.substr(start, rand() % 40);
+			}
+			else
+			{
+				q = RandomText(rand() % 40, alphabet);
+			}
+			CheckSearch(p, q);
+		}
+	}
+}
+
+TEST(SearchMatchesNaiveAroundBlockBoundaries)
+{
+	// Put a single match at every position of a haystack which spans a few
+	// blocks of 16, for needles on both sides of the 32 character limit
+	static const size_t lengths[] = { 1, 2, 15, 16, 17, 31, 32, 33, 48 };
+	for (size_t k = 0; k < _countof(lengths); ++k)
+	{
+		const std::string q = std::string(lengths[k] - 1, 'x') + "y";
+		for (size_t pos = 0; pos + q.size() <= 80; ++pos)
+		{
+			std::string p(80, 'x');
+			p.replace(pos, q.size(), q);
+			CheckSearch(p, q);
+			CheckSearch(p.substr(0, pos + q.size()), q);
+			CheckSearch(p.substr(0, pos + q.size() - 1), q);
+		}
+	}
+}
+
+TEST(DivModMatchesNativeDivision)
+{
+	static const ULONGLONG numbers[] =
+	{
+		0, 1, 2, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF, 0x100000000ULL, 0x1FFFFFFFFULL,
+		0x7FFFFFFFFFFFFFFFULL, 0x8000000000000000ULL, 0xFFFFFFFF00000000ULL, 0xFFFFFFFFFFFFFFFFULL,
+		116444736000000000ULL, // the FILETIME of the Unix epoch
+	};
+	static const DWORD divisors[] =
+	{
+		1, 2, 3, 7, 10, 1000, 10000000, 0x7FFFFFFF, 0x80000000, 0x80000001, 0xFFFFFFFE, 0xFFFFFFFF,
+	};
+	for (size_t i = 0; i < _countof(numbers); ++i)
+	{
+		for (size_t j = 0; j < _countof(divisors); ++j)
+		{
+			DWORD r = 0xCCCCCCCC;
+			CHECK_EQ(DivMod64(numbers[i], divisors[j], &r), numbers[i] / divisors[j]);
+			CHECK_EQ(r, numbers[i] % divisors[j]);
+		}
+	}
+	srand(9);
+	for (int i = 0; i < 100000; ++i)
+	{
+		const ULONGLONG n = static_cast<ULONGLONG>(rand()) << 62 ^ static_cast<ULONGLONG>(rand()) << 31 ^ rand();
+		DWORD d = static_cast<DWORD>(rand()) << 1 ^ rand();
+		if (i % 2)
+			d >>= rand() % 32;
+		if (d == 0)
+			d = 1;
+		DWORD r;
+		CHECK_EQ(DivMod64(n, d, &r), n / d);
+		CHECK_EQ(r, n % d);
+	}
+}
@@ -0,0 +1,158 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Tests for the MultiMap of multimap.h
+
+#include "test.h"
+#include "../miscutil.h"
+#include "../guid.h"
+#include "../multimap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::vector<WCHAR> Widen(const std::string &s)
+	{
+		std::vector<WCHAR> w(s.begin(), s.end());
+		w.push_back(L'\0');
+		return w;
+	}
+
+	std::string Upper(LPCWSTR p)
+	{
+		std::string s;
+		for (; *p != L'\0'; ++p)
+			s += static_cast<char>(*p >= L'a' && *p <= L'z' ? *p - (L'a' - L'A') : *p);
+		return s;
+	}
+}
+
+TEST(ValuesComeJoinedInOrder)
+{
+	MultiMap map;
+	map.Add(L"a.dll", L"C:\\one\\a.dll");
+	map.Add(L"b.dll", L"C:\\one\\b.dll");
+	map.Add(L"a.dll", L"C:\\two\\a.dll");
+	map.Add(L"a.dll", L"");
+	CHECK_EQ(map.GetItemCount(), 2);
+	CHECK_STR(map.GetKey(0), L"a.dll");
+	CHECK_STR(map.GetItem(0), L"C:\\one\\a.dll:C:\\two\\a.dll:");
+	CHECK_STR(map.GetKey(1), L"b.dll");
+	CHECK_STR(map.GetItem(1), L"C:\\one\\b.dll");
+}
+
+TEST(KeysCompareCaseInsensitively)
+{
+	MultiMap map;
+	map.Add(L"Foo.Dll", L"1");
+	map.Add(L"FOO.DLL", L"2");
+	map.Add(L"foo.dll", L"3");
+	// Only ASCII letters fold
+	map.Add(L"\x00E9", L"4");
+	map.Add(L"\x00C9", L"5");
+	CHECK_EQ(map.GetItemCount(), 3);
+	CHECK_STR(map.GetKey(0), L"Foo.Dll");
+	CHECK_STR(map.GetItem(0), L"1:2:3");
+	CHECK_STR(map.GetItem(1), L"4");
+	CHECK_STR(map.GetItem(2), L"5");
+}
+
+TEST(ManyKeysMatchReference)
+{
+	// Enough keys and values for the table to rehash a few times, and for
+	// the value buffers to grow repeatedly
+	srand(10);
+	MultiMap map;
+	std::map<std::string, std::string> reference;
+	std::vector<std::string> order;
+	for (int i = 0; i < 20000; ++i)
+	{
+		char key[32], val[32];
+		snprintf(key, sizeof key, rand() % 2 ? "Key%d" : "KEY%d", rand() % 3000);
+		snprintf(val, sizeof val, "v%d", i);
+		map.Add(&Widen(key)[0], &Widen(val)[0]);
+		const std::string upper = Upper(&Widen(key)[0]);
+		std::string &joined = reference[upper];
+		if (joined.empty())
+			order.push_back(upper);
+		else
+			joined += ':';
+		joined += val;
+	}
+	CHECK_EQ(map.GetItemCount(), static_cast<int>(order.size()));
+	for (int i = 0; i < map.GetItemCount(); ++i)
+	{
+		CHECK_STR(&Widen(Upper(map.GetKey(i)))[0], &Widen(order[i])[0]);
+		CHECK_STR(map.GetItem(i), &Widen(reference[order[i]])[0]);
+	}
+}
+
+// [user-009] GUIDs are keys by value, and come back spelled out in upper case
+TEST(GuidKeysCompareByValue)
+{
+	MultiMap map;
+	const GUID a = { 0xA0000000, 0, 0, { 0, 0, 0, 0, 0, 0, 0, 0x0A } };
+	const GUID b = { 0xB0000000, 0, 0, { 0, 0, 0, 0, 0, 0, 0, 0x0B } };
+	map.Add(a, L"1");
+	map.Add(b, L"2");
+	map.Add(a, L"3");
+	// A string is a key of its own, even if it spells out a GUID
+	map.Add(L"{A0000000-0000-0000-0000-00000000000A}", L"4");
+	map.Add(L"{a0000000-0000-0000-0000-00000000000a}", L"5");
+	CHECK_EQ(map.GetItemCount(), 3);
+	CHECK_STR(map.GetKey(0), L"{A0000000-0000-0000-0000-00000000000A}");
+	CHECK_STR(map.GetItem(0), L"1:3");
+	CHECK_STR(map.GetKey(1), L"{B0000000-0000-0000-0000-00000000000B}");
+	CHECK_STR(map.GetItem(1), L"2");
+	CHECK_STR(map.GetItem(2), L"4:5");
+}
+
+// [user-009] GUIDs which differ in any one byte stay apart, through as many
+// rehashes as it takes
+TEST(ManyGuidKeys)
+{
+	MultiMap map;
+	for (int round = 0; round < 2; ++round)
+	{
+		for (UINT i = 0; i < 16 * 256; ++i)
+		{
+			GUID guid = { 0x12345678, 0x9ABC, 0xDEF0, { 1, 2, 3, 4, 5, 6, 7, 8 } };
+			reinterpret_cast<BYTE *>(&guid)[i / 256] = static_cast<BYTE>(i);
+			map.Add(guid, round ? L"b" : L"a");
+		}
+	}
+	// Each byte position brings 255 GUIDs of its own, and the one all share
+	CHECK_EQ(map.GetItemCount(), 16 * 255 + 1);
+	for (int i = 0; i < map.GetItemCount(); ++i)
+	{
+		if (lstrcmpW(map.GetKey(i), L"{12345678-9ABC-DEF0-0102-030405060708}") == 0)
+			CHECK_EQ(lstrlenW(map.GetItem(i)), 16 * 2 * 2 - 1);
+		else
+			CHECK_STR(map.GetItem(i), L"a:b");
+	}
+}
@@ -0,0 +1,371 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "pebuilder.h"
+#include <string.h>
+#include <algorithm>
+
+namespace
+{
+	DWORD AlignUp(DWORD n, DWORD alignment)
+	{
+		return (n + alignment - 1) & ~(alignment - 1);
+	}
+
+	template<class T>
+	void Put(std::string &image, DWORD offset, const T &value)
+	{
+		if (image.size() < offset + sizeof value)
+			image.resize(offset + sizeof value);
+		memcpy(&image[offset], &value, sizeof value);
+	}
+
+	WCHAR UpCase(WCHAR c)
+	{
+		return c >= L'a' && c <= L'z' ? c - (L'a' - L'A') : c;
+	}
+
+	// Named entries come first, ordered by their upper case spelling, and are
+	// followed by integer ids in ascending order
+	bool Less(LPCWSTR p, LPCWSTR q)
+	{
+		if (IS_INTRESOURCE(p) || IS_INTRESOURCE(q))
+		{
+			if (!IS_INTRESOURCE(p) || !IS_INTRESOURCE(q))
+				return !IS_INTRESOURCE(p);
+			return reinterpret_cast<ULONG_PTR>(p) < reinterpret_cast<ULONG_PTR>(q);
+		}
+		while (*p != L'\0' && UpCase(*p) == UpCase(*q))
+		{
+			++p;
+			++q;
+		}
+		return UpCase(*p) < UpCase(*q);
+	}
+
+	bool Same(LPCWSTR p, LPCWSTR q)
+	{
+		return !Less(p, q) && !Less(q, p);
+	}
+
+	struct Node
+	{
+		LPCWSTR id;
+		const PEBuilder::Resource *resource;
+		std::vector<Node> children;
+		DWORD offset; // of the directory, or of the data entry
+		DWORD nameOffset;
+	};
+
+	Node &Child(Node &parent, LPCWSTR id)
+	{
+		for (size_t i = 0; i < parent.children.size(); ++i)
+			if (Same(parent.children[i].id, id))
+				return parent.children[i];
+		const Node node = { id, NULL, std::vector<Node>(), 0, 0 };
+		parent.children.push_back(node);
+		return parent.children.back();
+	}
+
+	bool NodeLess(const Node &a, const Node &b)
+	{
+		return Less(a.id, b.id);
+	}
+
+	void Sort(Node &node)
+	{
+		std::sort(node.children.begin(), node.children.end(), NodeLess);
+		for (size_t i = 0; i < node.children.size(); ++i)
+			Sort(node.children[i]);
+	}
+
+	DWORD DirectorySize(const Node &node)
+	{
+		return static_cast<DWORD>(sizeof(IMAGE_RESOURCE_DIRECTORY) + node.children.size() * sizeof(IMAGE_RESOURCE_DIRECTORY_ENTRY));
+	}
+
+	// Lays out the resource section as linkers do: directories level by level,
+	// then the names, then the data entries, and then the data
+	std::string BuildResourceSection(const std::vector<PEBuilder::Resource> &resources, DWORD rva)
+	{
+		Node root = { NULL, NULL, std::vector<Node>(), 0, 0 };
+		for (size_t i = 0; i < resources.size(); ++i)
+		{
+			const PEBuilder::Resource &resource = resources[i];
+			Node &lang = Child(Child(Child(root, resource.type), resource.name), MAKEINTRESOURCEW(resource.lang));
+			lang.resource = &resource;
+		}
+		Sort(root);
+		std::vector<Node *> levels[3];
+		std::vector<Node *> leaves;
+		DWORD offset = DirectorySize(root);
+		for (size_t i = 0; i < root.children.size(); ++i)
+			levels[0].push_back(&root.children[i]);
+		for (int level = 0; level < 3; ++level)
+		{
+			for (size_t i = 0; i < levels[level].size(); ++i)
+			{
+				Node *const node = levels[level][i];
+				if (level == 2)
+				{
+					leaves.push_back(node);
+					continue;
+				}
+				node->offset = offset;
+				offset += DirectorySize(*node);
+				for (size_t j = 0; j < node->children.size(); ++j)
+					levels[level + 1].push_back(&node->children[j]);
+			}
+		}
+		for (int level = 0; level < 2; ++level)
+		{
+			for (size_t i = 0; i < levels[level].size(); ++i)
+			{
+				Node *const node = levels[level][i];
+				if (!IS_INTRESOURCE(node->id))
+				{
+					node->nameOffset = offset;
+					offset += static_cast<DWORD>(sizeof(WORD) + lstrlenW(node->id) * sizeof(WCHAR));
+				}
+			}
+		}
+		offset = AlignUp(offset, 4);
+		for (size_t i = 0; i < leaves.size(); ++i)
+		{
+			leaves[i]->offset = offset;
+			offset += sizeof(IMAGE_RESOURCE_DATA_ENTRY);
+		}
+		std::string section(offset, '\0');
+		// Directories
+		std::vector<Node *> dirs(1, &root);
+		dirs.insert(dirs.end(), levels[0].begin(), levels[0].end());
+		dirs.insert(dirs.end(), levels[1].begin(), levels[1].end());
+		for (size_t i = 0; i < dirs.size(); ++i)
+		{
+			const Node &node = *dirs[i];
+			IMAGE_RESOURCE_DIRECTORY dir;
+			memset(&dir, 0, sizeof dir);
+			for (size_t j = 0; j < node.children.size(); ++j)
+			{
+				const Node &child = node.children[j];
+				if (IS_INTRESOURCE(child.id))
+					++dir.NumberOfIdEntries;
+				else
+					++dir.NumberOfNamedEntries;
+				IMAGE_RESOURCE_DIRECTORY_ENTRY entry;
+				entry.Name = IS_INTRESOURCE(child.id) ? static_cast<DWORD>(reinterpret_cast<ULONG_PTR>(child.id)) : child.nameOffset | IMAGE_RESOURCE_NAME_IS_STRING;
+				entry.OffsetToData = child.resource ? child.offset : child.offset | IMAGE_RESOURCE_DATA_IS_DIRECTORY;
+				Put(section, static_cast<DWORD>(node.offset + sizeof dir + j * sizeof entry), entry);
+			}
+			Put(section, node.offset, dir);
+		}
+		// Names
+		for (int level = 0; level < 2; ++level)
+		{
+			for (size_t i = 0; i < levels[level].size(); ++i)
+			{
+				const Node &node = *levels[level][i];
+				if (!IS_INTRESOURCE(node.id))
+				{
+					const WORD len = static_cast<WORD>(lstrlenW(node.id));
+					Put(section, node.nameOffset, len);
+					memcpy(&section[node.nameOffset + sizeof len], node.id, len * sizeof(WCHAR));
+				}
+			}
+		}
+		// Data entries and data
+		for (size_t i = 0; i < leaves.size(); ++i)
+		{
+			const std::string &data = leaves[i]->resource->data;
+			section.resize(AlignUp(static_cast<DWORD>(section.size()), 8));
+			IMAGE_RESOURCE_DATA_ENTRY entry;
+			entry.OffsetToData = rva + static_cast<DWORD>(section.size());
+			entry.Size = static_cast<DWORD>(data.size());
+			entry.CodePage = 0;
+			entry.Reserved = 0;
+			Put(section, leaves[i]->offset, entry);
+			section += data;
+		}
+		return section;
+	}
+
+	struct Section
+	{
+		const char *name;
+		std::string data;
+		DWORD virtualSize;
+		DWORD rva;
+		DWORD offset;
+	};
+
+	template<class NT>
+	void PutHeaders(std::string &image, const PEBuilder::Options &options, WORD magic, WORD machine,
+		const std::vector<Section> &sections, DWORD cbHeaders, DWORD relocSize, DWORD security, DWORD securitySize)
+	{
+		NT nt;
+		memset(&nt, 0, sizeof nt);
+		nt.Signature = IMAGE_NT_SIGNATURE;
+		nt.FileHeader.Machine = machine;
+		nt.FileHeader.NumberOfSections = static_cast<WORD>(sections.size());
+		nt.FileHeader.SizeOfOptionalHeader = sizeof nt.OptionalHeader;
+		nt.FileHeader.Characteristics = IMAGE_FILE_EXECUTABLE_IMAGE | IMAGE_FILE_DLL;
+		nt.OptionalHeader.Magic = magic;
+		nt.OptionalHeader.SectionAlignment = options.sectionAlignment;
+		nt.OptionalHeader.FileAlignment = options.fileAlignment;
+		nt.OptionalHeader.MajorOperatingSystemVersion = 6;
+		nt.OptionalHeader.MajorSubsystemVersion = 6;
+		nt.OptionalHeader.Subsystem = 2;
+		nt.OptionalHeader.SizeOfHeaders = cbHeaders;
+		nt.OptionalHeader.NumberOfRvaAndSizes = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+		nt.OptionalHeader.BaseOfCode = sections[0].rva;
+		nt.OptionalHeader.SizeOfCode = static_cast<DWORD>(sections[0].data.size());
+		for (size_t i = 1; i < sections.size(); ++i)
+			nt.OptionalHeader.SizeOfInitializedData += static_cast<DWORD>(sections[i].data.size());
+		const Section &last = sections.back();
+		nt.OptionalHeader.SizeOfImage = last.rva + AlignUp(last.virtualSize, options.sectionAlignment);
+		nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_RESOURCE].VirtualAddress = sections[1].rva;
+		nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_RESOURCE].Size = sections[1].virtualSize - options.slack;
+		if (options.reloc)
+		{
+			nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].VirtualAddress = last.rva;
+			nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].Size = relocSize;
+		}
+		if (securitySize != 0)
+		{
+			nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_SECURITY].VirtualAddress = security;
+			nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_SECURITY].Size = securitySize;
+		}
+		Put(image, 0x40, nt);
+		DWORD offset = 0x40 + sizeof nt;
+		for (size_t i = 0; i < sections.size(); ++i, offset += sizeof(IMAGE_SECTION_HEADER))
+		{
+			const Section &section = sections[i];
+			IMAGE_SECTION_HEADER header;
+			memset(&header, 0, sizeof header);
+			memcpy(header.Name, section.name, strlen(section.name));
+			header.Misc.VirtualSize = section.virtualSize;
+			header.VirtualAddress = section.rva;
+			header.SizeOfRawData = static_cast<DWORD>(section.data.size());
+			header.PointerToRawData = section.offset;
+			header.Characteristics = IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ;
+			Put(image, offset, header);
+		}
+	}
+}
+
+PEBuilder::Resource PEBuilder::MakeResource(LPCWSTR type, LPCWSTR name, WORD lang, const std::string &data)
+{
+	const Resource resource = { type, name, lang, data };
+	return resource;
+}
+
+std::string PEBuilder::Build(const std::vector<Resource> &resources, const Options &options)
+{
+	std::vector<Section> sections;
+	Section text = { ".text", std::string(16, '\xCC'), 16, 0, 0 };
+	sections.push_back(text);
+	Section rsrc = { ".rsrc", std::string(), 0, 0, 0 };
+	sections.push_back(rsrc);
+	if (options.data)
+	{
+		Section data = { ".data", "data which stays", 16, 0, 0 };
+		sections.push_back(data);
+	}
+	// A single block of base relocations for the .text section
+	const DWORD relocSize = 12;
+	if (options.reloc)
+	{
+		Section reloc = { ".reloc", std::string(relocSize, '\0'), relocSize, 0, 0 };
+		sections.push_back(reloc);
+	}
+	const DWORD cbNt = options.pe64 ? sizeof(IMAGE_NT_HEADERS64) : sizeof(IMAGE_NT_HEADERS32);
+	const DWORD cbHeaders = AlignUp(static_cast<DWORD>(0x40 + cbNt + sections.size() * sizeof(IMAGE_SECTION_HEADER)), options.fileAlignment);
+	DWORD rva = AlignUp(cbHeaders, options.sectionAlignment);
+	DWORD offset = cbHeaders;
+	for (size_t i = 0; i < sections.size(); ++i)
+	{
+		Section &section = sections[i];
+		section.rva = rva;
+		section.offset = offset;
+		if (i == 1)
+		{
+			section.data = BuildResourceSection(resources, rva);
+			section.virtualSize = static_cast<DWORD>(section.data.size()) + options.slack;
+			section.data.resize(section.virtualSize);
+		}
+		if (strcmp(section.name, ".reloc") == 0)
+		{
+			Put(section.data, 0, sections[0].rva);
+			Put(section.data, 4, relocSize);
+			Put(section.data, 8, static_cast<WORD>(0x3000));
+		}
+		section.data.resize(AlignUp(static_cast<DWORD>(section.data.size()), options.fileAlignment));
+		rva += AlignUp(section.virtualSize, options.sectionAlignment);
+		offset += static_cast<DWORD>(section.data.size());
+	}
+	std::string image(cbHeaders, '\0');
+	IMAGE_DOS_HEADER dos;
+	memset(&dos, 0, sizeof dos);
+	dos.e_magic = IMAGE_DOS_SIGNATURE;
+	dos.e_lfanew = 0x40;
+	Put(image, 0, dos);
+	const DWORD securitySize = options.signature ? 16 : 0;
+	if (options.pe64)
+		PutHeaders<IMAGE_NT_HEADERS64>(image, options, IMAGE_NT_OPTIONAL_HDR64_MAGIC, IMAGE_FILE_MACHINE_AMD64, sections, cbHeaders, relocSize, offset, securitySize);
+	else
+		PutHeaders<IMAGE_NT_HEADERS32>(image, options, IMAGE_NT_OPTIONAL_HDR32_MAGIC, IMAGE_FILE_MACHINE_I386, sections, cbHeaders, relocSize, offset, securitySize);
+	for (size_t i = 0; i < sections.size(); ++i)
+		image += sections[i].data;
+	// Certificates come at the end of the file, outside of any section
+	image += std::string(securitySize, '\x5A');
+	if (options.checksum)
+		Put(image, CheckSumOffset(image), CheckSum(image));
+	return image;
+}
+
+DWORD PEBuilder::CheckSumOffset(const std::string &image)
+{
+	IMAGE_DOS_HEADER dos;
+	memcpy(&dos, image.data(), sizeof dos);
+	return dos.e_lfanew + FIELD_OFFSET(IMAGE_NT_HEADERS32, OptionalHeader.CheckSum);
+}
+
+DWORD PEBuilder::CheckSum(const std::string &image)
+{
+	const DWORD skip = CheckSumOffset(image);
+	const BYTE *const p = reinterpret_cast<const BYTE *>(image.data());
+	const DWORD size = static_cast<DWORD>(image.size());
+	DWORD sum = 0;
+	for (DWORD i = 0; i < size; i += 2)
+	{
+		DWORD word = p[i];
+		if (i + 1 < size)
+			word |= p[i + 1] << 8;
+		if (i == skip || i == skip + 2)
+			word = 0;
+		sum += word;
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+	return sum + size;
+}
@@ -0,0 +1,71 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Puts together PE files for the tests, with a resource section laid out the
+// way linkers do it, and whatever else it takes to test the code which reads
+// and rewrites them
+
+#pragma once
+
+#include <shlwapi.h>
+#include <string>
+#include <vector>
+
+namespace PEBuilder
+{
+	struct Resource
+	{
+		LPCWSTR type; // a name, or MAKEINTRESOURCEW(n)
+		LPCWSTR name;
+		WORD lang;
+		std::string data;
+	};
+
+	// What goes where in the file, with sections in this order:
+	// .text, .rsrc, then optionally .data, then optionally .reloc
+	struct Options
+	{
+		bool pe64;
+		bool checksum;
+		bool data;			// a section after .rsrc which must not move
+		bool reloc;			// a .reloc section after .rsrc
+		bool signature;		// a security directory, as signed files have
+		DWORD fileAlignment;
+		DWORD sectionAlignment;
+		DWORD slack;		// unused bytes at the end of .rsrc, within its virtual size
+		Options(): pe64(false), checksum(true), data(false), reloc(false), signature(false),
+			fileAlignment(0x200), sectionAlignment(0x1000), slack(0) { }
+	};
+
+	std::string Build(const std::vector<Resource> &resources, const Options &options = Options());
+
+	// Computes the checksum the way CheckSumMappedFile() does, which is
+	// independent of the code under test
+	DWORD CheckSum(const std::string &image);
+
+	// Offset of the CheckSum field of the optional header
+	DWORD CheckSumOffset(const std::string &image);
+
+	Resource MakeResource(LPCWSTR type, LPCWSTR name, WORD lang, const std::string &data);
+}
@@ -0,0 +1,299 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Tests for the PEImage of peimage.h, on well-formed files as well as on ones
+// which are truncated or damaged, where nothing may be read out of bounds
+
+#include "test.h"
+#include "pebuilder.h"
+#include "../miscutil.h"
+#include "../peimage.h"
+#include <stdlib.h>
+#include <string.h>
+
+using PEBuilder::MakeResource;
+
+namespace
+{
+	const HRESULT BadFormat = HRESULT_FROM_WIN32(ERROR_BAD_EXE_FORMAT);
+
+	std::vector<PEBuilder::Resource> SampleResources()
+	{
+		std::vector<PEBuilder::Resource> resources;
+		resources.push_back(MakeResource(RT_MANIFEST, MAKEINTRESOURCEW(2), 1033, "<assembly manifestVersion=\"1.0\"/>"));
+		resources.push_back(MakeResource(RT_MANIFEST, MAKEINTRESOURCEW(1), 1031, "german"));
+		resources.push_back(MakeResource(RT_MANIFEST, MAKEINTRESOURCEW(1), 1033, "english"));
+		resources.push_back(MakeResource(L"REGISTRY", L"MYOBJECT", 1033, "HKCR { }"));
+		resources.push_back(MakeResource(L"REGISTRY", L"Other", 1033, "HKLM { }"));
+		resources.push_back(MakeResource(L"TYPELIB", MAKEINTRESOURCEW(1), 0, "MSFT"));
+		return resources;
+	}
+
+	bool Within(const PEImage &image, const void *p, DWORD cb)
+	{
+		const BYTE *const base = image.getBase();
+		const BYTE *const q = static_cast<const BYTE *>(p);
+		return q >= base && q <= base + image.getSize() && cb <= static_cast<DWORD>(base + image.getSize() - q);
+	}
+
+	// Walks the three levels of the resource tree, and checks that whatever
+	// comes back lies within the file. Returns the number of resources found.
+	int Walk(const PEImage &image, const IMAGE_RESOURCE_DIRECTORY *dir, int depth)
+	{
+		if (dir == NULL)
+			return 0;
+		CHECK(Within(image, dir, sizeof *dir));
+		int found = 0;
+		const UINT n = image.getCount(dir);
+		for (UINT i = 0; i < n; ++i)
+		{
+			const IMAGE_RESOURCE_DIRECTORY_ENTRY *const entry = image.getEntry(dir, i);
+			CHECK(entry != NULL && Within(image, entry, sizeof *entry));
+			if (const IMAGE_RESOURCE_DIR_STRING_U *const name = image.getName(entry))
+				CHECK(Within(image, name, sizeof(WORD) + name->Length * sizeof(WCHAR)));
+			if (depth < 2)
+			{
+				found += Walk(image, image.getDirectory(entry), depth + 1);
+			}
+			else if (const IMAGE_RESOURCE_DATA_ENTRY *const data = image.getDataEntry(entry))
+			{
+				CHECK(Within(image, data, sizeof *data));
+				DWORD cb = 0xCCCCCCCC;
+				if (const BYTE *const p = image.getData(entry, &cb))
+				{
+					CHECK(Within(image, p, cb));
+					++found;
+				}
+				else
+				{
+					CHECK_EQ(cb, 0u);
+				}
+			}
+		}
+		return found;
+	}
+
+	std::string Find(const PEImage &image, LPCWSTR type, LPCWSTR name, LPCWSTR lang)
+	{
+		DWORD cb = 0xCCCCCCCC;
+		const BYTE *const p = image.findResource(type, name, lang, &cb);
+		if (p == NULL)
+		{
+			CHECK_EQ(cb, 0u);
+			return "(none)";
+		}
+		CHECK(Within(image, p, cb));
+		return std::string(reinterpret_cast<const char *>(p), cb);
+	}
+
+	HRESULT Open(PEImage &image, const std::string &file)
+	{
+		Test::WriteFile(L"C:\\image.dll", file.data(), file.size());
+		return image.open(L"C:\\image.dll");
+	}
+
+	template<class T>
+	void Patch(std::string &file, DWORD offset, T value)
+	{
+		memcpy(&file[offset], &value, sizeof value);
+	}
+
+	DWORD NtOffset()
+	{
+		return 0x40;
+	}
+
+	DWORD OptionalHeaderOffset()
+	{
+		return NtOffset() + FIELD_OFFSET(IMAGE_NT_HEADERS32, OptionalHeader);
+	}
+}
+
+TEST(FindsResourcesByIdAndName)
+{
+	for (int pe64 = 0; pe64 < 2; ++pe64)
+	{
+		PEBuilder::Options options;
+		options.pe64 = pe64 != 0;
+		PEImage image;
+		CHECK_EQ(Open(image, PEBuilder::Build(SampleResources(), options)), S_OK);
+		CHECK_EQ(Walk(image, image.getRoot(), 0), 6);
+		CHECK_EQ(Find(image, RT_MANIFEST, MAKEINTRESOURCEW(2), NULL), "<assembly manifestVersion=\"1.0\"/>");
+		CHECK_EQ(Find(image, RT_MANIFEST, MAKEINTRESOURCEW(1), NULL), "german");
+		CHECK_EQ(Find(image, RT_MANIFEST, MAKEINTRESOURCEW(1), MAKEINTRESOURCEW(1033)), "english");
+		CHECK_EQ(Find(image, RT_MANIFEST, MAKEINTRESOURCEW(1), MAKEINTRESOURCEW(1036)), "(none)");
+		CHECK_EQ(Find(image, RT_MANIFEST, MAKEINTRESOURCEW(3), NULL), "(none)");
+		// NULL picks the first entry, and named ones come first
+		CHECK_EQ(Find(image, NULL, NULL, NULL), "HKCR { }");
+		// Names compare case-insensitively
+		CHECK_EQ(Find(image, L"registry", L"myObject", NULL), "HKCR { }");
+		CHECK_EQ(Find(image, L"REGISTRY", L"OTHER", NULL), "HKLM { }");
+		CHECK_EQ(Find(image, L"REGISTRY", L"MYOBJEC", NULL), "(none)");
+		CHECK_EQ(Find(image, L"TYPELIB", MAKEINTRESOURCEW(1), NULL), "MSFT");
+		CHECK_EQ(image.getNtHeaders()->OptionalHeader.Magic, pe64 ? IMAGE_NT_OPTIONAL_HDR64_MAGIC : IMAGE_NT_OPTIONAL_HDR32_MAGIC);
+		UINT n;
+		CHECK(image.getSections(&n) != NULL);
+		CHECK_EQ(n, 2u);
+	}
+}
+
+TEST(FindsIntegerIdsAmongMany)
+{
+	std::vector<PEBuilder::Resource> resources;
+	for (WORD id = 1; id <= 300; id += 3)
+	{
+		char data[16];
+		snprintf(data, sizeof data, "string %u", id);
+		resources.push_back(MakeResource(MAKEINTRESOURCEW(6), MAKEINTRESOURCEW(id), 0, data));
+	}
+	PEImage image;
+	CHECK_EQ(Open(image, PEBuilder::Build(resources)), S_OK);
+	for (WORD id = 1; id <= 302; ++id)
+	{
+		char data[16];
+		snprintf(data, sizeof data, "string %u", id);
+		CHECK_EQ(Find(image, MAKEINTRESOURCEW(6), MAKEINTRESOURCEW(id), NULL), id % 3 == 1 && id <= 300 ? data : "(none)");
+	}
+}
+
+TEST(OpenFailsOnMissingOrTinyFiles)
+{
+	PEImage image;
+	CHECK_EQ(image.open(L"C:\\missing.dll"), HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+	CHECK_EQ(Open(image, ""), BadFormat);
+	CHECK_EQ(Open(image, "MZ"), BadFormat);
+	CHECK_EQ(image.close(), E_POINTER);
+}
+
+TEST(OpenRejectsMalformedHeaders)
+{
+	const std::string good = PEBuilder::Build(SampleResources());
+	std::vector<std::string> bad;
+	std::string file = good;
+	Patch<WORD>(file, 0, 0x4D5A); // ZM
+	bad.push_back(file);
+	file = good;
+	Patch<LONG>(file, FIELD_OFFSET(IMAGE_DOS_HEADER, e_lfanew), static_cast<LONG>(good.size()) - 4);
+	bad.push_back(file);
+	file = good;
+	Patch<LONG>(file, FIELD_OFFSET(IMAGE_DOS_HEADER, e_lfanew), -0x40);
+	bad.push_back(file);
+	file = good;
+	Patch<DWORD>(file, NtOffset(), 0x00004551);
+	bad.push_back(file);
+	file = good;
+	Patch<WORD>(file, OptionalHeaderOffset(), 0x107);
+	bad.push_back(file);
+	file = good;
+	Patch<WORD>(file, NtOffset() + 4 + FIELD_OFFSET(IMAGE_FILE_HEADER, SizeOfOptionalHeader), FIELD_OFFSET(IMAGE_OPTIONAL_HEADER32, DataDirectory) - 1);
+	bad.push_back(file);
+	file = good;
+	Patch<DWORD>(file, OptionalHeaderOffset() + FIELD_OFFSET(IMAGE_OPTIONAL_HEADER32, NumberOfRvaAndSizes), 17);
+	bad.push_back(file);
+	file = good;
+	Patch<WORD>(file, NtOffset() + 4 + FIELD_OFFSET(IMAGE_FILE_HEADER, NumberOfSections), 0xFFFF);
+	bad.push_back(file);
+	// A PE32+ magic in a PE32 file which ends right after the headers
+	file = good.substr(0, NtOffset() + sizeof(IMAGE_NT_HEADERS32));
+	Patch<WORD>(file, OptionalHeaderOffset(), IMAGE_NT_OPTIONAL_HDR64_MAGIC);
+	bad.push_back(file);
+	for (size_t i = 0; i < bad.size(); ++i)
+	{
+		PEImage image;
+		CHECK_EQ(Open(image, bad[i]), BadFormat);
+		CHECK(image.getBase() == NULL);
+	}
+}
+
+TEST(TruncatedFilesStayWithinBounds)
+{
+	for (int pe64 = 0; pe64 < 2; ++pe64)
+	{
+		PEBuilder::Options options;
+		options.pe64 = pe64 != 0;
+		options.fileAlignment = 0x10;
+		const std::string file = PEBuilder::Build(SampleResources(), options);
+		int opened = 0;
+		for (size_t len = 0; len <= file.size(); ++len)
+		{
+			PEImage image;
+			const HRESULT hr = Open(image, file.substr(0, len));
+			if (FAILED(hr))
+			{
+				CHECK_EQ(hr, BadFormat);
+				continue;
+			}
+			++opened;
+			const int found = Walk(image, image.getRoot(), 0);
+			CHECK(found <= 6);
+			if (len == file.size())
+				CHECK_EQ(found, 6);
+			Find(image, RT_MANIFEST, MAKEINTRESOURCEW(2), NULL);
+			Find(image, L"REGISTRY", L"MYOBJECT", NULL);
+		}
+		CHECK(opened > 0);
+	}
+}
+
+TEST(DamagedResourcesStayWithinBounds)
+{
+	PEBuilder::Options options;
+	options.fileAlignment = 0x10;
+	const std::string good = PEBuilder::Build(SampleResources(), options);
+	PEImage image;
+	CHECK_EQ(Open(image, good), S_OK);
+	const DWORD rsrc = static_cast<DWORD>(reinterpret_cast<const BYTE *>(image.getRoot()) - image.getBase());
+	image.close();
+	srand(14);
+	for (int round = 0; round < 2000; ++round)
+	{
+		std::string file = good;
+		// Damage a few bytes of the resource section, sometimes with values
+		// which make for large counts and offsets
+		for (int i = rand() % 4; i >= 0; --i)
+		{
+			const DWORD at = rsrc + rand() % static_cast<DWORD>(file.size() - rsrc);
+			file[at] = static_cast<char>(rand() % 2 ? rand() : 0xFF);
+		}
+		CHECK_EQ(Open(image, file), S_OK);
+		Walk(image, image.getRoot(), 0);
+		Find(image, RT_MANIFEST, MAKEINTRESOURCEW(1), NULL);
+		Find(image, L"REGISTRY", L"MYOBJECT", NULL);
+	}
+}
+
+TEST(RvaToOffsetMapsSectionData)
+{
+	PEImage image;
+	CHECK_EQ(Open(image, PEBuilder::Build(SampleResources())), S_OK);
+	UINT n;
+	const IMAGE_SECTION_HEADER *const sections = image.getSections(&n);
+	DWORD avail;
+	CHECK_EQ(image.rvaToOffset(sections[1].VirtualAddress + 4, &avail), sections[1].PointerToRawData + 4);
+	CHECK_EQ(avail, sections[1].SizeOfRawData - 4);
+	// Past the raw data, and before the first section
+	CHECK_EQ(image.rvaToOffset(sections[1].VirtualAddress + sections[1].SizeOfRawData, &avail), 0u);
+	CHECK_EQ(avail, 0u);
+	CHECK_EQ(image.rvaToOffset(0x10, &avail), 0u);
+}
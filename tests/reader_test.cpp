@@ -0,0 +1,283 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Tests for the Reader of reader.h, going through files the way the .reg file
+// import does: lines viewed in place, trimmed, and joined where they end in a
+// backslash
+
+#include "test.h"
+#include "../miscutil.h"
+#include "../reader.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::string Narrow(const char *s, ULONG cb)
+	{
+		return std::string(s, cb);
+	}
+
+	std::string Narrow(const WCHAR *s, ULONG cb)
+	{
+		std::string narrow;
+		for (ULONG i = 0; i < cb / sizeof(WCHAR); ++i)
+			narrow += s[i] < 0x80 ? static_cast<char>(s[i]) : '?';
+		return narrow;
+	}
+
+	// Puts text into UTF-16, in either byte order, behind the matching BOM
+	std::string Encode(const std::string &text, bool bigEndian)
+	{
+		std::string bytes = bigEndian ? "\xFE\xFF" : "\xFF\xFE";
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			const char c[2] = { bigEndian ? '\0' : text[i], bigEndian ? text[i] : '\0' };
+			bytes.append(c, 2);
+		}
+		return bytes;
+	}
+
+	template<typename T>
+	std::vector<std::string> ReadLines(Reader &reader)
+	{
+		const BYTE eol = reader.allocCtype("\n");
+		const BYTE blank = reader.allocCtype(" \t\r\n");
+		const BYTE backslash = reader.allocCtype("\\");
+		std::vector<std::string> lines;
+		T *line = NULL;
+		ULONG len = 0;
+		while ((line = reader.viewLine(eol, &len, line)) != NULL)
+		{
+			len = reader.trim(line, len, blank);
+			const ULONG cb = reader.trim(line, len, backslash);
+			CHECK(line[cb / sizeof(T)] == 0);
+			if (cb != len)
+			{
+				len = cb;
+				continue;
+			}
+			len = 0;
+			lines.push_back(Narrow(line, cb));
+		}
+		return lines;
+	}
+
+	// Reads a file with and without SSE2, and checks that both agree
+	std::vector<std::string> ReadFile(const std::string &content, Reader::Encoding expected)
+	{
+		Test::WriteFile(L"C:\\file.reg", content.data(), content.size());
+		std::vector<std::string> lines[2];
+		for (int sse2 = 0; sse2 < 2; ++sse2)
+		{
+			Shim::EnableSse2(sse2 != 0);
+			Reader reader;
+			CHECK_EQ(reader.map(L"C:\\file.reg"), S_OK);
+			Reader::Encoding encoding = reader.readBom();
+			CHECK_EQ(encoding, expected);
+			if (encoding == Reader::UCS2BE)
+			{
+				reader.swapBytes();
+				encoding = Reader::UCS2LE;
+			}
+			if (encoding == Reader::UCS2LE)
+				lines[sse2] = ReadLines<WCHAR>(reader);
+			else
+				lines[sse2] = ReadLines<char>(reader);
+		}
+		Shim::EnableSse2(true);
+		CHECK(lines[0] == lines[1]);
+		return lines[1];
+	}
+
+	std::vector<std::string> Lines(const char *first, ...)
+	{
+		std::vector<std::string> lines;
+		va_list args;
+		va_start(args, first);
+		for (const char *s = first; s != NULL; s = va_arg(args, const char *))
+			lines.push_back(s);
+		va_end(args);
+		return lines;
+	}
+}
+
+TEST(MapReadsNothingFromEmptyFile)
+{
+	CHECK(ReadFile("", Reader::ANSI).empty());
+}
+
+TEST(MapFailsOnMissingFile)
+{
+	Reader reader;
+	CHECK_EQ(reader.map(L"C:\\missing.reg"), HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+}
+
+TEST(ViewLineSplitsAndTrims)
+{
+	const char text[] = "REGEDIT4\r\n\r\n  [HKEY_CLASSES_ROOT\\x]\t\r\n@=\"y\"\r\n";
+	const std::vector<std::string> expected = Lines("REGEDIT4", "", "[HKEY_CLASSES_ROOT\\x]", "@=\"y\"", NULL);
+	CHECK(ReadFile(text, Reader::ANSI) == expected);
+	CHECK(ReadFile(Encode(text, false), Reader::UCS2LE) == expected);
+	CHECK(ReadFile(Encode(text, true), Reader::UCS2BE) == expected);
+}
+
+TEST(ViewLineHandsOutLastLineWithoutTerminator)
+{
+	CHECK(ReadFile("a\nlast", Reader::ANSI) == Lines("a", "last", NULL));
+	CHECK(ReadFile("last", Reader::ANSI) == Lines("last", NULL));
+	CHECK(ReadFile(Encode("a\r\nlast", false), Reader::UCS2LE) == Lines("a", "last", NULL));
+	CHECK(ReadFile(Encode("a\r\nlast", true), Reader::UCS2BE) == Lines("a", "last", NULL));
+	// A terminator at the very end makes no extra line
+	CHECK(ReadFile("a\n", Reader::ANSI) == Lines("a", NULL));
+}
+
+TEST(ViewLineJoinsContinuationLines)
+{
+	const char text[] =
+		"\"x\"=hex:01,02,\\\r\n"
+		"  03,04,\\\r\n"
+		"  05\r\n"
+		"\"y\"=hex:06,\\\n"
+		"  07";
+	// The blanks which lead the continuation lines stay, as the hex decoder
+	// skips them anyway
+	const std::vector<std::string> expected = Lines("\"x\"=hex:01,02,  03,04,  05", "\"y\"=hex:06,  07", NULL);
+	CHECK(ReadFile(text, Reader::ANSI) == expected);
+	CHECK(ReadFile(Encode(text, false), Reader::UCS2LE) == expected);
+	CHECK(ReadFile(Encode(text, true), Reader::UCS2BE) == expected);
+}
+
+TEST(ViewLineMatchesScalarForAllLengths)
+{
+	// Lines of every length up to a few blocks of 16 bytes, with the blanks
+	// to trim at both ends, and characters which are only one byte off the
+	// line feed
+	srand(11);
+	std::string text;
+	std::vector<std::string> expected;
+	for (int len = 0; len < 70; ++len)
+	{
+		std::string line(len, 'x');
+		for (int i = 0; i < len; ++i)
+			line[i] = "ab\x0B\x0C-="[rand() % 6];
+		const std::string lead(rand() % 20, ' ');
+		const std::string tail(rand() % 20, '\t');
+		text += lead + line + tail + "\r\n";
+		expected.push_back(line);
+	}
+	CHECK(ReadFile(text, Reader::ANSI) == expected);
+	CHECK(ReadFile(Encode(text, false), Reader::UCS2LE) == expected);
+	CHECK(ReadFile(Encode(text, true), Reader::UCS2BE) == expected);
+}
+
+TEST(WideCharactersDoNotMatchByLowByte)
+{
+	// U+010A and U+0120 share their low bytes with a line feed and a blank
+	const WCHAR text[] = { 0xFEFF, L'a', 0x010A, L'b', 0x0120, 0x0120, L'\n', 0x0120, L'c', 0 };
+	Test::WriteFile(L"C:\\file.reg", text, sizeof text - sizeof *text);
+	for (int sse2 = 0; sse2 < 2; ++sse2)
+	{
+		Shim::EnableSse2(sse2 != 0);
+		Reader reader;
+		CHECK_EQ(reader.map(L"C:\\file.reg"), S_OK);
+		CHECK_EQ(reader.readBom(), Reader::UCS2LE);
+		CHECK(ReadLines<WCHAR>(reader) == Lines("a?b??", "?c", NULL));
+	}
+}
+
+TEST(TrimMatchesStrTrim)
+{
+	// A class of more than eight members goes the scalar way even with SSE2
+	srand(13);
+	for (int round = 0; round < 500; ++round)
+	{
+		std::vector<WCHAR> s(rand() % 50, L'x');
+		for (size_t i = 0; i < s.size(); ++i)
+			s[i] = L" \txy0123456789"[rand() % 14];
+		s.push_back(0);
+		for (int sse2 = 0; sse2 < 2; ++sse2)
+		{
+			Shim::EnableSse2(sse2 != 0);
+			Reader reader;
+			const BYTE blank = reader.allocCtype(" \t");
+			const BYTE digits = reader.allocCtype("0123456789 ");
+			static const WCHAR blanks[] = L" \t";
+			static const WCHAR digitChars[] = L"0123456789 ";
+			std::vector<WCHAR> expected = s;
+			StrTrimW(&expected[0], blanks);
+			std::vector<WCHAR> actual = s;
+			CHECK_EQ(reader.trim(&actual[0], static_cast<ULONG>((s.size() - 1) * sizeof(WCHAR)), blank), static_cast<ULONG>(lstrlenW(&expected[0]) * sizeof(WCHAR)));
+			CHECK_STR(&actual[0], &expected[0]);
+			expected = s;
+			StrTrimW(&expected[0], digitChars);
+			actual = s;
+			CHECK_EQ(reader.trim(&actual[0], static_cast<ULONG>((s.size() - 1) * sizeof(WCHAR)), digits), static_cast<ULONG>(lstrlenW(&expected[0]) * sizeof(WCHAR)));
+			CHECK_STR(&actual[0], &expected[0]);
+		}
+	}
+}
+
+TEST(ReadBomTellsEncoding)
+{
+	CHECK(ReadFile("\xEF\xBB\xBFx\n", Reader::UTF8) == Lines("x", NULL));
+	CHECK(ReadFile(Encode("x\n", false), Reader::UCS2LE) == Lines("x", NULL));
+	CHECK(ReadFile(Encode("x\n", true), Reader::UCS2BE) == Lines("x", NULL));
+	CHECK(ReadFile("x\n", Reader::ANSI) == Lines("x", NULL));
+	CHECK(ReadFile("\xFF", Reader::ANSI) == Lines("\xFF", NULL));
+}
+
+TEST(SwapBytesMatchesScalar)
+{
+	srand(12);
+	for (int len = 0; len < 40; ++len)
+	{
+		std::string bytes = "\xFE\xFF";
+		std::vector<WCHAR> expected;
+		for (int i = 0; i < len; ++i)
+		{
+			const WCHAR c = static_cast<WCHAR>(0x2000 + rand() % 0x1000);
+			const char be[2] = { static_cast<char>(c >> 8), static_cast<char>(c) };
+			bytes.append(be, 2);
+			expected.push_back(c);
+		}
+		Test::WriteFile(L"C:\\file.reg", bytes.data(), bytes.size());
+		for (int sse2 = 0; sse2 < 2; ++sse2)
+		{
+			Shim::EnableSse2(sse2 != 0);
+			Reader reader;
+			CHECK_EQ(reader.map(L"C:\\file.reg"), S_OK);
+			CHECK_EQ(reader.readBom(), Reader::UCS2BE);
+			reader.swapBytes();
+			const BYTE eol = reader.allocCtype("\n");
+			ULONG cb = 0;
+			WCHAR *const line = reader.viewLine<WCHAR>(eol, &cb);
+			CHECK_EQ(cb, static_cast<ULONG>(len * sizeof(WCHAR)));
+			CHECK(len == 0 ? line == NULL : memcmp(line, &expected[0], cb) == 0);
+		}
+	}
+}
@@ -0,0 +1,110 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Tests for the RegCache of regcache.cpp: which files it takes for a cache,
+// which ones it leaves alone, and what it replays
+
+#include "test.h"
+#include "../hive.h"
+#include "../regcache.h"
+
+namespace
+{
+	LPCWSTR const Path = L"C:\\reg.cache";
+	LPCWSTR const Module = L"C:\\app\\a.dll";
+	const HRESULT InvalidData = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+	// Has registration of the module add a class to the hive, and records it
+	void Record(RegCache &cache, RegCache::Fingerprint &fp)
+	{
+		Test::WriteFile(Module, "MZ");
+		CHECK_EQ(RegCache::Identify(Module, fp), S_OK);
+		Hive hive;
+		hive.Checkpoint();
+		Hive::Key *const key = hive.CreateKey(hive.GetClassesRoot(), L"CLSID\\{A0000000-0000-0000-0000-00000000000A}\\InprocServer32");
+		static const WCHAR model[] = L"Both";
+		hive.SetValue(key, L"ThreadingModel", REG_SZ, model, sizeof model);
+		CHECK_EQ(cache.Record(hive, fp), S_OK);
+	}
+}
+
+// [user-007] A cache which doesn't exist yet is created on save
+TEST(OpenMissingCache)
+{
+	RegCache cache;
+	CHECK_EQ(cache.Open(Path), S_FALSE);
+	CHECK_EQ(cache.Save(), S_OK);
+	CHECK(Test::FileExists(Path));
+}
+
+// [user-007] A file which isn't a cache fails to open, and is left alone
+TEST(OpenForeignFile)
+{
+	static const char text[] = "Not a cache, but something else entirely";
+	Test::WriteFile(Path, text);
+	RegCache cache;
+	CHECK_EQ(cache.Open(Path), InvalidData);
+	CHECK_EQ(cache.Save(), S_FALSE);
+	CHECK_EQ(Test::ReadFile(Path), text);
+	// Same for a file too short to hold a header
+	Test::WriteFile(Path, "MF");
+	CHECK_EQ(cache.Open(Path), InvalidData);
+	CHECK_EQ(cache.Save(), S_FALSE);
+	CHECK_EQ(Test::ReadFile(Path), "MF");
+}
+
+// [user-007] A cache written by another version counts as empty, and is
+// replaced on save
+TEST(OpenOutdatedCache)
+{
+	static const DWORD header[] = { 0x4352464D, 0 };
+	Test::WriteFile(Path, header, sizeof header);
+	RegCache cache;
+	CHECK_EQ(cache.Open(Path), S_FALSE);
+	CHECK_EQ(cache.Save(), S_OK);
+	CHECK_EQ(cache.Open(Path), S_OK);
+}
+
+// [user-007] What has been recorded comes back on the next run, as long as
+// the file is still the same
+TEST(ReplayRecorded)
+{
+	RegCache::Fingerprint fp;
+	{
+		RegCache cache;
+		CHECK_EQ(cache.Open(Path), S_FALSE);
+		Record(cache, fp);
+		CHECK_EQ(cache.Save(), S_OK);
+	}
+	RegCache cache;
+	CHECK_EQ(cache.Open(Path), S_OK);
+	Hive hive;
+	CHECK_EQ(cache.Replay(hive, fp), S_OK);
+	CHECK_STR(hive.GetString(hive.GetClassesRoot(), L"CLSID\\{A0000000-0000-0000-0000-00000000000A}\\InprocServer32", L"ThreadingModel"), L"Both");
+	// A changed file is not replayed
+	Test::WriteFile(Module, "MZ with a difference");
+	RegCache::Fingerprint changed;
+	CHECK_EQ(RegCache::Identify(Module, changed), S_OK);
+	CHECK(cache.Replay(hive, changed) != S_OK);
+}
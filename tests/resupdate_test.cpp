@@ -0,0 +1,223 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Tests for ReplaceResource of resupdate.cpp, which rewrites PE files in
+// place where it can, and tells when it can't
+
+#include "test.h"
+#include "pebuilder.h"
+#include "../miscutil.h"
+#include "../peimage.h"
+#include "../resupdate.h"
+#include <string.h>
+
+using PEBuilder::MakeResource;
+
+namespace
+{
+	LPCWSTR const Path = L"C:\\image.dll";
+
+	std::vector<PEBuilder::Resource> SampleResources()
+	{
+		std::vector<PEBuilder::Resource> resources;
+		resources.push_back(MakeResource(RT_MANIFEST, MAKEINTRESOURCEW(1), 1033, std::string(100, 'm')));
+		resources.push_back(MakeResource(RT_MANIFEST, MAKEINTRESOURCEW(2), 1033, "second"));
+		resources.push_back(MakeResource(L"REGISTRY", L"MYOBJECT", 1033, "HKCR { }"));
+		return resources;
+	}
+
+	HRESULT Replace(WORD id, const std::string &data)
+	{
+		const Chunk chunk = { reinterpret_cast<const BYTE *>(data.data()), static_cast<DWORD>(data.size()) };
+		return ReplaceResource(Path, RT_MANIFEST, MAKEINTRESOURCEW(id), 1033, &chunk, 1);
+	}
+
+	std::string Find(const PEImage &image, LPCWSTR type, LPCWSTR name)
+	{
+		DWORD cb;
+		const BYTE *const p = image.findResource(type, name, NULL, &cb);
+		return p ? std::string(reinterpret_cast<const char *>(p), cb) : "(none)";
+	}
+
+	// Checks that the file holds the given manifests, that the rest is still
+	// there, and that the headers add up
+	void CheckImage(const std::string &first, const std::string &second)
+	{
+		const std::string file = Test::ReadFile(Path);
+		PEImage image;
+		CHECK_EQ(image.open(Path), S_OK);
+		CHECK_EQ(Find(image, RT_MANIFEST, MAKEINTRESOURCEW(1)), first);
+		CHECK_EQ(Find(image, RT_MANIFEST, MAKEINTRESOURCEW(2)), second);
+		CHECK_EQ(Find(image, L"REGISTRY", L"MYOBJECT"), "HKCR { }");
+		const IMAGE_OPTIONAL_HEADER32 &optional = image.getNtHeaders()->OptionalHeader;
+		if (optional.CheckSum != 0)
+			CHECK_EQ(optional.CheckSum, PEBuilder::CheckSum(file));
+		UINT n;
+		const IMAGE_SECTION_HEADER *const sections = image.getSections(&n);
+		const IMAGE_SECTION_HEADER &last = sections[n - 1];
+		CHECK_EQ(optional.SizeOfImage, last.VirtualAddress + ((last.Misc.VirtualSize + optional.SectionAlignment - 1) & ~(optional.SectionAlignment - 1)));
+		for (UINT i = 0; i < n; ++i)
+		{
+			CHECK_EQ(sections[i].SizeOfRawData % optional.FileAlignment, 0u);
+			CHECK(sections[i].PointerToRawData + sections[i].SizeOfRawData <= file.size());
+			if (i != 0)
+				CHECK(sections[i].VirtualAddress >= sections[i - 1].VirtualAddress + sections[i - 1].Misc.VirtualSize);
+		}
+	}
+}
+
+TEST(PatchesInPlace)
+{
+	for (int pe64 = 0; pe64 < 2; ++pe64)
+	{
+		PEBuilder::Options options;
+		options.pe64 = pe64 != 0;
+		const std::string original = PEBuilder::Build(SampleResources(), options);
+		Test::WriteFile(Path, original.data(), original.size());
+		CHECK_EQ(Replace(1, "shorter"), S_OK);
+		CheckImage("shorter", "second");
+		// Nothing moves, and what is left of the old data is cleared
+		const std::string patched = Test::ReadFile(Path);
+		CHECK_EQ(patched.size(), original.size());
+		CHECK(patched.find(std::string(93, 'm')) == std::string::npos);
+		CHECK_EQ(Replace(1, std::string(100, 'n')), S_OK);
+		CheckImage(std::string(100, 'n'), "second");
+		CHECK_EQ(Test::ReadFile(Path).size(), original.size());
+	}
+}
+
+TEST(GrowsLastSection)
+{
+	for (int pe64 = 0; pe64 < 2; ++pe64)
+	{
+		PEBuilder::Options options;
+		options.pe64 = pe64 != 0;
+		const std::string original = PEBuilder::Build(SampleResources(), options);
+		Test::WriteFile(Path, original.data(), original.size());
+		// Goes to the end of the section, and takes it past its alignment
+		const std::string big(0x1800, 'b');
+		CHECK_EQ(Replace(1, big), S_OK);
+		CheckImage(big, "second");
+		CHECK(Test::ReadFile(Path).size() > original.size());
+		// Now that it comes last, it takes the slot over as it grows further
+		const std::string bigger(0x2800, 'c');
+		CHECK_EQ(Replace(1, bigger), S_OK);
+		CheckImage(bigger, "second");
+		// The other one goes after it, and the first one may shrink in place
+		CHECK_EQ(Replace(2, std::string(0x300, 's')), S_OK);
+		CheckImage(bigger, std::string(0x300, 's'));
+		CHECK_EQ(Replace(1, "small"), S_OK);
+		CheckImage("small", std::string(0x300, 's'));
+	}
+}
+
+TEST(GrowsSectionFollowedByRelocations)
+{
+	PEBuilder::Options options;
+	options.reloc = true;
+	const std::string original = PEBuilder::Build(SampleResources(), options);
+	Test::WriteFile(Path, original.data(), original.size());
+	PEImage before;
+	CHECK_EQ(before.open(Path), S_OK);
+	UINT n;
+	const DWORD relocRva = before.getSections(&n)[2].VirtualAddress;
+	const std::string relocData(original.data() + before.getSections(&n)[2].PointerToRawData, 12);
+	before.close();
+	const std::string big(0x1800, 'b');
+	CHECK_EQ(Replace(1, big), S_OK);
+	CheckImage(big, "second");
+	PEImage after;
+	CHECK_EQ(after.open(Path), S_OK);
+	const IMAGE_SECTION_HEADER *const sections = after.getSections(&n);
+	CHECK_EQ(n, 3u);
+	CHECK_EQ(sections[2].VirtualAddress, relocRva + 0x1000);
+	CHECK_EQ(after.getDataDirectory(IMAGE_DIRECTORY_ENTRY_BASERELOC)->VirtualAddress, relocRva + 0x1000);
+	CHECK(memcmp(after.getBase() + sections[2].PointerToRawData, relocData.data(), 12) == 0);
+}
+
+TEST(UsesSlackWithinSection)
+{
+	PEBuilder::Options options;
+	options.slack = 0x100;
+	const std::string original = PEBuilder::Build(SampleResources(), options);
+	Test::WriteFile(Path, original.data(), original.size());
+	// The last resource may spill into the unused part of the section
+	CHECK_EQ(Replace(2, std::string(0x80, 's')), S_OK);
+	CheckImage(std::string(100, 'm'), std::string(0x80, 's'));
+}
+
+TEST(DeclinesWhatItCannotDo)
+{
+	// A section after the resources which can't move, a signature, and a
+	// resource which isn't there
+	PEBuilder::Options data;
+	data.data = true;
+	PEBuilder::Options signature;
+	signature.signature = true;
+	const std::string files[] = { PEBuilder::Build(SampleResources(), data), PEBuilder::Build(SampleResources(), signature) };
+	for (size_t i = 0; i < _countof(files); ++i)
+	{
+		Test::WriteFile(Path, files[i].data(), files[i].size());
+		CHECK_EQ(Replace(1, std::string(0x1800, 'b')), S_FALSE);
+		CHECK(Test::ReadFile(Path) == files[i]);
+	}
+	const std::string file = PEBuilder::Build(SampleResources());
+	Test::WriteFile(Path, file.data(), file.size());
+	CHECK_EQ(Replace(3, "x"), S_FALSE);
+	const Chunk chunk = { reinterpret_cast<const BYTE *>("x"), 1 };
+	CHECK_EQ(ReplaceResource(Path, RT_MANIFEST, MAKEINTRESOURCEW(1), 1031, &chunk, 1), S_FALSE);
+	CHECK(Test::ReadFile(Path) == file);
+	// Patching in place still works with a section after the resources
+	Test::WriteFile(Path, files[0].data(), files[0].size());
+	CHECK_EQ(Replace(1, "fits"), S_OK);
+	CheckImage("fits", "second");
+}
+
+TEST(KeepsMissingChecksumMissing)
+{
+	PEBuilder::Options options;
+	options.checksum = false;
+	const std::string original = PEBuilder::Build(SampleResources(), options);
+	Test::WriteFile(Path, original.data(), original.size());
+	CHECK_EQ(Replace(1, std::string(0x1800, 'b')), S_OK);
+	const std::string file = Test::ReadFile(Path);
+	DWORD checksum;
+	memcpy(&checksum, file.data() + PEBuilder::CheckSumOffset(file), sizeof checksum);
+	CHECK_EQ(checksum, 0u);
+}
+
+TEST(ChecksumCoversOddLengthsAndZeroPadding)
+{
+	// Pieces of odd lengths, and zero padding given as NULL data, as the
+	// manifest writer hands them over
+	const std::string original = PEBuilder::Build(SampleResources());
+	Test::WriteFile(Path, original.data(), original.size());
+	const Chunk pieces[] = { { reinterpret_cast<const BYTE *>("abc"), 3 }, { NULL, 5 }, { reinterpret_cast<const BYTE *>("defg"), 4 } };
+	CHECK_EQ(ReplaceResource(Path, RT_MANIFEST, MAKEINTRESOURCEW(1), 1033, pieces, _countof(pieces)), S_OK);
+	CheckImage(std::string("abc\0\0\0\0\0defg", 12), "second");
+	const std::string big(0x1801, 'b');
+	const Chunk grown[] = { { reinterpret_cast<const BYTE *>(big.data()), 0x1801 }, { NULL, 3 } };
+	CHECK_EQ(ReplaceResource(Path, RT_MANIFEST, MAKEINTRESOURCEW(1), 1033, grown, _countof(grown)), S_OK);
+	CheckImage(big + std::string(3, '\0'), "second");
+}
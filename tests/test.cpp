@@ -0,0 +1,167 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "test.h"
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+	struct Entry
+	{
+		const char *name;
+		Test::Function function;
+	};
+
+	std::vector<Entry> &Cases()
+	{
+		static std::vector<Entry> cases;
+		return cases;
+	}
+
+	int Failures = 0;
+
+	int Remove(const char *path, const struct stat *, int, struct FTW *)
+	{
+		return remove(path);
+	}
+
+	void RemoveTree(const char *path)
+	{
+		nftw(path, Remove, 16, FTW_DEPTH | FTW_PHYS);
+	}
+
+	void CreateFolders(const std::string &path)
+	{
+		for (size_t i = path.find('/', 1); i != std::string::npos; i = path.find('/', i + 1))
+			mkdir(path.substr(0, i).c_str(), 0755);
+	}
+}
+
+Test::Case::Case(const char *name, Function function)
+{
+	const Entry entry = { name, function };
+	Cases().push_back(entry);
+}
+
+void Test::Fail(const char *file, int line, const std::string &message)
+{
+	fprintf(stderr, "%s:%d: %s\n", file, line, message.c_str());
+	++Failures;
+}
+
+std::string Test::Quote(LPCWSTR s)
+{
+	if (s == NULL)
+		return "NULL";
+	std::string quoted = "\"";
+	for (; *s != L'\0'; ++s)
+	{
+		char text[8];
+		if (*s >= 0x20 && *s < 0x7F)
+			quoted += static_cast<char>(*s);
+		else
+			quoted.append(text, snprintf(text, sizeof text, "\\x%04X", *s));
+	}
+	return quoted + "\"";
+}
+
+void Test::WriteFile(LPCWSTR path, const void *data, size_t size)
+{
+	const std::string local = Shim::ToLocalPath(path);
+	CreateFolders(local);
+	FILE *const file = fopen(local.c_str(), "wb");
+	if (file == NULL || fwrite(data, 1, size, file) != size)
+	{
+		perror(local.c_str());
+		abort();
+	}
+	fclose(file);
+}
+
+void Test::WriteFile(LPCWSTR path, const char *text)
+{
+	WriteFile(path, text, strlen(text));
+}
+
+std::string Test::ReadFile(LPCWSTR path)
+{
+	std::string content;
+	if (FILE *const file = fopen(Shim::ToLocalPath(path).c_str(), "rb"))
+	{
+		char buffer[4096];
+		while (size_t n = fread(buffer, 1, sizeof buffer, file))
+			content.append(buffer, n);
+		fclose(file);
+	}
+	return content;
+}
+
+bool Test::FileExists(LPCWSTR path)
+{
+	struct stat st;
+	return stat(Shim::ToLocalPath(path).c_str(), &st) == 0;
+}
+
+// Runs all test cases, or those whose names are given on the command line
+int main(int argc, char *argv[])
+{
+	char root[] = "/tmp/manfred-test-XXXXXX";
+	if (mkdtemp(root) == NULL)
+	{
+		perror("mkdtemp");
+		return 2;
+	}
+	int count = 0;
+	const std::vector<Entry> &cases = Cases();
+	for (size_t i = 0; i < cases.size(); ++i)
+	{
+		bool selected = argc < 2;
+		for (int j = 1; j < argc; ++j)
+			if (strcmp(argv[j], cases[i].name) == 0)
+				selected = true;
+		if (!selected)
+			continue;
+		// Give each test case a fresh drive C: and registry
+		char folder[sizeof root + 16];
+		snprintf(folder, sizeof folder, "%s/%d", root, count++);
+		mkdir(folder, 0755);
+		Shim::SetRoot(folder);
+		Shim::ResetRegistry();
+		Shim::RemoveModules();
+		Shim::EnableSse2(true);
+		const int failures = Failures;
+		cases[i].function();
+		Shim::TakeOutput();
+		printf("%s %s\n", Failures == failures ? "PASS" : "FAIL", cases[i].name);
+	}
+	RemoveTree(root);
+	printf("%d test cases, %d failures\n", count, Failures);
+	return Failures != 0 || count == 0;
+}
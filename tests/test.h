@@ -0,0 +1,78 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// A minimal test framework: TEST() defines a test case which registers itself,
+// and CHECK() and its siblings report failures without ending the test case.
+// Each test executable runs with drive C: in an empty temporary folder.
+
+#pragma once
+
+#include <shlwapi.h>
+#include "win32/shim.h"
+#include <sstream>
+#include <string>
+
+namespace Test
+{
+	typedef void (*Function)();
+
+	struct Case
+	{
+		Case(const char *name, Function function);
+	};
+
+	void Fail(const char *file, int line, const std::string &message);
+	std::string Quote(LPCWSTR s);
+
+	// Creates a file below C:\ with the given content, along with its folders
+	void WriteFile(LPCWSTR path, const void *data, size_t size);
+	void WriteFile(LPCWSTR path, const char *text);
+	std::string ReadFile(LPCWSTR path);
+	bool FileExists(LPCWSTR path);
+
+	template<class T, class U>
+	void CheckEqual(const char *file, int line, const char *expr, const T &actual, const U &expected)
+	{
+		if (!(actual == expected))
+		{
+			std::ostringstream message;
+			message << expr << ": got " << actual << ", expected " << expected;
+			Fail(file, line, message.str());
+		}
+	}
+}
+
+#define TEST(name) \
+	static void name(); \
+	static Test::Case name##_case(#name, name); \
+	static void name()
+
+#define CHECK(cond) \
+	((cond) ? (void)0 : Test::Fail(__FILE__, __LINE__, "CHECK(" #cond ") failed"))
+
+#define CHECK_EQ(actual, expected) \
+	Test::CheckEqual(__FILE__, __LINE__, #actual, (actual), (expected))
+
+#define CHECK_STR(actual, expected) \
+	Test::CheckEqual(__FILE__, __LINE__, #actual, Test::Quote(actual), Test::Quote(expected))
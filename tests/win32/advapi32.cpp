@@ -0,0 +1,677 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// An in-memory registry, which behaves like the real one as far as the code
+// can tell: subkeys enumerate in case-insensitive order, values in the order
+// they have been created, keys have last write times, and notifications
+// fire on changes to the names or values below a watched key.
+
+#include "internal.h"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <stdlib.h>
+
+using namespace Shim;
+
+#define ERROR_BAD_PATHNAME 161L
+
+namespace
+{
+	int HandleToIndex(HKEY hKey)
+	{
+		return static_cast<int>(reinterpret_cast<ULONG_PTR>(hKey) - reinterpret_cast<ULONG_PTR>(HKEY_CLASSES_ROOT));
+	}
+
+	struct Value
+	{
+		WideString name;
+		DWORD type;
+		std::vector<BYTE> data;
+	};
+
+	struct Node
+	{
+		WideString name;
+		Node *parent;
+		std::vector<Node *> keys;
+		std::vector<Value> values;
+		FILETIME time;
+		bool deleted;
+		Node(LPCWSTR name, int len, Node *parent): name(name, name + len), parent(parent), time(GetCurrentFileTime()), deleted(false)
+		{
+			this->name.push_back(L'\0');
+		}
+		~Node()
+		{
+			for (size_t i = 0; i < keys.size(); ++i)
+				delete keys[i];
+		}
+	};
+
+	struct Handle
+	{
+		Node *node;
+	};
+
+	struct Watch
+	{
+		Handle *handle;
+		bool subtree;
+		DWORD filter;
+		HANDLE event;
+	};
+
+	pthread_mutex_t RegLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+	LONG CallCount;
+
+	struct Lock
+	{
+		Lock() { pthread_mutex_lock(&RegLock); CountRegistryCall(); }
+		~Lock() { pthread_mutex_unlock(&RegLock); }
+	};
+
+	// The predefined keys, by their low bits
+	const int PredefCount = 6;
+	Node *Roots[PredefCount];
+	Node *Overrides[PredefCount];
+	std::vector<Node *> Graveyard;
+	std::set<Handle *> Handles;
+	// Watches go by the node they watch, so a change looks up just those of
+	// the node and its ancestors
+	typedef std::multimap<const Node *, Watch> WatchMap;
+	WatchMap Watches;
+
+	int CompareNames(LPCWSTR p, int cchP, LPCWSTR q, int cchQ)
+	{
+		return CompareNoCase(p, cchP, q, cchQ);
+	}
+
+	size_t LowerBound(const Node *node, LPCWSTR name, int len)
+	{
+		size_t lower = 0;
+		size_t upper = node->keys.size();
+		while (lower < upper)
+		{
+			const size_t i = (lower + upper) / 2;
+			const WideString &s = node->keys[i]->name;
+			if (CompareNames(&s[0], static_cast<int>(s.size() - 1), name, len) < 0)
+				lower = i + 1;
+			else
+				upper = i;
+		}
+		return lower;
+	}
+
+	Node *FindChild(const Node *node, LPCWSTR name, int len)
+	{
+		const size_t i = LowerBound(node, name, len);
+		if (i < node->keys.size())
+		{
+			const WideString &s = node->keys[i]->name;
+			if (CompareNames(&s[0], static_cast<int>(s.size() - 1), name, len) == 0)
+				return node->keys[i];
+		}
+		return NULL;
+	}
+
+	Node *GetRoot(int index)
+	{
+		if (Roots[index] == NULL)
+			Roots[index] = new Node(L"", 0, NULL);
+		return Roots[index];
+	}
+
+	// Signals and drops the watches for which a change to node matters
+	void Notify(const Node *node, DWORD kind)
+	{
+		for (const Node *watched = node; watched != NULL; watched = watched->parent)
+		{
+			std::pair<WatchMap::iterator, WatchMap::iterator> range = Watches.equal_range(watched);
+			while (range.first != range.second)
+			{
+				const Watch &w = range.first->second;
+				if ((w.filter & kind) && (watched == node || w.subtree))
+				{
+					SetEvent(w.event);
+					Watches.erase(range.first++);
+				}
+				else
+				{
+					++range.first;
+				}
+			}
+		}
+	}
+
+	void Touch(Node *node, DWORD kind)
+	{
+		node->time = GetCurrentFileTime();
+		Notify(node, kind);
+	}
+
+	// Watched keys which go away signal as well
+	void MarkDeleted(Node *node)
+	{
+		node->deleted = true;
+		std::pair<WatchMap::iterator, WatchMap::iterator> range = Watches.equal_range(node);
+		for (WatchMap::iterator it = range.first; it != range.second; ++it)
+			SetEvent(it->second.event);
+		Watches.erase(range.first, range.second);
+		for (size_t j = 0; j < node->keys.size(); ++j)
+			MarkDeleted(node->keys[j]);
+	}
+
+	void RemoveChild(Node *parent, size_t index)
+	{
+		Node *const node = parent->keys[index];
+		parent->keys.erase(parent->keys.begin() + index);
+		MarkDeleted(node);
+		node->parent = NULL;
+		Graveyard.push_back(node);
+		Touch(parent, REG_NOTIFY_CHANGE_NAME);
+	}
+
+	LSTATUS Resolve(HKEY hKey, Node **node)
+	{
+		const ULONG_PTR value = reinterpret_cast<ULONG_PTR>(hKey);
+		if (value >= reinterpret_cast<ULONG_PTR>(HKEY_CLASSES_ROOT) &&
+			value < reinterpret_cast<ULONG_PTR>(HKEY_CLASSES_ROOT) + PredefCount)
+		{
+			const int index = static_cast<int>(value - reinterpret_cast<ULONG_PTR>(HKEY_CLASSES_ROOT));
+			if (Overrides[index] != NULL)
+			{
+				*node = Overrides[index];
+			}
+			else if (hKey == HKEY_CLASSES_ROOT)
+			{
+				// Stands for the machine's classes, which is what matters here
+				Node *p = GetRoot(HandleToIndex(HKEY_LOCAL_MACHINE));
+				LPCWSTR const names[] = { L"Software", L"Classes" };
+				for (int i = 0; i < 2; ++i)
+				{
+					const int len = lstrlenW(names[i]);
+					Node *q = FindChild(p, names[i], len);
+					if (q == NULL)
+					{
+						q = new Node(names[i], len, p);
+						p->keys.insert(p->keys.begin() + LowerBound(p, names[i], len), q);
+					}
+					p = q;
+				}
+				*node = p;
+			}
+			else
+			{
+				*node = GetRoot(index);
+			}
+			return ERROR_SUCCESS;
+		}
+		Handle *const handle = reinterpret_cast<Handle *>(hKey);
+		if (Handles.find(handle) == Handles.end())
+			return ERROR_INVALID_HANDLE;
+		if (handle->node->deleted)
+			return ERROR_KEY_DELETED;
+		*node = handle->node;
+		return ERROR_SUCCESS;
+	}
+
+	HKEY NewHandle(Node *node)
+	{
+		Handle *const handle = new Handle;
+		handle->node = node;
+		Handles.insert(handle);
+		return reinterpret_cast<HKEY>(handle);
+	}
+
+	// Walks a path of subkeys, creating them on the way if so desired
+	LSTATUS Walk(Node *node, LPCWSTR path, bool create, Node **result, bool *created)
+	{
+		if (created)
+			*created = false;
+		if (path != NULL)
+		{
+			if (*path == L'\\')
+				return ERROR_BAD_PATHNAME;
+			while (*path != L'\0')
+			{
+				LPCWSTR end = path;
+				while (*end != L'\0' && *end != L'\\')
+					++end;
+				const int len = static_cast<int>(end - path);
+				if (len > 255)
+					return ERROR_INVALID_PARAMETER;
+				if (len != 0)
+				{
+					Node *child = FindChild(node, path, len);
+					if (child == NULL)
+					{
+						if (!create)
+							return ERROR_FILE_NOT_FOUND;
+						child = new Node(path, len, node);
+						node->keys.insert(node->keys.begin() + LowerBound(node, path, len), child);
+						Touch(node, REG_NOTIFY_CHANGE_NAME);
+						if (created)
+							*created = true;
+					}
+					node = child;
+				}
+				path = *end ? end + 1 : end;
+			}
+		}
+		*result = node;
+		return ERROR_SUCCESS;
+	}
+
+	Value *FindValue(Node *node, LPCWSTR name)
+	{
+		if (name == NULL)
+			name = L"";
+		const int len = lstrlenW(name);
+		for (size_t i = 0; i < node->values.size(); ++i)
+		{
+			const WideString &s = node->values[i].name;
+			if (CompareNames(&s[0], static_cast<int>(s.size() - 1), name, len) == 0)
+				return &node->values[i];
+		}
+		return NULL;
+	}
+
+	void DeleteTree(Node *node)
+	{
+		while (!node->keys.empty())
+			RemoveChild(node, node->keys.size() - 1);
+		if (!node->values.empty())
+		{
+			node->values.clear();
+			Touch(node, REG_NOTIFY_CHANGE_LAST_SET);
+		}
+	}
+}
+
+void Shim::CountRegistryCall()
+{
+	__sync_add_and_fetch(&CallCount, 1);
+}
+
+LONG Shim::GetRegistryCallCount()
+{
+	return CallCount;
+}
+
+void Shim::ResetRegistry()
+{
+	pthread_mutex_lock(&RegLock);
+	for (int i = 0; i < PredefCount; ++i)
+	{
+		delete Roots[i];
+		Roots[i] = NULL;
+		Overrides[i] = NULL;
+	}
+	for (size_t i = 0; i < Graveyard.size(); ++i)
+		delete Graveyard[i];
+	Graveyard.clear();
+	for (std::set<Handle *>::iterator it = Handles.begin(); it != Handles.end(); ++it)
+		delete *it;
+	Handles.clear();
+	Watches.clear();
+	pthread_mutex_unlock(&RegLock);
+}
+
+LONG Shim::GetOpenKeyCount()
+{
+	pthread_mutex_lock(&RegLock);
+	const LONG n = static_cast<LONG>(Handles.size());
+	pthread_mutex_unlock(&RegLock);
+	return n;
+}
+
+extern "C" LSTATUS WINAPI RegOpenKeyExW(HKEY hKey, LPCWSTR path, DWORD, REGSAM, PHKEY result)
+{
+	Lock lock;
+	Node *node;
+	if (LSTATUS r = Resolve(hKey, &node))
+		return r;
+	if (LSTATUS r = Walk(node, path, false, &node, NULL))
+		return r;
+	*result = NewHandle(node);
+	return ERROR_SUCCESS;
+}
+
+extern "C" LSTATUS WINAPI RegCreateKeyExW(HKEY hKey, LPCWSTR path, DWORD, LPWSTR, DWORD, REGSAM, void *, PHKEY result, LPDWORD disposition)
+{
+	Lock lock;
+	Node *node;
+	if (LSTATUS r = Resolve(hKey, &node))
+		return r;
+	bool created;
+	if (LSTATUS r = Walk(node, path, true, &node, &created))
+		return r;
+	*result = NewHandle(node);
+	if (disposition)
+		*disposition = created ? REG_CREATED_NEW_KEY : REG_OPENED_EXISTING_KEY;
+	return ERROR_SUCCESS;
+}
+
+extern "C" LSTATUS WINAPI RegCreateKeyW(HKEY hKey, LPCWSTR path, PHKEY result)
+{
+	return RegCreateKeyExW(hKey, path, 0, NULL, 0, KEY_ALL_ACCESS, NULL, result, NULL);
+}
+
+extern "C" LSTATUS WINAPI RegCloseKey(HKEY hKey)
+{
+	Lock lock;
+	Node *node;
+	if (Resolve(hKey, &node) == ERROR_INVALID_HANDLE)
+		return ERROR_INVALID_HANDLE;
+	Handle *const handle = reinterpret_cast<Handle *>(hKey);
+	if (Handles.erase(handle) == 0)
+		return ERROR_SUCCESS; // a predefined key
+	// Pending notifications fire as the handle goes away
+	std::pair<WatchMap::iterator, WatchMap::iterator> range = Watches.equal_range(handle->node);
+	while (range.first != range.second)
+	{
+		if (range.first->second.handle == handle)
+		{
+			SetEvent(range.first->second.event);
+			Watches.erase(range.first++);
+		}
+		else
+		{
+			++range.first;
+		}
+	}
+	delete handle;
+	return ERROR_SUCCESS;
+}
+
+extern "C" LSTATUS WINAPI RegQueryInfoKeyW(HKEY hKey, LPWSTR cls, LPDWORD cchClass, LPDWORD, LPDWORD cSubKeys, LPDWORD cchMaxSubKey, LPDWORD cchMaxClass,
+	LPDWORD cValues, LPDWORD cchMaxValueName, LPDWORD cbMaxValue, LPDWORD cbSecurityDescriptor, LPFILETIME time)
+{
+	Lock lock;
+	Node *node;
+	if (LSTATUS r = Resolve(hKey, &node))
+		return r;
+	if (cls && cchClass && *cchClass)
+		*cls = L'\0';
+	if (cchClass)
+		*cchClass = 0;
+	DWORD maxKey = 0;
+	for (size_t i = 0; i < node->keys.size(); ++i)
+		maxKey = std::max(maxKey, static_cast<DWORD>(node->keys[i]->name.size() - 1));
+	DWORD maxName = 0;
+	DWORD maxData = 0;
+	for (size_t i = 0; i < node->values.size(); ++i)
+	{
+		maxName = std::max(maxName, static_cast<DWORD>(node->values[i].name.size() - 1));
+		maxData = std::max(maxData, static_cast<DWORD>(node->values[i].data.size()));
+	}
+	if (cSubKeys)
+		*cSubKeys = static_cast<DWORD>(node->keys.size());
+	if (cchMaxSubKey)
+		*cchMaxSubKey = maxKey;
+	if (cchMaxClass)
+		*cchMaxClass = 0;
+	if (cValues)
+		*cValues = static_cast<DWORD>(node->values.size());
+	if (cchMaxValueName)
+		*cchMaxValueName = maxName;
+	if (cbMaxValue)
+		*cbMaxValue = maxData;
+	if (cbSecurityDescriptor)
+		*cbSecurityDescriptor = 0;
+	if (time)
+		*time = node->time;
+	return ERROR_SUCCESS;
+}
+
+extern "C" LSTATUS WINAPI RegEnumKeyExW(HKEY hKey, DWORD index, LPWSTR name, LPDWORD cchName, LPDWORD, LPWSTR cls, LPDWORD cchClass, LPFILETIME time)
+{
+	Lock lock;
+	Node *node;
+	if (LSTATUS r = Resolve(hKey, &node))
+		return r;
+	if (index >= node->keys.size())
+		return ERROR_NO_MORE_ITEMS;
+	const Node *const key = node->keys[index];
+	const DWORD len = static_cast<DWORD>(key->name.size() - 1);
+	if (len >= *cchName)
+		return ERROR_MORE_DATA;
+	std::copy(key->name.begin(), key->name.end(), name);
+	*cchName = len;
+	if (cls && cchClass && *cchClass)
+		*cls = L'\0';
+	if (cchClass)
+		*cchClass = 0;
+	if (time)
+		*time = key->time;
+	return ERROR_SUCCESS;
+}
+
+extern "C" LSTATUS WINAPI RegEnumValueW(HKEY hKey, DWORD index, LPWSTR name, LPDWORD cchName, LPDWORD, LPDWORD type, LPBYTE data, LPDWORD cbData)
+{
+	Lock lock;
+	Node *node;
+	if (LSTATUS r = Resolve(hKey, &node))
+		return r;
+	if (index >= node->values.size())
+		return ERROR_NO_MORE_ITEMS;
+	const Value &value = node->values[index];
+	const DWORD len = static_cast<DWORD>(value.name.size() - 1);
+	if (len >= *cchName)
+		return ERROR_MORE_DATA;
+	std::copy(value.name.begin(), value.name.end(), name);
+	*cchName = len;
+	if (type)
+		*type = value.type;
+	if (cbData)
+	{
+		const DWORD cb = static_cast<DWORD>(value.data.size());
+		const DWORD available = *cbData;
+		*cbData = cb;
+		if (data != NULL)
+		{
+			if (cb > available)
+				return ERROR_MORE_DATA;
+			std::copy(value.data.begin(), value.data.end(), data);
+		}
+	}
+	return ERROR_SUCCESS;
+}
+
+extern "C" LSTATUS WINAPI RegQueryValueExW(HKEY hKey, LPCWSTR name, LPDWORD, LPDWORD type, LPBYTE data, LPDWORD cbData)
+{
+	Lock lock;
+	Node *node;
+	if (LSTATUS r = Resolve(hKey, &node))
+		return r;
+	const Value *const value = FindValue(node, name);
+	if (value == NULL)
+		return ERROR_FILE_NOT_FOUND;
+	if (type)
+		*type = value->type;
+	if (cbData)
+	{
+		const DWORD cb = static_cast<DWORD>(value->data.size());
+		const DWORD available = *cbData;
+		*cbData = cb;
+		if (data != NULL)
+		{
+			if (cb > available)
+				return ERROR_MORE_DATA;
+			std::copy(value->data.begin(), value->data.end(), data);
+		}
+	}
+	return ERROR_SUCCESS;
+}
+
+extern "C" LSTATUS WINAPI RegSetValueExW(HKEY hKey, LPCWSTR name, DWORD, DWORD type, const BYTE *data, DWORD cb)
+{
+	Lock lock;
+	Node *node;
+	if (LSTATUS r = Resolve(hKey, &node))
+		return r;
+	if (name == NULL)
+		name = L"";
+	Value *value = FindValue(node, name);
+	if (value == NULL)
+	{
+		node->values.push_back(Value());
+		value = &node->values.back();
+		value->name.assign(name, name + lstrlenW(name) + 1);
+	}
+	value->type = type;
+	value->data.assign(data, data + cb);
+	Touch(node, REG_NOTIFY_CHANGE_LAST_SET);
+	return ERROR_SUCCESS;
+}
+
+extern "C" LSTATUS WINAPI RegDeleteValueW(HKEY hKey, LPCWSTR name)
+{
+	Lock lock;
+	Node *node;
+	if (LSTATUS r = Resolve(hKey, &node))
+		return r;
+	Value *const value = FindValue(node, name);
+	if (value == NULL)
+		return ERROR_FILE_NOT_FOUND;
+	node->values.erase(node->values.begin() + (value - &node->values[0]));
+	Touch(node, REG_NOTIFY_CHANGE_LAST_SET);
+	return ERROR_SUCCESS;
+}
+
+extern "C" LSTATUS WINAPI RegDeleteKeyW(HKEY hKey, LPCWSTR path)
+{
+	Lock lock;
+	Node *node;
+	if (LSTATUS r = Resolve(hKey, &node))
+		return r;
+	if (LSTATUS r = Walk(node, path, false, &node, NULL))
+		return r;
+	if (node->parent == NULL)
+		return ERROR_ACCESS_DENIED;
+	if (!node->keys.empty())
+		return ERROR_ACCESS_DENIED;
+	Node *const parent = node->parent;
+	RemoveChild(parent, std::find(parent->keys.begin(), parent->keys.end(), node) - parent->keys.begin());
+	return ERROR_SUCCESS;
+}
+
+extern "C" LSTATUS WINAPI RegDeleteTreeW(HKEY hKey, LPCWSTR path)
+{
+	Lock lock;
+	Node *node;
+	if (LSTATUS r = Resolve(hKey, &node))
+		return r;
+	if (path == NULL)
+	{
+		// Empties the key but leaves it in place
+		DeleteTree(node);
+		return ERROR_SUCCESS;
+	}
+	if (LSTATUS r = Walk(node, path, false, &node, NULL))
+		return r;
+	Node *const parent = node->parent;
+	if (parent == NULL)
+		return ERROR_ACCESS_DENIED;
+	RemoveChild(parent, std::find(parent->keys.begin(), parent->keys.end(), node) - parent->keys.begin());
+	return ERROR_SUCCESS;
+}
+
+extern "C" LSTATUS WINAPI SHDeleteKeyW(HKEY hKey, LPCWSTR path)
+{
+	return RegDeleteTreeW(hKey, path && *path ? path : NULL);
+}
+
+extern "C" LSTATUS WINAPI RegOverridePredefKey(HKEY hKey, HKEY hNewKey)
+{
+	Lock lock;
+	const int index = HandleToIndex(hKey);
+	if (index < 0 || index >= PredefCount)
+		return ERROR_INVALID_HANDLE;
+	if (hNewKey == NULL)
+	{
+		Overrides[index] = NULL;
+		return ERROR_SUCCESS;
+	}
+	Node *node;
+	if (LSTATUS r = Resolve(hNewKey, &node))
+		return r;
+	Overrides[index] = node;
+	return ERROR_SUCCESS;
+}
+
+extern "C" LSTATUS WINAPI RegNotifyChangeKeyValue(HKEY hKey, BOOL subtree, DWORD filter, HANDLE event, BOOL async)
+{
+	Lock lock;
+	Node *node;
+	if (LSTATUS r = Resolve(hKey, &node))
+		return r;
+	Handle *const handle = reinterpret_cast<Handle *>(hKey);
+	if (!async || event == NULL || Handles.find(handle) == Handles.end())
+		return ERROR_INVALID_PARAMETER;
+	Watch w = { handle, subtree != FALSE, filter, event };
+	Watches.insert(std::make_pair(handle->node, w));
+	return ERROR_SUCCESS;
+}
+
+// Security, which grants membership in whatever group is asked about
+
+extern "C" BOOL WINAPI AllocateAndInitializeSid(SID_IDENTIFIER_AUTHORITY *, BYTE, DWORD, DWORD, DWORD, DWORD, DWORD, DWORD, DWORD, DWORD, PSID *sid)
+{
+	*sid = calloc(1, 16);
+	return *sid != NULL;
+}
+
+extern "C" BOOL WINAPI CheckTokenMembership(HANDLE, PSID, BOOL *member)
+{
+	*member = TRUE;
+	return TRUE;
+}
+
+extern "C" PVOID WINAPI FreeSid(PSID sid)
+{
+	free(sid);
+	return NULL;
+}
+
+extern "C" BOOL WINAPI CryptReleaseContext(HCRYPTPROV, DWORD)
+{
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI CryptDestroyKey(HCRYPTKEY)
+{
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI CertCloseStore(HCERTSTORE, DWORD)
+{
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI DestroyWindow(HWND)
+{
+	return TRUE;
+}
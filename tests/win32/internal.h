@@ -0,0 +1,70 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// What the parts of the Win32 shim share among themselves
+
+#pragma once
+
+#include "shim.h"
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+namespace Shim
+{
+	typedef std::vector<WCHAR> WideString; // always null-terminated
+
+	// Kernel objects which HANDLEs point to. Waitable ones tell whether they
+	// are signaled, and what a satisfied wait takes from them, while the
+	// caller holds WaitLock.
+	struct Object
+	{
+		LONG refs;
+		Object(): refs(1) { }
+		virtual ~Object() { }
+		virtual bool isSignaled() { return false; }
+		virtual void satisfyWait() { }
+	};
+
+	void ReleaseObject(Object *object);
+
+	extern pthread_mutex_t WaitLock;
+	extern pthread_cond_t WaitCond;
+
+	// Fails with the given error, for the functions which return a BOOL
+	BOOL Fail(DWORD error);
+	DWORD ErrorFromErrno(int error);
+
+	WCHAR UpCase(WCHAR c);
+	int CompareNoCase(LPCWSTR p, int cchP, LPCWSTR q, int cchQ);
+	WideString Widen(const char *utf8);
+	std::string Narrow(LPCWSTR wide);
+	bool MatchSpec(LPCWSTR name, LPCWSTR spec, int cchSpec);
+	WideString GetFullPath(LPCWSTR path);
+
+	FILETIME GetCurrentFileTime();
+	FILETIME FileTimeFromUnix(long long seconds, long nanoseconds);
+
+	void CountRegistryCall();
+}
@@ -0,0 +1,1723 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "internal.h"
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace Shim;
+
+static __thread DWORD LastError;
+
+pthread_mutex_t Shim::WaitLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t Shim::WaitCond = PTHREAD_COND_INITIALIZER;
+
+namespace
+{
+	struct Lock
+	{
+		pthread_mutex_t &mutex;
+		explicit Lock(pthread_mutex_t &mutex): mutex(mutex) { pthread_mutex_lock(&mutex); }
+		~Lock() { pthread_mutex_unlock(&mutex); }
+	};
+
+	pthread_mutex_t StateLock = PTHREAD_MUTEX_INITIALIZER;
+	std::string Root = "/tmp";
+	WideString CurrentDirectory = Widen("C:\\");
+	WideString ModuleFileName = Widen("C:\\manfred.exe");
+	WideString CommandLine = Widen("manfred");
+	bool Sse2 = true;
+
+	pthread_mutex_t OutputLock = PTHREAD_MUTEX_INITIALIZER;
+	std::string Output;
+}
+
+BOOL Shim::Fail(DWORD error)
+{
+	LastError = error;
+	return FALSE;
+}
+
+DWORD Shim::ErrorFromErrno(int error)
+{
+	switch (error)
+	{
+	case ENOENT:
+		return ERROR_FILE_NOT_FOUND;
+	case ENOTDIR:
+		return ERROR_PATH_NOT_FOUND;
+	case EACCES:
+	case EPERM:
+	case EISDIR:
+		return ERROR_ACCESS_DENIED;
+	case EEXIST:
+		return ERROR_FILE_EXISTS;
+	case ENOMEM:
+		return ERROR_NOT_ENOUGH_MEMORY;
+	case EBADF:
+		return ERROR_INVALID_HANDLE;
+	case EINVAL:
+		return ERROR_INVALID_PARAMETER;
+	}
+	return ERROR_INVALID_FUNCTION;
+}
+
+void Shim::ReleaseObject(Object *object)
+{
+	if (__sync_sub_and_fetch(&object->refs, 1) == 0)
+		delete object;
+}
+
+// Strings
+
+WCHAR Shim::UpCase(WCHAR c)
+{
+	// Covers Latin-1, which is all the tests need
+	if ((c >= L'a' && c <= L'z') || (c >= 0xE0 && c <= 0xFE && c != 0xF7))
+		return c - 0x20;
+	if (c == 0xFF)
+		return 0x178;
+	return c;
+}
+
+int Shim::CompareNoCase(LPCWSTR p, int cchP, LPCWSTR q, int cchQ)
+{
+	const int n = cchP < cchQ ? cchP : cchQ;
+	for (int i = 0; i < n; ++i)
+	{
+		const WCHAR a = UpCase(p[i]);
+		const WCHAR b = UpCase(q[i]);
+		if (a != b)
+			return a < b ? -1 : 1;
+	}
+	return cchP < cchQ ? -1 : cchP > cchQ ? 1 : 0;
+}
+
+WideString Shim::Widen(const char *utf8)
+{
+	WideString s;
+	const int n = MultiByteToWideChar(CP_UTF8, 0, utf8, -1, NULL, 0);
+	s.resize(n ? n : 1);
+	MultiByteToWideChar(CP_UTF8, 0, utf8, -1, &s[0], n);
+	return s;
+}
+
+std::string Shim::Narrow(LPCWSTR wide)
+{
+	std::string s;
+	const int n = WideCharToMultiByte(CP_UTF8, 0, wide, -1, NULL, 0, NULL, NULL);
+	s.resize(n ? n : 1);
+	WideCharToMultiByte(CP_UTF8, 0, wide, -1, &s[0], n, NULL, NULL);
+	s.resize(n ? n - 1 : 0);
+	return s;
+}
+
+extern "C" int WINAPI lstrlenW(LPCWSTR s)
+{
+	if (s == NULL)
+		return 0;
+	LPCWSTR p = s;
+	while (*p)
+		++p;
+	return static_cast<int>(p - s);
+}
+
+extern "C" int WINAPI lstrlenA(LPCSTR s)
+{
+	return s ? static_cast<int>(strlen(s)) : 0;
+}
+
+extern "C" LPWSTR WINAPI lstrcpyW(LPWSTR dst, LPCWSTR src)
+{
+	LPWSTR p = dst;
+	while ((*p++ = *src++) != L'\0')
+		continue;
+	return dst;
+}
+
+extern "C" LPWSTR WINAPI lstrcpynW(LPWSTR dst, LPCWSTR src, int n)
+{
+	if (n <= 0)
+		return dst;
+	int i = 0;
+	while (i < n - 1 && src[i] != L'\0')
+	{
+		dst[i] = src[i];
+		++i;
+	}
+	dst[i] = L'\0';
+	return dst;
+}
+
+extern "C" int WINAPI lstrcmpW(LPCWSTR p, LPCWSTR q)
+{
+	while (*p && *p == *q)
+		++p, ++q;
+	return *p < *q ? -1 : *p > *q ? 1 : 0;
+}
+
+extern "C" int WINAPI lstrcmpiW(LPCWSTR p, LPCWSTR q)
+{
+	return CompareNoCase(p, lstrlenW(p), q, lstrlenW(q));
+}
+
+extern "C" int WINAPI CompareStringOrdinal(LPCWSTR p, int cchP, LPCWSTR q, int cchQ, BOOL bIgnoreCase)
+{
+	if (cchP < 0)
+		cchP = lstrlenW(p);
+	if (cchQ < 0)
+		cchQ = lstrlenW(q);
+	int cmp;
+	if (bIgnoreCase)
+	{
+		cmp = CompareNoCase(p, cchP, q, cchQ);
+	}
+	else
+	{
+		const int n = cchP < cchQ ? cchP : cchQ;
+		int i = 0;
+		while (i < n && p[i] == q[i])
+			++i;
+		cmp = i < n ? (p[i] < q[i] ? -1 : 1) : cchP < cchQ ? -1 : cchP > cchQ ? 1 : 0;
+	}
+	return CSTR_EQUAL + cmp;
+}
+
+// Code page 1252 differs from Latin-1 in the range from 0x80 to 0x9F
+static const WCHAR Cp1252[32] =
+{
+	0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+	0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+};
+
+extern "C" int WINAPI MultiByteToWideChar(UINT codepage, DWORD flags, LPCSTR src, int cb, LPWSTR dst, int cch)
+{
+	if (src == NULL || cb == 0 || cch < 0)
+		return Fail(ERROR_INVALID_PARAMETER);
+	if (cb < 0)
+		cb = static_cast<int>(strlen(src)) + 1;
+	const BYTE *p = reinterpret_cast<const BYTE *>(src);
+	const BYTE *const end = p + cb;
+	int n = 0;
+	while (p < end)
+	{
+		WCHAR units[2];
+		int count = 1;
+		const BYTE c = *p++;
+		if (codepage != CP_UTF8)
+		{
+			units[0] = c >= 0x80 && c < 0xA0 ? Cp1252[c - 0x80] : c;
+		}
+		else if (c < 0x80)
+		{
+			units[0] = c;
+		}
+		else
+		{
+			int more = c >= 0xF0 && c < 0xF5 ? 3 : c >= 0xE0 ? 2 : c >= 0xC2 && c < 0xE0 ? 1 : -1;
+			DWORD u = more > 0 ? c & (0x3F >> more) : 0;
+			while (more > 0 && p < end && (*p & 0xC0) == 0x80)
+			{
+				u = u << 6 | (*p++ & 0x3F);
+				--more;
+			}
+			if (more != 0 || (u >= 0xD800 && u < 0xE000) || u > 0x10FFFF ||
+				(c == 0xE0 && u < 0x800) || (c == 0xF0 && u < 0x10000))
+			{
+				if (flags & MB_ERR_INVALID_CHARS)
+					return Fail(1113); // ERROR_NO_UNICODE_TRANSLATION
+				u = 0xFFFD;
+			}
+			if (u >= 0x10000)
+			{
+				units[0] = static_cast<WCHAR>(0xD800 + ((u - 0x10000) >> 10));
+				units[1] = static_cast<WCHAR>(0xDC00 + ((u - 0x10000) & 0x3FF));
+				count = 2;
+			}
+			else
+			{
+				units[0] = static_cast<WCHAR>(u);
+			}
+		}
+		if (cch != 0)
+		{
+			if (n + count > cch)
+				return Fail(ERROR_INSUFFICIENT_BUFFER);
+			for (int i = 0; i < count; ++i)
+				dst[n + i] = units[i];
+		}
+		n += count;
+	}
+	return n;
+}
+
+extern "C" int WINAPI WideCharToMultiByte(UINT codepage, DWORD, LPCWSTR src, int cch, LPSTR dst, int cb, LPCSTR defaultChar, BOOL *usedDefaultChar)
+{
+	if (src == NULL || cch == 0 || cb < 0)
+		return Fail(ERROR_INVALID_PARAMETER);
+	if (cch < 0)
+		cch = lstrlenW(src) + 1;
+	if (usedDefaultChar)
+		*usedDefaultChar = FALSE;
+	LPCWSTR p = src;
+	LPCWSTR const end = p + cch;
+	int n = 0;
+	while (p < end)
+	{
+		char bytes[4];
+		int count = 1;
+		DWORD u = *p++;
+		if (codepage != CP_UTF8)
+		{
+			char c = defaultChar ? *defaultChar : '?';
+			if (u < 0x80 || (u >= 0xA0 && u < 0x100))
+			{
+				c = static_cast<char>(u);
+			}
+			else
+			{
+				const WCHAR *const q = std::find(Cp1252, Cp1252 + 32, static_cast<WCHAR>(u));
+				if (q < Cp1252 + 32)
+					c = static_cast<char>(0x80 + (q - Cp1252));
+				else if (usedDefaultChar)
+					*usedDefaultChar = TRUE;
+			}
+			bytes[0] = c;
+		}
+		else
+		{
+			if (u >= 0xD800 && u < 0xDC00 && p < end && *p >= 0xDC00 && *p < 0xE000)
+				u = 0x10000 + ((u - 0xD800) << 10) + (*p++ - 0xDC00);
+			else if (u >= 0xD800 && u < 0xE000)
+				u = 0xFFFD;
+			if (u < 0x80)
+			{
+				bytes[0] = static_cast<char>(u);
+			}
+			else if (u < 0x800)
+			{
+				bytes[0] = static_cast<char>(0xC0 | u >> 6);
+				bytes[1] = static_cast<char>(0x80 | (u & 0x3F));
+				count = 2;
+			}
+			else if (u < 0x10000)
+			{
+				bytes[0] = static_cast<char>(0xE0 | u >> 12);
+				bytes[1] = static_cast<char>(0x80 | (u >> 6 & 0x3F));
+				bytes[2] = static_cast<char>(0x80 | (u & 0x3F));
+				count = 3;
+			}
+			else
+			{
+				bytes[0] = static_cast<char>(0xF0 | u >> 18);
+				bytes[1] = static_cast<char>(0x80 | (u >> 12 & 0x3F));
+				bytes[2] = static_cast<char>(0x80 | (u >> 6 & 0x3F));
+				bytes[3] = static_cast<char>(0x80 | (u & 0x3F));
+				count = 4;
+			}
+		}
+		if (cb != 0)
+		{
+			if (n + count > cb)
+				return Fail(ERROR_INSUFFICIENT_BUFFER);
+			memcpy(dst + n, bytes, count);
+		}
+		n += count;
+	}
+	return n;
+}
+
+extern "C" int WINAPI MulDiv(int a, int b, int c)
+{
+	if (c == 0)
+		return -1;
+	long long product = static_cast<long long>(a) * b;
+	// Round half away from zero
+	const long long half = (c < 0 ? -static_cast<long long>(c) : c) / 2;
+	long long quotient = ((product < 0) != (c < 0) ? product - (product < 0 ? half : -half) : product + (product < 0 ? -half : half)) / c;
+	if (quotient > 0x7FFFFFFF || quotient < -0x7FFFFFFFLL - 1)
+		return -1;
+	return static_cast<int>(quotient);
+}
+
+// Errors and process
+
+extern "C" DWORD WINAPI GetLastError()
+{
+	return LastError;
+}
+
+extern "C" void WINAPI SetLastError(DWORD error)
+{
+	LastError = error;
+}
+
+extern "C" void WINAPI ExitProcess(UINT code)
+{
+	exit(static_cast<int>(code));
+}
+
+extern "C" LPWSTR WINAPI GetCommandLineW()
+{
+	return &CommandLine[0];
+}
+
+extern "C" DWORD WINAPI GetCurrentThreadId()
+{
+	return static_cast<DWORD>(syscall(SYS_gettid));
+}
+
+extern "C" DWORD WINAPI GetCurrentProcessId()
+{
+	return static_cast<DWORD>(getpid());
+}
+
+extern "C" void WINAPI GetSystemInfo(SYSTEM_INFO *si)
+{
+	memset(si, 0, sizeof *si);
+	si->wProcessorArchitecture = 9; // PROCESSOR_ARCHITECTURE_AMD64
+	si->dwPageSize = static_cast<DWORD>(sysconf(_SC_PAGESIZE));
+	si->dwNumberOfProcessors = static_cast<DWORD>(sysconf(_SC_NPROCESSORS_ONLN));
+	si->dwAllocationGranularity = 0x10000;
+}
+
+extern "C" BOOL WINAPI IsProcessorFeaturePresent(DWORD feature)
+{
+	return feature == PF_XMMI64_INSTRUCTIONS_AVAILABLE && Sse2;
+}
+
+extern "C" BOOL WINAPI QueryPerformanceFrequency(LARGE_INTEGER *li)
+{
+	li->QuadPart = 10000000;
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI QueryPerformanceCounter(LARGE_INTEGER *li)
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	li->QuadPart = static_cast<LONGLONG>(ts.tv_sec) * 10000000 + ts.tv_nsec / 100;
+	return TRUE;
+}
+
+FILETIME Shim::FileTimeFromUnix(long long seconds, long nanoseconds)
+{
+	const ULONGLONG ticks = static_cast<ULONGLONG>(seconds + 11644473600LL) * 10000000 + nanoseconds / 100;
+	FILETIME ft;
+	ft.dwLowDateTime = static_cast<DWORD>(ticks);
+	ft.dwHighDateTime = static_cast<DWORD>(ticks >> 32);
+	return ft;
+}
+
+FILETIME Shim::GetCurrentFileTime()
+{
+	timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return FileTimeFromUnix(ts.tv_sec, ts.tv_nsec);
+}
+
+extern "C" void WINAPI GetSystemTimeAsFileTime(LPFILETIME ft)
+{
+	*ft = GetCurrentFileTime();
+}
+
+extern "C" LONG WINAPI CompareFileTime(const FILETIME *a, const FILETIME *b)
+{
+	if (a->dwHighDateTime != b->dwHighDateTime)
+		return a->dwHighDateTime < b->dwHighDateTime ? -1 : 1;
+	if (a->dwLowDateTime != b->dwLowDateTime)
+		return a->dwLowDateTime < b->dwLowDateTime ? -1 : 1;
+	return 0;
+}
+
+// Heaps keep track of their blocks, so HeapDestroy() can free them all
+
+namespace
+{
+	struct Block
+	{
+		struct Heap *heap;
+		Block *prev;
+		Block *next;
+		SIZE_T size;
+	};
+
+	struct Heap
+	{
+		pthread_mutex_t mutex;
+		Block *first;
+		Heap(): first(NULL) { pthread_mutex_init(&mutex, NULL); }
+		~Heap() { pthread_mutex_destroy(&mutex); }
+		void link(Block *block)
+		{
+			Lock lock(mutex);
+			block->heap = this;
+			block->prev = NULL;
+			block->next = first;
+			if (first)
+				first->prev = block;
+			first = block;
+		}
+		void unlink(Block *block)
+		{
+			Lock lock(mutex);
+			if (block->prev)
+				block->prev->next = block->next;
+			else
+				first = block->next;
+			if (block->next)
+				block->next->prev = block->prev;
+		}
+	};
+
+	C_ASSERT(sizeof(Block) % 16 == 0);
+
+	Heap ProcessHeap;
+
+	Block *BlockOf(LPCVOID p)
+	{
+		return reinterpret_cast<Block *>(const_cast<LPVOID>(p)) - 1;
+	}
+}
+
+extern "C" HANDLE WINAPI GetProcessHeap()
+{
+	return &ProcessHeap;
+}
+
+extern "C" HANDLE WINAPI HeapCreate(DWORD, SIZE_T, SIZE_T)
+{
+	return new Heap;
+}
+
+extern "C" BOOL WINAPI HeapDestroy(HANDLE h)
+{
+	Heap *const heap = static_cast<Heap *>(h);
+	if (heap == NULL || heap == &ProcessHeap)
+		return Fail(ERROR_INVALID_HANDLE);
+	while (Block *const block = heap->first)
+	{
+		heap->first = block->next;
+		free(block);
+	}
+	delete heap;
+	return TRUE;
+}
+
+extern "C" LPVOID WINAPI HeapAlloc(HANDLE h, DWORD flags, SIZE_T size)
+{
+	Heap *const heap = static_cast<Heap *>(h);
+	Block *const block = static_cast<Block *>(flags & HEAP_ZERO_MEMORY ?
+		calloc(1, sizeof(Block) + size) : malloc(sizeof(Block) + size));
+	if (block == NULL)
+		return NULL;
+	block->size = size;
+	heap->link(block);
+	return block + 1;
+}
+
+extern "C" LPVOID WINAPI HeapReAlloc(HANDLE h, DWORD flags, LPVOID p, SIZE_T size)
+{
+	Heap *const heap = static_cast<Heap *>(h);
+	Block *block = BlockOf(p);
+	const SIZE_T old = block->size;
+	heap->unlink(block);
+	Block *const grown = static_cast<Block *>(realloc(block, sizeof(Block) + size));
+	if (grown == NULL)
+	{
+		heap->link(block);
+		return NULL;
+	}
+	block = grown;
+	if ((flags & HEAP_ZERO_MEMORY) && size > old)
+		memset(reinterpret_cast<BYTE *>(block + 1) + old, 0, size - old);
+	block->size = size;
+	heap->link(block);
+	return block + 1;
+}
+
+extern "C" BOOL WINAPI HeapFree(HANDLE h, DWORD, LPVOID p)
+{
+	if (p == NULL)
+		return TRUE;
+	Heap *const heap = static_cast<Heap *>(h);
+	Block *const block = BlockOf(p);
+	heap->unlink(block);
+	free(block);
+	return TRUE;
+}
+
+extern "C" SIZE_T WINAPI HeapSize(HANDLE, DWORD, LPCVOID p)
+{
+	return BlockOf(p)->size;
+}
+
+extern "C" HLOCAL WINAPI LocalFree(HLOCAL p)
+{
+	free(p);
+	return NULL;
+}
+
+extern "C" void *WINAPI SecureZeroMemory(void *p, SIZE_T cb)
+{
+	return memset(p, 0, cb);
+}
+
+// Paths map drive letters to the root folder, and are case sensitive
+
+WideString Shim::GetFullPath(LPCWSTR path)
+{
+	WideString s;
+	if (path[0] != L'\0' && path[1] == L':')
+	{
+		s.assign(path, path + 2);
+		path += 2;
+	}
+	else
+	{
+		s.assign(CurrentDirectory.begin(), CurrentDirectory.begin() + 2);
+	}
+	if (*path == L'\\' || *path == L'/')
+	{
+		++path;
+	}
+	else
+	{
+		// Relative to the current directory, which is on the only drive
+		s.assign(CurrentDirectory.begin(), CurrentDirectory.end() - 1);
+		if (s.back() == L'\\')
+			s.pop_back();
+	}
+	s.push_back(L'\\');
+	const size_t root = s.size();
+	while (*path != L'\0')
+	{
+		LPCWSTR end = path;
+		while (*end != L'\0' && *end != L'\\' && *end != L'/')
+			++end;
+		const size_t len = end - path;
+		if (len == 0 || (len == 1 && path[0] == L'.'))
+		{
+			// Skip empty and current directory components
+		}
+		else if (len == 2 && path[0] == L'.' && path[1] == L'.')
+		{
+			if (s.size() > root)
+			{
+				s.pop_back();
+				while (s.size() > root && s.back() != L'\\')
+					s.pop_back();
+			}
+		}
+		else
+		{
+			s.insert(s.end(), path, end);
+			s.push_back(L'\\');
+		}
+		path = *end ? end + 1 : end;
+	}
+	// Keep a trailing backslash only if the path ends with one
+	if (s.size() > root && (path[-1] != L'\\' && path[-1] != L'/'))
+		s.pop_back();
+	s.push_back(L'\0');
+	return s;
+}
+
+std::string Shim::ToLocalPath(LPCWSTR path)
+{
+	const WideString full = GetFullPath(path);
+	std::string s = Narrow(&full[2]);
+	std::replace(s.begin(), s.end(), '\\', '/');
+	Lock lock(StateLock);
+	return Root + s;
+}
+
+void Shim::SetRoot(const char *folder)
+{
+	Lock lock(StateLock);
+	Root = folder;
+	while (!Root.empty() && Root[Root.size() - 1] == '/')
+		Root.erase(Root.size() - 1);
+	CurrentDirectory = Widen("C:\\");
+}
+
+const char *Shim::GetRoot()
+{
+	return Root.c_str();
+}
+
+void Shim::SetCurrentDirectory(LPCWSTR path)
+{
+	CurrentDirectory = GetFullPath(path);
+}
+
+void Shim::SetModuleFileName(LPCWSTR path)
+{
+	ModuleFileName.assign(path, path + lstrlenW(path) + 1);
+}
+
+void Shim::SetCommandLine(LPCWSTR cmdline)
+{
+	CommandLine.assign(cmdline, cmdline + lstrlenW(cmdline) + 1);
+}
+
+void Shim::EnableSse2(bool enable)
+{
+	Sse2 = enable;
+}
+
+std::string Shim::TakeOutput()
+{
+	Lock lock(OutputLock);
+	std::string s;
+	s.swap(Output);
+	return s;
+}
+
+extern "C" DWORD WINAPI GetFullPathNameW(LPCWSTR path, DWORD cch, LPWSTR buffer, LPWSTR *filePart)
+{
+	if (path == NULL || *path == L'\0')
+		return Fail(ERROR_INVALID_PARAMETER);
+	const WideString full = GetFullPath(path);
+	if (full.size() > cch)
+		return static_cast<DWORD>(full.size());
+	std::copy(full.begin(), full.end(), buffer);
+	if (filePart)
+	{
+		LPWSTR name = buffer + full.size() - 1;
+		while (name > buffer && name[-1] != L'\\')
+			--name;
+		*filePart = *name ? name : NULL;
+	}
+	return static_cast<DWORD>(full.size() - 1);
+}
+
+// Files
+
+namespace
+{
+	struct File : Object
+	{
+		int fd;
+		bool console;
+		explicit File(int fd, bool console = false): fd(fd), console(console) { }
+		~File() { if (!console) close(fd); }
+	};
+
+	File StdOutput(1, true);
+	File StdError(2, true);
+
+	struct Mapping : Object
+	{
+		int fd;
+		ULONGLONG size;
+		DWORD protect;
+		Mapping(int fd, ULONGLONG size, DWORD protect): fd(fd), size(size), protect(protect) { }
+		~Mapping() { if (fd != -1) close(fd); }
+	};
+
+	pthread_mutex_t ViewLock = PTHREAD_MUTEX_INITIALIZER;
+	std::map<const void *, size_t> Views;
+
+	struct Find : Object
+	{
+		std::vector<WIN32_FIND_DATAW> entries;
+		size_t next;
+		Find(): next(0) { }
+	};
+
+	File *FileOf(HANDLE h)
+	{
+		if (h == NULL || h == INVALID_HANDLE_VALUE)
+			return NULL;
+		return dynamic_cast<File *>(static_cast<Object *>(h));
+	}
+
+	void FillFindData(WIN32_FIND_DATAW &fd, const struct stat &st)
+	{
+		fd.dwFileAttributes = S_ISDIR(st.st_mode) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+		fd.ftCreationTime = fd.ftLastAccessTime = fd.ftLastWriteTime = FileTimeFromUnix(st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+		fd.nFileSizeHigh = static_cast<DWORD>(static_cast<ULONGLONG>(st.st_size) >> 32);
+		fd.nFileSizeLow = static_cast<DWORD>(st.st_size);
+	}
+
+	bool CompareFindData(const WIN32_FIND_DATAW &a, const WIN32_FIND_DATAW &b)
+	{
+		return CompareNoCase(a.cFileName, lstrlenW(a.cFileName), b.cFileName, lstrlenW(b.cFileName)) < 0;
+	}
+}
+
+extern "C" HANDLE WINAPI GetStdHandle(DWORD which)
+{
+	switch (which)
+	{
+	case STD_OUTPUT_HANDLE:
+		return static_cast<Object *>(&StdOutput);
+	case STD_ERROR_HANDLE:
+		return static_cast<Object *>(&StdError);
+	}
+	Fail(ERROR_INVALID_HANDLE);
+	return INVALID_HANDLE_VALUE;
+}
+
+extern "C" HANDLE WINAPI CreateFileW(LPCWSTR path, DWORD access, DWORD, void *, DWORD disposition, DWORD, HANDLE)
+{
+	const std::string local = Shim::ToLocalPath(path);
+	int flags = O_CLOEXEC;
+	if ((access & GENERIC_READ) && (access & GENERIC_WRITE))
+		flags |= O_RDWR;
+	else if (access & GENERIC_WRITE)
+		flags |= O_WRONLY;
+	else
+		flags |= O_RDONLY;
+	struct stat st;
+	const bool existed = stat(local.c_str(), &st) == 0;
+	if (existed && S_ISDIR(st.st_mode))
+	{
+		Fail(ERROR_ACCESS_DENIED);
+		return INVALID_HANDLE_VALUE;
+	}
+	switch (disposition)
+	{
+	case CREATE_NEW:
+		flags |= O_CREAT | O_EXCL;
+		break;
+	case CREATE_ALWAYS:
+		flags |= O_CREAT | O_TRUNC;
+		break;
+	case OPEN_ALWAYS:
+		flags |= O_CREAT;
+		break;
+	case TRUNCATE_EXISTING:
+		flags |= O_TRUNC;
+		break;
+	}
+	const int fd = open(local.c_str(), flags, 0644);
+	if (fd == -1)
+	{
+		Fail(ErrorFromErrno(errno));
+		return INVALID_HANDLE_VALUE;
+	}
+	LastError = existed && (disposition == CREATE_ALWAYS || disposition == OPEN_ALWAYS) ? ERROR_ALREADY_EXISTS : 0;
+	return static_cast<Object *>(new File(fd));
+}
+
+extern "C" BOOL WINAPI CloseHandle(HANDLE h)
+{
+	if (h == NULL || h == INVALID_HANDLE_VALUE)
+		return Fail(ERROR_INVALID_HANDLE);
+	Object *const object = static_cast<Object *>(h);
+	if (object != &StdOutput && object != &StdError)
+		ReleaseObject(object);
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI ReadFile(HANDLE h, LPVOID buffer, DWORD cb, LPDWORD read, void *)
+{
+	File *const file = FileOf(h);
+	if (file == NULL || file->console)
+		return Fail(ERROR_INVALID_HANDLE);
+	DWORD total = 0;
+	while (total < cb)
+	{
+		const ssize_t n = ::read(file->fd, static_cast<BYTE *>(buffer) + total, cb - total);
+		if (n < 0)
+			return Fail(ErrorFromErrno(errno));
+		if (n == 0)
+			break;
+		total += static_cast<DWORD>(n);
+	}
+	if (read)
+		*read = total;
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI WriteFile(HANDLE h, LPCVOID buffer, DWORD cb, LPDWORD written, void *)
+{
+	File *const file = FileOf(h);
+	if (file == NULL)
+		return Fail(ERROR_INVALID_HANDLE);
+	if (file->console)
+	{
+		Lock lock(OutputLock);
+		Output.append(static_cast<const char *>(buffer), cb);
+		if (getenv("SHIM_ECHO"))
+			::write(2, buffer, cb);
+	}
+	else
+	{
+		DWORD total = 0;
+		while (total < cb)
+		{
+			const ssize_t n = ::write(file->fd, static_cast<const BYTE *>(buffer) + total, cb - total);
+			if (n <= 0)
+				return Fail(ErrorFromErrno(errno));
+			total += static_cast<DWORD>(n);
+		}
+	}
+	if (written)
+		*written = cb;
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI GetFileSizeEx(HANDLE h, LARGE_INTEGER *size)
+{
+	File *const file = FileOf(h);
+	struct stat st;
+	if (file == NULL || fstat(file->fd, &st) != 0)
+		return Fail(ERROR_INVALID_HANDLE);
+	size->QuadPart = st.st_size;
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI SetFilePointerEx(HANDLE h, LARGE_INTEGER distance, LARGE_INTEGER *position, DWORD method)
+{
+	File *const file = FileOf(h);
+	if (file == NULL)
+		return Fail(ERROR_INVALID_HANDLE);
+	const int whence = method == FILE_BEGIN ? SEEK_SET : method == FILE_CURRENT ? SEEK_CUR : SEEK_END;
+	const off_t pos = lseek(file->fd, distance.QuadPart, whence);
+	if (pos == -1)
+		return Fail(ERROR_INVALID_PARAMETER);
+	if (position)
+		position->QuadPart = pos;
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI SetEndOfFile(HANDLE h)
+{
+	File *const file = FileOf(h);
+	if (file == NULL)
+		return Fail(ERROR_INVALID_HANDLE);
+	if (ftruncate(file->fd, lseek(file->fd, 0, SEEK_CUR)) != 0)
+		return Fail(ErrorFromErrno(errno));
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI FlushFileBuffers(HANDLE h)
+{
+	return FileOf(h) ? TRUE : Fail(ERROR_INVALID_HANDLE);
+}
+
+extern "C" BOOL WINAPI GetFileInformationByHandle(HANDLE h, BY_HANDLE_FILE_INFORMATION *info)
+{
+	File *const file = FileOf(h);
+	struct stat st;
+	if (file == NULL || fstat(file->fd, &st) != 0)
+		return Fail(ERROR_INVALID_HANDLE);
+	WIN32_FIND_DATAW fd;
+	FillFindData(fd, st);
+	info->dwFileAttributes = fd.dwFileAttributes;
+	info->ftCreationTime = fd.ftCreationTime;
+	info->ftLastAccessTime = fd.ftLastAccessTime;
+	info->ftLastWriteTime = fd.ftLastWriteTime;
+	info->dwVolumeSerialNumber = static_cast<DWORD>(st.st_dev);
+	info->nFileSizeHigh = fd.nFileSizeHigh;
+	info->nFileSizeLow = fd.nFileSizeLow;
+	info->nNumberOfLinks = static_cast<DWORD>(st.st_nlink);
+	info->nFileIndexHigh = static_cast<DWORD>(static_cast<ULONGLONG>(st.st_ino) >> 32);
+	info->nFileIndexLow = static_cast<DWORD>(st.st_ino);
+	return TRUE;
+}
+
+extern "C" HANDLE WINAPI CreateFileMappingW(HANDLE h, void *, DWORD protect, DWORD maxHigh, DWORD maxLow, LPCWSTR)
+{
+	const ULONGLONG max = static_cast<ULONGLONG>(maxHigh) << 32 | maxLow;
+	if (h == INVALID_HANDLE_VALUE)
+	{
+		if (max == 0)
+		{
+			Fail(ERROR_INVALID_PARAMETER);
+			return NULL;
+		}
+		return static_cast<Object *>(new Mapping(-1, max, protect));
+	}
+	File *const file = FileOf(h);
+	struct stat st;
+	if (file == NULL || fstat(file->fd, &st) != 0)
+	{
+		Fail(ERROR_INVALID_HANDLE);
+		return NULL;
+	}
+	ULONGLONG size = st.st_size;
+	if (max > size)
+	{
+		if (protect != PAGE_READWRITE)
+		{
+			Fail(ERROR_ACCESS_DENIED);
+			return NULL;
+		}
+		if (ftruncate(file->fd, max) != 0)
+		{
+			Fail(ErrorFromErrno(errno));
+			return NULL;
+		}
+		size = max;
+	}
+	else if (max != 0)
+	{
+		size = max;
+	}
+	if (size == 0)
+	{
+		Fail(ERROR_FILE_INVALID);
+		return NULL;
+	}
+	return static_cast<Object *>(new Mapping(dup(file->fd), size, protect));
+}
+
+extern "C" LPVOID WINAPI MapViewOfFile(HANDLE h, DWORD access, DWORD offsetHigh, DWORD offsetLow, SIZE_T cb)
+{
+	Mapping *const mapping = dynamic_cast<Mapping *>(static_cast<Object *>(h));
+	if (mapping == NULL)
+	{
+		Fail(ERROR_INVALID_HANDLE);
+		return NULL;
+	}
+	const ULONGLONG offset = static_cast<ULONGLONG>(offsetHigh) << 32 | offsetLow;
+	if (offset > mapping->size || cb > mapping->size - offset)
+	{
+		Fail(ERROR_ACCESS_DENIED);
+		return NULL;
+	}
+	if (cb == 0)
+		cb = static_cast<SIZE_T>(mapping->size - offset);
+	int prot = PROT_READ;
+	int flags = MAP_SHARED;
+	if (access & FILE_MAP_COPY)
+	{
+		prot |= PROT_WRITE;
+		flags = MAP_PRIVATE;
+	}
+	else if (access & FILE_MAP_WRITE)
+	{
+		prot |= PROT_WRITE;
+	}
+	if (mapping->fd == -1)
+		flags |= MAP_ANONYMOUS;
+	void *const p = mmap(NULL, cb, prot, flags, mapping->fd, offset);
+	if (p == MAP_FAILED)
+	{
+		Fail(ErrorFromErrno(errno));
+		return NULL;
+	}
+	Lock lock(ViewLock);
+	Views[p] = cb;
+	return p;
+}
+
+extern "C" BOOL WINAPI UnmapViewOfFile(LPCVOID p)
+{
+	Lock lock(ViewLock);
+	std::map<const void *, size_t>::iterator it = Views.find(p);
+	if (it == Views.end())
+		return Fail(ERROR_INVALID_PARAMETER);
+	munmap(const_cast<void *>(p), it->second);
+	Views.erase(it);
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI FlushViewOfFile(LPCVOID, SIZE_T)
+{
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI MoveFileExW(LPCWSTR from, LPCWSTR to, DWORD flags)
+{
+	const std::string target = Shim::ToLocalPath(to);
+	struct stat st;
+	if (!(flags & MOVEFILE_REPLACE_EXISTING) && stat(target.c_str(), &st) == 0)
+		return Fail(ERROR_ALREADY_EXISTS);
+	if (rename(Shim::ToLocalPath(from).c_str(), target.c_str()) != 0)
+		return Fail(ErrorFromErrno(errno));
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI DeleteFileW(LPCWSTR path)
+{
+	if (unlink(Shim::ToLocalPath(path).c_str()) != 0)
+		return Fail(ErrorFromErrno(errno));
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI CreateDirectoryW(LPCWSTR path, void *)
+{
+	if (mkdir(Shim::ToLocalPath(path).c_str(), 0755) != 0)
+		return Fail(errno == EEXIST ? ERROR_ALREADY_EXISTS : ErrorFromErrno(errno));
+	return TRUE;
+}
+
+extern "C" UINT WINAPI GetTempFileNameW(LPCWSTR folder, LPCWSTR prefix, UINT unique, LPWSTR path)
+{
+	static LONG counter;
+	for (int attempt = 0; attempt < 0x10000; ++attempt)
+	{
+		const UINT n = unique ? unique : (static_cast<UINT>(getpid()) + InterlockedIncrement(&counter)) & 0xFFFF;
+		if (n == 0)
+			continue;
+		char name[16];
+		snprintf(name, sizeof name, "%.3s%X.TMP", Narrow(prefix).c_str(), n);
+		const WideString wide = Widen(name);
+		lstrcpyW(path, folder);
+		int len = lstrlenW(path);
+		if (len != 0 && path[len - 1] != L'\\')
+			path[len++] = L'\\';
+		lstrcpyW(path + len, &wide[0]);
+		if (unique)
+			return n;
+		const int fd = open(Shim::ToLocalPath(path).c_str(), O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0644);
+		if (fd != -1)
+		{
+			close(fd);
+			return n;
+		}
+		if (errno != EEXIST)
+			return Fail(ErrorFromErrno(errno));
+	}
+	return Fail(ERROR_FILE_EXISTS);
+}
+
+extern "C" HANDLE WINAPI FindFirstFileW(LPCWSTR pattern, WIN32_FIND_DATAW *data)
+{
+	LPCWSTR const spec = PathFindFileNameW(pattern);
+	WideString folder(pattern, spec);
+	folder.push_back(L'\0');
+	DIR *const dir = opendir(Shim::ToLocalPath(folder[0] ? &folder[0] : L".").c_str());
+	if (dir == NULL)
+	{
+		Fail(ERROR_PATH_NOT_FOUND);
+		return INVALID_HANDLE_VALUE;
+	}
+	const std::string local = Shim::ToLocalPath(folder[0] ? &folder[0] : L".");
+	Find *const find = new Find;
+	while (dirent *const entry = readdir(dir))
+	{
+		WIN32_FIND_DATAW fd;
+		memset(&fd, 0, sizeof fd);
+		const WideString name = Widen(entry->d_name);
+		if (name.size() > MAX_PATH || !MatchSpec(&name[0], spec, lstrlenW(spec)))
+			continue;
+		std::copy(name.begin(), name.end(), fd.cFileName);
+		struct stat st;
+		if (stat((local + "/" + entry->d_name).c_str(), &st) == 0)
+			FillFindData(fd, st);
+		find->entries.push_back(fd);
+	}
+	closedir(dir);
+	if (find->entries.empty())
+	{
+		ReleaseObject(find);
+		Fail(ERROR_FILE_NOT_FOUND);
+		return INVALID_HANDLE_VALUE;
+	}
+	// Come up with names in the order NTFS would
+	std::sort(find->entries.begin(), find->entries.end(), CompareFindData);
+	*data = find->entries[find->next++];
+	return static_cast<Object *>(find);
+}
+
+extern "C" BOOL WINAPI FindNextFileW(HANDLE h, WIN32_FIND_DATAW *data)
+{
+	Find *const find = dynamic_cast<Find *>(static_cast<Object *>(h));
+	if (find == NULL)
+		return Fail(ERROR_INVALID_HANDLE);
+	if (find->next == find->entries.size())
+		return Fail(ERROR_NO_MORE_FILES);
+	*data = find->entries[find->next++];
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI FindClose(HANDLE h)
+{
+	return CloseHandle(h);
+}
+
+// Reads a section from an ini file, which is UTF-16LE if it has a BOM, and
+// in the ANSI code page otherwise
+extern "C" DWORD WINAPI GetPrivateProfileSectionW(LPCWSTR section, LPWSTR buffer, DWORD cch, LPCWSTR path)
+{
+	if (cch < 2)
+		return 0;
+	buffer[0] = buffer[1] = L'\0';
+	FILE *const f = fopen(Shim::ToLocalPath(path).c_str(), "rb");
+	if (f == NULL)
+	{
+		SetLastError(ERROR_FILE_NOT_FOUND);
+		return 0;
+	}
+	std::string bytes;
+	char chunk[4096];
+	while (size_t n = fread(chunk, 1, sizeof chunk, f))
+		bytes.append(chunk, n);
+	fclose(f);
+	WideString text;
+	if (bytes.size() >= 2 && static_cast<BYTE>(bytes[0]) == 0xFF && static_cast<BYTE>(bytes[1]) == 0xFE)
+	{
+		for (size_t i = 2; i + 1 < bytes.size(); i += 2)
+			text.push_back(static_cast<WCHAR>(static_cast<BYTE>(bytes[i]) | static_cast<BYTE>(bytes[i + 1]) << 8));
+	}
+	else if (!bytes.empty())
+	{
+		text.resize(bytes.size());
+		MultiByteToWideChar(CP_ACP, 0, bytes.data(), static_cast<int>(bytes.size()), &text[0], static_cast<int>(text.size()));
+	}
+	text.push_back(L'\0');
+	const int lenSection = lstrlenW(section);
+	bool inside = false;
+	DWORD n = 0;
+	LPCWSTR p = &text[0];
+	while (*p != L'\0')
+	{
+		LPCWSTR end = p;
+		while (*end != L'\0' && *end != L'\n')
+			++end;
+		LPCWSTR q = end;
+		while (p < q && (*p == L' ' || *p == L'\t'))
+			++p;
+		while (q > p && (q[-1] == L' ' || q[-1] == L'\t' || q[-1] == L'\r'))
+			--q;
+		if (p < q && *p == L'[')
+		{
+			LPCWSTR close = p + 1;
+			while (close < q && *close != L']')
+				++close;
+			inside = close - p - 1 == lenSection && CompareNoCase(p + 1, lenSection, section, lenSection) == 0;
+		}
+		else if (inside && p < q && *p != L';')
+		{
+			const DWORD len = static_cast<DWORD>(q - p);
+			if (n + len + 2 > cch)
+			{
+				// Truncate as Windows does, and say so by returning cch - 2
+				const DWORD fit = cch - 2 - n;
+				std::copy(p, p + fit, buffer + n);
+				buffer[cch - 2] = buffer[cch - 1] = L'\0';
+				return cch - 2;
+			}
+			std::copy(p, q, buffer + n);
+			n += len;
+			buffer[n++] = L'\0';
+		}
+		p = *end ? end + 1 : end;
+	}
+	buffer[n] = L'\0';
+	return n;
+}
+
+// Modules which LoadLibraryW() knows about
+
+namespace
+{
+	struct Module
+	{
+		WideString name;
+		std::vector<Shim::Export> exports;
+		LONG refs;
+		bool pinned;
+	};
+
+	std::vector<Module *> Modules;
+
+	Module *FindModule(LPCWSTR path)
+	{
+		LPCWSTR const name = PathFindFileNameW(path);
+		const int len = lstrlenW(name);
+		for (size_t i = 0; i < Modules.size(); ++i)
+		{
+			Module *const m = Modules[i];
+			const int cch = lstrlenW(&m->name[0]);
+			// The name may come without the extension, which defaults to .dll
+			if (CompareNoCase(name, len, &m->name[0], cch) == 0 ||
+				(cch == len + 4 && CompareNoCase(name, len, &m->name[0], len) == 0 &&
+				CompareNoCase(&m->name[len], 4, L".dll", 4) == 0))
+			{
+				return m;
+			}
+		}
+		return NULL;
+	}
+}
+
+void Shim::AddModule(LPCWSTR name, const Export *exports, UINT count)
+{
+	Lock lock(StateLock);
+	Module *const m = new Module;
+	m->name.assign(name, name + lstrlenW(name) + 1);
+	m->exports.assign(exports, exports + count);
+	m->refs = 0;
+	m->pinned = false;
+	Modules.push_back(m);
+}
+
+void Shim::RemoveModules()
+{
+	Lock lock(StateLock);
+	for (size_t i = 0; i < Modules.size(); ++i)
+		delete Modules[i];
+	Modules.clear();
+}
+
+LONG Shim::GetModuleLoadCount(LPCWSTR name)
+{
+	Lock lock(StateLock);
+	Module *const m = FindModule(name);
+	return m ? m->refs : -1;
+}
+
+extern "C" HMODULE WINAPI LoadLibraryW(LPCWSTR path)
+{
+	// Look for the file before taking the lock, which ToLocalPath() takes too
+	struct stat st;
+	const bool found = PathFindFileNameW(path) == path || stat(Shim::ToLocalPath(path).c_str(), &st) == 0;
+	Lock lock(StateLock);
+	Module *const m = FindModule(path);
+	if (m == NULL || !found)
+	{
+		Fail(ERROR_MOD_NOT_FOUND);
+		return NULL;
+	}
+	++m->refs;
+	return reinterpret_cast<HMODULE>(m);
+}
+
+extern "C" BOOL WINAPI FreeLibrary(HMODULE module)
+{
+	Lock lock(StateLock);
+	Module *const m = reinterpret_cast<Module *>(module);
+	if (m == NULL || m->refs == 0)
+		return Fail(ERROR_INVALID_HANDLE);
+	if (!m->pinned)
+		--m->refs;
+	return TRUE;
+}
+
+extern "C" FARPROC WINAPI GetProcAddress(HMODULE module, LPCSTR name)
+{
+	Lock lock(StateLock);
+	Module *const m = reinterpret_cast<Module *>(module);
+	if (m == NULL)
+	{
+		Fail(ERROR_INVALID_HANDLE);
+		return NULL;
+	}
+	for (size_t i = 0; i < m->exports.size(); ++i)
+		if (strcmp(m->exports[i].name, name) == 0)
+			return m->exports[i].proc;
+	Fail(ERROR_PROC_NOT_FOUND);
+	return NULL;
+}
+
+extern "C" BOOL WINAPI GetModuleHandleExW(DWORD flags, LPCWSTR name, HMODULE *module)
+{
+	Lock lock(StateLock);
+	Module *const m = FindModule(name);
+	*module = NULL;
+	if (m == NULL || m->refs == 0)
+		return Fail(ERROR_MOD_NOT_FOUND);
+	if (flags & GET_MODULE_HANDLE_EX_FLAG_PIN)
+		m->pinned = true;
+	else
+		++m->refs;
+	*module = reinterpret_cast<HMODULE>(m);
+	return TRUE;
+}
+
+extern "C" DWORD WINAPI GetModuleFileNameW(HMODULE, LPWSTR path, DWORD cch)
+{
+	const DWORD len = static_cast<DWORD>(ModuleFileName.size() - 1);
+	if (cch == 0)
+		return 0;
+	lstrcpynW(path, &ModuleFileName[0], cch);
+	return len < cch ? len : cch;
+}
+
+extern "C" BOOL WINAPI SetDllDirectoryW(LPCWSTR)
+{
+	return TRUE;
+}
+
+// The program has no resources of its own, and the API for updating them
+// is not available
+
+extern "C" HRSRC WINAPI FindResourceW(HMODULE, LPCWSTR, LPCWSTR)
+{
+	Fail(ERROR_RESOURCE_TYPE_NOT_FOUND);
+	return NULL;
+}
+
+extern "C" DWORD WINAPI SizeofResource(HMODULE, HRSRC)
+{
+	return 0;
+}
+
+extern "C" HGLOBAL WINAPI LoadResource(HMODULE, HRSRC)
+{
+	return NULL;
+}
+
+extern "C" LPVOID WINAPI LockResource(HGLOBAL h)
+{
+	return h;
+}
+
+extern "C" HANDLE WINAPI BeginUpdateResourceW(LPCWSTR, BOOL)
+{
+	Fail(ERROR_CALL_NOT_IMPLEMENTED);
+	return NULL;
+}
+
+extern "C" BOOL WINAPI UpdateResourceW(HANDLE, LPCWSTR, LPCWSTR, WORD, LPVOID, DWORD)
+{
+	return Fail(ERROR_CALL_NOT_IMPLEMENTED);
+}
+
+extern "C" BOOL WINAPI EndUpdateResourceW(HANDLE, BOOL)
+{
+	return Fail(ERROR_CALL_NOT_IMPLEMENTED);
+}
+
+// Waitable objects
+
+namespace
+{
+	struct Event : Object
+	{
+		bool manual;
+		bool state;
+		Event(bool manual, bool state): manual(manual), state(state) { }
+		bool isSignaled() { return state; }
+		void satisfyWait() { if (!manual) state = false; }
+	};
+
+	struct Semaphore : Object
+	{
+		LONG count;
+		LONG max;
+		Semaphore(LONG count, LONG max): count(count), max(max) { }
+		bool isSignaled() { return count > 0; }
+		void satisfyWait() { --count; }
+	};
+
+	struct Thread : Object
+	{
+		LPTHREAD_START_ROUTINE start;
+		LPVOID param;
+		bool done;
+		Thread(LPTHREAD_START_ROUTINE start, LPVOID param): start(start), param(param), done(false) { }
+		bool isSignaled() { return done; }
+	};
+
+	void *ThreadMain(void *p)
+	{
+		Thread *const thread = static_cast<Thread *>(p);
+		thread->start(thread->param);
+		pthread_mutex_lock(&WaitLock);
+		thread->done = true;
+		pthread_cond_broadcast(&WaitCond);
+		pthread_mutex_unlock(&WaitLock);
+		ReleaseObject(thread);
+		return NULL;
+	}
+
+	Object *ObjectOf(HANDLE h)
+	{
+		return h == NULL || h == INVALID_HANDLE_VALUE ? NULL : static_cast<Object *>(h);
+	}
+
+	void GetDeadline(DWORD ms, timespec &deadline)
+	{
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += ms / 1000;
+		deadline.tv_nsec += (ms % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L)
+		{
+			deadline.tv_nsec -= 1000000000L;
+			++deadline.tv_sec;
+		}
+	}
+}
+
+extern "C" HANDLE WINAPI CreateThread(void *, SIZE_T, LPTHREAD_START_ROUTINE start, LPVOID param, DWORD, LPDWORD id)
+{
+	Thread *const thread = new Thread(start, param);
+	thread->refs = 2; // one for the handle, one for the thread itself
+	pthread_t t;
+	if (pthread_create(&t, NULL, ThreadMain, thread) != 0)
+	{
+		delete thread;
+		Fail(ERROR_NOT_ENOUGH_MEMORY);
+		return NULL;
+	}
+	pthread_detach(t);
+	if (id)
+		*id = 0;
+	return static_cast<Object *>(thread);
+}
+
+extern "C" HANDLE WINAPI CreateEventW(void *, BOOL manual, BOOL state, LPCWSTR)
+{
+	return static_cast<Object *>(new Event(manual != FALSE, state != FALSE));
+}
+
+extern "C" BOOL WINAPI SetEvent(HANDLE h)
+{
+	Event *const event = dynamic_cast<Event *>(ObjectOf(h));
+	if (event == NULL)
+		return Fail(ERROR_INVALID_HANDLE);
+	pthread_mutex_lock(&WaitLock);
+	event->state = true;
+	pthread_cond_broadcast(&WaitCond);
+	pthread_mutex_unlock(&WaitLock);
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI ResetEvent(HANDLE h)
+{
+	Event *const event = dynamic_cast<Event *>(ObjectOf(h));
+	if (event == NULL)
+		return Fail(ERROR_INVALID_HANDLE);
+	pthread_mutex_lock(&WaitLock);
+	event->state = false;
+	pthread_mutex_unlock(&WaitLock);
+	return TRUE;
+}
+
+extern "C" HANDLE WINAPI CreateSemaphoreW(void *, LONG count, LONG max, LPCWSTR)
+{
+	if (count < 0 || max <= 0 || count > max)
+	{
+		Fail(ERROR_INVALID_PARAMETER);
+		return NULL;
+	}
+	return static_cast<Object *>(new Semaphore(count, max));
+}
+
+extern "C" BOOL WINAPI ReleaseSemaphore(HANDLE h, LONG n, LONG *previous)
+{
+	Semaphore *const semaphore = dynamic_cast<Semaphore *>(ObjectOf(h));
+	if (semaphore == NULL)
+		return Fail(ERROR_INVALID_HANDLE);
+	Lock lock(WaitLock);
+	if (n <= 0 || semaphore->count + n > semaphore->max)
+		return Fail(298); // ERROR_TOO_MANY_POSTS
+	if (previous)
+		*previous = semaphore->count;
+	semaphore->count += n;
+	pthread_cond_broadcast(&WaitCond);
+	return TRUE;
+}
+
+extern "C" DWORD WINAPI WaitForMultipleObjects(DWORD n, const HANDLE *handles, BOOL all, DWORD ms)
+{
+	if (n == 0 || n > MAXIMUM_WAIT_OBJECTS)
+	{
+		Fail(ERROR_INVALID_PARAMETER);
+		return WAIT_FAILED;
+	}
+	for (DWORD i = 0; i < n; ++i)
+	{
+		if (ObjectOf(handles[i]) == NULL)
+		{
+			Fail(ERROR_INVALID_HANDLE);
+			return WAIT_FAILED;
+		}
+	}
+	timespec deadline;
+	if (ms != INFINITE)
+		GetDeadline(ms, deadline);
+	Lock lock(WaitLock);
+	for (;;)
+	{
+		DWORD signaled = 0;
+		DWORD first = n;
+		for (DWORD i = 0; i < n; ++i)
+		{
+			if (static_cast<Object *>(handles[i])->isSignaled())
+			{
+				++signaled;
+				if (first == n)
+					first = i;
+			}
+		}
+		if (all ? signaled == n : signaled != 0)
+		{
+			if (all)
+			{
+				for (DWORD i = 0; i < n; ++i)
+					static_cast<Object *>(handles[i])->satisfyWait();
+				return WAIT_OBJECT_0;
+			}
+			static_cast<Object *>(handles[first])->satisfyWait();
+			return WAIT_OBJECT_0 + first;
+		}
+		if (ms == 0)
+			return WAIT_TIMEOUT;
+		if (ms == INFINITE)
+			pthread_cond_wait(&WaitCond, &WaitLock);
+		else if (pthread_cond_timedwait(&WaitCond, &WaitLock, &deadline) == ETIMEDOUT)
+			ms = 0;
+	}
+}
+
+extern "C" DWORD WINAPI WaitForSingleObject(HANDLE h, DWORD ms)
+{
+	return WaitForMultipleObjects(1, &h, FALSE, ms);
+}
+
+extern "C" void WINAPI Sleep(DWORD ms)
+{
+	usleep(static_cast<useconds_t>(ms) * 1000);
+}
+
+// Slim reader/writer locks and condition variables live in the pointer they
+// come with. Locks are exclusive even when acquired shared, which the code
+// can't tell apart.
+
+namespace
+{
+	int *FutexOf(PVOID *ptr)
+	{
+		return reinterpret_cast<int *>(ptr);
+	}
+
+	long Futex(int *word, int op, int value, const timespec *timeout = NULL)
+	{
+		return syscall(SYS_futex, word, op | FUTEX_PRIVATE_FLAG, value, timeout, NULL, 0);
+	}
+
+	// 0 is unlocked, 1 is locked, and 2 is locked with possible waiters
+	void LockWord(int *word)
+	{
+		int c = __sync_val_compare_and_swap(word, 0, 1);
+		if (c == 0)
+			return;
+		if (c != 2)
+			c = __sync_lock_test_and_set(word, 2);
+		while (c != 0)
+		{
+			Futex(word, FUTEX_WAIT, 2);
+			c = __sync_lock_test_and_set(word, 2);
+		}
+	}
+
+	void UnlockWord(int *word)
+	{
+		if (__sync_fetch_and_sub(word, 1) != 1)
+		{
+			*word = 0;
+			__sync_synchronize();
+			Futex(word, FUTEX_WAKE, 1);
+		}
+	}
+}
+
+extern "C" void WINAPI InitializeSRWLock(PSRWLOCK lock)
+{
+	lock->Ptr = NULL;
+}
+
+extern "C" void WINAPI AcquireSRWLockExclusive(PSRWLOCK lock)
+{
+	LockWord(FutexOf(&lock->Ptr));
+}
+
+extern "C" void WINAPI ReleaseSRWLockExclusive(PSRWLOCK lock)
+{
+	UnlockWord(FutexOf(&lock->Ptr));
+}
+
+extern "C" void WINAPI AcquireSRWLockShared(PSRWLOCK lock)
+{
+	LockWord(FutexOf(&lock->Ptr));
+}
+
+extern "C" void WINAPI ReleaseSRWLockShared(PSRWLOCK lock)
+{
+	UnlockWord(FutexOf(&lock->Ptr));
+}
+
+extern "C" void WINAPI InitializeConditionVariable(PCONDITION_VARIABLE cv)
+{
+	cv->Ptr = NULL;
+}
+
+extern "C" BOOL WINAPI SleepConditionVariableSRW(PCONDITION_VARIABLE cv, PSRWLOCK lock, DWORD ms, ULONG)
+{
+	int *const seq = FutexOf(&cv->Ptr);
+	const int value = *seq;
+	UnlockWord(FutexOf(&lock->Ptr));
+	timespec timeout = { static_cast<time_t>(ms / 1000), static_cast<long>(ms % 1000) * 1000000L };
+	const long r = Futex(seq, FUTEX_WAIT, value, ms == INFINITE ? NULL : &timeout);
+	const int error = errno;
+	LockWord(FutexOf(&lock->Ptr));
+	if (r != 0 && error == ETIMEDOUT)
+		return Fail(ERROR_TIMEOUT);
+	return TRUE;
+}
+
+extern "C" void WINAPI WakeConditionVariable(PCONDITION_VARIABLE cv)
+{
+	__sync_fetch_and_add(FutexOf(&cv->Ptr), 1);
+	Futex(FutexOf(&cv->Ptr), FUTEX_WAKE, 1);
+}
+
+extern "C" void WINAPI WakeAllConditionVariable(PCONDITION_VARIABLE cv)
+{
+	__sync_fetch_and_add(FutexOf(&cv->Ptr), 1);
+	Futex(FutexOf(&cv->Ptr), FUTEX_WAKE, 0x7FFFFFFF);
+}
+
+extern "C" BOOL WINAPI InitOnceExecuteOnce(PINIT_ONCE once, PINIT_ONCE_FN fn, PVOID param, LPVOID *context)
+{
+	static pthread_mutex_t mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+	// The low bits of the pointer tell that initialization has completed
+	const ULONG_PTR done = 2;
+	Lock lock(mutex);
+	ULONG_PTR state = reinterpret_cast<ULONG_PTR>(once->Ptr);
+	if ((state & done) == 0)
+	{
+		PVOID ctx = NULL;
+		if (!fn(once, param, &ctx))
+			return FALSE;
+		state = (reinterpret_cast<ULONG_PTR>(ctx) & ~static_cast<ULONG_PTR>(3)) | done;
+		once->Ptr = reinterpret_cast<PVOID>(state);
+	}
+	if (context)
+		*context = reinterpret_cast<PVOID>(state & ~static_cast<ULONG_PTR>(3));
+	return TRUE;
+}
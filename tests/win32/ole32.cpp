@@ -0,0 +1,165 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// COM, as far as the code goes: memory, strings, and objects which do
+// nothing but exist. Type libraries don't load.
+
+#include "internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+using namespace Shim;
+
+extern "C" const IID IID_IUnknown = { 0x00000000, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+
+namespace
+{
+	class Dummy : public IUnknown
+	{
+		LONG refs;
+	public:
+		Dummy(): refs(1) { }
+		virtual ~Dummy() { }
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppv)
+		{
+			if (riid != IID_IUnknown)
+			{
+				*ppv = NULL;
+				return E_NOINTERFACE;
+			}
+			*ppv = this;
+			AddRef();
+			return S_OK;
+		}
+		ULONG STDMETHODCALLTYPE AddRef()
+		{
+			return InterlockedIncrement(&refs);
+		}
+		ULONG STDMETHODCALLTYPE Release()
+		{
+			const LONG n = InterlockedDecrement(&refs);
+			if (n == 0)
+				delete this;
+			return n;
+		}
+	};
+}
+
+extern "C" HRESULT WINAPI CoInitialize(LPVOID)
+{
+	return S_OK;
+}
+
+extern "C" void WINAPI CoUninitialize()
+{
+}
+
+extern "C" HRESULT WINAPI CoCreateInstance(REFCLSID, IUnknown *, DWORD, REFIID riid, LPVOID *ppv)
+{
+	Dummy *const dummy = new Dummy;
+	const HRESULT hr = dummy->QueryInterface(riid, ppv);
+	dummy->Release();
+	return hr;
+}
+
+extern "C" LPVOID WINAPI CoTaskMemAlloc(SIZE_T cb)
+{
+	return malloc(cb ? cb : 1);
+}
+
+extern "C" LPVOID WINAPI CoTaskMemRealloc(LPVOID p, SIZE_T cb)
+{
+	return realloc(p, cb ? cb : 1);
+}
+
+extern "C" void WINAPI CoTaskMemFree(LPVOID p)
+{
+	free(p);
+}
+
+extern "C" HRESULT WINAPI CLSIDFromProgID(LPCOLESTR, CLSID *clsid)
+{
+	memset(clsid, 0, sizeof *clsid);
+	return CO_E_CLASSSTRING;
+}
+
+// BSTRs come with their length in bytes in front of them
+
+extern "C" BSTR WINAPI SysAllocStringLen(LPCOLESTR s, UINT cch)
+{
+	DWORD *const p = static_cast<DWORD *>(malloc(sizeof(DWORD) + (cch + 1) * sizeof(WCHAR)));
+	if (p == NULL)
+		return NULL;
+	*p = cch * sizeof(WCHAR);
+	BSTR const bstr = reinterpret_cast<BSTR>(p + 1);
+	if (s)
+		memcpy(bstr, s, cch * sizeof(WCHAR));
+	else
+		memset(bstr, 0, cch * sizeof(WCHAR));
+	bstr[cch] = L'\0';
+	return bstr;
+}
+
+extern "C" BSTR WINAPI SysAllocString(LPCOLESTR s)
+{
+	return s ? SysAllocStringLen(s, lstrlenW(s)) : NULL;
+}
+
+extern "C" void WINAPI SysFreeString(BSTR bstr)
+{
+	if (bstr)
+		free(reinterpret_cast<DWORD *>(bstr) - 1);
+}
+
+extern "C" UINT WINAPI SysStringLen(BSTR bstr)
+{
+	return bstr ? reinterpret_cast<DWORD *>(bstr)[-1] / sizeof(WCHAR) : 0;
+}
+
+extern "C" void WINAPI VariantInit(VARIANT *v)
+{
+	v->vt = 0;
+}
+
+extern "C" HRESULT WINAPI VariantClear(VARIANT *v)
+{
+	if (v->vt == 8) // VT_BSTR
+		SysFreeString(v->bstrVal);
+	else if (v->vt == 13 && v->punkVal) // VT_UNKNOWN
+		v->punkVal->Release();
+	v->vt = 0;
+	return S_OK;
+}
+
+extern "C" HRESULT WINAPI LoadTypeLib(LPCOLESTR, ITypeLib **ppTypeLib)
+{
+	*ppTypeLib = NULL;
+	return TYPE_E_CANTLOADLIBRARY;
+}
+
+extern "C" HRESULT WINAPI LoadTypeLibEx(LPCOLESTR, REGKIND, ITypeLib **ppTypeLib)
+{
+	*ppTypeLib = NULL;
+	return TYPE_E_CANTLOADLIBRARY;
+}
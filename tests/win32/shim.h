@@ -0,0 +1,72 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Lets the tests set the stage for the Win32 shim: where drive C: lives on
+// the local file system, which modules LoadLibraryW() knows about, and what
+// has been written to the standard handles.
+
+#pragma once
+
+#include <shlwapi.h>
+#include <string>
+
+namespace Shim
+{
+	// An exported function of a module which LoadLibraryW() can load
+	struct Export
+	{
+		LPCSTR name;
+		FARPROC proc;
+	};
+
+	// Puts drive C: in a local folder, and makes C:\ the current directory
+	void SetRoot(const char *folder);
+	const char *GetRoot();
+	std::string ToLocalPath(LPCWSTR path);
+
+	void SetCurrentDirectory(LPCWSTR path);
+	void SetModuleFileName(LPCWSTR path);
+	void SetCommandLine(LPCWSTR cmdline);
+
+	// Modules are known by file name, and load only if the file exists, unless
+	// LoadLibraryW() is given just the name
+	void AddModule(LPCWSTR name, const Export *exports, UINT count);
+	void RemoveModules();
+	LONG GetModuleLoadCount(LPCWSTR name);
+
+	// Returns and forgets what has been written to the standard handles
+	std::string TakeOutput();
+
+	// Takes away the SSE2 code paths, as seen through IsSse2Present()
+	void EnableSse2(bool enable);
+
+	// Drops all keys, and any overrides of the predefined keys
+	void ResetRegistry();
+
+	// Counts the calls which have gone to the registry API
+	LONG GetRegistryCallCount();
+
+	// Tells how many registry keys are open, not counting predefined ones
+	LONG GetOpenKeyCount();
+}
@@ -0,0 +1,568 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Shim;
+
+// Strings
+
+extern "C" LPWSTR WINAPI StrChrW(LPCWSTR s, WCHAR c)
+{
+	if (s == NULL)
+		return NULL;
+	for (; *s != L'\0'; ++s)
+		if (*s == c)
+			return const_cast<LPWSTR>(s);
+	return NULL;
+}
+
+extern "C" LPWSTR WINAPI StrRChrW(LPCWSTR s, LPCWSTR end, WCHAR c)
+{
+	if (s == NULL)
+		return NULL;
+	if (end == NULL)
+		end = s + lstrlenW(s);
+	while (end > s)
+		if (*--end == c)
+			return const_cast<LPWSTR>(end);
+	return NULL;
+}
+
+extern "C" int WINAPI StrSpnW(LPCWSTR s, LPCWSTR set)
+{
+	int n = 0;
+	while (s[n] != L'\0' && StrChrW(set, s[n]) != NULL)
+		++n;
+	return n;
+}
+
+extern "C" int WINAPI StrCmpNA(LPCSTR p, LPCSTR q, int n)
+{
+	const int cmp = strncmp(p, q, n);
+	return cmp < 0 ? -1 : cmp > 0 ? 1 : 0;
+}
+
+extern "C" BOOL WINAPI StrIsIntlEqualW(BOOL caseSensitive, LPCWSTR p, LPCWSTR q, int n)
+{
+	for (int i = 0; i < n; ++i)
+	{
+		const WCHAR a = caseSensitive ? p[i] : UpCase(p[i]);
+		const WCHAR b = caseSensitive ? q[i] : UpCase(q[i]);
+		if (a != b)
+			return FALSE;
+		if (a == L'\0')
+			break;
+	}
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI StrTrimW(LPWSTR s, LPCWSTR set)
+{
+	LPWSTR p = s;
+	while (*p != L'\0' && StrChrW(set, *p))
+		++p;
+	LPWSTR q = p + lstrlenW(p);
+	while (q > p && StrChrW(set, q[-1]))
+		--q;
+	if (p == s && *q == L'\0')
+		return FALSE;
+	memmove(s, p, (q - p) * sizeof(WCHAR));
+	s[q - p] = L'\0';
+	return TRUE;
+}
+
+extern "C" BOOL WINAPI StrToIntExW(LPCWSTR s, DWORD flags, int *result)
+{
+	*result = 0;
+	while (*s == L' ' || *s == L'\t' || *s == L'\r' || *s == L'\n')
+		++s;
+	bool negative = false;
+	if (*s == L'-')
+	{
+		negative = true;
+		++s;
+	}
+	unsigned value = 0;
+	if ((flags & STIF_SUPPORT_HEX) && s[0] == L'0' && (s[1] == L'x' || s[1] == L'X'))
+	{
+		s += 2;
+		LPCWSTR const start = s;
+		for (;; ++s)
+		{
+			const WCHAR c = *s;
+			if (c >= L'0' && c <= L'9')
+				value = value * 16 + (c - L'0');
+			else if ((c | 0x20) >= L'a' && (c | 0x20) <= L'f')
+				value = value * 16 + ((c | 0x20) - L'a' + 10);
+			else
+				break;
+		}
+		if (s == start)
+			return FALSE;
+	}
+	else
+	{
+		if (*s < L'0' || *s > L'9')
+			return FALSE;
+		while (*s >= L'0' && *s <= L'9')
+			value = value * 10 + (*s++ - L'0');
+	}
+	*result = static_cast<int>(negative ? 0 - value : value);
+	return TRUE;
+}
+
+extern "C" int WINAPI StrToIntW(LPCWSTR s)
+{
+	int value;
+	StrToIntExW(s, STIF_DEFAULT, &value);
+	return value;
+}
+
+extern "C" HRESULT WINAPI SHStrDupW(LPCWSTR s, LPWSTR *result)
+{
+	*result = NULL;
+	if (s == NULL)
+		return E_INVALIDARG;
+	const size_t cb = (lstrlenW(s) + 1) * sizeof(WCHAR);
+	if ((*result = static_cast<LPWSTR>(CoTaskMemAlloc(cb))) == NULL)
+		return E_OUTOFMEMORY;
+	memcpy(*result, s, cb);
+	return S_OK;
+}
+
+// Supports the conversions the code and the tests make use of
+extern "C" int WINAPIV wnsprintfW(LPWSTR buffer, int cch, LPCWSTR format, ...)
+{
+	if (cch <= 0)
+		return -1;
+	va_list args;
+	va_start(args, format);
+	WideString out;
+	for (LPCWSTR p = format; *p != L'\0'; ++p)
+	{
+		if (*p != L'%')
+		{
+			out.push_back(*p);
+			continue;
+		}
+		char spec[16] = "%";
+		int n = 1;
+		++p;
+		while (*p == L'0' || *p == L'-' || (*p >= L'1' && *p <= L'9'))
+		{
+			if (n < 8)
+				spec[n++] = static_cast<char>(*p);
+			++p;
+		}
+		if (*p == L'l')
+			++p;
+		char text[64];
+		switch (*p)
+		{
+		case L's':
+			if (LPCWSTR s = va_arg(args, LPCWSTR))
+				out.insert(out.end(), s, s + lstrlenW(s));
+			continue;
+		case L'S':
+			if (LPCSTR s = va_arg(args, LPCSTR))
+				out.insert(out.end(), s, s + strlen(s));
+			continue;
+		case L'c':
+			out.push_back(static_cast<WCHAR>(va_arg(args, int)));
+			continue;
+		case L'd':
+		case L'i':
+		case L'u':
+		case L'x':
+		case L'X':
+			spec[n++] = static_cast<char>(*p);
+			spec[n] = '\0';
+			snprintf(text, sizeof text, spec, va_arg(args, int));
+			out.insert(out.end(), text, text + strlen(text));
+			continue;
+		case L'%':
+			out.push_back(L'%');
+			continue;
+		}
+		break;
+	}
+	va_end(args);
+	const int len = static_cast<int>(out.size()) < cch ? static_cast<int>(out.size()) : cch - 1;
+	std::copy(out.begin(), out.begin() + len, buffer);
+	buffer[len] = L'\0';
+	return static_cast<int>(out.size()) < cch ? len : -1;
+}
+
+// Paths
+
+bool Shim::MatchSpec(LPCWSTR name, LPCWSTR spec, int cchSpec)
+{
+	// *.* matches names without an extension as well
+	if (cchSpec == 3 && spec[0] == L'*' && spec[1] == L'.' && spec[2] == L'*')
+		return true;
+	LPCWSTR star = NULL;
+	LPCWSTR resume = NULL;
+	LPCWSTR const end = spec + cchSpec;
+	while (*name != L'\0')
+	{
+		if (spec < end && *spec == L'*')
+		{
+			star = ++spec;
+			resume = name;
+		}
+		else if (spec < end && (*spec == L'?' || UpCase(*spec) == UpCase(*name)))
+		{
+			++spec;
+			++name;
+		}
+		else if (star != NULL)
+		{
+			spec = star;
+			name = ++resume;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	while (spec < end && *spec == L'*')
+		++spec;
+	return spec == end;
+}
+
+extern "C" BOOL WINAPI PathMatchSpecW(LPCWSTR name, LPCWSTR spec)
+{
+	if (name == NULL || spec == NULL)
+		return FALSE;
+	while (*spec != L'\0')
+	{
+		while (*spec == L' ')
+			++spec;
+		LPCWSTR end = spec;
+		while (*end != L'\0' && *end != L';')
+			++end;
+		LPCWSTR last = end;
+		while (last > spec && last[-1] == L' ')
+			--last;
+		if (MatchSpec(name, spec, static_cast<int>(last - spec)))
+			return TRUE;
+		spec = *end ? end + 1 : end;
+	}
+	return FALSE;
+}
+
+extern "C" LPWSTR WINAPI PathFindFileNameW(LPCWSTR path)
+{
+	LPCWSTR name = path;
+	for (LPCWSTR p = path; *p != L'\0'; ++p)
+		if ((*p == L'\\' || *p == L':' || *p == L'/') && p[1] != L'\0' && p[1] != L'\\' && p[1] != L'/')
+			name = p + 1;
+	return const_cast<LPWSTR>(name);
+}
+
+extern "C" LPWSTR WINAPI PathFindNextComponentW(LPCWSTR path)
+{
+	if (path == NULL || *path == L'\0')
+		return NULL;
+	while (*path != L'\0')
+		if (*path++ == L'\\')
+			return const_cast<LPWSTR>(path);
+	return const_cast<LPWSTR>(path);
+}
+
+// Removes . and .. components in place, as PathCanonicalizeW() does
+static void Canonicalize(WideString &s)
+{
+	LPCWSTR p = &s[0];
+	WideString out;
+	if (p[0] != L'\0' && p[1] == L':')
+	{
+		out.assign(p, p + 2);
+		p += 2;
+	}
+	if (*p == L'\\')
+	{
+		out.push_back(L'\\');
+		++p;
+	}
+	const size_t root = out.size();
+	while (*p != L'\0')
+	{
+		LPCWSTR end = p;
+		while (*end != L'\0' && *end != L'\\')
+			++end;
+		const size_t len = end - p;
+		if (len == 1 && p[0] == L'.')
+		{
+			// Stay where we are
+		}
+		else if (len == 2 && p[0] == L'.' && p[1] == L'.')
+		{
+			if (out.size() > root)
+			{
+				out.pop_back();
+				while (out.size() > root && out.back() != L'\\')
+					out.pop_back();
+			}
+		}
+		else
+		{
+			out.insert(out.end(), p, end);
+			if (*end != L'\0')
+				out.push_back(L'\\');
+		}
+		p = *end ? end + 1 : end;
+	}
+	out.push_back(L'\0');
+	s.swap(out);
+}
+
+extern "C" LPWSTR WINAPI PathCombineW(LPWSTR dest, LPCWSTR dir, LPCWSTR file)
+{
+	if (dest == NULL || (dir == NULL && file == NULL))
+		return NULL;
+	WideString s;
+	const bool absolute = file != NULL && (file[0] == L'\\' || (file[0] != L'\0' && file[1] == L':'));
+	if (file == NULL || *file == L'\0')
+	{
+		s.assign(dir, dir + lstrlenW(dir));
+	}
+	else if (absolute || dir == NULL || *dir == L'\0')
+	{
+		s.assign(file, file + lstrlenW(file));
+	}
+	else
+	{
+		s.assign(dir, dir + lstrlenW(dir));
+		if (s.back() != L'\\')
+			s.push_back(L'\\');
+		s.insert(s.end(), file, file + lstrlenW(file));
+	}
+	s.push_back(L'\0');
+	Canonicalize(s);
+	if (s.size() > MAX_PATH)
+	{
+		*dest = L'\0';
+		return NULL;
+	}
+	std::copy(s.begin(), s.end(), dest);
+	return dest;
+}
+
+extern "C" LPWSTR WINAPI PathAddBackslashW(LPWSTR path)
+{
+	int len = lstrlenW(path);
+	if (len != 0 && path[len - 1] != L'\\')
+	{
+		if (len + 1 >= MAX_PATH)
+			return NULL;
+		path[len++] = L'\\';
+		path[len] = L'\0';
+	}
+	return path + len;
+}
+
+extern "C" BOOL WINAPI PathRemoveFileSpecW(LPWSTR path)
+{
+	LPWSTR const name = PathFindFileNameW(path);
+	if (name == path && !(path[0] != L'\0' && path[1] == L':'))
+	{
+		const BOOL changed = *path != L'\0';
+		*path = L'\0';
+		return changed;
+	}
+	LPWSTR end = name;
+	// Keep the backslash which stands for the root
+	if (end > path && end[-1] == L'\\' && !(end - 1 == path || (end - 3 == path && path[1] == L':')))
+		--end;
+	const BOOL changed = *end != L'\0';
+	*end = L'\0';
+	return changed;
+}
+
+extern "C" int WINAPI PathCommonPrefixW(LPCWSTR p, LPCWSTR q, LPWSTR prefix)
+{
+	int len = 0;
+	for (int i = 0;; ++i)
+	{
+		const WCHAR a = p[i];
+		const WCHAR b = q[i];
+		if ((a == L'\0' || a == L'\\') && (b == L'\0' || b == L'\\'))
+		{
+			// Include the backslash if all there is in common is the root
+			len = i == 2 && p[1] == L':' && a == L'\\' && b == L'\\' ? 3 : i;
+			if (a == L'\0' || b == L'\0')
+				break;
+		}
+		else if (UpCase(a) != UpCase(b))
+		{
+			break;
+		}
+	}
+	if (prefix)
+	{
+		lstrcpynW(prefix, p, len + 1);
+	}
+	return len;
+}
+
+extern "C" LPWSTR WINAPI PathGetArgsW(LPCWSTR path)
+{
+	bool quoted = false;
+	for (; *path != L'\0'; ++path)
+	{
+		if (*path == L'"')
+			quoted = !quoted;
+		else if (*path == L' ' && !quoted)
+			return const_cast<LPWSTR>(path + 1);
+	}
+	return const_cast<LPWSTR>(path);
+}
+
+extern "C" void WINAPI PathRemoveArgsW(LPWSTR path)
+{
+	LPWSTR const args = PathGetArgsW(path);
+	if (*args != L'\0' || (args > path && args[-1] == L' '))
+		args[-1] = L'\0';
+}
+
+extern "C" void WINAPI PathUnquoteSpacesW(LPWSTR path)
+{
+	const int len = lstrlenW(path);
+	if (len >= 2 && path[0] == L'"' && path[len - 1] == L'"')
+	{
+		memmove(path, path + 1, (len - 2) * sizeof(WCHAR));
+		path[len - 2] = L'\0';
+	}
+}
+
+// Streams on files
+
+namespace
+{
+	class FileStream : public IStream
+	{
+		LONG refs;
+		int fd;
+	public:
+		explicit FileStream(int fd): refs(1), fd(fd) { }
+		virtual ~FileStream() { close(fd); }
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void **ppv)
+		{
+			*ppv = this;
+			AddRef();
+			return S_OK;
+		}
+		ULONG STDMETHODCALLTYPE AddRef()
+		{
+			return InterlockedIncrement(&refs);
+		}
+		ULONG STDMETHODCALLTYPE Release()
+		{
+			const LONG n = InterlockedDecrement(&refs);
+			if (n == 0)
+				delete this;
+			return n;
+		}
+		HRESULT STDMETHODCALLTYPE Read(void *data, ULONG cb, ULONG *read)
+		{
+			ULONG total = 0;
+			while (total < cb)
+			{
+				const ssize_t n = ::read(fd, static_cast<BYTE *>(data) + total, cb - total);
+				if (n < 0)
+					return HRESULT_FROM_WIN32(ErrorFromErrno(errno));
+				if (n == 0)
+					break;
+				total += static_cast<ULONG>(n);
+			}
+			if (read)
+				*read = total;
+			return total < cb ? S_FALSE : S_OK;
+		}
+		HRESULT STDMETHODCALLTYPE Write(const void *data, ULONG cb, ULONG *written)
+		{
+			ULONG total = 0;
+			while (total < cb)
+			{
+				const ssize_t n = ::write(fd, static_cast<const BYTE *>(data) + total, cb - total);
+				if (n <= 0)
+					return HRESULT_FROM_WIN32(ErrorFromErrno(errno));
+				total += static_cast<ULONG>(n);
+			}
+			if (written)
+				*written = total;
+			return S_OK;
+		}
+		HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER distance, DWORD origin, ULARGE_INTEGER *position)
+		{
+			const int whence = origin == STREAM_SEEK_SET ? SEEK_SET : origin == STREAM_SEEK_CUR ? SEEK_CUR : SEEK_END;
+			const off_t pos = lseek(fd, distance.QuadPart, whence);
+			if (pos == -1)
+				return HRESULT_FROM_WIN32(ErrorFromErrno(errno));
+			if (position)
+				position->QuadPart = pos;
+			return S_OK;
+		}
+		HRESULT STDMETHODCALLTYPE SetSize(ULARGE_INTEGER size)
+		{
+			return ftruncate(fd, size.QuadPart) == 0 ? S_OK : HRESULT_FROM_WIN32(ErrorFromErrno(errno));
+		}
+	};
+}
+
+extern "C" HRESULT WINAPI SHCreateStreamOnFileEx(LPCWSTR path, DWORD mode, DWORD, BOOL create, IStream *, IStream **stream)
+{
+	*stream = NULL;
+	int flags = O_CLOEXEC;
+	switch (mode & 3)
+	{
+	case STGM_WRITE:
+		flags |= O_WRONLY;
+		break;
+	case STGM_READWRITE:
+		flags |= O_RDWR;
+		break;
+	default:
+		flags |= O_RDONLY;
+		break;
+	}
+	if (mode & STGM_CREATE)
+		flags |= O_CREAT | O_TRUNC;
+	else if (create)
+		flags |= O_CREAT | O_EXCL;
+	const int fd = open(ToLocalPath(path).c_str(), flags, 0644);
+	if (fd == -1)
+		return HRESULT_FROM_WIN32(ErrorFromErrno(errno));
+	*stream = new FileStream(fd);
+	return S_OK;
+}
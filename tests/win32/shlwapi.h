@@ -0,0 +1,710 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Stands in for the Windows SDK when building the sources on Linux for the
+// tests. It declares just what the sources use, with the same layouts and
+// sizes as on 64-bit Windows, provided the compiler is told -fshort-wchar.
+// The functions are implemented on top of POSIX in the accompanying files.
+// _M_X64 is deliberately left undefined, so the tests can take the SSE2 code
+// paths away through IsProcessorFeaturePresent().
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define _WIN64
+
+#define WINAPI
+#define CALLBACK
+#define WINAPIV
+#define STDMETHODCALLTYPE
+#define STDAPI extern "C" HRESULT
+#define STDAPICALLTYPE
+#define CONST const
+#define VOID void
+
+#define C_ASSERT(e) typedef char __C_ASSERT__[(e) ? 1 : -1] __attribute__((unused))
+#define _countof(a) (sizeof(a) / sizeof *(a))
+#define FIELD_OFFSET(t, f) ((LONG)offsetof(t, f))
+#define UNREFERENCED_PARAMETER(p) (void)(p)
+
+// Basic types
+
+typedef unsigned char BYTE, UCHAR, BOOLEAN;
+typedef unsigned short WORD, USHORT, ATOM, LANGID;
+typedef wchar_t WCHAR;
+typedef char CHAR;
+typedef int BOOL, INT;
+typedef unsigned int UINT, DWORD, ULONG, LCID, REGSAM;
+typedef int LONG, LSTATUS, HRESULT;
+typedef uint64_t ULONGLONG, DWORD64, UINT64, ULONG64;
+typedef int64_t LONGLONG, INT64, LONG64;
+typedef size_t SIZE_T, ULONG_PTR, UINT_PTR, DWORD_PTR;
+typedef ptrdiff_t LONG_PTR, INT_PTR;
+typedef void *HANDLE, *LPVOID, *PVOID, *HGLOBAL, *HLOCAL, *HRSRC, *PSID;
+typedef void *HCRYPTPROV, *HCRYPTKEY, *HCERTSTORE;
+typedef const void *LPCVOID;
+typedef struct HKEY__ *HKEY, **PHKEY;
+typedef struct HINSTANCE__ *HMODULE, *HINSTANCE;
+typedef struct HWND__ *HWND;
+typedef WCHAR *LPWSTR, *PWSTR, *BSTR, *LPOLESTR;
+typedef const WCHAR *LPCWSTR, *PCWSTR, *LPCOLESTR;
+typedef CHAR *LPSTR;
+typedef const CHAR *LPCSTR;
+typedef BYTE *LPBYTE, *PBYTE;
+typedef DWORD *LPDWORD, *PDWORD;
+typedef LONG *PLONG;
+typedef INT_PTR (WINAPI *FARPROC)();
+
+#define TRUE 1
+#define FALSE 0
+#define MAX_PATH 260
+#define MAXLONG 0x7fffffff
+#define MAXDWORD 0xffffffff
+#define INFINITE 0xFFFFFFFF
+
+#define LOWORD(l) ((WORD)((DWORD_PTR)(l) & 0xffff))
+#define HIWORD(l) ((WORD)((DWORD_PTR)(l) >> 16))
+#define MAKELONG(a, b) ((LONG)(((WORD)(a)) | ((DWORD)((WORD)(b))) << 16))
+#define MAKELANGID(p, s) ((((WORD)(s)) << 10) | (WORD)(p))
+#define UInt32x32To64(a, b) ((ULONGLONG)(DWORD)(a) * (DWORD)(b))
+
+typedef struct _FILETIME { DWORD dwLowDateTime, dwHighDateTime; } FILETIME, *LPFILETIME;
+typedef union _LARGE_INTEGER { struct { DWORD LowPart; LONG HighPart; }; LONGLONG QuadPart; } LARGE_INTEGER;
+typedef union _ULARGE_INTEGER { struct { DWORD LowPart; DWORD HighPart; }; ULONGLONG QuadPart; } ULARGE_INTEGER;
+
+typedef struct _GUID { DWORD Data1; WORD Data2; WORD Data3; BYTE Data4[8]; } GUID, IID, CLSID;
+typedef const GUID &REFGUID, &REFIID, &REFCLSID;
+inline bool operator==(const GUID &a, const GUID &b) { return __builtin_memcmp(&a, &b, sizeof a) == 0; }
+inline bool operator!=(const GUID &a, const GUID &b) { return !(a == b); }
+inline bool IsEqualGUID(const GUID &a, const GUID &b) { return a == b; }
+
+// Status codes
+
+#define S_OK ((HRESULT)0)
+#define S_FALSE ((HRESULT)1)
+#define E_NOTIMPL ((HRESULT)0x80004001)
+#define E_POINTER ((HRESULT)0x80004003)
+#define E_ABORT ((HRESULT)0x80004004)
+#define E_FAIL ((HRESULT)0x80004005)
+#define E_UNEXPECTED ((HRESULT)0x8000FFFF)
+#define E_ACCESSDENIED ((HRESULT)0x80070005)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000E)
+#define E_INVALIDARG ((HRESULT)0x80070057)
+#define E_NOINTERFACE ((HRESULT)0x80004002)
+#define DISP_E_UNKNOWNNAME ((HRESULT)0x80020006)
+#define TYPE_E_INVDATAREAD ((HRESULT)0x80028018)
+#define TYPE_E_CANTLOADLIBRARY ((HRESULT)0x80029C4A)
+#define CO_E_CLASSSTRING ((HRESULT)0x800401F3)
+#define CLASS_E_CLASSNOTAVAILABLE ((HRESULT)0x80040111)
+#define REGDB_E_CLASSNOTREG ((HRESULT)0x80040154)
+
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+#define FACILITY_WIN32 7
+#define HRESULT_FROM_WIN32(x) ((HRESULT)(x) <= 0 ? ((HRESULT)(x)) : ((HRESULT)(((x) & 0x0000FFFF) | (FACILITY_WIN32 << 16) | 0x80000000)))
+#define HRESULT_CODE(hr) ((hr) & 0xFFFF)
+
+#define ERROR_SUCCESS 0L
+#define ERROR_INVALID_FUNCTION 1L
+#define ERROR_FILE_NOT_FOUND 2L
+#define ERROR_PATH_NOT_FOUND 3L
+#define ERROR_ACCESS_DENIED 5L
+#define ERROR_INVALID_HANDLE 6L
+#define ERROR_NOT_ENOUGH_MEMORY 8L
+#define ERROR_BAD_FORMAT 11L
+#define ERROR_INVALID_DATA 13L
+#define ERROR_OUTOFMEMORY 14L
+#define ERROR_NO_MORE_FILES 18L
+#define ERROR_HANDLE_EOF 38L
+#define ERROR_NOT_SUPPORTED 50L
+#define ERROR_FILE_EXISTS 80L
+#define ERROR_INVALID_PARAMETER 87L
+#define ERROR_CALL_NOT_IMPLEMENTED 120L
+#define ERROR_INSUFFICIENT_BUFFER 122L
+#define ERROR_MOD_NOT_FOUND 126L
+#define ERROR_PROC_NOT_FOUND 127L
+#define ERROR_ALREADY_EXISTS 183L
+#define ERROR_BAD_EXE_FORMAT 193L
+#define ERROR_FILENAME_EXCED_RANGE 206L
+#define ERROR_FILE_TOO_LARGE 223L
+#define ERROR_MORE_DATA 234L
+#define ERROR_NO_MORE_ITEMS 259L
+#define ERROR_FILE_INVALID 1006L
+#define ERROR_KEY_DELETED 1018L
+#define ERROR_NOT_FOUND 1168L
+#define ERROR_TIMEOUT 1460L
+#define ERROR_RESOURCE_DATA_NOT_FOUND 1812L
+#define ERROR_RESOURCE_TYPE_NOT_FOUND 1813L
+
+// Memory
+
+#define HEAP_NO_SERIALIZE 0x00000001
+#define HEAP_ZERO_MEMORY 0x00000008
+
+// Files
+
+#define INVALID_HANDLE_VALUE ((HANDLE)(LONG_PTR)-1)
+#define GENERIC_READ 0x80000000
+#define GENERIC_WRITE 0x40000000
+#define DELETE 0x00010000
+#define FILE_SHARE_READ 0x00000001
+#define FILE_SHARE_WRITE 0x00000002
+#define FILE_SHARE_DELETE 0x00000004
+#define CREATE_NEW 1
+#define CREATE_ALWAYS 2
+#define OPEN_EXISTING 3
+#define OPEN_ALWAYS 4
+#define TRUNCATE_EXISTING 5
+#define FILE_ATTRIBUTE_READONLY 0x00000001
+#define FILE_ATTRIBUTE_DIRECTORY 0x00000010
+#define FILE_ATTRIBUTE_NORMAL 0x00000080
+#define FILE_ATTRIBUTE_TEMPORARY 0x00000100
+#define FILE_FLAG_SEQUENTIAL_SCAN 0x08000000
+#define FILE_BEGIN 0
+#define FILE_CURRENT 1
+#define FILE_END 2
+#define PAGE_READONLY 0x02
+#define PAGE_READWRITE 0x04
+#define PAGE_WRITECOPY 0x08
+#define FILE_MAP_COPY 0x0001
+#define FILE_MAP_WRITE 0x0002
+#define FILE_MAP_READ 0x0004
+#define MOVEFILE_REPLACE_EXISTING 0x00000001
+#define MOVEFILE_WRITE_THROUGH 0x00000008
+
+typedef struct _WIN32_FIND_DATAW
+{
+	DWORD dwFileAttributes;
+	FILETIME ftCreationTime;
+	FILETIME ftLastAccessTime;
+	FILETIME ftLastWriteTime;
+	DWORD nFileSizeHigh;
+	DWORD nFileSizeLow;
+	DWORD dwReserved0;
+	DWORD dwReserved1;
+	WCHAR cFileName[MAX_PATH];
+	WCHAR cAlternateFileName[14];
+} WIN32_FIND_DATAW;
+
+typedef struct _BY_HANDLE_FILE_INFORMATION
+{
+	DWORD dwFileAttributes;
+	FILETIME ftCreationTime;
+	FILETIME ftLastAccessTime;
+	FILETIME ftLastWriteTime;
+	DWORD dwVolumeSerialNumber;
+	DWORD nFileSizeHigh;
+	DWORD nFileSizeLow;
+	DWORD nNumberOfLinks;
+	DWORD nFileIndexHigh;
+	DWORD nFileIndexLow;
+} BY_HANDLE_FILE_INFORMATION;
+
+#define STD_INPUT_HANDLE ((DWORD)-10)
+#define STD_OUTPUT_HANDLE ((DWORD)-11)
+#define STD_ERROR_HANDLE ((DWORD)-12)
+
+// Code pages
+
+#define CP_ACP 0
+#define CP_UTF8 65001
+#define MB_ERR_INVALID_CHARS 0x00000008
+#define CSTR_LESS_THAN 1
+#define CSTR_EQUAL 2
+#define CSTR_GREATER_THAN 3
+#define STIF_DEFAULT 0x00000000
+#define STIF_SUPPORT_HEX 0x00000001
+
+// Threads and synchronization
+
+#define WAIT_OBJECT_0 0x00000000
+#define WAIT_TIMEOUT 258L
+#define WAIT_FAILED ((DWORD)0xFFFFFFFF)
+#define MAXIMUM_WAIT_OBJECTS 64
+
+typedef struct _RTL_SRWLOCK { PVOID Ptr; } SRWLOCK, *PSRWLOCK;
+typedef struct _RTL_CONDITION_VARIABLE { PVOID Ptr; } CONDITION_VARIABLE, *PCONDITION_VARIABLE;
+typedef union _RTL_RUN_ONCE { PVOID Ptr; } INIT_ONCE, *PINIT_ONCE;
+#define SRWLOCK_INIT { 0 }
+#define CONDITION_VARIABLE_INIT { 0 }
+#define INIT_ONCE_STATIC_INIT { 0 }
+
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID);
+typedef BOOL (CALLBACK *PINIT_ONCE_FN)(PINIT_ONCE, PVOID, PVOID *);
+
+typedef struct _SYSTEM_INFO
+{
+	union { DWORD dwOemId; struct { WORD wProcessorArchitecture; WORD wReserved; }; };
+	DWORD dwPageSize;
+	LPVOID lpMinimumApplicationAddress;
+	LPVOID lpMaximumApplicationAddress;
+	DWORD_PTR dwActiveProcessorMask;
+	DWORD dwNumberOfProcessors;
+	DWORD dwProcessorType;
+	DWORD dwAllocationGranularity;
+	WORD wProcessorLevel;
+	WORD wProcessorRevision;
+} SYSTEM_INFO;
+
+#define PF_XMMI64_INSTRUCTIONS_AVAILABLE 10
+
+// Modules and resources
+
+#define MAKEINTRESOURCEW(i) ((LPWSTR)((ULONG_PTR)((WORD)(i))))
+#define IS_INTRESOURCE(r) ((((ULONG_PTR)(r)) >> 16) == 0)
+#define RT_MANIFEST MAKEINTRESOURCEW(24)
+#define GET_MODULE_HANDLE_EX_FLAG_PIN 0x00000001
+#define LANG_NEUTRAL 0x00
+#define SUBLANG_NEUTRAL 0x00
+
+// Registry
+
+#define HKEY_CLASSES_ROOT ((HKEY)(ULONG_PTR)((LONG)0x80000000))
+#define HKEY_CURRENT_USER ((HKEY)(ULONG_PTR)((LONG)0x80000001))
+#define HKEY_LOCAL_MACHINE ((HKEY)(ULONG_PTR)((LONG)0x80000002))
+#define HKEY_USERS ((HKEY)(ULONG_PTR)((LONG)0x80000003))
+#define HKEY_CURRENT_CONFIG ((HKEY)(ULONG_PTR)((LONG)0x80000005))
+
+#define REG_NONE 0
+#define REG_SZ 1
+#define REG_EXPAND_SZ 2
+#define REG_BINARY 3
+#define REG_DWORD 4
+#define REG_DWORD_BIG_ENDIAN 5
+#define REG_LINK 6
+#define REG_MULTI_SZ 7
+#define REG_QWORD 11
+
+#define KEY_QUERY_VALUE 0x0001
+#define KEY_SET_VALUE 0x0002
+#define KEY_CREATE_SUB_KEY 0x0004
+#define KEY_ENUMERATE_SUB_KEYS 0x0008
+#define KEY_NOTIFY 0x0010
+#define KEY_READ 0x20019
+#define KEY_WRITE 0x20006
+#define KEY_ALL_ACCESS 0xF003F
+#define REG_OPTION_NON_VOLATILE 0x00000000
+#define REG_CREATED_NEW_KEY 0x00000001
+#define REG_OPENED_EXISTING_KEY 0x00000002
+#define REG_NOTIFY_CHANGE_NAME 0x00000001
+#define REG_NOTIFY_CHANGE_ATTRIBUTES 0x00000002
+#define REG_NOTIFY_CHANGE_LAST_SET 0x00000004
+#define REG_NOTIFY_CHANGE_SECURITY 0x00000008
+
+// Security
+
+typedef struct _SID_IDENTIFIER_AUTHORITY { BYTE Value[6]; } SID_IDENTIFIER_AUTHORITY;
+#define SECURITY_NT_AUTHORITY { 0, 0, 0, 0, 0, 5 }
+#define SECURITY_BUILTIN_DOMAIN_RID 0x00000020
+#define DOMAIN_ALIAS_RID_ADMINS 0x00000220
+
+// COM
+
+#define CLSCTX_INPROC_SERVER 0x1
+#define CLSCTX_ALL 0x17
+#define STGM_READ 0x00000000
+#define STGM_WRITE 0x00000001
+#define STGM_READWRITE 0x00000002
+#define STGM_SHARE_DENY_NONE 0x00000040
+#define STGM_SHARE_DENY_WRITE 0x00000020
+#define STGM_CREATE 0x00001000
+#define STGM_FAILIFTHERE 0x00000000
+#define STREAM_SEEK_SET 0
+#define STREAM_SEEK_CUR 1
+#define STREAM_SEEK_END 2
+#define MEMBERID_NIL (-1)
+
+struct IUnknown
+{
+	virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void **) = 0;
+	virtual ULONG STDMETHODCALLTYPE AddRef() = 0;
+	virtual ULONG STDMETHODCALLTYPE Release() = 0;
+};
+
+struct IStream : IUnknown
+{
+	virtual HRESULT STDMETHODCALLTYPE Read(void *, ULONG, ULONG *) = 0;
+	virtual HRESULT STDMETHODCALLTYPE Write(const void *, ULONG, ULONG *) = 0;
+	virtual HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER, DWORD, ULARGE_INTEGER *) = 0;
+	virtual HRESULT STDMETHODCALLTYPE SetSize(ULARGE_INTEGER) = 0;
+};
+
+typedef HRESULT (STDMETHODCALLTYPE *LPFNGETCLASSOBJECT)(REFCLSID, REFIID, LPVOID *);
+typedef HRESULT (STDMETHODCALLTYPE *LPFNCANUNLOADNOW)();
+
+typedef struct tagVARIANT { WORD vt; WORD wReserved1, wReserved2, wReserved3; union { LONG lVal; BSTR bstrVal; IUnknown *punkVal; }; } VARIANT;
+
+// Type libraries
+
+typedef enum tagTYPEKIND
+{
+	TKIND_ENUM, TKIND_RECORD, TKIND_MODULE, TKIND_INTERFACE, TKIND_DISPATCH,
+	TKIND_COCLASS, TKIND_ALIAS, TKIND_UNION, TKIND_MAX
+} TYPEKIND;
+
+typedef enum tagSYSKIND { SYS_WIN16, SYS_WIN32, SYS_MAC, SYS_WIN64 } SYSKIND;
+typedef enum tagREGKIND { REGKIND_DEFAULT, REGKIND_REGISTER, REGKIND_NONE } REGKIND;
+
+#define TYPEFLAG_FHIDDEN 0x10
+#define TYPEFLAG_FDUAL 0x40
+#define TYPEFLAG_FOLEAUTOMATION 0x100
+#define TYPEFLAG_FDISPATCHABLE 0x1000
+
+typedef struct tagTYPEATTR
+{
+	GUID guid;
+	LCID lcid;
+	DWORD dwReserved;
+	LONG memidConstructor;
+	LONG memidDestructor;
+	LPOLESTR lpstrSchema;
+	ULONG cbSizeInstance;
+	TYPEKIND typekind;
+	WORD cFuncs, cVars, cImplTypes, cbSizeVft, cbAlignment, wTypeFlags, wMajorVerNum, wMinorVerNum;
+} TYPEATTR;
+
+struct ITypeInfo : IUnknown
+{
+	virtual HRESULT STDMETHODCALLTYPE GetTypeAttr(TYPEATTR **) = 0;
+	virtual HRESULT STDMETHODCALLTYPE GetDocumentation(LONG, BSTR *, BSTR *, DWORD *, BSTR *) = 0;
+	virtual void STDMETHODCALLTYPE ReleaseTypeAttr(TYPEATTR *) = 0;
+};
+
+struct ITypeLib : IUnknown
+{
+	virtual UINT STDMETHODCALLTYPE GetTypeInfoCount() = 0;
+	virtual HRESULT STDMETHODCALLTYPE GetTypeInfo(UINT, ITypeInfo **) = 0;
+	virtual HRESULT STDMETHODCALLTYPE GetDocumentation(INT, BSTR *, BSTR *, DWORD *, BSTR *) = 0;
+};
+
+// OLE miscellaneous status bits
+
+#define OLEMISC_RECOMPOSEONRESIZE 0x1
+#define OLEMISC_ONLYICONIC 0x2
+#define OLEMISC_INSERTNOTREPLACE 0x4
+#define OLEMISC_STATIC 0x8
+#define OLEMISC_CANTLINKINSIDE 0x10
+#define OLEMISC_CANLINKBYOLE1 0x20
+#define OLEMISC_ISLINKOBJECT 0x40
+#define OLEMISC_INSIDEOUT 0x80
+#define OLEMISC_ACTIVATEWHENVISIBLE 0x100
+#define OLEMISC_RENDERINGISDEVICEINDEPENDENT 0x200
+#define OLEMISC_INVISIBLEATRUNTIME 0x400
+#define OLEMISC_ALWAYSRUN 0x800
+#define OLEMISC_ACTSLIKEBUTTON 0x1000
+#define OLEMISC_ACTSLIKELABEL 0x2000
+#define OLEMISC_NOUIACTIVATE 0x4000
+#define OLEMISC_ALIGNABLE 0x8000
+#define OLEMISC_SIMPLEFRAME 0x10000
+#define OLEMISC_SETCLIENTSITEFIRST 0x20000
+#define OLEMISC_IMEMODE 0x40000
+#define OLEMISC_IGNOREACTIVATEWHENVISIBLE 0x80000
+#define OLEMISC_WANTSTOMENUMERGE 0x100000
+#define OLEMISC_SUPPORTSMULTILEVELUNDO 0x200000
+
+// Portable executables
+
+#define IMAGE_DOS_SIGNATURE 0x5A4D
+#define IMAGE_NT_SIGNATURE 0x00004550
+#define IMAGE_NT_OPTIONAL_HDR32_MAGIC 0x10b
+#define IMAGE_NT_OPTIONAL_HDR64_MAGIC 0x20b
+#define IMAGE_NUMBEROF_DIRECTORY_ENTRIES 16
+#define IMAGE_DIRECTORY_ENTRY_RESOURCE 2
+#define IMAGE_DIRECTORY_ENTRY_SECURITY 4
+#define IMAGE_DIRECTORY_ENTRY_BASERELOC 5
+#define IMAGE_DIRECTORY_ENTRY_DEBUG 6
+#define IMAGE_SIZEOF_SHORT_NAME 8
+#define IMAGE_FILE_MACHINE_I386 0x014c
+#define IMAGE_FILE_MACHINE_AMD64 0x8664
+#define IMAGE_FILE_EXECUTABLE_IMAGE 0x0002
+#define IMAGE_FILE_DLL 0x2000
+#define IMAGE_RESOURCE_NAME_IS_STRING 0x80000000
+#define IMAGE_RESOURCE_DATA_IS_DIRECTORY 0x80000000
+#define IMAGE_SCN_CNT_INITIALIZED_DATA 0x00000040
+#define IMAGE_SCN_MEM_DISCARDABLE 0x02000000
+#define IMAGE_SCN_MEM_READ 0x40000000
+
+typedef struct _IMAGE_DOS_HEADER
+{
+	WORD e_magic, e_cblp, e_cp, e_crlc, e_cparhdr, e_minalloc, e_maxalloc, e_ss, e_sp, e_csum, e_ip, e_cs, e_lfarlc, e_ovno;
+	WORD e_res[4];
+	WORD e_oemid, e_oeminfo;
+	WORD e_res2[10];
+	LONG e_lfanew;
+} IMAGE_DOS_HEADER;
+
+typedef struct _IMAGE_FILE_HEADER
+{
+	WORD Machine;
+	WORD NumberOfSections;
+	DWORD TimeDateStamp;
+	DWORD PointerToSymbolTable;
+	DWORD NumberOfSymbols;
+	WORD SizeOfOptionalHeader;
+	WORD Characteristics;
+} IMAGE_FILE_HEADER;
+
+typedef struct _IMAGE_DATA_DIRECTORY { DWORD VirtualAddress; DWORD Size; } IMAGE_DATA_DIRECTORY;
+
+typedef struct _IMAGE_OPTIONAL_HEADER
+{
+	WORD Magic;
+	BYTE MajorLinkerVersion, MinorLinkerVersion;
+	DWORD SizeOfCode, SizeOfInitializedData, SizeOfUninitializedData, AddressOfEntryPoint, BaseOfCode, BaseOfData;
+	DWORD ImageBase, SectionAlignment, FileAlignment;
+	WORD MajorOperatingSystemVersion, MinorOperatingSystemVersion, MajorImageVersion, MinorImageVersion, MajorSubsystemVersion, MinorSubsystemVersion;
+	DWORD Win32VersionValue, SizeOfImage, SizeOfHeaders, CheckSum;
+	WORD Subsystem, DllCharacteristics;
+	DWORD SizeOfStackReserve, SizeOfStackCommit, SizeOfHeapReserve, SizeOfHeapCommit;
+	DWORD LoaderFlags, NumberOfRvaAndSizes;
+	IMAGE_DATA_DIRECTORY DataDirectory[IMAGE_NUMBEROF_DIRECTORY_ENTRIES];
+} IMAGE_OPTIONAL_HEADER32;
+
+typedef struct _IMAGE_OPTIONAL_HEADER64
+{
+	WORD Magic;
+	BYTE MajorLinkerVersion, MinorLinkerVersion;
+	DWORD SizeOfCode, SizeOfInitializedData, SizeOfUninitializedData, AddressOfEntryPoint, BaseOfCode;
+	ULONGLONG ImageBase;
+	DWORD SectionAlignment, FileAlignment;
+	WORD MajorOperatingSystemVersion, MinorOperatingSystemVersion, MajorImageVersion, MinorImageVersion, MajorSubsystemVersion, MinorSubsystemVersion;
+	DWORD Win32VersionValue, SizeOfImage, SizeOfHeaders, CheckSum;
+	WORD Subsystem, DllCharacteristics;
+	ULONGLONG SizeOfStackReserve, SizeOfStackCommit, SizeOfHeapReserve, SizeOfHeapCommit;
+	DWORD LoaderFlags, NumberOfRvaAndSizes;
+	IMAGE_DATA_DIRECTORY DataDirectory[IMAGE_NUMBEROF_DIRECTORY_ENTRIES];
+} IMAGE_OPTIONAL_HEADER64;
+
+typedef struct _IMAGE_NT_HEADERS { DWORD Signature; IMAGE_FILE_HEADER FileHeader; IMAGE_OPTIONAL_HEADER32 OptionalHeader; } IMAGE_NT_HEADERS32;
+typedef struct _IMAGE_NT_HEADERS64 { DWORD Signature; IMAGE_FILE_HEADER FileHeader; IMAGE_OPTIONAL_HEADER64 OptionalHeader; } IMAGE_NT_HEADERS64;
+
+typedef struct _IMAGE_SECTION_HEADER
+{
+	BYTE Name[IMAGE_SIZEOF_SHORT_NAME];
+	union { DWORD PhysicalAddress; DWORD VirtualSize; } Misc;
+	DWORD VirtualAddress, SizeOfRawData, PointerToRawData, PointerToRelocations, PointerToLinenumbers;
+	WORD NumberOfRelocations, NumberOfLinenumbers;
+	DWORD Characteristics;
+} IMAGE_SECTION_HEADER;
+
+#define IMAGE_FIRST_SECTION(h) ((IMAGE_SECTION_HEADER *)((ULONG_PTR)(h) + FIELD_OFFSET(IMAGE_NT_HEADERS32, OptionalHeader) + (h)->FileHeader.SizeOfOptionalHeader))
+
+typedef struct _IMAGE_RESOURCE_DIRECTORY
+{
+	DWORD Characteristics, TimeDateStamp;
+	WORD MajorVersion, MinorVersion, NumberOfNamedEntries, NumberOfIdEntries;
+} IMAGE_RESOURCE_DIRECTORY;
+
+typedef struct _IMAGE_RESOURCE_DIRECTORY_ENTRY
+{
+	union { struct { DWORD NameOffset:31; DWORD NameIsString:1; }; DWORD Name; WORD Id; };
+	union { DWORD OffsetToData; struct { DWORD OffsetToDirectory:31; DWORD DataIsDirectory:1; }; };
+} IMAGE_RESOURCE_DIRECTORY_ENTRY;
+
+typedef struct _IMAGE_RESOURCE_DIR_STRING_U { WORD Length; WCHAR NameString[1]; } IMAGE_RESOURCE_DIR_STRING_U;
+typedef struct _IMAGE_RESOURCE_DATA_ENTRY { DWORD OffsetToData, Size, CodePage, Reserved; } IMAGE_RESOURCE_DATA_ENTRY;
+
+extern "C" {
+
+// kernel32
+
+DWORD WINAPI GetLastError();
+void WINAPI SetLastError(DWORD);
+void WINAPI ExitProcess(UINT);
+LPWSTR WINAPI GetCommandLineW();
+
+HANDLE WINAPI GetProcessHeap();
+HANDLE WINAPI HeapCreate(DWORD, SIZE_T, SIZE_T);
+BOOL WINAPI HeapDestroy(HANDLE);
+LPVOID WINAPI HeapAlloc(HANDLE, DWORD, SIZE_T);
+LPVOID WINAPI HeapReAlloc(HANDLE, DWORD, LPVOID, SIZE_T);
+BOOL WINAPI HeapFree(HANDLE, DWORD, LPVOID);
+SIZE_T WINAPI HeapSize(HANDLE, DWORD, LPCVOID);
+HLOCAL WINAPI LocalFree(HLOCAL);
+void *WINAPI SecureZeroMemory(void *, SIZE_T);
+
+int WINAPI lstrlenW(LPCWSTR);
+int WINAPI lstrlenA(LPCSTR);
+LPWSTR WINAPI lstrcpyW(LPWSTR, LPCWSTR);
+LPWSTR WINAPI lstrcpynW(LPWSTR, LPCWSTR, int);
+int WINAPI lstrcmpW(LPCWSTR, LPCWSTR);
+int WINAPI lstrcmpiW(LPCWSTR, LPCWSTR);
+int WINAPI CompareStringOrdinal(LPCWSTR, int, LPCWSTR, int, BOOL);
+int WINAPI MultiByteToWideChar(UINT, DWORD, LPCSTR, int, LPWSTR, int);
+int WINAPI WideCharToMultiByte(UINT, DWORD, LPCWSTR, int, LPSTR, int, LPCSTR, BOOL *);
+int WINAPI MulDiv(int, int, int);
+
+HANDLE WINAPI GetStdHandle(DWORD);
+HANDLE WINAPI CreateFileW(LPCWSTR, DWORD, DWORD, void *, DWORD, DWORD, HANDLE);
+BOOL WINAPI CloseHandle(HANDLE);
+BOOL WINAPI ReadFile(HANDLE, LPVOID, DWORD, LPDWORD, void *);
+BOOL WINAPI WriteFile(HANDLE, LPCVOID, DWORD, LPDWORD, void *);
+BOOL WINAPI GetFileSizeEx(HANDLE, LARGE_INTEGER *);
+BOOL WINAPI SetFilePointerEx(HANDLE, LARGE_INTEGER, LARGE_INTEGER *, DWORD);
+BOOL WINAPI SetEndOfFile(HANDLE);
+BOOL WINAPI FlushFileBuffers(HANDLE);
+BOOL WINAPI GetFileInformationByHandle(HANDLE, BY_HANDLE_FILE_INFORMATION *);
+HANDLE WINAPI CreateFileMappingW(HANDLE, void *, DWORD, DWORD, DWORD, LPCWSTR);
+LPVOID WINAPI MapViewOfFile(HANDLE, DWORD, DWORD, DWORD, SIZE_T);
+BOOL WINAPI UnmapViewOfFile(LPCVOID);
+BOOL WINAPI FlushViewOfFile(LPCVOID, SIZE_T);
+BOOL WINAPI MoveFileExW(LPCWSTR, LPCWSTR, DWORD);
+BOOL WINAPI DeleteFileW(LPCWSTR);
+BOOL WINAPI CreateDirectoryW(LPCWSTR, void *);
+UINT WINAPI GetTempFileNameW(LPCWSTR, LPCWSTR, UINT, LPWSTR);
+HANDLE WINAPI FindFirstFileW(LPCWSTR, WIN32_FIND_DATAW *);
+BOOL WINAPI FindNextFileW(HANDLE, WIN32_FIND_DATAW *);
+BOOL WINAPI FindClose(HANDLE);
+DWORD WINAPI GetFullPathNameW(LPCWSTR, DWORD, LPWSTR, LPWSTR *);
+DWORD WINAPI GetPrivateProfileSectionW(LPCWSTR, LPWSTR, DWORD, LPCWSTR);
+LONG WINAPI CompareFileTime(const FILETIME *, const FILETIME *);
+void WINAPI GetSystemTimeAsFileTime(LPFILETIME);
+
+HMODULE WINAPI LoadLibraryW(LPCWSTR);
+BOOL WINAPI FreeLibrary(HMODULE);
+FARPROC WINAPI GetProcAddress(HMODULE, LPCSTR);
+BOOL WINAPI GetModuleHandleExW(DWORD, LPCWSTR, HMODULE *);
+DWORD WINAPI GetModuleFileNameW(HMODULE, LPWSTR, DWORD);
+BOOL WINAPI SetDllDirectoryW(LPCWSTR);
+HRSRC WINAPI FindResourceW(HMODULE, LPCWSTR, LPCWSTR);
+DWORD WINAPI SizeofResource(HMODULE, HRSRC);
+HGLOBAL WINAPI LoadResource(HMODULE, HRSRC);
+LPVOID WINAPI LockResource(HGLOBAL);
+HANDLE WINAPI BeginUpdateResourceW(LPCWSTR, BOOL);
+BOOL WINAPI UpdateResourceW(HANDLE, LPCWSTR, LPCWSTR, WORD, LPVOID, DWORD);
+BOOL WINAPI EndUpdateResourceW(HANDLE, BOOL);
+
+HANDLE WINAPI CreateThread(void *, SIZE_T, LPTHREAD_START_ROUTINE, LPVOID, DWORD, LPDWORD);
+HANDLE WINAPI CreateEventW(void *, BOOL, BOOL, LPCWSTR);
+BOOL WINAPI SetEvent(HANDLE);
+BOOL WINAPI ResetEvent(HANDLE);
+HANDLE WINAPI CreateSemaphoreW(void *, LONG, LONG, LPCWSTR);
+BOOL WINAPI ReleaseSemaphore(HANDLE, LONG, LONG *);
+DWORD WINAPI WaitForSingleObject(HANDLE, DWORD);
+DWORD WINAPI WaitForMultipleObjects(DWORD, const HANDLE *, BOOL, DWORD);
+void WINAPI Sleep(DWORD);
+DWORD WINAPI GetCurrentThreadId();
+DWORD WINAPI GetCurrentProcessId();
+void WINAPI GetSystemInfo(SYSTEM_INFO *);
+BOOL WINAPI IsProcessorFeaturePresent(DWORD);
+BOOL WINAPI QueryPerformanceCounter(LARGE_INTEGER *);
+BOOL WINAPI QueryPerformanceFrequency(LARGE_INTEGER *);
+
+void WINAPI InitializeSRWLock(PSRWLOCK);
+void WINAPI AcquireSRWLockExclusive(PSRWLOCK);
+void WINAPI ReleaseSRWLockExclusive(PSRWLOCK);
+void WINAPI AcquireSRWLockShared(PSRWLOCK);
+void WINAPI ReleaseSRWLockShared(PSRWLOCK);
+void WINAPI InitializeConditionVariable(PCONDITION_VARIABLE);
+BOOL WINAPI SleepConditionVariableSRW(PCONDITION_VARIABLE, PSRWLOCK, DWORD, ULONG);
+void WINAPI WakeConditionVariable(PCONDITION_VARIABLE);
+void WINAPI WakeAllConditionVariable(PCONDITION_VARIABLE);
+BOOL WINAPI InitOnceExecuteOnce(PINIT_ONCE, PINIT_ONCE_FN, PVOID, LPVOID *);
+
+// advapi32
+
+LSTATUS WINAPI RegOpenKeyExW(HKEY, LPCWSTR, DWORD, REGSAM, PHKEY);
+LSTATUS WINAPI RegCreateKeyW(HKEY, LPCWSTR, PHKEY);
+LSTATUS WINAPI RegCreateKeyExW(HKEY, LPCWSTR, DWORD, LPWSTR, DWORD, REGSAM, void *, PHKEY, LPDWORD);
+LSTATUS WINAPI RegCloseKey(HKEY);
+LSTATUS WINAPI RegQueryInfoKeyW(HKEY, LPWSTR, LPDWORD, LPDWORD, LPDWORD, LPDWORD, LPDWORD, LPDWORD, LPDWORD, LPDWORD, LPDWORD, LPFILETIME);
+LSTATUS WINAPI RegEnumKeyExW(HKEY, DWORD, LPWSTR, LPDWORD, LPDWORD, LPWSTR, LPDWORD, LPFILETIME);
+LSTATUS WINAPI RegEnumValueW(HKEY, DWORD, LPWSTR, LPDWORD, LPDWORD, LPDWORD, LPBYTE, LPDWORD);
+LSTATUS WINAPI RegQueryValueExW(HKEY, LPCWSTR, LPDWORD, LPDWORD, LPBYTE, LPDWORD);
+LSTATUS WINAPI RegSetValueExW(HKEY, LPCWSTR, DWORD, DWORD, const BYTE *, DWORD);
+LSTATUS WINAPI RegDeleteValueW(HKEY, LPCWSTR);
+LSTATUS WINAPI RegDeleteKeyW(HKEY, LPCWSTR);
+LSTATUS WINAPI RegDeleteTreeW(HKEY, LPCWSTR);
+LSTATUS WINAPI RegOverridePredefKey(HKEY, HKEY);
+LSTATUS WINAPI RegNotifyChangeKeyValue(HKEY, BOOL, DWORD, HANDLE, BOOL);
+
+BOOL WINAPI AllocateAndInitializeSid(SID_IDENTIFIER_AUTHORITY *, BYTE, DWORD, DWORD, DWORD, DWORD, DWORD, DWORD, DWORD, DWORD, PSID *);
+BOOL WINAPI CheckTokenMembership(HANDLE, PSID, BOOL *);
+PVOID WINAPI FreeSid(PSID);
+BOOL WINAPI CryptReleaseContext(HCRYPTPROV, DWORD);
+BOOL WINAPI CryptDestroyKey(HCRYPTKEY);
+BOOL WINAPI CertCloseStore(HCERTSTORE, DWORD);
+BOOL WINAPI DestroyWindow(HWND);
+
+// shlwapi
+
+LPWSTR WINAPI StrChrW(LPCWSTR, WCHAR);
+LPWSTR WINAPI StrRChrW(LPCWSTR, LPCWSTR, WCHAR);
+int WINAPI StrSpnW(LPCWSTR, LPCWSTR);
+int WINAPI StrCmpNA(LPCSTR, LPCSTR, int);
+BOOL WINAPI StrIsIntlEqualW(BOOL, LPCWSTR, LPCWSTR, int);
+BOOL WINAPI StrTrimW(LPWSTR, LPCWSTR);
+BOOL WINAPI StrToIntExW(LPCWSTR, DWORD, int *);
+int WINAPI StrToIntW(LPCWSTR);
+#define StrToInt StrToIntW
+HRESULT WINAPI SHStrDupW(LPCWSTR, LPWSTR *);
+int WINAPIV wnsprintfW(LPWSTR, int, LPCWSTR, ...);
+
+BOOL WINAPI PathMatchSpecW(LPCWSTR, LPCWSTR);
+LPWSTR WINAPI PathFindFileNameW(LPCWSTR);
+LPWSTR WINAPI PathFindNextComponentW(LPCWSTR);
+LPWSTR WINAPI PathCombineW(LPWSTR, LPCWSTR, LPCWSTR);
+LPWSTR WINAPI PathAddBackslashW(LPWSTR);
+BOOL WINAPI PathRemoveFileSpecW(LPWSTR);
+int WINAPI PathCommonPrefixW(LPCWSTR, LPCWSTR, LPWSTR);
+LPWSTR WINAPI PathGetArgsW(LPCWSTR);
+void WINAPI PathRemoveArgsW(LPWSTR);
+void WINAPI PathUnquoteSpacesW(LPWSTR);
+
+LSTATUS WINAPI SHDeleteKeyW(HKEY, LPCWSTR);
+HRESULT WINAPI SHCreateStreamOnFileEx(LPCWSTR, DWORD, DWORD, BOOL, IStream *, IStream **);
+
+// ole32 and oleaut32
+
+HRESULT WINAPI CoInitialize(LPVOID);
+void WINAPI CoUninitialize();
+HRESULT WINAPI CoCreateInstance(REFCLSID, IUnknown *, DWORD, REFIID, LPVOID *);
+LPVOID WINAPI CoTaskMemAlloc(SIZE_T);
+LPVOID WINAPI CoTaskMemRealloc(LPVOID, SIZE_T);
+void WINAPI CoTaskMemFree(LPVOID);
+HRESULT WINAPI CLSIDFromProgID(LPCOLESTR, CLSID *);
+BSTR WINAPI SysAllocString(LPCOLESTR);
+BSTR WINAPI SysAllocStringLen(LPCOLESTR, UINT);
+void WINAPI SysFreeString(BSTR);
+UINT WINAPI SysStringLen(BSTR);
+void WINAPI VariantInit(VARIANT *);
+HRESULT WINAPI VariantClear(VARIANT *);
+HRESULT WINAPI LoadTypeLib(LPCOLESTR, ITypeLib **);
+HRESULT WINAPI LoadTypeLibEx(LPCOLESTR, REGKIND, ITypeLib **);
+
+extern const IID IID_IUnknown;
+
+// Interlocked operations, which the compiler provides as intrinsics
+
+inline LONG InterlockedIncrement(LONG volatile *p) { return __sync_add_and_fetch(p, 1); }
+inline LONG InterlockedDecrement(LONG volatile *p) { return __sync_sub_and_fetch(p, 1); }
+inline LONG InterlockedExchange(LONG volatile *p, LONG v) { return __sync_lock_test_and_set(p, v); }
+inline LONG InterlockedExchangeAdd(LONG volatile *p, LONG v) { return __sync_fetch_and_add(p, v); }
+inline LONG InterlockedCompareExchange(LONG volatile *p, LONG v, LONG c) { return __sync_val_compare_and_swap(p, c, v); }
+inline PVOID InterlockedExchangePointer(PVOID volatile *p, PVOID v) { return __sync_lock_test_and_set(p, v); }
+inline PVOID InterlockedCompareExchangePointer(PVOID volatile *p, PVOID v, PVOID c) { return __sync_val_compare_and_swap(p, c, v); }
+
+}
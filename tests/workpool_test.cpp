@@ -0,0 +1,124 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Tests for the WorkPool of workpool.h
+
+#include "test.h"
+#include "../workpool.h"
+#include <vector>
+
+namespace
+{
+	struct Context
+	{
+		std::vector<LONG> runs;
+		volatile LONG consumed;
+		volatile LONG overruns;
+		UINT ahead;
+		Context(UINT count, UINT ahead): runs(count), consumed(0), overruns(0), ahead(ahead) { }
+	};
+
+	void CALLBACK Task(void *param, UINT index)
+	{
+		Context *const context = static_cast<Context *>(param);
+		// An item can start only once the consumer has let go of all but the
+		// last so many of those before it
+		if (index >= static_cast<UINT>(context->consumed) + context->ahead)
+			InterlockedIncrement(&context->overruns);
+		if (index % 7 == 0)
+			Sleep(1);
+		InterlockedIncrement(&context->runs[index]);
+	}
+
+	void Consume(WorkPool &pool, Context &context, UINT count)
+	{
+		for (UINT i = 0; i < count; ++i)
+		{
+			pool.wait(i);
+			CHECK_EQ(context.runs[i], 1);
+			InterlockedIncrement(&context.consumed);
+			pool.release();
+		}
+	}
+}
+
+TEST(RunsEachItemOnceAndInOrder)
+{
+	static const UINT threads[] = { 1, 2, 4, 16 };
+	static const UINT ahead[] = { 1, 3, 64 };
+	for (size_t t = 0; t < _countof(threads); ++t)
+	{
+		for (size_t a = 0; a < _countof(ahead); ++a)
+		{
+			Context context(200, ahead[a]);
+			WorkPool pool;
+			CHECK_EQ(pool.start(Task, &context, 200, threads[t], ahead[a]), S_OK);
+			Consume(pool, context, 200);
+			pool.stop();
+			for (UINT i = 0; i < 200; ++i)
+				CHECK_EQ(context.runs[i], 1);
+			CHECK_EQ(context.overruns, 0);
+		}
+	}
+}
+
+TEST(StartsNothingForNoItems)
+{
+	Context context(1, 1);
+	WorkPool pool;
+	CHECK_EQ(pool.start(Task, &context, 0, 4, 4), S_FALSE);
+	pool.stop();
+	CHECK_EQ(context.runs[0], 0);
+}
+
+TEST(StopsBeforeAllItemsAreConsumed)
+{
+	Context context(1000, 8);
+	WorkPool pool;
+	CHECK_EQ(pool.start(Task, &context, 1000, 4, 8), S_OK);
+	Consume(pool, context, 10);
+	pool.stop();
+	// The workers may have run ahead of the consumer, but only so far
+	LONG total = 0;
+	for (UINT i = 0; i < 1000; ++i)
+	{
+		CHECK(context.runs[i] <= 1);
+		total += context.runs[i];
+	}
+	CHECK(total >= 10 && total <= 10 + 8);
+	CHECK_EQ(context.overruns, 0);
+}
+
+TEST(CanBeStartedAgain)
+{
+	WorkPool pool;
+	for (int round = 0; round < 5; ++round)
+	{
+		Context context(50, 4);
+		CHECK_EQ(pool.start(Task, &context, 50, 3, 4), S_OK);
+		Consume(pool, context, 50);
+		pool.stop();
+	}
+	CHECK(WorkPool::getProcessorCount() >= 1);
+}
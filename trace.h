@@ -0,0 +1,222 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Times what happens to each file, phase by phase, and writes the results to
+// a file in the Chrome trace event format, for chrome://tracing or Perfetto
+// to visualize. Along the way, it sums up the time per phase and keeps track
+// of the slowest files, for a summary to conclude the run with. Unless a file
+// has been opened, timing boils down to checking a flag.
+class Trace
+{
+public:
+	enum Phase
+	{
+		File,		// everything that happens to a file on the main thread
+		Scripts,	// loading its REGISTRY scripts on a worker thread
+		Reg,		// importing a .REG file
+		Rgs,		// running its REGISTRY scripts against the hive
+		Replay,		// replaying cached registration results
+		Load,		// LoadLibraryW
+		Register,	// DllRegisterServer
+		Unload,		// FreeLibrary
+		Capture,	// picking up from the sandbox what has been written to it
+		Export,		// adding the file to the manifest
+		Manifest,	// patching the manifest into the target
+		Script,		// writing the RGS file
+		PhaseCount
+	};
+
+	// Times a scope from construction to destruction
+	class Scope
+	{
+	public:
+		Scope(Trace &trace, Phase phase, LPCWSTR name)
+			: trace(trace), phase(phase), name(name), since(trace.now()) { }
+		~Scope() { trace.record(phase, name, since); }
+	private:
+		Scope(const Scope &);
+		void operator=(const Scope &);
+		Trace &trace;
+		const Phase phase;
+		const LPCWSTR name;
+		const LONGLONG since;
+	};
+
+	Trace(): frequency(0), pid(0), nEvents(0), nSlowest(0)
+	{
+		InitializeSRWLock(&lock);
+		origin.QuadPart = 0;
+		SecureZeroMemory(totals, sizeof totals);
+	}
+	~Trace() { close(); }
+
+	bool active() const { return frequency != 0; }
+
+	HRESULT open(LPCWSTR path)
+	{
+		close();
+		LARGE_INTEGER li;
+		// Ticks are converted to microseconds using 32-bit divisors only
+		if (!QueryPerformanceFrequency(&li) || li.HighPart != 0 || li.LowPart == 0)
+			return E_NOTIMPL;
+		out.setTabWidth(0);
+		out.setCodePage(CP_UTF8);
+		HRESULT hr = SHCreateStreamOnFileEx(path,
+			STGM_CREATE | STGM_WRITE | STGM_SHARE_DENY_WRITE,
+			FILE_ATTRIBUTE_NORMAL, FALSE, NULL, &out);
+		if (SUCCEEDED(hr) && SUCCEEDED(hr = out.write("{\"traceEvents\":[\r\n")))
+		{
+			frequency = li.LowPart;
+			pid = GetCurrentProcessId();
+			QueryPerformanceCounter(&origin);
+		}
+		return hr;
+	}
+
+	LONGLONG now() const
+	{
+		LARGE_INTEGER li;
+		li.QuadPart = 0;
+		if (active())
+			QueryPerformanceCounter(&li);
+		return li.QuadPart;
+	}
+
+	// Records a complete event which has lasted from the given time till now.
+	// The name is supposed to be a file name, so it needs no JSON escaping.
+	void record(Phase phase, LPCWSTR name, LONGLONG since)
+	{
+		if (!active() || since < origin.QuadPart)
+			return;
+		LARGE_INTEGER until;
+		QueryPerformanceCounter(&until);
+		const ULONGLONG ts = micros(since - origin.QuadPart);
+		const ULONGLONG dur = micros(until.QuadPart - since);
+		const DWORD tid = GetCurrentThreadId();
+		AcquireSRWLockExclusive(&lock);
+		out.write(&",\r\n{\"name\":\""[nEvents++ == 0 ? 3 : 0], name, "\",\"cat\":\"", getName(phase),
+			"\",\"ph\":\"X\",\"ts\":", ts, ",\"dur\":", dur);
+		out.write(",\"pid\":", pid, ",\"tid\":", tid, "}");
+		totals[phase].count += 1;
+		totals[phase].micros += dur;
+		if (phase == File)
+			rank(name, dur);
+		ReleaseSRWLockExclusive(&lock);
+	}
+
+	// Writes the time per phase and the slowest files
+	void summarize(Writer &writer) const
+	{
+		writer.write("\r\nTime per phase:\r\n");
+		for (int phase = 0; phase < PhaseCount; ++phase)
+		{
+			if (totals[phase].count != 0)
+			{
+				const DWORD count = totals[phase].count;
+				writer.write("\t", getName(static_cast<Phase>(phase)), ": ", millis(totals[phase].micros), " ms in ",
+					count, count == 1 ? " event\r\n" : " events\r\n");
+			}
+		}
+		writer.write("\r\nSlowest files:\r\n");
+		for (UINT i = 0; i < nSlowest; ++i)
+			writer.write("\t", millis(slowMicros[i]), " ms ", slowNames[i], "\r\n");
+	}
+
+	HRESULT close()
+	{
+		if (!active())
+			return S_FALSE;
+		frequency = 0;
+		HRESULT hr = out.write("\r\n]}\r\n");
+		HRESULT hrClose = out.close();
+		return FAILED(hr) ? hr : hrClose;
+	}
+
+private:
+	Trace(const Trace &);
+	void operator=(const Trace &);
+
+	static const UINT SlowestCount = 10;
+
+	struct Total
+	{
+		UINT count;
+		ULONGLONG micros;
+	};
+
+	ULONGLONG micros(LONGLONG ticks) const
+	{
+		DWORD rem;
+		const ULONGLONG seconds = DivMod64(ticks, frequency, &rem);
+		const ULONGLONG fraction = DivMod64(UInt32x32To64(rem, 1000000), frequency, &rem);
+		return UInt32x32To64(seconds, 1000000) + fraction;
+	}
+
+	static ULONGLONG millis(ULONGLONG micros)
+	{
+		DWORD rem;
+		return DivMod64(micros, 1000, &rem);
+	}
+
+	// Keeps the slowest files sorted by descending duration
+	void rank(LPCWSTR name, ULONGLONG dur)
+	{
+		UINT i = nSlowest < SlowestCount ? nSlowest++ : SlowestCount;
+		while (i != 0 && slowMicros[i - 1] < dur)
+		{
+			if (i < SlowestCount)
+			{
+				slowMicros[i] = slowMicros[i - 1];
+				lstrcpyW(slowNames[i], slowNames[i - 1]);
+			}
+			--i;
+		}
+		if (i < SlowestCount)
+		{
+			slowMicros[i] = dur;
+			lstrcpynW(slowNames[i], name, _countof(slowNames[i]));
+		}
+	}
+
+	static LPCSTR getName(Phase phase)
+	{
+		static const char *const names[PhaseCount] =
+		{
+			"file", "scripts", "reg", "rgs", "replay", "load",
+			"register", "unload", "capture", "export", "manifest", "script"
+		};
+		return names[phase];
+	}
+
+	Writer out;
+	SRWLOCK lock;
+	LARGE_INTEGER origin;
+	DWORD frequency;
+	DWORD pid;
+	UINT nEvents;
+	UINT nSlowest;
+	Total totals[PhaseCount];
+	ULONGLONG slowMicros[SlowestCount];
+	WCHAR slowNames[SlowestCount][MAX_PATH];
+};
@@ -0,0 +1,240 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Reads type libraries in MSFT format, as generated by MIDL and CreateTypeLib2,
+// straight from their bytes, e.g. a TYPELIB resource in a mapped PE image.
+// Type libraries in the older SLTG format are not supported, so open() gives
+// S_FALSE for them, in which case the caller needs to resort to LoadTypeLib.
+class TypeLib
+{
+public:
+	TypeLib(): base(NULL), size(0), header(NULL), segments(NULL), nTypeInfos(0) { }
+
+	HRESULT open(const BYTE *p, DWORD cb)
+	{
+		base = p;
+		size = cb;
+		header = NULL;
+		segments = NULL;
+		nTypeInfos = 0;
+		const Header *const h = view<Header>(0);
+		if (h == NULL)
+			return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		if (h->magic1 == MagicSLTG)
+			return S_FALSE;
+		if (h->magic1 != MagicMSFT || h->nrtypeinfos < 0)
+			return TYPE_E_INVDATAREAD;
+		// The typeinfo offsets, preceded by the offset of the help string DLL if
+		// there is one, sit between the header and the segment directory
+		const DWORD offset = sizeof(Header) + ((h->varflags & HelpDllFlag) ? 4 : 0);
+		if (view<DWORD>(offset, h->nrtypeinfos) == NULL)
+			return TYPE_E_INVDATAREAD;
+		segments = view<Segment>(offset + h->nrtypeinfos * sizeof(DWORD), SegmentCount);
+		if (segments == NULL)
+			return TYPE_E_INVDATAREAD;
+		header = h;
+		const DWORD length = segments[TypeInfoTab].length;
+		nTypeInfos = static_cast<DWORD>(h->nrtypeinfos) < length / sizeof(TypeInfo) ?
+			h->nrtypeinfos : length / sizeof(TypeInfo);
+		return S_OK;
+	}
+
+	const GUID *getGuid() const { return header ? getGuid(header->posguid) : NULL; }
+	LCID getLcid() const { return header ? header->lcid : 0; }
+	SYSKIND getSysKind() const { return header ? static_cast<SYSKIND>(header->varflags & 0xF) : SYS_WIN32; }
+	WORD getMajorVersion() const { return header ? LOWORD(header->version) : 0; }
+	WORD getMinorVersion() const { return header ? HIWORD(header->version) : 0; }
+	WORD getFlags() const { return header ? LOWORD(header->flags) : 0; }
+	int getName(LPWSTR name, int cch) const { return getName(header ? header->NameOffset : -1, name, cch); }
+
+	UINT getTypeInfoCount() const { return nTypeInfos; }
+
+	TYPEKIND getTypeKind(UINT i) const
+	{
+		const TypeInfo *const info = getTypeInfo(i);
+		return info ? static_cast<TYPEKIND>(info->typekind & 0xF) : TKIND_MAX;
+	}
+
+	WORD getTypeFlags(UINT i) const
+	{
+		const TypeInfo *const info = getTypeInfo(i);
+		return info ? LOWORD(info->flags) : 0;
+	}
+
+	const GUID *getTypeGuid(UINT i) const
+	{
+		const TypeInfo *const info = getTypeInfo(i);
+		return info ? getGuid(info->posguid) : NULL;
+	}
+
+	int getTypeName(UINT i, LPWSTR name, int cch) const
+	{
+		const TypeInfo *const info = getTypeInfo(i);
+		return getName(info ? info->NameOffset : -1, name, cch);
+	}
+
+private:
+	// Layout as documented by the Wine project
+	enum { MagicMSFT = 0x5446534D, MagicSLTG = 0x47544C53, HelpDllFlag = 0x100 };
+
+	struct Header
+	{
+		DWORD magic1;
+		DWORD magic2;
+		int posguid;
+		LCID lcid;
+		LCID lcid2;
+		DWORD varflags;
+		DWORD version;
+		DWORD flags;
+		int nrtypeinfos;
+		int helpstring;
+		int helpstringcontext;
+		int helpcontext;
+		int nametablecount;
+		int nametablechars;
+		int NameOffset;
+		int helpfile;
+		int CustomDataOffset;
+		int res44;
+		int res48;
+		int dispatchpos;
+		int nimpinfos;
+	};
+
+	struct Segment
+	{
+		DWORD offset;
+		DWORD length;
+		DWORD res08;
+		DWORD res0c;
+	};
+
+	enum
+	{
+		TypeInfoTab, ImpInfo, ImpFiles, RefTab, GuidHashTab, GuidTab, NameHashTab,
+		NameTab, StringTab, TypdescTab, ArrayDescriptions, CustData, CDGuids,
+		res0e, res0f, SegmentCount
+	};
+
+	struct TypeInfo
+	{
+		DWORD typekind; // low nibble is the TYPEKIND, the rest is alignment
+		int memoffset;
+		int res2;
+		int res3;
+		int res4;
+		int res5;
+		DWORD cElement;
+		int res7;
+		int res8;
+		int res9;
+		int resA;
+		int posguid;
+		DWORD flags;
+		int NameOffset;
+		DWORD version;
+		int docstringoffs;
+		int helpstringcontext;
+		int helpcontext;
+		int oCustData;
+		WORD cImplTypes;
+		WORD cbSizeVft;
+		int size;
+		int datatype1;
+		int datatype2;
+		int res18;
+		int res19;
+	};
+
+	struct GuidEntry
+	{
+		GUID guid;
+		int hreftype;
+		int next_hash;
+	};
+
+	struct NameIntro
+	{
+		int hreftype;
+		int next_hash;
+		DWORD namelen; // low byte is the length, followed by as many chars
+	};
+
+	C_ASSERT(sizeof(Header) == 0x54 && sizeof(TypeInfo) == 0x64);
+
+	TypeLib(const TypeLib &);
+	void operator=(const TypeLib &);
+
+	template<class T>
+	const T *view(DWORD offset, DWORD count = 1) const
+	{
+		if (offset > size || (size - offset) / sizeof(T) < count)
+			return NULL;
+		return reinterpret_cast<const T *>(base + offset);
+	}
+
+	// Resolves an offset into a segment, or returns NULL if out of bounds
+	template<class T>
+	const T *at(UINT segment, int offset, DWORD count = 1) const
+	{
+		if (segments == NULL || offset < 0)
+			return NULL;
+		const Segment &seg = segments[segment];
+		if (static_cast<DWORD>(offset) > seg.length || (seg.length - offset) / sizeof(T) < count)
+			return NULL;
+		return view<T>(seg.offset + offset, count);
+	}
+
+	const TypeInfo *getTypeInfo(UINT i) const
+	{
+		return i < nTypeInfos ? at<TypeInfo>(TypeInfoTab, i * sizeof(TypeInfo)) : NULL;
+	}
+
+	const GUID *getGuid(int offset) const
+	{
+		const GuidEntry *const entry = at<GuidEntry>(GuidTab, offset);
+		return entry ? &entry->guid : NULL;
+	}
+
+	// Names are stored as ANSI, and are converted on the way out
+	int getName(int offset, LPWSTR name, int cch) const
+	{
+		int len = 0;
+		if (const NameIntro *const intro = at<NameIntro>(NameTab, offset))
+		{
+			const int cb = intro->namelen & 0xFF;
+			if (const char *const p = at<char>(NameTab, offset + sizeof(NameIntro), cb))
+				len = MultiByteToWideChar(CP_ACP, 0, p, cb, name, cch - 1);
+		}
+		name[len] = L'\0';
+		return len;
+	}
+
+	const BYTE *base;
+	DWORD size;
+	const Header *header;
+	const Segment *segments;
+	UINT nTypeInfos;
+};
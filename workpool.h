@@ -0,0 +1,155 @@
+/*
+[The MIT license]
+
+Copyright (c) 2026 Jochen Neubeck
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Runs a task over a sequence of items on a number of worker threads, while
+// the caller consumes the results in order. Items are handed out through an
+// atomic counter, so idle workers keep picking up whatever comes next, and a
+// semaphore limits how far the workers may get ahead of the consumer.
+class WorkPool
+{
+public:
+	typedef void (CALLBACK *Task)(void *context, UINT index);
+
+	WorkPool(): task(NULL), context(NULL), count(0), next(0), done(NULL), window(NULL), nThreads(0)
+	{
+		InitializeSRWLock(&lock);
+		InitializeConditionVariable(&ready);
+	}
+
+	~WorkPool() { stop(); }
+
+	HRESULT start(Task task, void *context, UINT count, UINT threads, UINT ahead)
+	{
+		stop();
+		if (threads > count)
+			threads = count;
+		if (threads > _countof(handles))
+			threads = _countof(handles);
+		if (threads == 0)
+			return S_FALSE;
+		this->task = task;
+		this->context = context;
+		this->count = count;
+		next = 0;
+		if ((done = static_cast<BYTE *>(HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, count))) == NULL)
+			return E_OUTOFMEMORY;
+		if ((window = CreateSemaphoreW(NULL, ahead, ahead, NULL)) == NULL)
+			return lastError();
+		while (nThreads < threads)
+		{
+			if ((handles[nThreads] = CreateThread(NULL, 0, ThreadProc, this, 0, NULL)) == NULL)
+				break;
+			++nThreads;
+		}
+		return nThreads != 0 ? S_OK : lastError();
+	}
+
+	// Blocks until the task is done with the given item
+	void wait(UINT index)
+	{
+		AcquireSRWLockExclusive(&lock);
+		while (done[index] == 0)
+			SleepConditionVariableSRW(&ready, &lock, INFINITE, 0);
+		ReleaseSRWLockExclusive(&lock);
+	}
+
+	// Lets the workers move on to one more item
+	void release()
+	{
+		ReleaseSemaphore(window, 1, NULL);
+	}
+
+	void stop()
+	{
+		if (nThreads != 0)
+		{
+			// Have the workers drain out without picking up anything new. One
+			// slot is enough, as every worker passes it on when leaving.
+			InterlockedExchange(&next, static_cast<LONG>(count));
+			ReleaseSemaphore(window, 1, NULL);
+			WaitForMultipleObjects(nThreads, handles, TRUE, INFINITE);
+			do CloseHandle(handles[--nThreads]); while (nThreads != 0);
+		}
+		if (window != NULL)
+		{
+			CloseHandle(window);
+			window = NULL;
+		}
+		if (done != NULL)
+		{
+			HeapFree(GetProcessHeap(), 0, done);
+			done = NULL;
+		}
+	}
+
+	static UINT getProcessorCount()
+	{
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		return si.dwNumberOfProcessors;
+	}
+
+private:
+	WorkPool(const WorkPool &);
+	void operator=(const WorkPool &);
+
+	static HRESULT lastError()
+	{
+		DWORD dw = GetLastError();
+		return dw ? HRESULT_FROM_WIN32(dw) : E_UNEXPECTED;
+	}
+
+	static DWORD WINAPI ThreadProc(LPVOID param)
+	{
+		WorkPool *const pool = static_cast<WorkPool *>(param);
+		for (;;)
+		{
+			WaitForSingleObject(pool->window, INFINITE);
+			const UINT index = static_cast<UINT>(InterlockedIncrement(&pool->next) - 1);
+			if (index >= pool->count)
+			{
+				// Pass on the slot so other workers get to see the end as well
+				ReleaseSemaphore(pool->window, 1, NULL);
+				break;
+			}
+			pool->task(pool->context, index);
+			AcquireSRWLockExclusive(&pool->lock);
+			pool->done[index] = 1;
+			ReleaseSRWLockExclusive(&pool->lock);
+			WakeAllConditionVariable(&pool->ready);
+		}
+		return 0;
+	}
+
+	Task task;
+	void *context;
+	UINT count;
+	volatile LONG next;
+	BYTE *done;
+	HANDLE window;
+	SRWLOCK lock;
+	CONDITION_VARIABLE ready;
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+	UINT nThreads;
+};
@@ -22,68 +22,323 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+// Hexadecimal number, zero-padded to a given count of digits
+struct Hex
+{
+	Hex(DWORD value, int digits): value(value), digits(digits) { }
+	DWORD value;
+	int digits;
+};
+
+// Bytes written as a contiguous run of hex digits
+struct HexBytes
+{
+	HexBytes(const BYTE *data, DWORD cb): data(data), cb(cb) { }
+	const BYTE *data;
+	DWORD cb;
+};
+
+// Collects output in chunks of memory. Without a stream attached, the chunks
+// pile up until the caller gathers them. With a stream attached, a chunk is
+// flushed to it whenever it runs full. Output is pieced together from string
+// literals and typed arguments, so the compiler gets to pick the conversion of
+// each argument, and there is no format string to parse at runtime.
 class Writer
 {
 public:
-	Writer(): pstm(NULL), tabwidth(0) { }
+	Writer(): pstm(NULL), chunks(NULL), nChunks(0), cbRoom(0), tabwidth(0), codepage(CP_ACP)
+	{
+		flushed.QuadPart = 0;
+	}
 	~Writer() { close(); }
 
 	operator IStream *() { return pstm; }
-	IStream **operator&() { return &pstm; }
+	IStream **operator&() { close(); return &pstm; }
 
 	void setTabWidth(int n) { tabwidth = n; }
+	void setCodePage(UINT cp) { codepage = cp; }
 
-	template<class FORMAT>
-	HRESULT write(FORMAT *format, ...)
+	// Starts collecting output in memory
+	HRESULT open(DWORD cb = ChunkSize)
+	{
+		close();
+		return append(cb);
+	}
+
+	// Writes a string literal, followed by arguments of supported types
+	template<class A>
+	HRESULT write(LPCSTR s, const A &a)
+	{
+		HRESULT hr = write(s);
+		return SUCCEEDED(hr) ? put(a) : hr;
+	}
+	template<class A, class B>
+	HRESULT write(LPCSTR s, const A &a, const B &b)
+	{
+		HRESULT hr = write(s, a);
+		return SUCCEEDED(hr) ? put(b) : hr;
+	}
+	template<class A, class B, class C>
+	HRESULT write(LPCSTR s, const A &a, const B &b, const C &c)
+	{
+		HRESULT hr = write(s, a, b);
+		return SUCCEEDED(hr) ? put(c) : hr;
+	}
+	template<class A, class B, class C, class D>
+	HRESULT write(LPCSTR s, const A &a, const B &b, const C &c, const D &d)
+	{
+		HRESULT hr = write(s, a, b, c);
+		return SUCCEEDED(hr) ? put(d) : hr;
+	}
+	template<class A, class B, class C, class D, class E>
+	HRESULT write(LPCSTR s, const A &a, const B &b, const C &c, const D &d, const E &e)
 	{
-		format = indent(format);
-		char buffer[1024];
-		DWORD cb = wvsprintfA(buffer, format, va_list(&format + 1));
-		return write(cb, buffer);
+		HRESULT hr = write(s, a, b, c, d);
+		return SUCCEEDED(hr) ? put(e) : hr;
+	}
+	template<class A, class B, class C, class D, class E, class F>
+	HRESULT write(LPCSTR s, const A &a, const B &b, const C &c, const D &d, const E &e, const F &f)
+	{
+		HRESULT hr = write(s, a, b, c, d, e);
+		return SUCCEEDED(hr) ? put(f) : hr;
+	}
+	template<class A, class B, class C, class D, class E, class F, class G>
+	HRESULT write(LPCSTR s, const A &a, const B &b, const C &c, const D &d, const E &e, const F &f, const G &g)
+	{
+		HRESULT hr = write(s, a, b, c, d, e, f);
+		return SUCCEEDED(hr) ? put(g) : hr;
 	}
 	HRESULT write(LPCSTR buffer)
 	{
-		buffer = indent(buffer);
-		DWORD cb = lstrlenA(buffer);
-		return write(cb, buffer);
+		HRESULT hr = indent(buffer);
+		if (SUCCEEDED(hr))
+			hr = write(lstrlenA(buffer), buffer);
+		return hr;
+	}
+	// Writes a line which comes with its length, and expands its indentation
+	// the same way as for a null-terminated string
+	HRESULT writeLine(DWORD cb, LPCSTR line)
+	{
+		LPCSTR p = line;
+		while (p < line + cb && *p == '\t')
+			++p;
+		LPCSTR q = line;
+		HRESULT hr = p < line + cb ? indent(q) : S_OK;
+		if (SUCCEEDED(hr))
+			hr = write(cb - static_cast<DWORD>(q - line), q);
+		return hr;
 	}
 	HRESULT write(DWORD cb, LPCSTR buffer)
 	{
-		if (pstm == NULL)
-			return E_POINTER;
-		return pstm->Write(buffer, cb, NULL);
+		HRESULT hr = S_OK;
+		while (cb != 0 && SUCCEEDED(hr = reserve(1)))
+		{
+			Chunk &chunk = chunks[nChunks - 1];
+			DWORD n = cbRoom - chunk.cb;
+			if (n > cb)
+				n = cb;
+			MemCopy(const_cast<BYTE *>(chunk.data) + chunk.cb, reinterpret_cast<const BYTE *>(buffer), n);
+			chunk.cb += n;
+			buffer += n;
+			cb -= n;
+		}
+		return hr;
 	}
 	HRESULT tell(ULARGE_INTEGER *out)
 	{
-		if (pstm == NULL)
+		if (pstm == NULL && nChunks == 0)
 			return E_POINTER;
-		LARGE_INTEGER in = { 0, 0 };
-		return pstm->Seek(in, STREAM_SEEK_CUR, out);
+		out->QuadPart = flushed.QuadPart;
+		for (UINT i = 0; i < nChunks; ++i)
+			out->QuadPart += chunks[i].cb;
+		return S_OK;
+	}
+	// Hands out the output collected so far, without copying it
+	const Chunk *gather(UINT *n) const
+	{
+		*n = nChunks;
+		return chunks;
 	}
 	HRESULT close()
 	{
-		if (pstm == NULL)
+		if (pstm == NULL && nChunks == 0)
 			return E_POINTER;
-		pstm->Release();
-		pstm = NULL;
-		return S_OK;
+		HRESULT hr = flush();
+		while (nChunks != 0)
+			HeapFree(GetProcessHeap(), 0, const_cast<BYTE *>(chunks[--nChunks].data));
+		if (chunks != NULL)
+		{
+			HeapFree(GetProcessHeap(), 0, chunks);
+			chunks = NULL;
+		}
+		cbRoom = 0;
+		flushed.QuadPart = 0;
+		if (pstm != NULL)
+		{
+			pstm->Release();
+			pstm = NULL;
+		}
+		return hr;
 	}
 
 private:
-	LPCSTR indent(LPCSTR format)
+	Writer(const Writer &);
+	void operator=(const Writer &);
+
+	static const DWORD ChunkSize = 0x10000;
+
+	HRESULT flush()
+	{
+		if (pstm == NULL || nChunks == 0)
+			return S_OK;
+		Chunk &chunk = chunks[nChunks - 1];
+		HRESULT hr = chunk.cb != 0 ? pstm->Write(chunk.data, chunk.cb, NULL) : S_OK;
+		flushed.QuadPart += chunk.cb;
+		chunk.cb = 0;
+		return hr;
+	}
+
+	// Makes sure the last chunk has room for more than cb bytes. With a stream
+	// attached, there is only ever one chunk, which is flushed to make room.
+	HRESULT reserve(DWORD cb)
+	{
+		if (pstm == NULL && nChunks == 0)
+			return E_POINTER;
+		if (nChunks != 0 && cbRoom - chunks[nChunks - 1].cb > cb)
+			return S_OK;
+		if (pstm != NULL && nChunks != 0)
+		{
+			HRESULT hr = flush();
+			if (FAILED(hr) || cbRoom > cb)
+				return hr;
+			HeapFree(GetProcessHeap(), 0, const_cast<BYTE *>(chunks[--nChunks].data));
+		}
+		DWORD cbAlloc = ChunkSize;
+		while (cbAlloc <= cb)
+			cbAlloc *= 2;
+		return append(cbAlloc);
+	}
+
+	HRESULT append(DWORD cb)
+	{
+		// Grow the array whenever the count reaches a power of two
+		if ((nChunks & (nChunks - 1)) == 0)
+		{
+			const SIZE_T cbArray = (nChunks ? nChunks * 2 : 1) * sizeof *chunks;
+			void *const p = chunks != NULL ? HeapReAlloc(GetProcessHeap(), 0, chunks, cbArray) : HeapAlloc(GetProcessHeap(), 0, cbArray);
+			if (p == NULL)
+				return E_OUTOFMEMORY;
+			chunks = static_cast<Chunk *>(p);
+		}
+		if ((chunks[nChunks].data = static_cast<BYTE *>(HeapAlloc(GetProcessHeap(), 0, cb))) == NULL)
+			return E_OUTOFMEMORY;
+		chunks[nChunks++].cb = 0;
+		cbRoom = cb;
+		return S_OK;
+	}
+
+	HRESULT put(LPCSTR s)
+	{
+		return write(lstrlenA(s), s);
+	}
+	HRESULT put(LPCWSTR s)
+	{
+		const int len = lstrlenW(s);
+		// Prepare for the worst case of three bytes per UTF-16 code unit
+		HRESULT hr = reserve(3 * len);
+		if (SUCCEEDED(hr))
+		{
+			Chunk &chunk = chunks[nChunks - 1];
+			LPSTR const p = reinterpret_cast<LPSTR>(const_cast<BYTE *>(chunk.data)) + chunk.cb;
+			int i = 0;
+			// Plain ASCII needs no conversion
+			while (i < len && s[i] < 0x80)
+			{
+				p[i] = static_cast<char>(s[i]);
+				++i;
+			}
+			if (i < len)
+			{
+				const int cb = WideCharToMultiByte(codepage, 0, s + i, len - i, p + i, 3 * (len - i), NULL, NULL);
+				if (cb == 0)
+					hr = HRESULT_FROM_WIN32(GetLastError());
+				i += cb;
+			}
+			chunk.cb += i;
+		}
+		return hr;
+	}
+	HRESULT put(DWORD value)
+	{
+		char buffer[10];
+		int i = sizeof buffer;
+		do buffer[--i] = static_cast<char>('0' + value % 10); while ((value /= 10) != 0);
+		return write(sizeof buffer - i, buffer + i);
+	}
+	HRESULT put(ULONGLONG value)
+	{
+		if (value <= MAXDWORD)
+			return put(static_cast<DWORD>(value));
+		char buffer[20];
+		int i = sizeof buffer;
+		do
+		{
+			DWORD digit;
+			value = DivMod64(value, 10, &digit);
+			buffer[--i] = static_cast<char>('0' + digit);
+		} while (value != 0);
+		return write(sizeof buffer - i, buffer + i);
+	}
+	HRESULT put(const Hex &hex)
+	{
+		static const char digits[] = "0123456789ABCDEF";
+		char buffer[8];
+		int i = sizeof buffer;
+		DWORD value = hex.value;
+		do buffer[--i] = digits[value & 0xF]; while ((value >>= 4) != 0);
+		while (i > 0 && static_cast<int>(sizeof buffer) - i < hex.digits)
+			buffer[--i] = '0';
+		return write(sizeof buffer - i, buffer + i);
+	}
+	HRESULT put(const HexBytes &hex)
+	{
+		HRESULT hr = S_OK;
+		const BYTE *p = hex.data;
+		DWORD cb = hex.cb;
+		while (cb != 0 && SUCCEEDED(hr = reserve(1)))
+		{
+			Chunk &chunk = chunks[nChunks - 1];
+			DWORD n = (cbRoom - chunk.cb) / 2;
+			if (n > cb)
+				n = cb;
+			HexEncode(p, n, reinterpret_cast<LPSTR>(const_cast<BYTE *>(chunk.data)) + chunk.cb);
+			chunk.cb += 2 * n;
+			p += n;
+			cb -= n;
+		}
+		return hr;
+	}
+
+	HRESULT indent(LPCSTR &format)
 	{
 		static const char buffer[8] = { ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ' };
+		HRESULT hr = reserve(0);
 		if (int cb = tabwidth < 8 ? tabwidth : 8)
 		{
-			while (*format == '\t')
+			while (SUCCEEDED(hr) && *format == '\t')
 			{
-				write(cb, buffer);
+				hr = write(cb, buffer);
 				++format;
 			}
 		}
-		return format;
+		return hr;
 	}
 
 	IStream *pstm;
+	Chunk *chunks;
+	UINT nChunks;
+	DWORD cbRoom; // capacity of the last chunk
+	ULARGE_INTEGER flushed;
 	int tabwidth;
+	UINT codepage; // for arguments of type LPCWSTR
 };
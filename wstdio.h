@@ -22,25 +22,75 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
-template<DWORD STD_HANDLE, class FORMAT>
-void WriteTo(FORMAT *format, ...)
+// Collects output, and passes it on to a standard handle on destruction
+template<DWORD STD_HANDLE>
+class StdWriter : public Writer
 {
-	C_ASSERT(STD_HANDLE == STD_OUTPUT_HANDLE || STD_HANDLE == STD_ERROR_HANDLE);
-	if (HANDLE handle = GetStdHandle(STD_HANDLE))
+public:
+	StdWriter()
 	{
-		CHAR buffer[1024];
-		DWORD cb = wvsprintfA(buffer, format, va_list(&format + 1));
-		WriteFile(handle, buffer, cb, &cb, 0);
+		C_ASSERT(STD_HANDLE == STD_OUTPUT_HANDLE || STD_HANDLE == STD_ERROR_HANDLE);
+		open(0x400);
 	}
-}
+	~StdWriter()
+	{
+		if (HANDLE handle = GetStdHandle(STD_HANDLE))
+		{
+			UINT n;
+			const Chunk *const chunks = gather(&n);
+			for (UINT i = 0; i < n; ++i)
+			{
+				DWORD cb = chunks[i].cb;
+				WriteFile(handle, chunks[i].data, cb, &cb, 0);
+			}
+		}
+	}
+};
 
 template<DWORD STD_HANDLE>
-void WriteTo(LPCSTR buffer)
+void WriteTo(LPCSTR s)
 {
-	C_ASSERT(STD_HANDLE == STD_OUTPUT_HANDLE || STD_HANDLE == STD_ERROR_HANDLE);
-	if (HANDLE handle = GetStdHandle(STD_HANDLE))
-	{
-		DWORD cb = lstrlenA(buffer);
-		WriteFile(handle, buffer, cb, &cb, 0);
-	}
+	StdWriter<STD_HANDLE>().write(s);
+}
+
+template<DWORD STD_HANDLE, class A>
+void WriteTo(LPCSTR s, const A &a)
+{
+	StdWriter<STD_HANDLE>().write(s, a);
+}
+
+template<DWORD STD_HANDLE, class A, class B>
+void WriteTo(LPCSTR s, const A &a, const B &b)
+{
+	StdWriter<STD_HANDLE>().write(s, a, b);
+}
+
+template<DWORD STD_HANDLE, class A, class B, class C>
+void WriteTo(LPCSTR s, const A &a, const B &b, const C &c)
+{
+	StdWriter<STD_HANDLE>().write(s, a, b, c);
+}
+
+template<DWORD STD_HANDLE, class A, class B, class C, class D>
+void WriteTo(LPCSTR s, const A &a, const B &b, const C &c, const D &d)
+{
+	StdWriter<STD_HANDLE>().write(s, a, b, c, d);
+}
+
+template<DWORD STD_HANDLE, class A, class B, class C, class D, class E>
+void WriteTo(LPCSTR s, const A &a, const B &b, const C &c, const D &d, const E &e)
+{
+	StdWriter<STD_HANDLE>().write(s, a, b, c, d, e);
+}
+
+template<DWORD STD_HANDLE, class A, class B, class C, class D, class E, class F>
+void WriteTo(LPCSTR s, const A &a, const B &b, const C &c, const D &d, const E &e, const F &f)
+{
+	StdWriter<STD_HANDLE>().write(s, a, b, c, d, e, f);
+}
+
+template<DWORD STD_HANDLE, class A, class B, class C, class D, class E, class F, class G>
+void WriteTo(LPCSTR s, const A &a, const B &b, const C &c, const D &d, const E &e, const F &f, const G &g)
+{
+	StdWriter<STD_HANDLE>().write(s, a, b, c, d, e, f, g);
 }